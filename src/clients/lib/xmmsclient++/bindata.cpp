@@ -63,6 +63,14 @@ namespace Xmms
 		return StringListResult( res, ml_ );
 	}
 
+	DictResult Bindata::cacheStats() const
+	{
+		xmmsc_result_t* res =
+		    call( connected_,
+		          boost::bind( xmmsc_bindata_cache_stats, conn_ ) );
+		return DictResult( res, ml_ );
+	}
+
 	Bindata::Bindata( xmmsc_connection_t*& conn, bool& connected,
 	                  MainloopInterface*& ml ) :
 		conn_( conn ), connected_( connected ), ml_( ml )
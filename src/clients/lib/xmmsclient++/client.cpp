@@ -46,17 +46,15 @@ namespace Xmms
 		  xform(      conn_, connected_, mainloop_ ),
 		  collection( conn_, connected_, mainloop_ ),
 		  name_( name ), conn_(0), connected_( false ),
-		  mainloop_( 0 ), listener_( 0 ), quitSignal_( 0 ), dc_( 0 )
+		  mainloop_( 0 ), ownsMainloop_( true ), listener_( 0 ),
+		  quitSignal_( 0 ), dc_( 0 )
 	{
 		conn_ = xmmsc_init( name.c_str() );
 	}
 
 	Client::~Client() 
 	{
-		if( mainloop_ ) {
-			// Also deletes listener_
-			delete mainloop_;
-		}
+		releaseMainLoop();
 		if( quitSignal_ ) {
 			delete quitSignal_;
 		}
@@ -110,10 +108,16 @@ namespace Xmms
 	}
 
 	MainloopInterface& Client::getMainLoop() 
+	{
+		return getMainLoop( MainLoop::Select );
+	}
+
+	MainloopInterface& Client::getMainLoop( MainLoop::Backend backend )
 	{
 
 		if( !mainloop_ ) {
-			mainloop_ = new MainLoop( conn_ );
+			mainloop_ = new MainLoop( conn_, backend );
+			ownsMainloop_ = true;
 			listener_ = new Listener( conn_ );
 			broadcastQuit().connect( boost::bind( &Client::quitHandler,
 			                                      this, _1 ) );
@@ -124,13 +128,27 @@ namespace Xmms
 
 	}
 
+	void Client::useMainLoop( MainLoop& ml )
+	{
+
+		check( connected_ );
+		releaseMainLoop();
+		mainloop_ = &ml;
+		ownsMainloop_ = false;
+		listener_ = new Listener( conn_ );
+		broadcastQuit().connect( boost::bind( &Client::quitHandler,
+		                                      this, _1 ) );
+		setDisconnectCallback( boost::bind( &Client::dcHandler, this ) );
+		ml.addListener( listener_ );
+
+	}
+
 	void Client::setMainloop( MainloopInterface* ml )
 	{
 
-		if( mainloop_ ) {
-			delete mainloop_;
-		}
+		releaseMainLoop();
 		mainloop_ = ml;
+		ownsMainloop_ = true;
 		broadcastQuit().connect( boost::bind( &Client::quitHandler,
 		                                      this, _1 ) );
 		setDisconnectCallback( boost::bind( &Client::dcHandler, this ) );
@@ -172,7 +190,7 @@ namespace Xmms
 			dynamic_cast<MainLoop*>(mainloop_)->removeListener( listener_ );
 			delete listener_; listener_ = 0;
 		}
-		else if( mainloop_ ) {
+		else if( mainloop_ && ownsMainloop_ ) {
 			delete mainloop_; mainloop_ = 0;
 		}
 
@@ -180,4 +198,18 @@ namespace Xmms
 		xmmsc_unref( conn_ ); conn_ = 0;
 	}
 
+	void Client::releaseMainLoop()
+	{
+		if( mainloop_ && ownsMainloop_ ) {
+			// Also deletes listener_
+			delete mainloop_;
+		}
+		else if( mainloop_ && listener_ ) {
+			static_cast< MainLoop* >( mainloop_ )->removeListener( listener_ );
+			delete listener_;
+		}
+		mainloop_ = 0;
+		listener_ = 0;
+	}
+
 }
@@ -19,53 +19,89 @@
 #include <xmmsclient/xmmsclient.h>
 
 #include <list>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
 using std::list;
+using std::map;
+using std::set;
+
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+
+#ifdef __linux__
+# include <sys/epoll.h>
+# include <unistd.h>
+#endif
 
 
 namespace Xmms
 {
 
-	MainLoop::MainLoop( xmmsc_connection_t*& conn )
-		: MainloopInterface( conn ), listeners()
+	static long long
+	now()
 	{
+		struct timespec ts;
+		clock_gettime( CLOCK_MONOTONIC, &ts );
+		return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
 	}
 
-	MainLoop::~MainLoop()
+	static void
+	waitFailed( const char* what )
 	{
-		list< ListenerInterface* >::iterator lit;
-		for(lit = listeners.begin(); lit != listeners.end(); ++lit) {
-			delete (*lit);
-		}
-		listeners.clear();
+		throw std::runtime_error( std::string( what ) + " failed: "
+		                          + strerror( errno ) );
 	}
 
-	void
-	MainLoop::addListener( ListenerInterface* l )
+	class MainLoop::Poller
 	{
-		listeners.push_back( l );
-	}
+		public:
+			virtual ~Poller() {}
+
+			virtual void add( ListenerInterface* l ) = 0;
+			virtual void remove( ListenerInterface* l ) = 0;
+
+			// Wait at most timeout milliseconds (-1 for ever) and
+			// handle the listeners that are ready.
+			virtual void wait( list< ListenerInterface* >& listeners,
+			                   int timeout ) = 0;
+	};
+
+	class MainLoop::SelectPoller : public MainLoop::Poller
+	{
+		public:
+			virtual void add( ListenerInterface* l );
+			virtual void remove( ListenerInterface* l );
+			virtual void wait( list< ListenerInterface* >& listeners,
+			                   int timeout );
+
+		private:
+			// Removed while handling the current wait
+			set< ListenerInterface* > removed_;
+	};
 
 	void
-	MainLoop::removeListener( ListenerInterface* l )
+	MainLoop::SelectPoller::add( ListenerInterface* l )
 	{
-		listeners.remove( l );
+		removed_.erase( l );
 	}
 
 	void
-	MainLoop::run()
+	MainLoop::SelectPoller::remove( ListenerInterface* l )
 	{
-		running_ = true;
-		while(listeners.size() > 0) {
-			waitForData();
-		}
+		removed_.insert( l );
 	}
 
 	void
-	MainLoop::waitForData()
+	MainLoop::SelectPoller::wait( list< ListenerInterface* >& listeners,
+	                              int timeout )
 	{
 		fd_set rfds, wfds;
 		int modfds( 0 );
 		int maxfds( -1 );
+		struct timeval tv;
 
 		list< ListenerInterface* >::iterator lit;
 
@@ -91,26 +127,33 @@ namespace Xmms
 			}
 		}
 
+		tv.tv_sec = timeout / 1000;
+		tv.tv_usec = ( timeout % 1000 ) * 1000;
+
 		// Select on the fds
-		if( maxfds >= 0 ) {
-			modfds = select(maxfds + 1, &rfds, &wfds, NULL, NULL);
+		if( maxfds >= 0 || timeout >= 0 ) {
+			modfds = select(maxfds + 1, &rfds, &wfds, NULL,
+			                timeout >= 0 ? &tv : NULL);
 		}
 
-		if(modfds < 0) {
-			// FIXME: Error
+		if(modfds < 0 && errno != EINTR) {
+			waitFailed( "select" );
 		}
 		// Handle the data
 		else if(modfds > 0) {
-			for(lit = listeners.begin();
-			    lit != listeners.end() && listeners.size() != 0;
-			    ++lit) {
+			// Handlers may add and remove (and delete) listeners,
+			// so walk a copy and skip the ones removed meanwhile.
+			list< ListenerInterface* > ready( listeners );
+			removed_.clear();
+
+			for(lit = ready.begin(); lit != ready.end(); ++lit) {
 
-				if( (*lit)->listenOut()
+				if( !removed_.count( *lit ) && (*lit)->listenOut()
 					&& FD_ISSET((*lit)->getFileDescriptor(), &wfds) ) {
 					(*lit)->handleOut();
 				}
 
-				if( (*lit)->listenIn()
+				if( !removed_.count( *lit ) && (*lit)->listenIn()
 					&& FD_ISSET((*lit)->getFileDescriptor(), &rfds) ) {
 					(*lit)->handleIn();
 				}
@@ -119,4 +162,333 @@ namespace Xmms
 		}
 	}
 
+#ifdef __linux__
+
+	class MainLoop::EpollPoller : public MainLoop::Poller
+	{
+		public:
+			EpollPoller();
+			virtual ~EpollPoller();
+
+			virtual void add( ListenerInterface* l );
+			virtual void remove( ListenerInterface* l );
+			virtual void wait( list< ListenerInterface* >& listeners,
+			                   int timeout );
+
+		private:
+			struct Entry
+			{
+				EpollPoller* poller;
+				ListenerInterface* listener;
+				int fd;
+				uint32_t events;
+				// An Xmms::Listener, tells us when its output
+				// queue fills or drains instead of being asked.
+				bool notifies;
+				bool removed;
+			};
+
+			static void needOut( int need, void* data );
+			void update( Entry* e, bool in, bool out );
+
+			int epfd_;
+			map< ListenerInterface*, Entry* > entries_;
+
+			// Listeners asked for listenIn/listenOut before every wait
+			list< Entry* > polled_;
+
+			// Removed while handling events, freed after the wait
+			list< Entry* > removed_;
+	};
+
+	MainLoop::EpollPoller::EpollPoller()
+		: epfd_( epoll_create1( EPOLL_CLOEXEC ) )
+	{
+		if( epfd_ < 0 ) {
+			throw std::runtime_error( "Could not create epoll instance" );
+		}
+	}
+
+	MainLoop::EpollPoller::~EpollPoller()
+	{
+		map< ListenerInterface*, Entry* >::iterator it;
+		for( it = entries_.begin(); it != entries_.end(); ++it ) {
+			if( it->second->notifies ) {
+				MainLoop::setNeedOut( it->first, 0, 0 );
+			}
+			delete it->second;
+		}
+
+		list< Entry* >::iterator rit;
+		for( rit = removed_.begin(); rit != removed_.end(); ++rit ) {
+			delete *rit;
+		}
+
+		close( epfd_ );
+	}
+
+	void
+	MainLoop::EpollPoller::add( ListenerInterface* l )
+	{
+		if( entries_.count( l ) ) {
+			return;
+		}
+
+		Entry* e = new Entry;
+		e->poller = this;
+		e->listener = l;
+		e->fd = l->getFileDescriptor();
+		e->events = 0;
+		e->removed = false;
+
+		struct epoll_event ev;
+		ev.events = 0;
+		ev.data.ptr = e;
+		if( epoll_ctl( epfd_, EPOLL_CTL_ADD, e->fd, &ev ) < 0 ) {
+			delete e;
+			throw std::runtime_error( "Could not add listener to epoll" );
+		}
+
+		entries_[ l ] = e;
+
+		e->notifies = MainLoop::setNeedOut( l, &EpollPoller::needOut, e );
+		if( !e->notifies ) {
+			polled_.push_back( e );
+		}
+		update( e, l->listenIn(), l->listenOut() );
+	}
+
+	void
+	MainLoop::EpollPoller::remove( ListenerInterface* l )
+	{
+		map< ListenerInterface*, Entry* >::iterator it = entries_.find( l );
+		if( it == entries_.end() ) {
+			return;
+		}
+
+		Entry* e = it->second;
+		entries_.erase( it );
+
+		if( e->notifies ) {
+			MainLoop::setNeedOut( l, 0, 0 );
+		}
+		else {
+			polled_.remove( e );
+		}
+
+		// The descriptor may be closed already, nothing to do then
+		epoll_ctl( epfd_, EPOLL_CTL_DEL, e->fd, 0 );
+
+		e->removed = true;
+		removed_.push_back( e );
+	}
+
+	void
+	MainLoop::EpollPoller::needOut( int need, void* data )
+	{
+		Entry* e = static_cast< Entry* >( data );
+		e->poller->update( e, true, need );
+	}
+
+	void
+	MainLoop::EpollPoller::update( Entry* e, bool in, bool out )
+	{
+		uint32_t events = ( in ? EPOLLIN : 0 ) | ( out ? EPOLLOUT : 0 );
+
+		if( e->removed || events == e->events ) {
+			return;
+		}
+
+		struct epoll_event ev;
+		ev.events = events;
+		ev.data.ptr = e;
+		if( epoll_ctl( epfd_, EPOLL_CTL_MOD, e->fd, &ev ) == 0 ) {
+			e->events = events;
+		}
+	}
+
+	void
+	MainLoop::EpollPoller::wait( list< ListenerInterface* >& /*listeners*/,
+	                             int timeout )
+	{
+		struct epoll_event events[64];
+		int n;
+
+		list< Entry* >::iterator pit;
+		for( pit = polled_.begin(); pit != polled_.end(); ++pit ) {
+			update( *pit, (*pit)->listener->listenIn(),
+			        (*pit)->listener->listenOut() );
+		}
+
+		n = epoll_wait( epfd_, events, 64, timeout );
+
+		if( n < 0 && errno != EINTR ) {
+			waitFailed( "epoll_wait" );
+		}
+
+		// Handlers may remove (and delete) any listener, including
+		// ones further down in this batch, hence the removed flag.
+		for( int i = 0; i < n; ++i ) {
+			Entry* e = static_cast< Entry* >( events[i].data.ptr );
+
+			if( !e->removed && ( events[i].events & EPOLLOUT )
+			    && e->listener->listenOut() ) {
+				e->listener->handleOut();
+			}
+
+			if( !e->removed
+			    && ( events[i].events & ( EPOLLIN | EPOLLHUP | EPOLLERR ) ) ) {
+				e->listener->handleIn();
+			}
+		}
+
+		list< Entry* >::iterator rit;
+		for( rit = removed_.begin(); rit != removed_.end(); ++rit ) {
+			delete *rit;
+		}
+		removed_.clear();
+	}
+
+#endif
+
+	MainLoop::MainLoop( Backend backend )
+		: MainloopInterface( 0 ), listeners(), timers_(), quit_( false ),
+		  poller_( 0 )
+	{
+		setBackend( backend );
+	}
+
+	MainLoop::MainLoop( xmmsc_connection_t*& conn, Backend backend )
+		: MainloopInterface( conn ), listeners(), timers_(), quit_( false ),
+		  poller_( 0 )
+	{
+		setBackend( backend );
+	}
+
+	MainLoop::~MainLoop()
+	{
+		list< ListenerInterface* >::iterator lit;
+		for(lit = listeners.begin(); lit != listeners.end(); ++lit) {
+			poller_->remove( *lit );
+			delete (*lit);
+		}
+		listeners.clear();
+		delete poller_;
+	}
+
+	void
+	MainLoop::setBackend( Backend backend )
+	{
+		switch( backend ) {
+			case Select:
+				poller_ = new SelectPoller;
+				break;
+			case Epoll:
+#ifdef __linux__
+				poller_ = new EpollPoller;
+				break;
+#else
+				throw std::runtime_error( "epoll is not available" );
+#endif
+		}
+	}
+
+	bool
+	MainLoop::setNeedOut( ListenerInterface* l,
+	                      xmmsc_io_need_out_callback_func_t func, void* data )
+	{
+		Listener* listener = dynamic_cast< Listener* >( l );
+		if( !listener ) {
+			return false;
+		}
+
+		xmmsc_io_need_out_callback_set( listener->conn_, func, data );
+		return true;
+	}
+
+	void
+	MainLoop::addListener( ListenerInterface* l )
+	{
+		poller_->add( l );
+		listeners.push_back( l );
+	}
+
+	void
+	MainLoop::removeListener( ListenerInterface* l )
+	{
+		poller_->remove( l );
+		listeners.remove( l );
+	}
+
+	void
+	MainLoop::addTimer( unsigned int interval, const TimerCallback& func )
+	{
+		Timer timer;
+		timer.interval = interval;
+		timer.func = func;
+		timers_.insert( std::make_pair( now() + interval, timer ) );
+	}
+
+	void
+	MainLoop::quit()
+	{
+		quit_ = true;
+	}
+
+	void
+	MainLoop::run()
+	{
+		running_ = true;
+		quit_ = false;
+		try {
+			while( !quit_ && ( listeners.size() > 0 || timers_.size() > 0 ) ) {
+				waitForData();
+			}
+		}
+		catch( ... ) {
+			running_ = false;
+			throw;
+		}
+		running_ = false;
+	}
+
+	void
+	MainLoop::waitForData()
+	{
+		int timeout = runTimers();
+
+		// The last timer may just have gone, then there is nothing
+		// left to wait for
+		if( !quit_ && ( listeners.size() > 0 || timeout >= 0 ) ) {
+			poller_->wait( listeners, timeout );
+		}
+	}
+
+	int
+	MainLoop::runTimers()
+	{
+		long long current = now();
+		list< Timer > again;
+
+		while( !timers_.empty() && timers_.begin()->first <= current ) {
+			Timer timer = timers_.begin()->second;
+			timers_.erase( timers_.begin() );
+
+			if( timer.func() ) {
+				again.push_back( timer );
+			}
+		}
+
+		// Rescheduled only now, or a zero interval would never let go
+		list< Timer >::iterator tit;
+		for( tit = again.begin(); tit != again.end(); ++tit ) {
+			timers_.insert( std::make_pair( current + tit->interval, *tit ) );
+		}
+
+		if( timers_.empty() ) {
+			return -1;
+		}
+		return static_cast< int >( timers_.begin()->first - current );
+	}
+
 }
@@ -18,6 +18,7 @@
 #include <xmmsclient/xmmsclient++/medialib.h>
 #include <xmmsclient/xmmsclient++/mainloop.h>
 #include <xmmsclient/xmmsclient++/helpers.h>
+#include <xmmsclient/xmmsclient++/exceptions.h>
 #include <xmmsclient/xmmsclient++/result.h>
 
 #include <boost/function.hpp>
@@ -138,6 +139,85 @@ namespace Xmms
 		return VoidResult( res, ml_ );
 	}
 
+	VoidResult
+	Medialib::entryPropertiesSet( const std::map< int, std::map< std::string, Dict::Variant > >& properties,
+	                              const std::string& source ) const
+	{
+		xmmsv_t* dict = xmmsv_new_dict();
+
+		std::map< int, std::map< std::string, Dict::Variant > >::const_iterator it;
+		for( it = properties.begin(); it != properties.end(); ++it ) {
+			xmmsv_t* entry = xmmsv_new_dict();
+
+			std::string id = boost::lexical_cast< std::string >( it->first );
+			xmmsv_dict_set( dict, id.c_str(), entry );
+			xmmsv_unref( entry );
+
+			std::map< std::string, Dict::Variant >::const_iterator prop;
+			for( prop = it->second.begin(); prop != it->second.end(); ++prop ) {
+				if( const int32_t* val = boost::get< int32_t >( &prop->second ) ) {
+					xmmsv_dict_set_int( entry, prop->first.c_str(), *val );
+				}
+				else if( const std::string* val = boost::get< std::string >( &prop->second ) ) {
+					xmmsv_dict_set_string( entry, prop->first.c_str(), val->c_str() );
+				}
+				else {
+					xmmsv_unref( dict );
+					throw argument_error( "Can only handle int and string." );
+				}
+			}
+		}
+
+		VoidResult res = propertiesSet( dict, source );
+		xmmsv_unref( dict );
+		return res;
+	}
+
+	VoidResult
+	Medialib::entryPropertiesRemove( const std::map< int, std::list< std::string > >& keys,
+	                                 const std::string& source ) const
+	{
+		xmmsv_t* dict = xmmsv_new_dict();
+		xmmsv_t* none = xmmsv_new_none();
+
+		std::map< int, std::list< std::string > >::const_iterator it;
+		for( it = keys.begin(); it != keys.end(); ++it ) {
+			xmmsv_t* entry = xmmsv_new_dict();
+
+			std::list< std::string >::const_iterator key;
+			for( key = it->second.begin(); key != it->second.end(); ++key ) {
+				xmmsv_dict_set( entry, key->c_str(), none );
+			}
+
+			std::string id = boost::lexical_cast< std::string >( it->first );
+			xmmsv_dict_set( dict, id.c_str(), entry );
+			xmmsv_unref( entry );
+		}
+		xmmsv_unref( none );
+
+		VoidResult res = propertiesSet( dict, source );
+		xmmsv_unref( dict );
+		return res;
+	}
+
+	VoidResult
+	Medialib::propertiesSet( xmmsv_t* properties,
+	                         const std::string& source ) const
+	{
+		boost::function< xmmsc_result_t*() > f;
+
+		using boost::bind;
+		if( source.empty() ) {
+			f = bind( xmmsc_medialib_entries_properties_set, conn_, properties );
+		}
+		else {
+			f = bind( xmmsc_medialib_entries_properties_set_with_source,
+			          conn_, source.c_str(), properties );
+		}
+
+		xmmsc_result_t* res = call( connected_, f );
+		return VoidResult( res, ml_ );
+	}
 
 	IntResult Medialib::getID( const std::string& url ) const
 	{
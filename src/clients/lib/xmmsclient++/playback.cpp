@@ -173,6 +173,15 @@ namespace Xmms
 		return IntSignal( res, ml_ );
 	}
 
+	IntSignal Playback::signalPlaytime( int interval ) const
+	{
+		xmmsc_result_t* res =
+		    call( connected_,
+		          boost::bind( xmmsc_signal_playback_playtime_interval,
+		                       conn_, interval ) );
+		return IntSignal( res, ml_ );
+	}
+
 	Playback::Playback( xmmsc_connection_t*& conn, bool& connected,
 	                    MainloopInterface*& ml ) :
 		conn_( conn ), connected_( connected ), ml_( ml )
@@ -28,12 +28,12 @@ namespace Xmms
 
 	void SignalHolder::addSignal( SignalInterface* sig )
 	{
-		signals_.push_back( sig );
+		signals_.insert( sig );
 	}
 
 	void SignalHolder::removeSignal( SignalInterface* sig )
 	{
-		signals_.remove( sig );
+		signals_.erase( sig );
 		delete sig;
 	}
 
@@ -44,10 +44,10 @@ namespace Xmms
 
 	void SignalHolder::deleteAll()
 	{
-		std::list< SignalInterface* >::iterator i;
+		std::set< SignalInterface* >::iterator i;
 		for( i = signals_.begin(); i != signals_.end(); ++i )
 		{
-			delete *i; *i = 0;
+			delete *i;
 		}
 		signals_.clear();
 	}
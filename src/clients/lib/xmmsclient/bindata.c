@@ -79,3 +79,16 @@ xmmsc_bindata_list (xmmsc_connection_t *c)
 	return xmmsc_send_cmd (c, XMMS_IPC_OBJECT_BINDATA, XMMS_IPC_COMMAND_BINDATA_LIST,
 	                       XMMSV_LIST_END);
 }
+
+/**
+ * Retrieve the hit and miss counters and the size of the server's cache
+ * of recently retrieved bindata.
+ */
+xmmsc_result_t *
+xmmsc_bindata_cache_stats (xmmsc_connection_t *c)
+{
+	x_check_conn (c, NULL);
+
+	return xmmsc_send_cmd (c, XMMS_IPC_OBJECT_BINDATA, XMMS_IPC_COMMAND_BINDATA_CACHE_STATS,
+	                       XMMSV_LIST_END);
+}
@@ -267,40 +267,56 @@ xmmsc_ipc_error_set (xmmsc_ipc_t *ipc, char *error)
 	ipc->error = error;
 }
 
+/**
+ * Wait until something happens on the connection and handle it.
+ * @param timeout milliseconds to wait at most, -1 to wait forever
+ */
 void
-xmmsc_ipc_wait_for_event (xmmsc_ipc_t *ipc, unsigned int timeout)
+xmmsc_ipc_wait_for_event (xmmsc_ipc_t *ipc, int timeout)
 {
-	fd_set rfdset;
-	fd_set wfdset;
-	struct timeval tmout;
 	xmms_socket_t fd;
+	bool readable, writable;
+	int ret;
 
 	x_return_if_fail (ipc);
 	x_return_if_fail (!ipc->disconnect);
 
-	tmout.tv_sec = timeout;
-	tmout.tv_usec = 0;
+	/* Data the transport has already read ahead won't make the socket
+	 * readable. This happens when a result callback waits for another
+	 * result while more replies are buffered.
+	 */
+	if (xmms_ipc_transport_pending (ipc->transport)) {
+		xmmsc_ipc_io_in_callback (ipc);
+		return;
+	}
+
+	/* The socket is nearly always writable, so try sending what is
+	 * queued right away instead of waiting to be told so.
+	 */
+	if (xmmsc_ipc_io_out (ipc) && !xmmsc_ipc_io_out_callback (ipc)) {
+		return;
+	}
 
 	fd = xmms_ipc_transport_fd_get (ipc->transport);
 
-	FD_ZERO (&rfdset);
-	FD_SET (fd, &rfdset);
+	readable = false;
+	writable = xmmsc_ipc_io_out (ipc);
 
-	FD_ZERO (&wfdset);
-	if (xmmsc_ipc_io_out (ipc)) {
-		FD_SET (fd, &wfdset);
+	ret = xmms_socket_wait (fd, &readable, &writable, timeout);
+	if (ret == SOCKET_ERROR && !xmms_socket_error_recoverable ()) {
+		xmmsc_ipc_disconnect (ipc);
+		return;
 	}
-
-	if (select (fd + 1, &rfdset, &wfdset, NULL, &tmout) == SOCKET_ERROR) {
+	if (ret <= 0) {
 		return;
 	}
 
-	if (FD_ISSET (fd, &rfdset)) {
+	if (readable) {
 		if (!xmmsc_ipc_io_in_callback (ipc)) {
 			return;
 		}
 	}
-	if (FD_ISSET (fd, &wfdset)) {
+	if (writable) {
 		xmmsc_ipc_io_out_callback (ipc);
 	}
 }
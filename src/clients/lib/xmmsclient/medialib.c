@@ -490,6 +490,53 @@ xmmsc_medialib_entry_property_remove_with_source (xmmsc_connection_t *c,
 	                       XMMSV_LIST_END);
 }
 
+/**
+ * Set or remove properties of several medialib entries in one go.
+ * Uses default source which is client/&lt;clientname&gt;
+ *
+ * @param c The #xmmsc_connection_t
+ * @param properties A dict mapping medialib ids (as decimal strings)
+ * to dicts of properties. String and int values are written, none
+ * values remove the property.
+ */
+xmmsc_result_t *
+xmmsc_medialib_entries_properties_set (xmmsc_connection_t *c,
+                                       xmmsv_t *properties)
+{
+	char tmp[256];
+
+	x_check_conn (c, NULL);
+
+	snprintf (tmp, 256, "client/%s", c->clientname);
+	return xmmsc_medialib_entries_properties_set_with_source (c, tmp,
+	                                                          properties);
+}
+
+/**
+ * Set or remove properties of several medialib entries in one go,
+ * the same as #xmmsc_medialib_entries_properties_set but with
+ * specifying your own source.
+ *
+ * All changes are applied in a single transaction on the server, so
+ * either every property is written or none of them are.
+ */
+xmmsc_result_t *
+xmmsc_medialib_entries_properties_set_with_source (xmmsc_connection_t *c,
+                                                   const char *source,
+                                                   xmmsv_t *properties)
+{
+	x_check_conn (c, NULL);
+	x_api_error_if (!properties, "with a NULL properties dict", NULL);
+	x_api_error_if (!xmmsv_is_type (properties, XMMSV_TYPE_DICT),
+	                "with a non-dict properties argument", NULL);
+
+	return xmmsc_send_cmd (c, XMMS_IPC_OBJECT_MEDIALIB,
+	                       XMMS_IPC_COMMAND_MEDIALIB_SET_PROPERTIES,
+	                       XMMSV_LIST_ENTRY_STR (source),
+	                       XMMSV_LIST_ENTRY (xmmsv_ref (properties)),
+	                       XMMSV_LIST_END);
+}
+
 /** @} */
 
 #define GOODCHAR(a) ((((a) >= 'a') && ((a) <= 'z')) || \
@@ -198,6 +198,21 @@ xmmsc_signal_playback_playtime (xmmsc_connection_t *c)
 	return xmmsc_send_signal_msg (c, XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME);
 }
 
+/**
+ * Request the playback_playtime signal, but at most once every
+ * interval milliseconds. Clients that only redraw now and then get
+ * the latest playtime without waking up for every update.
+ */
+xmmsc_result_t *
+xmmsc_signal_playback_playtime_interval (xmmsc_connection_t *c, int interval)
+{
+	x_check_conn (c, NULL);
+	x_api_error_if (interval < 0, "with a negative interval", NULL);
+
+	return xmmsc_send_signal_msg_interval (c, XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME,
+	                                       interval);
+}
+
 /**
  * Make server emit the current playtime.
  */
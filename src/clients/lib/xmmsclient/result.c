@@ -73,6 +73,7 @@ struct xmmsc_result_St {
 
 	uint32_t cookie;
 	uint32_t restart_signal;
+	int restart_interval;
 
 	xmmsv_t *data;
 
@@ -210,7 +211,8 @@ xmmsc_result_restart (xmmsc_result_t *res)
 		return;
 	}
 
-	res->cookie = xmmsc_write_signal_msg (res->c, res->restart_signal);
+	res->cookie = xmmsc_write_signal_msg (res->c, res->restart_signal,
+	                                      res->restart_interval);
 }
 
 static bool
@@ -428,6 +430,9 @@ GEN_RESULT_NOTIFIER_SET_FULL_FUNC (c2c)
  * Block for the reply. In a synchronous application this
  * can be used to wait for the result. Will return when
  * the server replyed.
+ *
+ * Replies to other results that arrive in the meantime are
+ * dispatched as usual.
  */
 
 void
@@ -437,8 +442,11 @@ xmmsc_result_wait (xmmsc_result_t *res)
 	x_return_if_fail (res);
 	x_return_if_fail (res->ipc);
 
+	/* every event is looked at, so this wakes up as soon as the
+	 * reply has been parsed or the connection is lost
+	 */
 	while (!res->parsed && !(err = xmmsc_ipc_error_get (res->ipc))) {
-		xmmsc_ipc_wait_for_event (res->ipc, 5);
+		xmmsc_ipc_wait_for_event (res->ipc, -1);
 	}
 
 	if (err) {
@@ -487,11 +495,13 @@ xmmsc_result_seterror (xmmsc_result_t *res, const char *errstr)
 }
 
 void
-xmmsc_result_restartable (xmmsc_result_t *res, uint32_t signalid)
+xmmsc_result_restartable (xmmsc_result_t *res, uint32_t signalid,
+                          int interval)
 {
 	x_return_if_fail (res);
 
 	res->restart_signal = signalid;
+	res->restart_interval = interval;
 }
 
 /**
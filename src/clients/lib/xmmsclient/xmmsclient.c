@@ -365,7 +365,7 @@ xmmsc_send_broadcast_msg (xmmsc_connection_t *c, int signalid)
 
 
 uint32_t
-xmmsc_write_signal_msg (xmmsc_connection_t *c, int signalid)
+xmmsc_write_signal_msg (xmmsc_connection_t *c, int signalid, int interval)
 {
 	xmms_ipc_msg_t *msg;
 	xmmsv_t *args;
@@ -376,6 +376,11 @@ xmmsc_write_signal_msg (xmmsc_connection_t *c, int signalid)
 	args = xmmsv_build_list (XMMSV_LIST_ENTRY_INT (signalid),
 	                         XMMSV_LIST_END);
 
+	/* leave it out when not throttled, like older clients do */
+	if (interval > 0) {
+		xmmsv_list_append_int (args, interval);
+	}
+
 	xmms_ipc_msg_put_value (msg, args);
 	xmmsv_unref (args);
 
@@ -387,12 +392,25 @@ xmmsc_write_signal_msg (xmmsc_connection_t *c, int signalid)
 xmmsc_result_t *
 xmmsc_send_signal_msg (xmmsc_connection_t *c, int signalid)
 {
+	return xmmsc_send_signal_msg_interval (c, signalid, 0);
+}
+
+/**
+ * Like #xmmsc_send_signal_msg, but asks the server to deliver the
+ * signal at most once every interval milliseconds. Values emitted in
+ * between are coalesced by the server, only the latest one is sent.
+ */
+xmmsc_result_t *
+xmmsc_send_signal_msg_interval (xmmsc_connection_t *c, int signalid,
+                                int interval)
+{
+	uint32_t cookie;
 	xmmsc_result_t *res;
 
-	res = xmmsc_send_cmd (c, XMMS_IPC_OBJECT_SIGNAL, XMMS_IPC_COMMAND_SIGNAL,
-	                      XMMSV_LIST_ENTRY_INT (signalid), XMMSV_LIST_END);
+	cookie = xmmsc_write_signal_msg (c, signalid, interval);
 
-	xmmsc_result_restartable (res, signalid);
+	res = xmmsc_result_new (c, XMMSC_RESULT_CLASS_SIGNAL, cookie);
+	xmmsc_result_restartable (res, signalid, interval);
 
 	return res;
 }
@@ -45,7 +45,7 @@ typedef struct xmms_output_St xmms_output_t;
 /**
  * The current API version.
  */
-#define XMMS_OUTPUT_API_VERSION 8
+#define XMMS_OUTPUT_API_VERSION 9
 
 struct xmms_output_plugin_St;
 typedef struct xmms_output_plugin_St xmms_output_plugin_t;
@@ -212,6 +212,20 @@ typedef struct xmms_output_methods_St {
 	 * @return the number of bytes in the soundcard buffer or 0 on failure
 	 */
 	guint (*latency_get)(xmms_output_t *);
+
+	/**
+	 * Start reporting volume changes.
+	 *
+	 * Plugins whose mixer can tell them when the volume changes should
+	 * implement this, and from then on until #destroy call
+	 * #xmms_output_volume_changed on every change, or
+	 * #xmms_output_volume_monitor_lost if that stops working. Otherwise
+	 * the volume is polled once a second.
+	 *
+	 * @param output an output object
+	 * @return TRUE if changes will be reported, FALSE to be polled
+	 */
+	gboolean (*volume_monitor)(xmms_output_t *output);
 } xmms_output_methods_t;
 
 /**
@@ -324,6 +338,18 @@ gint xmms_output_read (xmms_output_t *output, char *buffer, gint len) XMMS_PUBLI
  */
 gint xmms_output_bytes_available (xmms_output_t *output) XMMS_PUBLIC;
 
+/**
+ * Tell whether the plugin plays in realtime, which is the default.
+ *
+ * A plugin that isn't tied to a clock, such as one writing to a file,
+ * can turn this off from #open to have the output hand it data in
+ * large chunks as fast as it can be decoded.
+ *
+ * @param output an output object
+ * @param realtime FALSE if data may be consumed faster than realtime
+ */
+void xmms_output_realtime_set (xmms_output_t *output, gboolean realtime) XMMS_PUBLIC;
+
 /**
  * Set an error.
  *
@@ -335,6 +361,28 @@ gint xmms_output_bytes_available (xmms_output_t *output) XMMS_PUBLIC;
  */
 void xmms_output_set_error (xmms_output_t *output, xmms_error_t *error) XMMS_PUBLIC;
 
+/**
+ * Tell the output that the volume has changed.
+ *
+ * Used by plugins that implement #volume_monitor, may be called from
+ * any thread. The volume is then read with #volume_get and sent to
+ * the clients if it differs from what they were told last.
+ *
+ * @param output an output object
+ */
+void xmms_output_volume_changed (xmms_output_t *output) XMMS_PUBLIC;
+
+/**
+ * Tell the output that volume changes can't be reported anymore.
+ *
+ * Used by plugins that implement #volume_monitor when they lose track
+ * of their mixer, may be called from any thread. The volume is polled
+ * once a second from then on.
+ *
+ * @param output an output object
+ */
+void xmms_output_volume_monitor_lost (xmms_output_t *output) XMMS_PUBLIC;
+
 /**
  * Check if an output plugin needs format updates on each track change.
  *
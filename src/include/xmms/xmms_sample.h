@@ -66,6 +66,15 @@ gint64 xmms_sample_bytes_to_samples_inexact (const xmms_stream_type_t *st, gint6
 gint64 xmms_sample_ms_to_bytes (const xmms_stream_type_t *st, gint64 ms) XMMS_PUBLIC;
 gint64 xmms_sample_bytes_to_ms (const xmms_stream_type_t *st, gint64 bytes) XMMS_PUBLIC;
 
+typedef struct xmms_sample_gain_St xmms_sample_gain_t;
+
+xmms_sample_gain_t *xmms_sample_gain_new (xmms_sample_format_t format, gint channels) XMMS_PUBLIC;
+void xmms_sample_gain_free (xmms_sample_gain_t *gain) XMMS_PUBLIC;
+void xmms_sample_gain_set (xmms_sample_gain_t *gain, gfloat value, gint ramp) XMMS_PUBLIC;
+gfloat xmms_sample_gain_get (xmms_sample_gain_t *gain) XMMS_PUBLIC;
+gboolean xmms_sample_gain_is_unity (xmms_sample_gain_t *gain) XMMS_PUBLIC;
+void xmms_sample_gain_apply (xmms_sample_gain_t *gain, xmms_sample_t *buf, gint len) XMMS_PUBLIC;
+
 static inline gint
 xmms_sample_size_get (xmms_sample_format_t fmt)
 {
@@ -31,6 +31,7 @@ typedef void (*xmms_ipc_destroy_func) (xmms_ipc_transport_t *);
 void xmms_ipc_transport_destroy (xmms_ipc_transport_t *ipct);
 int xmms_ipc_transport_read (xmms_ipc_transport_t *ipct, char *buffer, int len);
 int xmms_ipc_transport_write (xmms_ipc_transport_t *ipct, char *buffer, int len);
+int xmms_ipc_transport_pending (xmms_ipc_transport_t *ipct);
 xmms_socket_t xmms_ipc_transport_fd_get (xmms_ipc_transport_t *ipct);
 xmms_ipc_transport_t * xmms_ipc_server_accept (xmms_ipc_transport_t *ipct);
 xmms_ipc_transport_t * xmms_ipc_client_init (const char *path);
@@ -48,6 +49,11 @@ struct xmms_ipc_transport_St {
 	xmms_ipc_write_func write_func;
 	xmms_ipc_read_func read_func;
 	xmms_ipc_destroy_func destroy_func;
+
+	/* read-ahead for small reads, see xmms_ipc_transport_read () */
+	char *rbuf;
+	int rbuf_pos;
+	int rbuf_len;
 };
 
 #endif
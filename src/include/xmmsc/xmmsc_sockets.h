@@ -27,6 +27,7 @@ typedef int socklen_t;
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <poll.h>
 #include <sys/time.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
@@ -45,6 +46,7 @@ void xmms_socket_invalidate (xmms_socket_t *socket);
 void xmms_socket_close (xmms_socket_t socket);
 int xmms_socket_errno (void);
 bool xmms_socket_error_recoverable (void);
+int xmms_socket_wait (xmms_socket_t socket, bool *readable, bool *writable, int timeout);
 int xmms_getaddrinfo (const char *node, const char *service, const struct addrinfo *hints, struct addrinfo **res);
 void xmms_freeaddrinfo (struct addrinfo *res);
 
@@ -66,6 +66,11 @@ xmmsv_t *xmmsv_coll_copy (xmmsv_t *orig_coll) XMMS_PUBLIC XMMS_DEPRECATED;
 xmmsv_t *xmmsv_ref (xmmsv_t *val) XMMS_PUBLIC;
 void xmmsv_unref (xmmsv_t *val) XMMS_PUBLIC;
 
+int xmmsv_freeze (xmmsv_t *val) XMMS_PUBLIC;
+int xmmsv_is_frozen (const xmmsv_t *val) XMMS_PUBLIC;
+
+xmmsv_t *xmmsv_get_alloc_stats (void) XMMS_PUBLIC;
+
 xmmsv_type_t xmmsv_get_type (const xmmsv_t *val) XMMS_PUBLIC;
 int xmmsv_is_type (const xmmsv_t *val, xmmsv_type_t t) XMMS_PUBLIC;
 
@@ -94,6 +94,21 @@ namespace Xmms
 			 */
 			StringListResult list() const;
 
+			/** Get statistics about the server's cache of recently
+			 *  retrieved binary data.
+			 *
+			 *  @throw connection_error If the client isn't connected.
+			 *  @throw mainloop_running_error If a mainloop is running -
+			 *  sync functions can't be called when mainloop is running. This
+			 *  is only thrown if the programmer is careless or doesn't know
+			 *  what he/she's doing. (logic_error)
+			 *  @throw result_error If the operation failed.
+			 *
+			 *  @return Dict with the hits, misses, entries, size and
+			 *          limit of the cache.
+			 */
+			DictResult cacheStats() const;
+
 		/** @cond */
 		private:
 
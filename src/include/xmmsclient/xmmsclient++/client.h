@@ -119,6 +119,30 @@ namespace Xmms
 			 */
 			MainloopInterface& getMainLoop();
 
+			/** Get the current mainloop.
+			 *  If no mainloop is set, it will create a MainLoop waiting
+			 *  with the given backend.
+			 *
+			 *  @param backend How a newly created MainLoop waits.
+			 *
+			 *  @throw std::runtime_error If the backend is not available.
+			 *
+			 *  @return Reference to the current mainloop object.
+			 */
+			MainloopInterface& getMainLoop( MainLoop::Backend backend );
+
+			/** Run the client in a MainLoop shared with other clients.
+			 *  Must be called after connect().
+			 *
+			 *  @param ml The loop to add the client's listener to.
+			 *
+			 *  @note The loop is not owned by the client and must
+			 *        outlive it.
+			 *
+			 *  @throw connection_error If the client isn't connected.
+			 */
+			void useMainLoop( MainLoop& ml );
+
 			/** Set the mainloop which is to be used.
 			 *  
 			 *  @param ml A mainloop class derived from MainloopInterface.
@@ -157,6 +181,7 @@ namespace Xmms
 
 			bool quitHandler( const int& time );
 			void dcHandler();
+			void releaseMainLoop();
 
 			std::string name_;
 
@@ -165,6 +190,7 @@ namespace Xmms
 			bool connected_;
 
 			MainloopInterface* mainloop_;
+			bool ownsMainloop_;
 			Listener* listener_;
 
 			QuitSignal* quitSignal_;
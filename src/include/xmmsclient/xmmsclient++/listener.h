@@ -24,6 +24,7 @@ namespace Xmms
 {
 
 	class Client;
+	class MainLoop;
 
 	/** @class ListenerInterface listener.h "xmmsclient/xmmsclient++/listener.h"
 	 *  @brief Interface to define MainLoop listeners.
@@ -94,6 +95,9 @@ namespace Xmms
 			// Constructor, only to be called by Xmms::Client
 			friend class Client;
 
+			// Hooks the need out callback of conn_
+			friend class MainLoop;
+
 			/** Constructor, only callable by Client.
 			 *
 			 *  @param conn xmmsc_connection_t* of the connection used
@@ -19,7 +19,10 @@
 
 #include <xmmsclient/xmmsclient++/listener.h>
 
+#include <boost/function.hpp>
+
 #include <list>
+#include <map>
 
 
 namespace Xmms 
@@ -69,12 +72,39 @@ namespace Xmms
 
 	/** @class MainLoop mainloop.h "xmmsclient/xmmsclient++/mainloop.h"
 	 *  @brief A standalone mainloop allowing additional custom Listeners.
-	 *  Can only be created by the Client class.
+	 *  Created by the Client class, or directly to drive several
+	 *  clients at once (see Client::useMainLoop).
 	 */
 	class MainLoop : public MainloopInterface
 	{
 
 		public:
+			/** How the loop waits for its listeners.
+			 */
+			enum Backend {
+				/** select(), available everywhere. */
+				Select,
+				/** epoll, only available on Linux.  Listeners are
+				 *  registered with the kernel once instead of on every
+				 *  iteration, so many listeners are cheap and file
+				 *  descriptors above FD_SETSIZE work.
+				 */
+				Epoll
+			};
+
+			/** Timer callback, return false to remove the timer.
+			 */
+			typedef boost::function< bool() > TimerCallback;
+
+			/** Constructor for a loop shared by several clients.
+			 *
+			 *  @param backend How to wait for the listeners.
+			 *
+			 *  @throw std::runtime_error If the backend is not
+			 *                            available.
+			 */
+			explicit MainLoop( Backend backend );
+
 			/** Copy-constructor.
 			 */
 			MainLoop( const MainLoop& src );
@@ -97,9 +127,22 @@ namespace Xmms
 			 */
 			void removeListener( ListenerInterface* l );
 
+			/** Call a function every interval milliseconds while the
+			 *  loop runs, until it returns false.
+			 */
+			void addTimer( unsigned int interval, const TimerCallback& func );
+
+			/** Make run() return once the current iteration is done.
+			 */
+			void quit();
+
 			/** Start the mainloop.
-			 *  Only stops if the connection is lost or all listeners
-			 *  are removed.
+			 *  Only stops if the connection is lost, all listeners
+			 *  and timers are removed or quit() is called.
+			 *
+			 *  @throw std::runtime_error If waiting for the listeners
+			 *                            fails, e.g. because one of
+			 *                            their descriptors was closed.
 			 */
 			virtual void run();
 
@@ -113,8 +156,9 @@ namespace Xmms
 			 *
 			 *  @param conn xmmsc_connection_t* of the connection used
 			 *              in the mainloop.
+			 *  @param backend How to wait for the listeners.
 			 */
-			MainLoop( xmmsc_connection_t*& conn );
+			MainLoop( xmmsc_connection_t*& conn, Backend backend = Select );
 
 			/** Copy assignment operator, only callable by Client.
 			 */
@@ -124,11 +168,44 @@ namespace Xmms
 			 */
 			std::list< ListenerInterface* > listeners;
 
+			struct Timer
+			{
+				unsigned int interval;
+				TimerCallback func;
+			};
+
+			/** Timers by their next expiry, in milliseconds.
+			 */
+			std::multimap< long long, Timer > timers_;
+
+			bool quit_;
+
+			// Waits on the listeners, one per backend
+			class Poller;
+			class SelectPoller;
+			class EpollPoller;
+
+			Poller* poller_;
+
+			void setBackend( Backend backend );
+
+			/** Let an Xmms::Listener report when it wants to write,
+			 *  returns false for other listeners.
+			 */
+			static bool setNeedOut( ListenerInterface* l,
+			                        xmmsc_io_need_out_callback_func_t func,
+			                        void* data );
+
 			/** The method actually doing the io operations on the
 			 *  listeners.
 			 */
 			void waitForData();
 
+			/** Run the expired timers, return the milliseconds until
+			 *  the next one or -1 if there are none.
+			 */
+			int runTimers();
+
 		/** @endcond */
 	};
 
@@ -161,6 +161,55 @@ namespace Xmms
 			                             int32_t value,
 			                             const std::string& source = "" ) const;
 
+			/** Set properties of several medialib entries at once.
+			 *
+			 *  All properties are written in a single transaction on
+			 *  the server, so either all of them are set or none is.
+			 *
+			 *  The optional @c source parameter will default to
+			 *  client/@<clientname@> if not provided.
+			 *
+			 *  @param properties Map of entry ID to the key/value
+			 *  pairs to set on that entry.
+			 *  @param source Source for the values. (<b>optional</b>)
+			 *
+			 *  @throw connection_error If the client isn't connected.
+			 *  @throw mainloop_running_error If a mainloop is running -
+			 *  sync functions can't be called when mainloop is running. This
+			 *  is only thrown if the programmer is careless or doesn't know
+			 *  what he/she's doing. (logic_error)
+			 *  @throw argument_error If a value is neither an int nor
+			 *  a string.
+			 *  @throw result_error If the operation failed.
+			 */
+			VoidResult
+			entryPropertiesSet( const std::map< int, std::map< std::string, Dict::Variant > >& properties,
+			                    const std::string& source = "" ) const;
+
+			/** Remove properties from several medialib entries at once.
+			 *
+			 *  All properties are removed in a single transaction on
+			 *  the server, so either all of them are removed or none is.
+			 *
+			 *  The optional @c source parameter will default to
+			 *  client/@<clientname@> if not provided.
+			 *
+			 *  @param keys Map of entry ID to the keys to remove from
+			 *  that entry.
+			 *  @param source Source to remove the values from.
+			 *  (<b>optional</b>)
+			 *
+			 *  @throw connection_error If the client isn't connected.
+			 *  @throw mainloop_running_error If a mainloop is running -
+			 *  sync functions can't be called when mainloop is running. This
+			 *  is only thrown if the programmer is careless or doesn't know
+			 *  what he/she's doing. (logic_error)
+			 *  @throw result_error If the operation failed.
+			 */
+			VoidResult
+			entryPropertiesRemove( const std::map< int, std::list< std::string > >& keys,
+			                       const std::string& source = "" ) const;
+
 			/** Search for a entry (URL) in the medialib db
 			 *  and return its ID number.
 			 *
@@ -330,6 +379,9 @@ namespace Xmms
 			Medialib( const Medialib& src );
 			Medialib& operator=( const Medialib& src );
 
+			VoidResult propertiesSet( xmmsv_t* properties,
+			                          const std::string& source ) const;
+
 			xmmsc_connection_t*& conn_;
 			bool& connected_;
 			MainloopInterface*& ml_;
@@ -229,6 +229,11 @@ namespace Xmms
 			DictSignal broadcastVolumeChanged() const;
 			IntSignal signalPlaytime() const;
 
+			/** Like signalPlaytime(), but delivered at most once every
+			 *  interval milliseconds, with the latest playtime.
+			 */
+			IntSignal signalPlaytime( int interval ) const;
+
 		/** @cond */
 		private:
 
@@ -22,6 +22,7 @@
 #include <boost/function.hpp>
 #include <string>
 #include <list>
+#include <set>
 #include <iostream>
 #include <deque>
 
@@ -116,7 +117,7 @@ namespace Xmms
 			SignalHolder& operator=( SignalHolder& src );
 			void deleteAll();
 
-			std::list< SignalInterface* > signals_;
+			std::set< SignalInterface* > signals_;
 		/** @endcond */
 
 	};
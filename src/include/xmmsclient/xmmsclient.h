@@ -142,6 +142,7 @@ xmmsc_result_t *xmmsc_broadcast_playback_current_id (xmmsc_connection_t *c) XMMS
 
 /* signals */
 xmmsc_result_t *xmmsc_signal_playback_playtime (xmmsc_connection_t *c) XMMS_PUBLIC;
+xmmsc_result_t *xmmsc_signal_playback_playtime_interval (xmmsc_connection_t *c, int interval) XMMS_PUBLIC;
 
 
 /*
@@ -234,6 +235,9 @@ xmmsc_result_t *xmmsc_medialib_entry_property_set_str_with_source (xmmsc_connect
 xmmsc_result_t *xmmsc_medialib_entry_property_remove (xmmsc_connection_t *c, int id, const char *key) XMMS_PUBLIC;
 xmmsc_result_t *xmmsc_medialib_entry_property_remove_with_source (xmmsc_connection_t *c, int id, const char *source, const char *key) XMMS_PUBLIC;
 
+xmmsc_result_t *xmmsc_medialib_entries_properties_set (xmmsc_connection_t *c, xmmsv_t *properties) XMMS_PUBLIC;
+xmmsc_result_t *xmmsc_medialib_entries_properties_set_with_source (xmmsc_connection_t *c, const char *source, xmmsv_t *properties) XMMS_PUBLIC;
+
 /* XForm object */
 xmmsc_result_t *xmmsc_xform_media_browse (xmmsc_connection_t *c, const char *url) XMMS_PUBLIC;
 xmmsc_result_t *xmmsc_xform_media_browse_encoded (xmmsc_connection_t *c, const char *url) XMMS_PUBLIC;
@@ -243,6 +247,7 @@ xmmsc_result_t *xmmsc_bindata_add (xmmsc_connection_t *c, const unsigned char *d
 xmmsc_result_t *xmmsc_bindata_retrieve (xmmsc_connection_t *c, const char *hash) XMMS_PUBLIC;
 xmmsc_result_t *xmmsc_bindata_remove (xmmsc_connection_t *c, const char *hash) XMMS_PUBLIC;
 xmmsc_result_t *xmmsc_bindata_list (xmmsc_connection_t *c) XMMS_PUBLIC;
+xmmsc_result_t *xmmsc_bindata_cache_stats (xmmsc_connection_t *c) XMMS_PUBLIC;
 
 /* broadcasts */
 xmmsc_result_t *xmmsc_broadcast_medialib_entry_changed (xmmsc_connection_t *c) XMMS_PUBLIC  XMMS_DEPRECATED;
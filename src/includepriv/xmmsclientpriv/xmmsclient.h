@@ -82,11 +82,12 @@ xmmsc_result_t *xmmsc_send_msg (xmmsc_connection_t *c, xmms_ipc_msg_t *msg);
 xmmsc_result_t *xmmsc_send_msg_flush (xmmsc_connection_t *c, xmms_ipc_msg_t *msg);
 xmmsc_result_t *xmmsc_send_broadcast_msg (xmmsc_connection_t *c, int signalid);
 xmmsc_result_t *xmmsc_send_signal_msg (xmmsc_connection_t *c, int signalid);
-uint32_t xmmsc_write_signal_msg (xmmsc_connection_t *c, int signalid);
+xmmsc_result_t *xmmsc_send_signal_msg_interval (xmmsc_connection_t *c, int signalid, int interval);
+uint32_t xmmsc_write_signal_msg (xmmsc_connection_t *c, int signalid, int interval);
 char *_xmmsc_medialib_encode_url_old (const char *url, int narg, const char **args);
 int _xmmsc_medialib_verify_url (const char *url);
 
-void xmmsc_result_restartable (xmmsc_result_t *res, uint32_t signalid);
+void xmmsc_result_restartable (xmmsc_result_t *res, uint32_t signalid, int interval);
 void xmmsc_result_seterror (xmmsc_result_t *res, const char *errstr);
 
 void xmmsc_result_visc_set (xmmsc_result_t *res, xmmsc_visualization_t *visc);
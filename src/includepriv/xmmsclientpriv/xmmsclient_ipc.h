@@ -50,7 +50,7 @@ xmms_socket_t xmmsc_ipc_fd_get (xmmsc_ipc_t *ipc);
 void xmmsc_ipc_result_register (xmmsc_ipc_t *ipc, xmmsc_result_t *res);
 xmmsc_result_t *xmmsc_ipc_result_lookup (xmmsc_ipc_t *ipc, uint32_t cookie);
 void xmmsc_ipc_result_unregister (xmmsc_ipc_t *ipc, xmmsc_result_t *res);
-void xmmsc_ipc_wait_for_event (xmmsc_ipc_t *ipc, unsigned int timeout);
+void xmmsc_ipc_wait_for_event (xmmsc_ipc_t *ipc, int timeout);
 
 /* FIXME: The proper place would be in a new header
  * xmmsclientpriv/xmmsclient_result.h  */
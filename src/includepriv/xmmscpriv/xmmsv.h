@@ -17,11 +17,32 @@
 #ifndef __XMMSV_INTERNAL_H__
 #define __XMMSV_INTERNAL_H__
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <xmmsc/xmmsv.h>
 #include <xmmsc/xmmsc_stdbool.h>
 
+/* Refcounts and statistics are updated atomically where supported */
+#if defined (__GNUC__) && defined (__ATOMIC_RELAXED)
+#	define XMMSV_HAVE_ATOMICS 1
+#	define XMMSV_ATOMIC_ADD(p, v) __atomic_add_fetch ((p), (v), __ATOMIC_RELAXED)
+#	define XMMSV_ATOMIC_SUB(p, v) __atomic_sub_fetch ((p), (v), __ATOMIC_ACQ_REL)
+#	define XMMSV_ATOMIC_GET(p) __atomic_load_n ((p), __ATOMIC_RELAXED)
+#	define XMMSV_ATOMIC_LOAD_ACQUIRE(p) __atomic_load_n ((p), __ATOMIC_ACQUIRE)
+#	define XMMSV_ATOMIC_CAS(p, expected, desired) \
+		__atomic_compare_exchange_n ((p), (expected), (desired), false, \
+		                             __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#	define XMMSV_SPIN_LOCK(p) while (__atomic_test_and_set ((p), __ATOMIC_ACQUIRE))
+#	define XMMSV_SPIN_UNLOCK(p) __atomic_clear ((p), __ATOMIC_RELEASE)
+#else
+#	define XMMSV_ATOMIC_ADD(p, v) (*(p) += (v))
+#	define XMMSV_ATOMIC_SUB(p, v) (*(p) -= (v))
+#	define XMMSV_ATOMIC_GET(p) (*(p))
+#	define XMMSV_SPIN_LOCK(p)
+#	define XMMSV_SPIN_UNLOCK(p)
+#endif
+
 typedef struct xmmsv_dict_internal_St xmmsv_dict_internal_t;
 typedef struct xmmsv_list_internal_St xmmsv_list_internal_t;
 typedef struct xmmsv_coll_internal_St xmmsv_coll_internal_t;
@@ -52,12 +73,35 @@ struct xmmsv_St {
 	xmmsv_type_t type;
 
 	int ref;  /* refcounting */
+	bool frozen;
 };
 
+/* Fixed-size objects served by the value allocator, see xmmsv_alloc.c */
+typedef enum {
+	XMMSV_ALLOC_VALUE,
+	XMMSV_ALLOC_LIST,
+	XMMSV_ALLOC_DICT,
+	XMMSV_ALLOC_NUM_KINDS
+} xmmsv_alloc_kind_t;
+
+void *_xmmsv_alloc (xmmsv_alloc_kind_t kind, size_t size);
+void _xmmsv_alloc_free (xmmsv_alloc_kind_t kind, void *ptr);
+
+void _xmmsv_arena_begin (void);
+void _xmmsv_arena_end (void);
+
 xmmsv_t *_xmmsv_new (xmmsv_type_t type);
 
 void _xmmsv_list_free (xmmsv_list_internal_t *dict);
 void _xmmsv_dict_free (xmmsv_dict_internal_t *dict);
 void _xmmsv_coll_free (xmmsv_coll_internal_t *coll);
 
+unsigned char *_xmmsv_bitbuffer_reserve (xmmsv_t *v, int len);
+void _xmmsv_bitbuffer_set_length (xmmsv_t *v, int len);
+
+bool _xmmsv_freeze (xmmsv_t *val, bool apply);
+bool _xmmsv_list_freeze (xmmsv_list_internal_t *list, bool apply);
+bool _xmmsv_dict_freeze (xmmsv_dict_internal_t *dict, bool apply);
+bool _xmmsv_coll_freeze (xmmsv_coll_internal_t *coll, bool apply);
+
 #endif
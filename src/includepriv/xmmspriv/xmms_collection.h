@@ -77,6 +77,8 @@ xmmsv_t *xmms_collection_changed_msg_new (xmms_collection_changed_action_t type,
 void xmms_collection_changed_msg_send (xmms_coll_dag_t *colldag, xmmsv_t *dict);
 
 xmmsv_t *xmms_collection_snapshot (xmms_coll_dag_t *dag);
+xmmsv_t *xmms_collection_snapshot_collection (xmms_coll_dag_t *dag, const gchar *name, xmms_collection_namespace_id_t nsid);
+xmmsv_t *xmms_collection_snapshot_position (xmms_coll_dag_t *dag, const gchar *name);
 void xmms_collection_restore (xmms_coll_dag_t *dag, xmmsv_t *snapshot);
 
 #define XMMS_COLLECTION_PLAYLIST_CHANGED_MSG(dag, name) xmms_collection_changed_msg_send (dag, xmms_collection_changed_msg_new (XMMS_COLLECTION_CHANGED_UPDATE, name, XMMS_COLLECTION_NS_PLAYLISTS))
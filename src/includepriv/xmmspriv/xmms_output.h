@@ -38,6 +38,8 @@ void xmms_output_flush (xmms_output_t *output);
   */
 guint32 xmms_output_latency (xmms_output_t *output);
 
+gboolean xmms_output_is_realtime (xmms_output_t *output);
+
 gboolean xmms_output_plugin_switch (xmms_output_t *output, xmms_output_plugin_t *new_plugin);
 
 #endif
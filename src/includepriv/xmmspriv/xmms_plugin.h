@@ -35,6 +35,15 @@ typedef struct xmms_plugin_St {
 	const gchar *shortname;
 	const gchar *description;
 	const gchar *version;
+
+	/* Plugins registered from the manifest are only opened when they
+	 * are first needed, until then the strings above point into the
+	 * manifest entry.
+	 */
+	gchar *path;
+	xmmsv_t *manifest;
+	gboolean deferred;
+	gboolean broken;
 } xmms_plugin_t;
 
 /*
@@ -49,6 +58,8 @@ typedef gboolean (*xmms_plugin_foreach_func_t)(xmms_plugin_t *, gpointer);
 void xmms_plugin_foreach (xmms_plugin_type_t type, xmms_plugin_foreach_func_t func, gpointer user_data);
 
 xmms_plugin_t *xmms_plugin_find (xmms_plugin_type_t type, const gchar *name);
+gboolean xmms_plugin_ensure_loaded (xmms_plugin_t *plugin);
+gboolean xmms_plugin_manifest_record (xmmsv_t *registration);
 
 xmms_plugin_type_t xmms_plugin_type_get (const xmms_plugin_t *plugin);
 const char *xmms_plugin_name_get (const xmms_plugin_t *plugin);
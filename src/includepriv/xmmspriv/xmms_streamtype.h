@@ -19,11 +19,14 @@
 
 #include <stdarg.h>
 #include <xmms/xmms_streamtype.h>
+#include <xmmsc/xmmsv.h>
 
 xmms_stream_type_t *xmms_stream_type_parse (va_list ap);
 gboolean xmms_stream_type_match (const xmms_stream_type_t *in_type, const xmms_stream_type_t *out_type);
 xmms_stream_type_t *xmms_stream_type_coerce (const xmms_stream_type_t *in, const GList *goal_types);
 xmms_stream_type_t *_xmms_stream_type_new (const gchar *begin, ...);
+xmmsv_t *xmms_stream_type_to_value (const xmms_stream_type_t *st);
+xmms_stream_type_t *xmms_stream_type_from_value (xmmsv_t *list);
 
 
 #endif
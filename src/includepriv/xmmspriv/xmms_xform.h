@@ -39,7 +39,9 @@ xmms_xform_t *xmms_xform_chain_setup_url (xmms_medialib_t *medialib, xmms_medial
 
 gint64 xmms_xform_this_seek (xmms_xform_t *xform, gint64 offset, xmms_xform_seek_mode_t whence, xmms_error_t *err);
 int xmms_xform_this_read (xmms_xform_t *xform, gpointer buf, int siz, xmms_error_t *err);
+gint xmms_xform_peek_buffered (xmms_xform_t *xform, gpointer buf, gint siz);
 gboolean xmms_xform_iseos (xmms_xform_t *xform);
+xmmsv_t *xmms_xform_chain_stats (xmms_xform_t *xform);
 
 const GList *xmms_xform_goal_hints_get (xmms_xform_t *xform);
 xmms_stream_type_t *xmms_xform_intype_get (xmms_xform_t *xform);
@@ -50,6 +52,8 @@ xmmsv_t *xmms_xform_browse_method (xmms_xform_t *xform, const gchar *url, xmms_e
 
 const char *xmms_xform_indata_find_str (xmms_xform_t *xform, xmms_stream_type_key_t key);
 
+gboolean xmms_magic_add_list (const gchar *desc, const gchar *mime, xmmsv_t *specs);
+
 #define XMMS_XFORM_BUILTIN_DEFINE(shname, name, ver, desc, setupfunc) XMMS_BUILTIN_DEFINE(XMMS_PLUGIN_TYPE_XFORM, XMMS_XFORM_API_VERSION, shname, name, ver, desc, (gboolean (*)(gpointer))setupfunc)
 
 #endif
@@ -30,7 +30,9 @@ gboolean xmms_xform_plugin_browse (const xmms_xform_plugin_t *plugin, xmms_xform
 void xmms_xform_plugin_destroy (const xmms_xform_plugin_t *plugin, xmms_xform_t *xform);
 
 gboolean xmms_xform_plugin_supports (const xmms_xform_plugin_t *plugin, const xmms_stream_type_t *st, gint *priority);
+xmms_xform_plugin_t *xmms_xform_plugin_find (const xmms_stream_type_t *st, gint *priority);
 
 xmms_stream_type_t *xmms_xform_plugin_get_out_stream_type (xmms_xform_plugin_t *plugin);
+void xmms_xform_plugin_indata_add_type (xmms_xform_plugin_t *plugin, xmms_stream_type_t *t);
 
 #endif
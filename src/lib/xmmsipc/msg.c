@@ -19,6 +19,7 @@
 #include <stdlib.h>
 
 #include <errno.h>
+#include <limits.h>
 #include <time.h>
 #include <assert.h>
 
@@ -29,6 +30,10 @@
 #include <xmmsc/xmmsc_sockets.h>
 #include <xmmsc/xmmsc_stdint.h>
 #include <xmmsc/xmmsv_coll.h>
+#include <xmmscpriv/xmmsv.h>
+
+/* messages larger than this are read in chunks that double in size */
+#define XMMS_IPC_MSG_READ_CHUNK (1024 * 1024)
 
 struct xmms_ipc_msg_St {
 	xmmsv_t *bb;
@@ -228,6 +233,11 @@ xmms_ipc_msg_write_transport (xmms_ipc_msg_t *msg,
 /**
  * Try to read message from transport into msg.
  *
+ * The data is received straight into the message buffer, which is
+ * grown from the length in the header. Growth is limited to what has
+ * actually arrived so far, so a bogus header can't make us allocate
+ * gigabytes up front.
+ *
  * @returns TRUE if message is fully read.
  */
 bool
@@ -235,8 +245,9 @@ xmms_ipc_msg_read_transport (xmms_ipc_msg_t *msg,
                              xmms_ipc_transport_t *transport,
                              bool *disconnected)
 {
-	char buf[512];
+	unsigned char *buf;
 	unsigned int ret, len, rlen;
+	uint32_t body;
 
 	x_return_val_if_fail (msg, false);
 	x_return_val_if_fail (transport, false);
@@ -245,9 +256,21 @@ xmms_ipc_msg_read_transport (xmms_ipc_msg_t *msg,
 		len = XMMS_IPC_MSG_HEAD_LEN;
 
 		if (msg->xfered >= XMMS_IPC_MSG_HEAD_LEN) {
-			len += xmms_ipc_msg_get_length (msg);
+			body = xmms_ipc_msg_get_length (msg);
+
+			/* bitbuffer positions are in bits and must fit an int */
+			if (body > INT_MAX / 8 - XMMS_IPC_MSG_HEAD_LEN) {
+				if (disconnected) {
+					*disconnected = true;
+				}
+
+				return false;
+			}
+
+			len += body;
 
 			if (msg->xfered == len) {
+				xmmsv_bitbuffer_goto (msg->bb, XMMS_IPC_MSG_HEAD_LEN * 8);
 				return true;
 			}
 		}
@@ -255,10 +278,20 @@ xmms_ipc_msg_read_transport (xmms_ipc_msg_t *msg,
 		x_return_val_if_fail (msg->xfered < len, false);
 
 		rlen = len - msg->xfered;
-		if (rlen > sizeof (buf))
-			rlen = sizeof (buf);
+		if (rlen > msg->xfered + XMMS_IPC_MSG_READ_CHUNK)
+			rlen = msg->xfered + XMMS_IPC_MSG_READ_CHUNK;
+
+		buf = _xmmsv_bitbuffer_reserve (msg->bb, msg->xfered + rlen);
+		if (!buf) {
+			if (disconnected) {
+				*disconnected = true;
+			}
+
+			return false;
+		}
 
-		ret = xmms_ipc_transport_read (transport, buf, rlen);
+		ret = xmms_ipc_transport_read (transport, (char *) buf + msg->xfered,
+		                               rlen);
 
 		if (ret == SOCKET_ERROR) {
 			if (xmms_socket_error_recoverable ()) {
@@ -277,10 +310,8 @@ xmms_ipc_msg_read_transport (xmms_ipc_msg_t *msg,
 
 			return false;
 		} else {
-			xmmsv_bitbuffer_goto (msg->bb, msg->xfered * 8);
-			xmmsv_bitbuffer_put_data (msg->bb, (unsigned char *) buf, ret);
 			msg->xfered += ret;
-			xmmsv_bitbuffer_goto (msg->bb, XMMS_IPC_MSG_HEAD_LEN * 8);
+			_xmmsv_bitbuffer_set_length (msg->bb, msg->xfered);
 		}
 	}
 }
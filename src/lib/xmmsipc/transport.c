@@ -25,6 +25,8 @@
 #include "socket_tcp.h"
 #include "url.h"
 
+#define XMMS_IPC_TRANSPORT_READAHEAD 4096
+
 void
 xmms_ipc_transport_destroy (xmms_ipc_transport_t *ipct)
 {
@@ -32,13 +34,65 @@ xmms_ipc_transport_destroy (xmms_ipc_transport_t *ipct)
 
 	ipct->destroy_func (ipct);
 
+	free (ipct->rbuf);
 	free (ipct);
 }
 
+/**
+ * Read up to len bytes from the transport.
+ *
+ * Small reads, like message headers and short replies, are served
+ * from a read-ahead buffer so that a burst of small messages doesn't
+ * cost two system calls each. Large reads go straight into the
+ * caller's buffer. Callers must keep reading until the transport
+ * reports an error or would block, otherwise data may be left
+ * sitting in the read-ahead buffer.
+ */
 int
 xmms_ipc_transport_read (xmms_ipc_transport_t *ipct, char *buffer, int len)
 {
-	return ipct->read_func (ipct, buffer, len);
+	int ret;
+
+	if (ipct->rbuf_pos < ipct->rbuf_len) {
+		ret = ipct->rbuf_len - ipct->rbuf_pos;
+		if (ret > len)
+			ret = len;
+
+		memcpy (buffer, ipct->rbuf + ipct->rbuf_pos, ret);
+		ipct->rbuf_pos += ret;
+
+		return ret;
+	}
+
+	if (len >= XMMS_IPC_TRANSPORT_READAHEAD)
+		return ipct->read_func (ipct, buffer, len);
+
+	if (!ipct->rbuf) {
+		ipct->rbuf = malloc (XMMS_IPC_TRANSPORT_READAHEAD);
+		if (!ipct->rbuf)
+			return ipct->read_func (ipct, buffer, len);
+	}
+
+	ret = ipct->read_func (ipct, ipct->rbuf, XMMS_IPC_TRANSPORT_READAHEAD);
+	if (ret <= 0)
+		return ret;
+
+	ipct->rbuf_pos = 0;
+	ipct->rbuf_len = ret;
+
+	return xmms_ipc_transport_read (ipct, buffer, len);
+}
+
+/**
+ * Number of bytes already read ahead from the socket. A poll on the
+ * socket won't report these, so event loops need to check here first.
+ */
+int
+xmms_ipc_transport_pending (xmms_ipc_transport_t *ipct)
+{
+	x_return_val_if_fail (ipct, 0);
+
+	return ipct->rbuf_len - ipct->rbuf_pos;
 }
 
 int
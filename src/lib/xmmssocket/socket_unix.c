@@ -51,3 +51,40 @@ void xmms_socket_close (xmms_socket_t socket) {
 int xmms_socket_errno () {
 	return errno;
 }
+
+/**
+ * Wait for a socket to become readable, or writable if *writable is
+ * true on entry.
+ * @param timeout Milliseconds to wait at most, -1 to wait forever.
+ * On return *readable and *writable tell what the socket is ready for.
+ * Returns a positive number if it is ready, 0 on timeout and
+ * SOCKET_ERROR on failure.
+ */
+int xmms_socket_wait (xmms_socket_t socket, bool *readable, bool *writable, int timeout) {
+	struct pollfd pfd;
+	int ret;
+
+	pfd.fd = socket;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	if (*writable) {
+		pfd.events |= POLLOUT;
+	}
+
+	ret = poll (&pfd, 1, timeout);
+
+	/* the descriptor isn't open, nothing will ever happen on it */
+	if (ret > 0 && (pfd.revents & POLLNVAL)) {
+		*readable = false;
+		*writable = false;
+		errno = EBADF;
+		return SOCKET_ERROR;
+	}
+
+	/* hangups and errors are found out about by reading */
+	*readable = ret > 0 && (pfd.revents & (POLLIN | POLLHUP | POLLERR));
+	*writable = ret > 0 && (pfd.revents & POLLOUT);
+
+	return ret;
+}
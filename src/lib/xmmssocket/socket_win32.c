@@ -43,3 +43,39 @@ void xmms_socket_close (xmms_socket_t socket) {
 int xmms_socket_errno () {
 	return WSAGetLastError ();
 }
+
+/**
+ * Wait for a socket to become readable, or writable if *writable is
+ * true on entry.
+ * @param timeout Milliseconds to wait at most, -1 to wait forever.
+ * On return *readable and *writable tell what the socket is ready for.
+ * Returns a positive number if it is ready, 0 on timeout and
+ * SOCKET_ERROR on failure.
+ */
+int xmms_socket_wait (xmms_socket_t socket, bool *readable, bool *writable, int timeout) {
+	fd_set rfdset, wfdset;
+	struct timeval tmout, *tmoutp = NULL;
+	int ret;
+
+	/* fd_set is a list of sockets here, not a bitmap, so any socket fits */
+	FD_ZERO (&rfdset);
+	FD_SET (socket, &rfdset);
+
+	FD_ZERO (&wfdset);
+	if (*writable) {
+		FD_SET (socket, &wfdset);
+	}
+
+	if (timeout >= 0) {
+		tmout.tv_sec = timeout / 1000;
+		tmout.tv_usec = (timeout % 1000) * 1000;
+		tmoutp = &tmout;
+	}
+
+	ret = select (0, &rfdset, &wfdset, NULL, tmoutp);
+
+	*readable = ret > 0 && FD_ISSET (socket, &rfdset);
+	*writable = ret > 0 && FD_ISSET (socket, &wfdset);
+
+	return ret;
+}
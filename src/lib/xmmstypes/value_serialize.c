@@ -19,6 +19,7 @@
 
 #include <xmmsc/xmmsc_stdbool.h>
 #include <xmmsc/xmmsv.h>
+#include <xmmscpriv/xmmsv.h>
 #include <xmmscpriv/xmmsc_util.h>
 
 static bool _internal_put_on_bb_bin (xmmsv_t *bb, const unsigned char *data, unsigned int len);
@@ -650,12 +651,18 @@ int
 xmmsv_bitbuffer_deserialize_value (xmmsv_t *bb, xmmsv_t **val)
 {
 	int32_t type;
+	bool ret;
 
 	if (!_internal_get_from_bb_int32 (bb, &type)) {
 		return false;
 	}
 
-	return _internal_get_from_bb_value_of_type_alloc (bb, type, val);
+	/* The whole tree is usually freed at once, so allocate it in one go. */
+	_xmmsv_arena_begin ();
+	ret = _internal_get_from_bb_value_of_type_alloc (bb, type, val);
+	_xmmsv_arena_end ();
+
+	return ret;
 }
 
 
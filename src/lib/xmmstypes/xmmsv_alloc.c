@@ -0,0 +1,418 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <xmmscpriv/xmmsv.h>
+#include <xmmscpriv/xmmsc_util.h>
+
+#include <xmmsc/xmmsv.h>
+
+/** @file
+ * Allocator for #xmmsv_t and the headers of lists and dicts.
+ *
+ * Every thread keeps a few freed objects of each kind around, so the
+ * constant churn of short-lived values doesn't go through malloc. While
+ * an arena is open, which is the case when deserializing, objects are
+ * instead carved out of larger regions that are released in one go when
+ * the last object allocated from them is freed.
+ *
+ * Setting XMMSV_DISABLE_POOLS in the environment makes every object a
+ * plain malloc, which is handy when hunting leaks with valgrind.
+ */
+
+#if defined (XMMSV_ALLOC_POOLS) && !(defined (__GNUC__) && defined (__ATOMIC_RELAXED))
+#	undef XMMSV_ALLOC_POOLS
+#endif
+
+#ifdef XMMSV_ALLOC_POOLS
+#	include <pthread.h>
+#endif
+
+/* Number of freed objects of each kind a thread keeps for reuse. */
+#define XMMSV_ALLOC_CACHE_SIZE 256
+
+/* Arenas start out small as most messages are tiny, and grow from there. */
+#define XMMSV_ARENA_CHUNK_MIN_SIZE 1024
+#define XMMSV_ARENA_CHUNK_MAX_SIZE 65536
+
+typedef struct xmmsv_arena_St xmmsv_arena_t;
+
+/* Precedes every object, tells where it has to be returned to. */
+typedef union {
+	xmmsv_arena_t *arena;
+	int64_t align_int;
+	double align_double;
+	void *align_ptr;
+} xmmsv_alloc_header_t;
+
+/* Cached objects are chained through their (no longer used) body. */
+typedef struct xmmsv_alloc_free_St {
+	struct xmmsv_alloc_free_St *next;
+} xmmsv_alloc_free_t;
+
+typedef union xmmsv_arena_chunk_St {
+	union xmmsv_arena_chunk_St *next;
+	xmmsv_alloc_header_t align;
+} xmmsv_arena_chunk_t;
+
+struct xmmsv_arena_St {
+	xmmsv_arena_chunk_t *chunks;
+	char *pos;
+	char *end;
+	size_t size;
+
+	/* objects still in use, plus one while the arena is open */
+	long live;
+};
+
+typedef struct {
+	xmmsv_alloc_free_t *free[XMMSV_ALLOC_NUM_KINDS];
+	int length[XMMSV_ALLOC_NUM_KINDS];
+
+	xmmsv_arena_t *arena;
+	int arena_depth;
+
+	bool registered;
+} xmmsv_alloc_cache_t;
+
+typedef struct {
+	long allocated;
+	long freed;
+	long reused;
+	long arena;
+} xmmsv_alloc_counters_t;
+
+static const char *kind_names[XMMSV_ALLOC_NUM_KINDS] = {
+	"value",
+	"list",
+	"dict"
+};
+
+static xmmsv_alloc_counters_t counters[XMMSV_ALLOC_NUM_KINDS];
+static long arenas_live;
+static long arenas_size;
+
+#ifdef XMMSV_ALLOC_POOLS
+
+static __thread xmmsv_alloc_cache_t cache;
+
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+static int pools_disabled = -1;
+
+/* Called on thread exit, returns the cached objects to malloc. */
+static void
+_xmmsv_alloc_cache_flush (void *data)
+{
+	xmmsv_alloc_cache_t *c = (xmmsv_alloc_cache_t *) data;
+	xmmsv_alloc_free_t *item;
+	int i;
+
+	for (i = 0; i < XMMSV_ALLOC_NUM_KINDS; i++) {
+		while (c->free[i]) {
+			item = c->free[i];
+			c->free[i] = item->next;
+			free ((xmmsv_alloc_header_t *) item - 1);
+		}
+		c->length[i] = 0;
+	}
+
+	c->registered = false;
+}
+
+static void
+_xmmsv_alloc_cache_key_create (void)
+{
+	pthread_key_create (&cache_key, _xmmsv_alloc_cache_flush);
+}
+
+static xmmsv_alloc_cache_t *
+_xmmsv_alloc_cache (void)
+{
+	if (pools_disabled < 0) {
+		pools_disabled = getenv ("XMMSV_DISABLE_POOLS") != NULL;
+	}
+
+	if (pools_disabled) {
+		return NULL;
+	}
+
+	if (!cache.registered) {
+		pthread_once (&cache_key_once, _xmmsv_alloc_cache_key_create);
+		pthread_setspecific (cache_key, &cache);
+		cache.registered = true;
+	}
+
+	return &cache;
+}
+
+#else
+
+static xmmsv_alloc_cache_t *
+_xmmsv_alloc_cache (void)
+{
+	return NULL;
+}
+
+#endif
+
+static size_t
+_xmmsv_alloc_slot_size (size_t size)
+{
+	const size_t align = sizeof (xmmsv_alloc_header_t);
+
+	return align + ((size + align - 1) / align) * align;
+}
+
+static xmmsv_alloc_header_t *
+_xmmsv_arena_alloc (xmmsv_arena_t *arena, size_t size)
+{
+	xmmsv_alloc_header_t *header;
+
+	size = _xmmsv_alloc_slot_size (size);
+
+	if ((size_t) (arena->end - arena->pos) < size) {
+		xmmsv_arena_chunk_t *chunk;
+		size_t chunk_size;
+
+		chunk_size = arena->chunks ? arena->size : XMMSV_ARENA_CHUNK_MIN_SIZE;
+		if (chunk_size > XMMSV_ARENA_CHUNK_MAX_SIZE) {
+			chunk_size = XMMSV_ARENA_CHUNK_MAX_SIZE;
+		}
+
+		chunk = x_malloc (chunk_size);
+		if (!chunk) {
+			return NULL;
+		}
+
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+		arena->pos = (char *) (chunk + 1);
+		arena->end = (char *) chunk + chunk_size;
+		arena->size += chunk_size;
+
+		XMMSV_ATOMIC_ADD (&arenas_size, chunk_size);
+	}
+
+	header = (xmmsv_alloc_header_t *) arena->pos;
+	arena->pos += size;
+
+	memset (header, 0, size);
+	header->arena = arena;
+
+	XMMSV_ATOMIC_ADD (&arena->live, 1);
+
+	return header;
+}
+
+static void
+_xmmsv_arena_release (xmmsv_arena_t *arena)
+{
+	xmmsv_arena_chunk_t *chunk;
+
+	if (XMMSV_ATOMIC_SUB (&arena->live, 1) > 0) {
+		return;
+	}
+
+	while (arena->chunks) {
+		chunk = arena->chunks;
+		arena->chunks = chunk->next;
+		free (chunk);
+	}
+
+	XMMSV_ATOMIC_SUB (&arenas_size, arena->size);
+	XMMSV_ATOMIC_SUB (&arenas_live, 1);
+
+	free (arena);
+}
+
+/**
+ * Allocates a zeroed object of the given kind.
+ * @internal
+ */
+void *
+_xmmsv_alloc (xmmsv_alloc_kind_t kind, size_t size)
+{
+	xmmsv_alloc_cache_t *c = _xmmsv_alloc_cache ();
+	xmmsv_alloc_header_t *header = NULL;
+	xmmsv_alloc_free_t *item;
+
+	if (c && c->arena) {
+		header = _xmmsv_arena_alloc (c->arena, size);
+		if (header) {
+			XMMSV_ATOMIC_ADD (&counters[kind].arena, 1);
+		}
+	}
+
+	if (!header && c && c->free[kind]) {
+		item = c->free[kind];
+		c->free[kind] = item->next;
+		c->length[kind]--;
+
+		header = (xmmsv_alloc_header_t *) item - 1;
+		memset (header, 0, _xmmsv_alloc_slot_size (size));
+
+		XMMSV_ATOMIC_ADD (&counters[kind].reused, 1);
+	}
+
+	if (!header) {
+		header = x_malloc0 (_xmmsv_alloc_slot_size (size));
+		if (!header) {
+			return NULL;
+		}
+	}
+
+	XMMSV_ATOMIC_ADD (&counters[kind].allocated, 1);
+
+	return header + 1;
+}
+
+/**
+ * Frees an object allocated with #_xmmsv_alloc.
+ * @internal
+ */
+void
+_xmmsv_alloc_free (xmmsv_alloc_kind_t kind, void *ptr)
+{
+	xmmsv_alloc_header_t *header;
+	xmmsv_alloc_free_t *item;
+	xmmsv_alloc_cache_t *c;
+
+	x_return_if_fail (ptr);
+
+	XMMSV_ATOMIC_ADD (&counters[kind].freed, 1);
+
+	header = (xmmsv_alloc_header_t *) ptr - 1;
+	if (header->arena) {
+		_xmmsv_arena_release (header->arena);
+		return;
+	}
+
+	c = _xmmsv_alloc_cache ();
+	if (c && c->length[kind] < XMMSV_ALLOC_CACHE_SIZE) {
+		item = (xmmsv_alloc_free_t *) ptr;
+		item->next = c->free[kind];
+		c->free[kind] = item;
+		c->length[kind]++;
+		return;
+	}
+
+	free (header);
+}
+
+/**
+ * Makes the objects allocated by this thread come from one arena until
+ * the matching #_xmmsv_arena_end. Calls may be nested.
+ * @internal
+ */
+void
+_xmmsv_arena_begin (void)
+{
+	xmmsv_alloc_cache_t *c = _xmmsv_alloc_cache ();
+
+	if (!c || c->arena_depth++ > 0) {
+		return;
+	}
+
+	c->arena = x_new0 (xmmsv_arena_t, 1);
+	if (!c->arena) {
+		x_oom ();
+		return;
+	}
+
+	c->arena->live = 1;
+
+	XMMSV_ATOMIC_ADD (&arenas_live, 1);
+}
+
+/**
+ * Closes the arena opened by #_xmmsv_arena_begin. It is released when
+ * the last object allocated from it is freed.
+ * @internal
+ */
+void
+_xmmsv_arena_end (void)
+{
+	xmmsv_alloc_cache_t *c = _xmmsv_alloc_cache ();
+	xmmsv_arena_t *arena;
+
+	if (!c || --c->arena_depth > 0) {
+		return;
+	}
+
+	arena = c->arena;
+	c->arena = NULL;
+
+	if (arena) {
+		_xmmsv_arena_release (arena);
+	}
+}
+
+/**
+ * Get statistics about the values allocated by this process.
+ *
+ * For each kind of object ("value", "list" and "dict") the dict holds
+ * the number of objects allocated in total ("<kind>.allocated"), still
+ * in use ("<kind>.live"), reused from a free-list ("<kind>.reused") and
+ * allocated from an arena ("<kind>.arena"). "arena.live" and
+ * "arena.bytes" tell how many arenas, and how much memory in them, are
+ * being kept alive by the values allocated from them.
+ *
+ * @return A new dict #xmmsv_t. Must be unreferenced with #xmmsv_unref.
+ */
+xmmsv_t *
+xmmsv_get_alloc_stats (void)
+{
+	xmmsv_alloc_counters_t snapshot[XMMSV_ALLOC_NUM_KINDS];
+	long live, size;
+	char key[32];
+	xmmsv_t *stats;
+	int i;
+
+	for (i = 0; i < XMMSV_ALLOC_NUM_KINDS; i++) {
+		snapshot[i].allocated = XMMSV_ATOMIC_GET (&counters[i].allocated);
+		snapshot[i].freed = XMMSV_ATOMIC_GET (&counters[i].freed);
+		snapshot[i].reused = XMMSV_ATOMIC_GET (&counters[i].reused);
+		snapshot[i].arena = XMMSV_ATOMIC_GET (&counters[i].arena);
+	}
+
+	live = XMMSV_ATOMIC_GET (&arenas_live);
+	size = XMMSV_ATOMIC_GET (&arenas_size);
+
+	stats = xmmsv_new_dict ();
+
+	for (i = 0; i < XMMSV_ALLOC_NUM_KINDS; i++) {
+		snprintf (key, sizeof (key), "%s.allocated", kind_names[i]);
+		xmmsv_dict_set_int (stats, key, snapshot[i].allocated);
+
+		snprintf (key, sizeof (key), "%s.live", kind_names[i]);
+		xmmsv_dict_set_int (stats, key, snapshot[i].allocated - snapshot[i].freed);
+
+		snprintf (key, sizeof (key), "%s.reused", kind_names[i]);
+		xmmsv_dict_set_int (stats, key, snapshot[i].reused);
+
+		snprintf (key, sizeof (key), "%s.arena", kind_names[i]);
+		xmmsv_dict_set_int (stats, key, snapshot[i].arena);
+	}
+
+	xmmsv_dict_set_int (stats, "arena.live", live);
+	xmmsv_dict_set_int (stats, "arena.bytes", size);
+
+	return stats;
+}
@@ -14,7 +14,9 @@
  *  Lesser General Public License for more details.
  */
 
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <xmmscpriv/xmmsv.h>
@@ -105,6 +107,15 @@ xmmsv_bitbuffer_get_bits (xmmsv_t *v, int bits, int64_t *res)
 int
 xmmsv_bitbuffer_get_data (xmmsv_t *v, unsigned char *b, int len)
 {
+	/* whole bytes can be copied in one go */
+	if (v->value.bit.pos % 8 == 0) {
+		if (len > (v->value.bit.len - v->value.bit.pos) / 8)
+			return 0;
+		memcpy (b, v->value.bit.buf + v->value.bit.pos / 8, len);
+		v->value.bit.pos += len * 8;
+		return 1;
+	}
+
 	while (len) {
 		int64_t t;
 		if (!xmmsv_bitbuffer_get_bits (v, 8, &t))
@@ -174,6 +185,22 @@ xmmsv_bitbuffer_put_bits_at (xmmsv_t *v, int bits, int64_t d, int offset)
 int
 xmmsv_bitbuffer_put_data (xmmsv_t *v, const unsigned char *b, int len)
 {
+	/* whole bytes can be copied in one go */
+	if (v->value.bit.pos % 8 == 0 && !v->value.bit.ro) {
+		int pos = v->value.bit.pos / 8;
+
+		if ((pos + len) * 8 > v->value.bit.alloclen) {
+			int nl = v->value.bit.alloclen / 8 * 2;
+			if (!_xmmsv_bitbuffer_reserve (v, nl > pos + len ? nl : pos + len))
+				return 0;
+		}
+
+		memcpy (v->value.bit.buf + pos, b, len);
+		_xmmsv_bitbuffer_set_length (v, pos + len);
+		v->value.bit.pos = (pos + len) * 8;
+		return 1;
+	}
+
 	while (len) {
 		int t;
 		t = *b;
@@ -185,6 +212,48 @@ xmmsv_bitbuffer_put_data (xmmsv_t *v, const unsigned char *b, int len)
 	return 1;
 }
 
+/**
+ * Make sure the bitbuffer has room for at least len bytes, so that it
+ * can be filled directly through the returned pointer. The length of
+ * the contents is not changed, see _xmmsv_bitbuffer_set_length ().
+ *
+ * @return the buffer, or NULL if it could not be grown
+ */
+unsigned char *
+_xmmsv_bitbuffer_reserve (xmmsv_t *v, int len)
+{
+	unsigned char *buf;
+
+	x_api_error_if (v->value.bit.ro, "write to readonly bitbuffer", NULL);
+	x_api_error_if (len < 0 || len > INT_MAX / 8, "invalid length", NULL);
+
+	if (len * 8 <= v->value.bit.alloclen)
+		return v->value.bit.buf;
+
+	buf = realloc (v->value.bit.buf, len);
+	if (!buf)
+		return NULL;
+
+	v->value.bit.buf = buf;
+	v->value.bit.alloclen = len * 8;
+
+	return buf;
+}
+
+/**
+ * Extend the contents of the bitbuffer to len bytes, after they have
+ * been written through the pointer from _xmmsv_bitbuffer_reserve ().
+ * Never shrinks the contents.
+ */
+void
+_xmmsv_bitbuffer_set_length (xmmsv_t *v, int len)
+{
+	x_return_if_fail (len * 8 <= v->value.bit.alloclen);
+
+	if (len * 8 > v->value.bit.len)
+		v->value.bit.len = len * 8;
+}
+
 int
 xmmsv_bitbuffer_align (xmmsv_t *v)
 {
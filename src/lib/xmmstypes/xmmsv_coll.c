@@ -31,6 +31,8 @@ struct xmmsv_coll_internal_St {
 	xmmsv_t *operands;
 	xmmsv_t *attributes;
 	xmmsv_t *idlist;
+
+	bool frozen;
 };
 
 static xmmsv_coll_internal_t *_xmmsv_coll_new (xmmsv_coll_type_t type);
@@ -159,6 +161,22 @@ _xmmsv_coll_free (xmmsv_coll_internal_t *coll)
 	free (coll);
 }
 
+bool
+_xmmsv_coll_freeze (xmmsv_coll_internal_t *coll, bool apply)
+{
+	if (!_xmmsv_freeze (coll->operands, apply) ||
+	    !_xmmsv_freeze (coll->attributes, apply) ||
+	    !_xmmsv_freeze (coll->idlist, apply)) {
+		return false;
+	}
+
+	if (apply) {
+		coll->frozen = true;
+	}
+
+	return true;
+}
+
 /**
  * Set the list of ids in the given collection.
  * The list must be 0-terminated.
@@ -437,6 +455,7 @@ xmmsv_coll_idlist_set (xmmsv_t *coll, xmmsv_t *idlist)
 	x_return_if_fail (coll);
 	x_return_if_fail (idlist);
 	x_return_if_fail (xmmsv_list_restrict_type (idlist, XMMSV_TYPE_INT64));
+	x_api_error_if (coll->value.coll->frozen, "on a frozen collection",);
 
 	old = coll->value.coll->idlist;
 	coll->value.coll->idlist = xmmsv_ref (idlist);
@@ -465,6 +484,7 @@ xmmsv_coll_operands_set (xmmsv_t *coll, xmmsv_t *operands)
 	x_return_if_fail (coll);
 	x_return_if_fail (operands);
 	x_return_if_fail (xmmsv_list_restrict_type (operands, XMMSV_TYPE_COLL));
+	x_api_error_if (coll->value.coll->frozen, "on a frozen collection",);
 
 	old = coll->value.coll->operands;
 	coll->value.coll->operands = xmmsv_ref (operands);
@@ -493,6 +513,7 @@ xmmsv_coll_attributes_set (xmmsv_t *coll, xmmsv_t *attributes)
 	x_return_if_fail (coll);
 	x_return_if_fail (attributes);
 	x_return_if_fail (xmmsv_is_type (attributes, XMMSV_TYPE_DICT));
+	x_api_error_if (coll->value.coll->frozen, "on a frozen collection",);
 
 	old = coll->value.coll->attributes;
 	coll->value.coll->attributes = xmmsv_ref (attributes);
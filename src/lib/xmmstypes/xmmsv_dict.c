@@ -22,16 +22,28 @@
 
 typedef struct xmmsv_dict_data_St {
 	uint32_t hash;
+	/* str belongs to the table of interned keys */
+	bool interned;
 	char *str;
 	xmmsv_t *value;
 } xmmsv_dict_data_t;
 
+/* Dicts with up to this many entries are kept unhashed, inline. */
+#define SMALL_DICT_SIZE 8
+
 struct xmmsv_dict_internal_St {
 	int elems;
+	/* log2 of the hash table size, or 0 while the dict is small */
 	int size;
 	xmmsv_dict_data_t *data;
 
 	x_list_t *iterators;
+
+	bool frozen;
+	/* guards iterators once the dict is frozen and may be shared */
+	bool iterators_lock;
+
+	xmmsv_dict_data_t small[SMALL_DICT_SIZE];
 };
 
 struct xmmsv_dict_iter_St {
@@ -45,7 +57,32 @@ static void _xmmsv_dict_iter_free (xmmsv_dict_iter_t *it);
 #define HASH_FILL_LIM 7
 #define DELETED_STR ((char*)-1)
 #define DICT_INIT_DATA(s) {.hash = _xmmsv_dict_hash (s, strlen (s)), .str = (char*)s}
-#define START_SIZE 2
+#define DICT_SLOTS(d) ((d)->size ? 1 << (d)->size : SMALL_DICT_SIZE)
+#define DICT_IS_SMALL(d) ((d)->size == 0)
+#define START_SIZE 4
+
+/* The property names that nearly every medialib dict carries. Only these
+ * are interned, so the set stays fixed no matter which keys clients send.
+ * Sorted in strcmp order for bsearch.
+ */
+static const char *intern_keys[] = {
+	"added", "album", "album_artist", "album_artist_sort", "album_id",
+	"album_sort", "arranger", "artist", "artist_id", "artist_sort",
+	"asin", "barcode", "bitrate", "bpm", "catalognumber", "chain",
+	"channel", "channels", "comment", "commentlang", "compilation",
+	"composer", "conductor", "copyright", "date", "description",
+	"djmixer", "duration", "gain_album", "gain_track", "genre",
+	"grouping", "id", "isrc", "isvbr", "laststarted", "lmod", "lyricist",
+	"mime", "mixer", "name", "namespace", "original_artist",
+	"originaldate", "partofset", "peak_album", "peak_track", "performer",
+	"picture_front", "picture_front_mime", "producer", "publisher",
+	"release_country", "release_format", "release_status",
+	"release_type", "remixer", "sample_format", "samplerate", "size",
+	"source", "startms", "status", "stopms", "subtunes", "timesplayed",
+	"title", "title_sort", "totalset", "totaltracks", "track_id",
+	"tracknr", "type", "url", "value", "website_artist",
+	"website_copyright", "website_file", "website_publisher"
+};
 
 /* MurmurHash2, by Austin Appleby */
 static uint32_t
@@ -101,6 +138,63 @@ _xmmsv_dict_hash (const void *key, int len)
 	return h;
 }
 
+static int
+_xmmsv_dict_intern_compare (const void *key, const void *member)
+{
+	return strcmp ((const char *) key, *(const char **) member);
+}
+
+/* Returns the interned copy of a key, or NULL if it isn't one of the
+ * known keys, in which case the dict has to own a copy of its own.
+ */
+static char *
+_xmmsv_dict_intern (const char *key)
+{
+	const char **found;
+
+	found = bsearch (key, intern_keys,
+	                 sizeof (intern_keys) / sizeof (intern_keys[0]),
+	                 sizeof (intern_keys[0]), _xmmsv_dict_intern_compare);
+
+	return found ? (char *) *found : NULL;
+}
+
+static bool
+_xmmsv_dict_key_equal (const xmmsv_dict_data_t *entry, const char *key)
+{
+	return entry->str == key || strcmp (entry->str, key) == 0;
+}
+
+/* Searches a small dict for an entry matching the string in data, which
+ * needs no hash. Other than that it works like _xmmsv_dict_search.
+ */
+static int
+_xmmsv_dict_search_small (xmmsv_dict_internal_t *dict, const char *key,
+                          int *pos, int *deleted)
+{
+	int i;
+
+	*deleted = -1;
+	*pos = -1;
+
+	for (i = 0; i < SMALL_DICT_SIZE; i++) {
+		if (dict->data[i].str == NULL) {
+			if (*pos == -1) {
+				*pos = i;
+			}
+		} else if (dict->data[i].str == DELETED_STR) {
+			if (*deleted == -1) {
+				*deleted = i;
+			}
+		} else if (_xmmsv_dict_key_equal (&dict->data[i], key)) {
+			*pos = i;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
 /* Searches the hash table for an entry matching the hash and string in data.
  * It will save the found position in pos.
  * If a deleted position was found before the key, it will be saved in deleted
@@ -110,9 +204,15 @@ static int
 _xmmsv_dict_search (xmmsv_dict_internal_t *dict, xmmsv_dict_data_t data,
                     int *pos, int *deleted)
 {
-	int bucket = data.hash & HASH_MASK (dict);
-	int stop = bucket;
-	int size = 1 << dict->size;
+	int bucket, stop, size;
+
+	if (DICT_IS_SMALL (dict)) {
+		return _xmmsv_dict_search_small (dict, data.str, pos, deleted);
+	}
+
+	bucket = data.hash & HASH_MASK (dict);
+	stop = bucket;
+	size = 1 << dict->size;
 
 	*deleted = -1;
 
@@ -124,7 +224,7 @@ _xmmsv_dict_search (xmmsv_dict_internal_t *dict, xmmsv_dict_data_t data,
 			}
 			/* If we found the entry we save it in the pos pointer */
 		} else if (dict->data[bucket].hash == data.hash
-		           && strcmp (dict->data[bucket].str, data.str) == 0) {
+		           && _xmmsv_dict_key_equal (&dict->data[bucket], data.str)) {
 			*pos = bucket;
 			return 1;
 		}
@@ -147,8 +247,21 @@ _xmmsv_dict_search (xmmsv_dict_internal_t *dict, xmmsv_dict_data_t data,
 	return 0;
 }
 
-/* Inserts data into the hash table */
-static void
+/* Looks up a key, only hashing it if the dict is large enough to need it */
+static int
+_xmmsv_dict_find (xmmsv_dict_internal_t *dict, const char *key,
+                  int *pos, int *deleted)
+{
+	if (DICT_IS_SMALL (dict)) {
+		return _xmmsv_dict_search_small (dict, key, pos, deleted);
+	} else {
+		xmmsv_dict_data_t data = DICT_INIT_DATA (key);
+		return _xmmsv_dict_search (dict, data, pos, deleted);
+	}
+}
+
+/* Inserts data into the hash table, returns 0 if a small dict is full */
+static int
 _xmmsv_dict_insert (xmmsv_dict_internal_t *dict, xmmsv_dict_data_t data, int alloc)
 {
 	int pos, deleted;
@@ -158,9 +271,17 @@ _xmmsv_dict_insert (xmmsv_dict_internal_t *dict, xmmsv_dict_data_t data, int all
 		xmmsv_unref (dict->data[pos].value);
 		dict->data[pos].value = data.value;
 	} else {
+		/* A small dict has run out of room */
+		if (pos == -1 && deleted == -1) {
+			return 0;
+		}
+
 		/* Otherwise we insert a new entry */
-		if (alloc)
-			data.str = strdup (data.str);
+		if (alloc) {
+			char *interned = _xmmsv_dict_intern (data.str);
+			data.interned = interned != NULL;
+			data.str = data.interned ? interned : strdup (data.str);
+		}
 		dict->elems++;
 		/* If we found a deleted entry before an empty one we use the free entry */
 		if (deleted != -1) {
@@ -169,6 +290,8 @@ _xmmsv_dict_insert (xmmsv_dict_internal_t *dict, xmmsv_dict_data_t data, int all
 			dict->data[pos] = data;
 		}
 	}
+
+	return 1;
 }
 
 /* Remove an entry at the given position
@@ -176,7 +299,9 @@ _xmmsv_dict_insert (xmmsv_dict_internal_t *dict, xmmsv_dict_data_t data, int all
 static void
 _xmmsv_dict_remove (xmmsv_dict_internal_t *dict, int pos)
 {
-	free ((void*)dict->data[pos].str);
+	if (!dict->data[pos].interned) {
+		free ((void*)dict->data[pos].str);
+	}
 	dict->data[pos].str = DELETED_STR;
 	xmmsv_unref (dict->data[pos].value);
 	dict->data[pos].value = NULL;
@@ -184,28 +309,55 @@ _xmmsv_dict_remove (xmmsv_dict_internal_t *dict, int pos)
 }
 
 /* Resizes the hash table by creating a new data table
- * twice the size of the old one
+ * twice the size of the old one, small dicts are turned into a hash
+ * table of START_SIZE.
  */
 static void
 _xmmsv_dict_resize (xmmsv_dict_internal_t *dict)
 {
-	int i;
+	int i, slots;
 	xmmsv_dict_data_t *old_data;
 
+	slots = DICT_SLOTS (dict);
+
 	/* Double the table size */
-	dict->size++;
+	dict->size = DICT_IS_SMALL (dict) ? START_SIZE : dict->size + 1;
 	dict->elems = 0;
 	old_data = dict->data;
 	dict->data = x_new0 (xmmsv_dict_data_t, 1 << dict->size);
 
 	/* Insert all the entries in the old table into the new one */
-	for (i = 0; i < (1 << (dict->size - 1)); i++) {
-		if (old_data[i].str != NULL) {
+	for (i = 0; i < slots; i++) {
+		if (old_data[i].str != NULL && old_data[i].str != DELETED_STR) {
 			_xmmsv_dict_insert (dict, old_data[i], 0);
 		}
 	}
 
-	free (old_data);
+	if (old_data == dict->small) {
+		memset (dict->small, 0, sizeof (dict->small));
+	} else {
+		free (old_data);
+	}
+}
+
+bool
+_xmmsv_dict_freeze (xmmsv_dict_internal_t *dict, bool apply)
+{
+	int i;
+
+	for (i = DICT_SLOTS (dict) - 1; i >= 0; i--) {
+		if (dict->data[i].str != NULL && dict->data[i].str != DELETED_STR) {
+			if (!_xmmsv_freeze (dict->data[i].value, apply)) {
+				return false;
+			}
+		}
+	}
+
+	if (apply) {
+		dict->frozen = true;
+	}
+
+	return true;
 }
 
 static xmmsv_dict_internal_t *
@@ -213,29 +365,43 @@ _xmmsv_dict_new (void)
 {
 	xmmsv_dict_internal_t *dict;
 
-	dict = x_new0 (xmmsv_dict_internal_t, 1);
+	dict = _xmmsv_alloc (XMMSV_ALLOC_DICT, sizeof (xmmsv_dict_internal_t));
 	if (!dict) {
 		x_oom ();
 		return NULL;
 	}
 
-	dict->size = 2;
-	dict->data = x_new0 (xmmsv_dict_data_t, (1 << dict->size));
+	dict->size = 0;
+	dict->data = dict->small;
 
-	if (!dict->data) {
-		x_oom ();
-		free (dict);
-		return NULL;
+	return dict;
+}
+
+/* Unrefs and frees all entries, leaving the slots empty. */
+static void
+_xmmsv_dict_clear (xmmsv_dict_internal_t *dict)
+{
+	int i;
+
+	for (i = DICT_SLOTS (dict) - 1; i >= 0; i--) {
+		if (dict->data[i].str != NULL) {
+			if (dict->data[i].str != DELETED_STR) {
+				if (!dict->data[i].interned) {
+					free (dict->data[i].str);
+				}
+				xmmsv_unref (dict->data[i].value);
+			}
+			dict->data[i].str = NULL;
+		}
 	}
 
-	return dict;
+	dict->elems = 0;
 }
 
 void
 _xmmsv_dict_free (xmmsv_dict_internal_t *dict)
 {
 	xmmsv_dict_iter_t *it;
-	int i;
 
 	/* free iterators */
 	while (dict->iterators) {
@@ -243,17 +409,12 @@ _xmmsv_dict_free (xmmsv_dict_internal_t *dict)
 		_xmmsv_dict_iter_free (it);
 	}
 
-	for (i = (1 << dict->size) - 1; i >= 0; i--) {
-		if (dict->data[i].str != NULL) {
-			if (dict->data[i].str != DELETED_STR) {
-				free (dict->data[i].str);
-				xmmsv_unref (dict->data[i].value);
-			}
-			dict->data[i].str = NULL;
-		}
+	_xmmsv_dict_clear (dict);
+
+	if (dict->data != dict->small) {
+		free (dict->data);
 	}
-	free (dict->data);
-	free (dict);
+	_xmmsv_alloc_free (XMMSV_ALLOC_DICT, dict);
 }
 
 /**
@@ -375,16 +536,15 @@ xmmsv_dict_get (xmmsv_t *dictv, const char *key, xmmsv_t **val)
 	x_return_val_if_fail (dictv, 0);
 	x_return_val_if_fail (xmmsv_is_type (dictv, XMMSV_TYPE_DICT), 0);
 
-	xmmsv_dict_data_t data = DICT_INIT_DATA (key);
 	dict = dictv->value.dict;
 
-	if (_xmmsv_dict_search (dict, data, &pos, &deleted)) {
+	if (_xmmsv_dict_find (dict, key, &pos, &deleted)) {
 		/* If there was a deleted entry before the one we found
 		 * we can optimize a little by moving the entry to the
 		 * deleted slot (and thus closer to the actual bucket it
-		 * belongs to)
+		 * belongs to), unless others may be reading it too.
 		 */
-		if (deleted != -1) {
+		if (deleted != -1 && !DICT_IS_SMALL (dict) && !dict->frozen) {
 			dict->data[deleted] = dict->data[pos];
 			dict->data[pos].str = DELETED_STR;
 		}
@@ -417,17 +577,22 @@ xmmsv_dict_set (xmmsv_t *dictv, const char *key, xmmsv_t *val)
 	x_return_val_if_fail (val, 0);
 	x_return_val_if_fail (dictv, 0);
 	x_return_val_if_fail (xmmsv_is_type (dictv, XMMSV_TYPE_DICT), 0);
+	x_api_error_if (dictv->value.dict->frozen, "on a frozen dict", 0);
 
 	xmmsv_dict_data_t data = DICT_INIT_DATA (key);
 	data.value = xmmsv_ref (val);
 	dict = dictv->value.dict;
 
 	/* Resize if fill is too high */
-	if (((dict->elems * 10) >> dict->size) > HASH_FILL_LIM) {
+	if (!DICT_IS_SMALL (dict) && ((dict->elems * 10) >> dict->size) > HASH_FILL_LIM) {
 		_xmmsv_dict_resize (dict);
 	}
 
-	_xmmsv_dict_insert (dict, data, 1);
+	/* Small dicts turn into a hash table once they're full */
+	if (!_xmmsv_dict_insert (dict, data, 1)) {
+		_xmmsv_dict_resize (dict);
+		_xmmsv_dict_insert (dict, data, 1);
+	}
 
 	return ret;
 }
@@ -450,12 +615,12 @@ xmmsv_dict_remove (xmmsv_t *dictv, const char *key)
 	x_return_val_if_fail (key, 0);
 	x_return_val_if_fail (dictv, 0);
 	x_return_val_if_fail (xmmsv_is_type (dictv, XMMSV_TYPE_DICT), 0);
+	x_api_error_if (dictv->value.dict->frozen, "on a frozen dict", 0);
 
-	xmmsv_dict_data_t data = DICT_INIT_DATA (key);
 	dict = dictv->value.dict;
 
 	/* If we find the entry we free the string and mark it as deleted */
-	if (_xmmsv_dict_search (dict, data, &pos, &deleted)) {
+	if (_xmmsv_dict_find (dict, key, &pos, &deleted)) {
 		_xmmsv_dict_remove (dict, pos);
 		ret = 1;
 	}
@@ -472,23 +637,11 @@ xmmsv_dict_remove (xmmsv_t *dictv, const char *key)
 int
 xmmsv_dict_clear (xmmsv_t *dictv)
 {
-	int i;
-	xmmsv_dict_internal_t *dict;
-
 	x_return_val_if_fail (dictv, 0);
 	x_return_val_if_fail (xmmsv_is_type (dictv, XMMSV_TYPE_DICT), 0);
+	x_api_error_if (dictv->value.dict->frozen, "on a frozen dict", 0);
 
-	dict = dictv->value.dict;
-
-	for (i = (1 << dict->size) - 1; i >= 0; i--) {
-		if (dict->data[i].str != NULL) {
-			if (dict->data[i].str != DELETED_STR) {
-				free (dict->data[i].str);
-				xmmsv_unref (dict->data[i].value);
-			}
-			dict->data[i].str = NULL;
-		}
-	}
+	_xmmsv_dict_clear (dictv->value.dict);
 
 	return 1;
 }
@@ -554,7 +707,13 @@ _xmmsv_dict_iter_new (xmmsv_dict_internal_t *d)
 	xmmsv_dict_iter_first (it);
 
 	/* register iterator into parent */
-	d->iterators = x_list_prepend (d->iterators, it);
+	if (d->frozen) {
+		XMMSV_SPIN_LOCK (&d->iterators_lock);
+		d->iterators = x_list_prepend (d->iterators, it);
+		XMMSV_SPIN_UNLOCK (&d->iterators_lock);
+	} else {
+		d->iterators = x_list_prepend (d->iterators, it);
+	}
 
 	return it;
 }
@@ -562,8 +721,16 @@ _xmmsv_dict_iter_new (xmmsv_dict_internal_t *d)
 static void
 _xmmsv_dict_iter_free (xmmsv_dict_iter_t *it)
 {
+	xmmsv_dict_internal_t *d = it->parent;
+
 	/* unref iterator from dict and free it */
-	it->parent->iterators = x_list_remove (it->parent->iterators, it);
+	if (d->frozen) {
+		XMMSV_SPIN_LOCK (&d->iterators_lock);
+		d->iterators = x_list_remove (d->iterators, it);
+		XMMSV_SPIN_UNLOCK (&d->iterators_lock);
+	} else {
+		d->iterators = x_list_remove (d->iterators, it);
+	}
 	free (it);
 }
 
@@ -651,7 +818,7 @@ xmmsv_dict_iter_pair (xmmsv_dict_iter_t *it, const char **key,
 int
 xmmsv_dict_iter_valid (xmmsv_dict_iter_t *it)
 {
-	return it && (it->pos < (1 << it->parent->size))
+	return it && (it->pos < DICT_SLOTS (it->parent))
 		&& it->parent->data[it->pos].str != NULL
 		&& it->parent->data[it->pos].str != DELETED_STR;
 }
@@ -669,7 +836,7 @@ xmmsv_dict_iter_first (xmmsv_dict_iter_t *it)
 	xmmsv_dict_internal_t *d = it->parent;
 
 	for (it->pos = 0
-		     ; it->pos < (1 << d->size) && (d->data[it->pos].str == NULL || d->data[it->pos].str == DELETED_STR)
+		     ; it->pos < DICT_SLOTS (d) && (d->data[it->pos].str == NULL || d->data[it->pos].str == DELETED_STR)
 		     ; it->pos++);
 }
 
@@ -686,7 +853,7 @@ xmmsv_dict_iter_next (xmmsv_dict_iter_t *it)
 	xmmsv_dict_internal_t *d = it->parent;
 
 	for (it->pos++
-		     ; it->pos < (1 << d->size) && (d->data[it->pos].str == NULL || d->data[it->pos].str == DELETED_STR)
+		     ; it->pos < DICT_SLOTS (d) && (d->data[it->pos].str == NULL || d->data[it->pos].str == DELETED_STR)
 		     ; it->pos++);
 }
 
@@ -732,6 +899,7 @@ xmmsv_dict_iter_set (xmmsv_dict_iter_t *it, xmmsv_t *val)
 {
 	x_return_val_if_fail (xmmsv_dict_iter_valid (it), 0);
 	x_return_val_if_fail (val, 0);
+	x_api_error_if (it->parent->frozen, "on a frozen dict", 0);
 
 	/* In case old value is new value, ref first. */
 	xmmsv_ref (val);
@@ -751,6 +919,7 @@ int
 xmmsv_dict_iter_remove (xmmsv_dict_iter_t *it)
 {
 	x_return_val_if_fail (xmmsv_dict_iter_valid (it), 0);
+	x_api_error_if (it->parent->frozen, "on a frozen dict", 0);
 
 	_xmmsv_dict_remove (it->parent, it->pos);
 	xmmsv_dict_iter_next (it);
@@ -48,7 +48,7 @@ _xmmsv_new (xmmsv_type_t type)
 {
 	xmmsv_t *val;
 
-	val = x_new0 (xmmsv_t, 1);
+	val = _xmmsv_alloc (XMMSV_ALLOC_VALUE, sizeof (xmmsv_t));
 	if (!val) {
 		x_oom ();
 		return NULL;
@@ -106,7 +106,7 @@ _xmmsv_free (xmmsv_t *val)
 			break;
 	}
 
-	free (val);
+	_xmmsv_alloc_free (XMMSV_ALLOC_VALUE, val);
 }
 
 
@@ -216,7 +216,7 @@ xmmsv_new_bin (const unsigned char *data, unsigned int len)
 		/* copy the data! */
 		val->value.bin.data = x_malloc (len);
 		if (!val->value.bin.data) {
-			free (val);
+			_xmmsv_alloc_free (XMMSV_ALLOC_VALUE, val);
 			x_oom ();
 			return NULL;
 		}
@@ -237,7 +237,7 @@ xmmsv_t *
 xmmsv_ref (xmmsv_t *val)
 {
 	x_return_val_if_fail (val, NULL);
-	val->ref++;
+	XMMSV_ATOMIC_ADD (&val->ref, 1);
 
 	return val;
 }
@@ -252,14 +252,86 @@ void
 xmmsv_unref (xmmsv_t *val)
 {
 	x_return_if_fail (val);
-	x_api_error_if (val->ref < 1, "with a freed value",);
+	x_api_error_if (XMMSV_ATOMIC_GET (&val->ref) < 1, "with a freed value",);
 
-	val->ref--;
-	if (val->ref == 0) {
+	if (XMMSV_ATOMIC_SUB (&val->ref, 1) == 0) {
 		_xmmsv_free (val);
 	}
 }
 
+/**
+ * Walk a value tree, either checking that it can be frozen or freezing it.
+ * @internal
+ */
+bool
+_xmmsv_freeze (xmmsv_t *val, bool apply)
+{
+	bool ret = true;
+
+	if (val->frozen) {
+		return true;
+	}
+
+	switch (val->type) {
+		case XMMSV_TYPE_BITBUFFER:
+			/* reading moves the position, so it can never be shared */
+			return false;
+		case XMMSV_TYPE_LIST:
+			ret = _xmmsv_list_freeze (val->value.list, apply);
+			break;
+		case XMMSV_TYPE_DICT:
+			ret = _xmmsv_dict_freeze (val->value.dict, apply);
+			break;
+		case XMMSV_TYPE_COLL:
+			ret = _xmmsv_coll_freeze (val->value.coll, apply);
+			break;
+		default:
+			break;
+	}
+
+	if (apply) {
+		val->frozen = true;
+	}
+
+	return ret;
+}
+
+/**
+ * Make a value, and every value it contains, immutable.
+ *
+ * A frozen value can be shared between threads by reference, as long as
+ * each thread holds its own reference. Every attempt to modify it fails,
+ * use #xmmsv_copy to get a mutable copy. Values containing a bitbuffer
+ * can't be frozen.
+ *
+ * @param val The value to freeze.
+ * @return 1 upon success otherwise 0
+ */
+int
+xmmsv_freeze (xmmsv_t *val)
+{
+	x_return_val_if_fail (val, 0);
+	x_api_error_if (!_xmmsv_freeze (val, false), "with a bitbuffer", 0);
+
+	_xmmsv_freeze (val, true);
+
+	return 1;
+}
+
+/**
+ * Check whether a value has been frozen with #xmmsv_freeze.
+ *
+ * @param val The value to check.
+ * @return 1 if the value is frozen otherwise 0
+ */
+int
+xmmsv_is_frozen (const xmmsv_t *val)
+{
+	x_return_val_if_fail (val, 0);
+
+	return val->frozen;
+}
+
 /**
  * Get the type of the value.
  *
@@ -35,6 +35,10 @@ struct xmmsv_list_internal_St {
 	bool restricted;
 	xmmsv_type_t restricttype;
 	x_list_t *iterators;
+
+	bool frozen;
+	/* guards iterators once the list is frozen and may be shared */
+	bool iterators_lock;
 };
 
 static void _xmmsv_list_iter_free (xmmsv_list_iter_t *it);
@@ -64,7 +68,7 @@ _xmmsv_list_new (void)
 {
 	xmmsv_list_internal_t *list;
 
-	list = x_new0 (xmmsv_list_internal_t, 1);
+	list = _xmmsv_alloc (XMMSV_ALLOC_LIST, sizeof (xmmsv_list_internal_t));
 	if (!list) {
 		x_oom ();
 		return NULL;
@@ -93,7 +97,25 @@ _xmmsv_list_free (xmmsv_list_internal_t *l)
 	}
 
 	free (l->list);
-	free (l);
+	_xmmsv_alloc_free (XMMSV_ALLOC_LIST, l);
+}
+
+bool
+_xmmsv_list_freeze (xmmsv_list_internal_t *l, bool apply)
+{
+	int i;
+
+	for (i = 0; i < l->size; i++) {
+		if (!_xmmsv_freeze (l->list[i], apply)) {
+			return false;
+		}
+	}
+
+	if (apply) {
+		l->frozen = true;
+	}
+
+	return true;
 }
 
 static int
@@ -120,6 +142,8 @@ _xmmsv_list_insert (xmmsv_list_internal_t *l, int pos, xmmsv_t *val)
 	xmmsv_list_iter_t *it;
 	x_list_t *n;
 
+	x_api_error_if (l->frozen, "on a frozen list", 0);
+
 	if (!_xmmsv_list_position_normalize (&pos, l->size, 1)) {
 		return 0;
 	}
@@ -174,6 +198,8 @@ _xmmsv_list_remove (xmmsv_list_internal_t *l, int pos)
 	int half_size;
 	x_list_t *n;
 
+	x_api_error_if (l->frozen, "on a frozen list", 0);
+
 	/* prevent removing after the last element */
 	if (!_xmmsv_list_position_normalize (&pos, l->size, 0)) {
 		return 0;
@@ -215,6 +241,8 @@ _xmmsv_list_move (xmmsv_list_internal_t *l, int old_pos, int new_pos)
 	xmmsv_list_iter_t *it;
 	x_list_t *n;
 
+	x_api_error_if (l->frozen, "on a frozen list", 0);
+
 	if (!_xmmsv_list_position_normalize (&old_pos, l->size, 0)) {
 		return 0;
 	}
@@ -366,6 +394,8 @@ xmmsv_list_set (xmmsv_t *listv, int pos, xmmsv_t *val)
 
 	l = listv->value.list;
 
+	x_api_error_if (l->frozen, "on a frozen list", 0);
+
 	if (!_xmmsv_list_position_normalize (&pos, l->size, 0)) {
 		return 0;
 	}
@@ -466,6 +496,7 @@ xmmsv_list_clear (xmmsv_t *listv)
 {
 	x_return_val_if_fail (listv, 0);
 	x_return_val_if_fail (xmmsv_is_type (listv, XMMSV_TYPE_LIST), 0);
+	x_api_error_if (listv->value.list->frozen, "on a frozen list", 0);
 
 	_xmmsv_list_clear (listv->value.list);
 
@@ -484,6 +515,7 @@ xmmsv_list_sort (xmmsv_t *listv, xmmsv_list_compare_func_t comparator)
 	x_return_val_if_fail (comparator, 0);
 	x_return_val_if_fail (listv, 0);
 	x_return_val_if_fail (xmmsv_is_type (listv, XMMSV_TYPE_LIST), 0);
+	x_api_error_if (listv->value.list->frozen, "on a frozen list", 0);
 
 	_xmmsv_list_sort (listv->value.list, comparator);
 
@@ -542,6 +574,12 @@ xmmsv_list_restrict_type (xmmsv_t *listv, xmmsv_type_t type)
 	x_return_val_if_fail (!listv->value.list->restricted ||
 	                      listv->value.list->restricttype == type, 0);
 
+	if (listv->value.list->restricted) {
+		return 1;
+	}
+
+	x_api_error_if (listv->value.list->frozen, "on a frozen list", 0);
+
 	listv->value.list->restricted = true;
 	listv->value.list->restricttype = type;
 
@@ -650,7 +688,13 @@ _xmmsv_list_iter_new (xmmsv_list_internal_t *l)
 	it->position = 0;
 
 	/* register iterator into parent */
-	l->iterators = x_list_prepend (l->iterators, it);
+	if (l->frozen) {
+		XMMSV_SPIN_LOCK (&l->iterators_lock);
+		l->iterators = x_list_prepend (l->iterators, it);
+		XMMSV_SPIN_UNLOCK (&l->iterators_lock);
+	} else {
+		l->iterators = x_list_prepend (l->iterators, it);
+	}
 
 	return it;
 }
@@ -687,8 +731,16 @@ xmmsv_get_list_iter (const xmmsv_t *val, xmmsv_list_iter_t **it)
 static void
 _xmmsv_list_iter_free (xmmsv_list_iter_t *it)
 {
+	xmmsv_list_internal_t *l = it->parent;
+
 	/* unref iterator from list and free it */
-	it->parent->iterators = x_list_remove (it->parent->iterators, it);
+	if (l->frozen) {
+		XMMSV_SPIN_LOCK (&l->iterators_lock);
+		l->iterators = x_list_remove (l->iterators, it);
+		XMMSV_SPIN_UNLOCK (&l->iterators_lock);
+	} else {
+		l->iterators = x_list_remove (l->iterators, it);
+	}
 	free (it);
 }
 
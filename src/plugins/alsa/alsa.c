@@ -22,6 +22,11 @@
 
 #include <glib.h>
 
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
 /*
  *  Defines
  */
@@ -35,6 +40,11 @@ typedef struct xmms_alsa_data_St {
 	snd_pcm_t *pcm;
 	snd_mixer_t *mixer;
 	snd_mixer_elem_t *mixer_elem;
+
+	/* a mixer of its own for the thread waiting for volume changes */
+	snd_mixer_t *monitor;
+	GThread *monitor_thread;
+	gint monitor_wakeup[2];
 } xmms_alsa_data_t;
 
 static const struct {
@@ -97,6 +107,8 @@ static gboolean xmms_alsa_volume_set (xmms_output_t *output,
 static gboolean xmms_alsa_volume_get (xmms_output_t *output,
                                       const gchar **names, guint *values,
                                       guint *num_channels);
+static gboolean xmms_alsa_volume_monitor (xmms_output_t *output);
+static gpointer xmms_alsa_volume_monitor_thread (gpointer udata);
 static gboolean xmms_alsa_mixer_setup (xmms_output_t *plugin,
                                        xmms_alsa_data_t *data);
 static gboolean xmms_alsa_probe_modes (xmms_output_t *output,
@@ -136,6 +148,7 @@ xmms_alsa_plugin_setup (xmms_output_plugin_t *plugin)
 
 	methods.volume_get = xmms_alsa_volume_get;
 	methods.volume_set = xmms_alsa_volume_set;
+	methods.volume_monitor = xmms_alsa_volume_monitor;
 
 	methods.write = xmms_alsa_write;
 
@@ -308,6 +321,18 @@ xmms_alsa_destroy (xmms_output_t *output)
 	data = xmms_output_private_data_get (output);
 	g_return_if_fail (data);
 
+	if (data->monitor_thread) {
+		/* wake the monitor thread up so that it can quit */
+		if (write (data->monitor_wakeup[1], "", 1) != 1) {
+			xmms_log_error ("Unable to stop the mixer monitor");
+		}
+		g_thread_join (data->monitor_thread);
+
+		close (data->monitor_wakeup[0]);
+		close (data->monitor_wakeup[1]);
+		snd_mixer_close (data->monitor);
+	}
+
 	if (data->mixer) {
 		err = snd_mixer_close (data->mixer);
 		if (err != 0) {
@@ -729,6 +754,116 @@ xmms_alsa_volume_get (xmms_output_t *output, const gchar **names,
 	return TRUE;
 }
 
+/**
+ * Start waiting for volume changes.
+ *
+ * The mixer is opened a second time, and a thread polls it and tells
+ * the output whenever something changed.
+ *
+ * @param output The output struct containing alsa data.
+ * @return TRUE if volume changes will be reported, else FALSE.
+ */
+static gboolean
+xmms_alsa_volume_monitor (xmms_output_t *output)
+{
+	const xmms_config_property_t *cv;
+	xmms_alsa_data_t *data;
+	const gchar *dev;
+	gint err;
+
+	g_return_val_if_fail (output, FALSE);
+
+	data = xmms_output_private_data_get (output);
+	g_return_val_if_fail (data, FALSE);
+
+	if (!data->mixer || !data->mixer_elem) {
+		return FALSE;
+	}
+
+	cv = xmms_output_config_lookup (output, "mixer_dev");
+	dev = xmms_config_property_get_string (cv);
+
+	err = snd_mixer_open (&data->monitor, 0);
+	if (err < 0) {
+		xmms_log_error ("Failed to open empty mixer: %s", snd_strerror (err));
+		return FALSE;
+	}
+
+	if ((err = snd_mixer_attach (data->monitor, dev)) < 0 ||
+	    (err = snd_mixer_selem_register (data->monitor, NULL, NULL)) < 0 ||
+	    (err = snd_mixer_load (data->monitor)) < 0) {
+		xmms_log_error ("Failed to set up mixer monitor: %s", snd_strerror (err));
+		snd_mixer_close (data->monitor);
+		data->monitor = NULL;
+		return FALSE;
+	}
+
+	if (pipe (data->monitor_wakeup) < 0) {
+		xmms_log_error ("Failed to set up mixer monitor: %s", strerror (errno));
+		snd_mixer_close (data->monitor);
+		data->monitor = NULL;
+		return FALSE;
+	}
+
+	data->monitor_thread = g_thread_new ("x2 alsa mixer",
+	                                     xmms_alsa_volume_monitor_thread,
+	                                     output);
+
+	return TRUE;
+}
+
+static gpointer
+xmms_alsa_volume_monitor_thread (gpointer udata)
+{
+	xmms_output_t *output = udata;
+	xmms_alsa_data_t *data;
+	struct pollfd *fds;
+	unsigned short revents;
+	gint count, err;
+
+	data = xmms_output_private_data_get (output);
+
+	count = snd_mixer_poll_descriptors_count (data->monitor);
+	fds = g_new0 (struct pollfd, count + 1);
+	snd_mixer_poll_descriptors (data->monitor, fds, count);
+
+	fds[count].fd = data->monitor_wakeup[0];
+	fds[count].events = POLLIN;
+
+	while (TRUE) {
+		if (poll (fds, count + 1, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			xmms_log_error ("Polling the mixer failed: %s", strerror (errno));
+			xmms_output_volume_monitor_lost (output);
+			break;
+		}
+
+		/* destroy wants us gone */
+		if (fds[count].revents) {
+			break;
+		}
+
+		err = snd_mixer_poll_descriptors_revents (data->monitor, fds, count,
+		                                          &revents);
+		if (err < 0 || (revents & (POLLERR | POLLNVAL))) {
+			xmms_log_error ("Lost the mixer, polling the volume instead");
+			xmms_output_volume_monitor_lost (output);
+			break;
+		}
+
+		if (revents & POLLIN) {
+			snd_mixer_handle_events (data->monitor);
+			xmms_output_volume_changed (output);
+		}
+	}
+
+	g_free (fds);
+
+	return NULL;
+}
+
 /**
  * Get bytes in buffer.
  * Calculates bytes in buffer by subtract buffer size with available frames
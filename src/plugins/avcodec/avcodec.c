@@ -39,6 +39,7 @@ typedef struct {
 	gboolean no_demuxer;
 
 	AVFrame *read_out_frame;
+	gboolean draining;
 
 	guint channels;
 	guint samplerate;
@@ -59,6 +60,7 @@ static gboolean xmms_avcodec_init (xmms_xform_t *xform);
 static void xmms_avcodec_destroy (xmms_xform_t *xform);
 static gint xmms_avcodec_internal_read_some (xmms_xform_t *xform, xmms_avcodec_data_t *data, xmms_error_t *error);
 static gint xmms_avcodec_internal_decode_some (xmms_avcodec_data_t *data);
+static gint xmms_avcodec_internal_drain (xmms_avcodec_data_t *data);
 static void xmms_avcodec_internal_append (xmms_avcodec_data_t *data);
 static gint xmms_avcodec_read (xmms_xform_t *xform, xmms_sample_t *buf, gint len,
                                xmms_error_t *error);
@@ -88,6 +90,10 @@ xmms_avcodec_plugin_setup (xmms_xform_plugin_t *xform_plugin)
 
 	xmms_xform_plugin_methods_set (xform_plugin, &methods);
 
+	/* decoder threads, 0 means one per core */
+	xmms_xform_plugin_config_property_register (xform_plugin, "threads",
+	                                            "0", NULL, NULL);
+
 	xmms_magic_add ("Shorten header", "audio/x-ffmpeg-shorten",
 	                "0 string ajkg", NULL);
 	xmms_magic_add ("A/52 (AC-3) header", "audio/x-ffmpeg-ac3",
@@ -137,6 +143,7 @@ static gboolean
 xmms_avcodec_init (xmms_xform_t *xform)
 {
 	xmms_avcodec_data_t *data;
+	xmms_config_property_t *cfgv;
 	AVCodec *codec;
 	const gchar *mimetype;
 	const guchar *tmpbuf;
@@ -231,6 +238,13 @@ xmms_avcodec_init (xmms_xform_t *xform)
 	data->codecctx->codec_id = codec->id;
 	data->codecctx->codec_type = codec->type;
 
+	/* Frame threading only kicks in for decoders that support it, the
+	 * others silently stay single threaded. thread_count 0 is auto.
+	 */
+	cfgv = xmms_xform_config_lookup (xform, "threads");
+	data->codecctx->thread_count = MAX (0, xmms_config_property_get_int (cfgv));
+	data->codecctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
 	if (avcodec_open2 (data->codecctx, codec, NULL) < 0) {
 		XMMS_DBG ("Opening decoder '%s' failed", codec->name);
 		goto err;
@@ -272,6 +286,11 @@ xmms_avcodec_init (xmms_xform_t *xform)
 	          codec->name, data->codecctx->sample_rate,
 	          data->codecctx->channels,
 	          av_get_sample_fmt_name (data->codecctx->sample_fmt));
+	XMMS_DBG ("Decoding with %d thread(s), %s threading",
+	          data->codecctx->thread_count,
+	          (data->codecctx->active_thread_type & FF_THREAD_FRAME) ? "frame" :
+	          (data->codecctx->active_thread_type & FF_THREAD_SLICE) ? "slice" :
+	          "no");
 
 	return TRUE;
 
@@ -306,7 +325,14 @@ xmms_avcodec_read (xmms_xform_t *xform, xmms_sample_t *buf, gint len,
 			gint bytes_read;
 
 			bytes_read = xmms_avcodec_internal_read_some (xform, data, error);
-			if (bytes_read <= 0) { return bytes_read; }
+			if (bytes_read < 0) { return bytes_read; }
+			if (bytes_read == 0) {
+				/* EOF, collect what the decoder threads still hold */
+				res = xmms_avcodec_internal_drain (data);
+				if (res <= 0) { return res; }
+				xmms_avcodec_internal_append (data);
+				continue;
+			}
 		}
 
 		res = xmms_avcodec_internal_decode_some (data);
@@ -351,8 +377,10 @@ xmms_avcodec_seek (xmms_xform_t *xform, gint64 samples, xmms_xform_seek_mode_t w
 	ret = xmms_xform_seek (xform, samples, whence, err);
 
 	if (ret >= 0) {
+		/* also drops the frames still queued in the decoder threads */
 		avcodec_flush_buffers (data->codecctx);
 
+		data->draining = FALSE;
 		data->buffer_length = 0;
 		g_string_erase (data->outbuf, 0, -1);
 	}
@@ -499,6 +527,41 @@ xmms_avcodec_internal_decode_some (xmms_avcodec_data_t *data)
 	return rc;
 }
 
+/*
+Fetch the frames the decoder still holds once the input is exhausted,
+a frame threaded decoder has up to one frame per thread in flight.
+
+Returns: on error: negative
+         when fully drained: zero
+         otherwise: positive, with the frame in data->read_out_frame
+*/
+static gint
+xmms_avcodec_internal_drain (xmms_avcodec_data_t *data)
+{
+	int rc;
+
+	if (!data->draining) {
+		data->draining = TRUE;
+		data->packet.size = 0;
+
+		rc = avcodec_send_packet (data->codecctx, NULL);
+		if (rc < 0 && rc != AVERROR_EOF && rc != AVERROR(EAGAIN)) {
+			XMMS_DBG ("Error flushing decoder!");
+			return -1;
+		}
+	}
+
+	rc = avcodec_receive_frame (data->codecctx, data->read_out_frame);
+	if (rc == AVERROR_EOF) {
+		return 0;
+	} else if (rc < 0) {
+		XMMS_DBG ("Error decoding data!");
+		return -1;
+	}
+
+	return 1;
+}
+
 static void
 xmms_avcodec_internal_append (xmms_avcodec_data_t *data)
 {
@@ -0,0 +1,539 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+/*
+ * Sparse on-disk cache of HTTP resources.
+ *
+ * Every URL gets a data file, written at the same offsets as the remote
+ * resource, and an index listing which byte ranges of it are valid. The
+ * index is only written once the data is on disk, so a crash can lose
+ * cached data but never make us serve garbage.
+ *
+ * The index is rewritten whenever a cache entry is closed, so its mtime
+ * doubles as the last use time when evicting least recently used
+ * entries to stay below the size limit. Entries that are open in this
+ * process are never evicted.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <xmms/xmms_log.h>
+
+#include "cache.h"
+
+#if !defined(O_BINARY)
+# define O_BINARY 0
+#endif
+
+#define XMMS_CURL_CACHE_MAGIC "xmms2-curl-cache 1"
+
+typedef struct {
+	gint64 start;
+	gint64 end;
+} xmms_curl_cache_range_t;
+
+struct xmms_curl_cache_St {
+	gchar *dir;
+	gchar *key;
+	gint fd;
+
+	gint64 limit;
+	gint64 size;
+	gchar *etag;
+
+	/* sorted, non-overlapping, non-adjacent */
+	GArray *ranges;
+	gint64 stored;
+};
+
+typedef struct {
+	gchar *key;
+	time_t mtime;
+	gint64 usage;
+} xmms_curl_cache_entry_t;
+
+/* key -> number of open entries for it */
+static GHashTable *open_keys;
+G_LOCK_DEFINE_STATIC (open_keys);
+
+static gchar *
+xmms_curl_cache_path (const gchar *dir, const gchar *key, const gchar *suffix)
+{
+	gchar *name, *path;
+
+	name = g_strconcat (key, suffix, NULL);
+	path = g_build_filename (dir, name, NULL);
+	g_free (name);
+
+	return path;
+}
+
+static void
+xmms_curl_cache_hold (const gchar *key)
+{
+	gint count;
+
+	G_LOCK (open_keys);
+
+	if (!open_keys) {
+		open_keys = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	}
+
+	count = GPOINTER_TO_INT (g_hash_table_lookup (open_keys, key));
+	g_hash_table_insert (open_keys, g_strdup (key), GINT_TO_POINTER (count + 1));
+
+	G_UNLOCK (open_keys);
+}
+
+static void
+xmms_curl_cache_release (const gchar *key)
+{
+	gint count;
+
+	G_LOCK (open_keys);
+
+	count = GPOINTER_TO_INT (g_hash_table_lookup (open_keys, key));
+	if (count > 1) {
+		g_hash_table_insert (open_keys, g_strdup (key), GINT_TO_POINTER (count - 1));
+	} else {
+		g_hash_table_remove (open_keys, key);
+	}
+
+	G_UNLOCK (open_keys);
+}
+
+static void
+xmms_curl_cache_add_range (xmms_curl_cache_t *cache, gint64 start, gint64 end)
+{
+	xmms_curl_cache_range_t *range, new_range = { start, end };
+	guint i, first;
+
+	/* find the first range that ends at or after our start */
+	for (i = 0; i < cache->ranges->len; i++) {
+		range = &g_array_index (cache->ranges, xmms_curl_cache_range_t, i);
+		if (range->end >= start) {
+			break;
+		}
+	}
+	first = i;
+
+	/* swallow everything we overlap or touch */
+	for (; i < cache->ranges->len; i++) {
+		range = &g_array_index (cache->ranges, xmms_curl_cache_range_t, i);
+		if (range->start > end) {
+			break;
+		}
+		new_range.start = MIN (new_range.start, range->start);
+		new_range.end = MAX (new_range.end, range->end);
+		cache->stored -= range->end - range->start;
+	}
+
+	g_array_remove_range (cache->ranges, first, i - first);
+	g_array_insert_val (cache->ranges, first, new_range);
+	cache->stored += new_range.end - new_range.start;
+}
+
+static void
+xmms_curl_cache_reset (xmms_curl_cache_t *cache)
+{
+	g_array_set_size (cache->ranges, 0);
+	cache->stored = 0;
+
+	if (ftruncate (cache->fd, 0) == -1) {
+		XMMS_DBG ("Couldn't truncate cache file: %s", strerror (errno));
+	}
+}
+
+static void
+xmms_curl_cache_load_index (xmms_curl_cache_t *cache)
+{
+	gchar *path, *contents, **lines;
+	gint64 start, end;
+	gint i;
+
+	path = xmms_curl_cache_path (cache->dir, cache->key, ".index");
+
+	if (!g_file_get_contents (path, &contents, NULL, NULL)) {
+		g_free (path);
+		return;
+	}
+
+	lines = g_strsplit (contents, "\n", -1);
+
+	if (g_strcmp0 (lines[0], XMMS_CURL_CACHE_MAGIC) == 0) {
+		for (i = 1; lines[i]; i++) {
+			if (g_str_has_prefix (lines[i], "size ")) {
+				cache->size = g_ascii_strtoll (lines[i] + 5, NULL, 10);
+			} else if (g_str_has_prefix (lines[i], "etag ")) {
+				cache->etag = g_strdup (lines[i] + 5);
+			} else if (sscanf (lines[i], "range %" G_GINT64_FORMAT " %" G_GINT64_FORMAT,
+			                   &start, &end) == 2 && start < end) {
+				xmms_curl_cache_add_range (cache, start, end);
+			}
+		}
+	}
+
+	g_strfreev (lines);
+	g_free (contents);
+	g_free (path);
+}
+
+/* Write and sync a whole file. */
+static gboolean
+xmms_curl_cache_write_file (const gchar *path, const gchar *contents, gsize len)
+{
+	gssize ret;
+	gint fd;
+
+	fd = open (path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+	if (fd == -1) {
+		return FALSE;
+	}
+
+	for (; len > 0; len -= ret, contents += ret) {
+		ret = write (fd, contents, len);
+		if (ret == -1 && errno == EINTR) {
+			ret = 0;
+		} else if (ret <= 0) {
+			close (fd);
+			return FALSE;
+		}
+	}
+
+	if (fsync (fd) == -1) {
+		close (fd);
+		return FALSE;
+	}
+
+	return close (fd) == 0;
+}
+
+static void
+xmms_curl_cache_save_index (xmms_curl_cache_t *cache)
+{
+	xmms_curl_cache_range_t *range;
+	gchar *path, *tmp;
+	GString *index;
+	guint i;
+
+	index = g_string_new (XMMS_CURL_CACHE_MAGIC "\n");
+	g_string_append_printf (index, "size %" G_GINT64_FORMAT "\n", cache->size);
+	if (cache->etag) {
+		g_string_append_printf (index, "etag %s\n", cache->etag);
+	}
+
+	for (i = 0; i < cache->ranges->len; i++) {
+		range = &g_array_index (cache->ranges, xmms_curl_cache_range_t, i);
+		g_string_append_printf (index, "range %" G_GINT64_FORMAT " %" G_GINT64_FORMAT "\n",
+		                        range->start, range->end);
+	}
+
+	path = xmms_curl_cache_path (cache->dir, cache->key, ".index");
+	tmp = xmms_curl_cache_path (cache->dir, cache->key, ".index.tmp");
+
+	/* The ranges must not be listed before the data they describe is on
+	 * disk, and the new index must be complete before it replaces the
+	 * old one, or a crash could leave an index pointing at garbage.
+	 */
+	if (fsync (cache->fd) == -1) {
+		XMMS_DBG ("Couldn't sync cache file: %s", strerror (errno));
+	} else if (!xmms_curl_cache_write_file (tmp, index->str, index->len)) {
+		XMMS_DBG ("Couldn't write cache index %s: %s", tmp, strerror (errno));
+		g_unlink (tmp);
+	} else if (g_rename (tmp, path) == -1) {
+		XMMS_DBG ("Couldn't replace cache index %s: %s", path, strerror (errno));
+		g_unlink (tmp);
+	}
+
+	g_free (tmp);
+	g_free (path);
+	g_string_free (index, TRUE);
+}
+
+/**
+ * Open the cache entry for an URL, creating it if needed.
+ *
+ * @param dir the directory holding the cache
+ * @param url the URL whose data will be cached
+ * @param limit the total size of the cache, in bytes
+ * @return the cache entry, or NULL if it couldn't be created.
+ */
+xmms_curl_cache_t *
+xmms_curl_cache_open (const gchar *dir, const gchar *url, gint64 limit)
+{
+	xmms_curl_cache_t *cache;
+	gchar *path;
+	gint fd;
+
+	g_return_val_if_fail (dir, NULL);
+	g_return_val_if_fail (url, NULL);
+
+	if (g_mkdir_with_parents (dir, 0755) == -1) {
+		XMMS_DBG ("Couldn't create cache directory %s: %s", dir, strerror (errno));
+		return NULL;
+	}
+
+	cache = g_new0 (xmms_curl_cache_t, 1);
+	cache->dir = g_strdup (dir);
+	cache->key = g_compute_checksum_for_string (G_CHECKSUM_SHA1, url, -1);
+	cache->limit = limit;
+	cache->ranges = g_array_new (FALSE, FALSE, sizeof (xmms_curl_cache_range_t));
+
+	path = xmms_curl_cache_path (dir, cache->key, ".data");
+	fd = open (path, O_RDWR | O_CREAT | O_BINARY, 0644);
+	g_free (path);
+
+	if (fd == -1) {
+		XMMS_DBG ("Couldn't open cache file: %s", strerror (errno));
+		g_array_free (cache->ranges, TRUE);
+		g_free (cache->key);
+		g_free (cache->dir);
+		g_free (cache);
+		return NULL;
+	}
+
+	cache->fd = fd;
+
+	xmms_curl_cache_hold (cache->key);
+	xmms_curl_cache_load_index (cache);
+
+	return cache;
+}
+
+/**
+ * Close a cache entry, saving its index and making room for it by
+ * evicting others.
+ */
+void
+xmms_curl_cache_close (xmms_curl_cache_t *cache)
+{
+	g_return_if_fail (cache);
+
+	/* always rewrite the index to bump its mtime */
+	xmms_curl_cache_save_index (cache);
+	close (cache->fd);
+
+	/* still held, so this entry stays */
+	xmms_curl_cache_evict (cache->dir, cache->limit);
+	xmms_curl_cache_release (cache->key);
+
+	g_array_free (cache->ranges, TRUE);
+	g_free (cache->etag);
+	g_free (cache->key);
+	g_free (cache->dir);
+	g_free (cache);
+}
+
+/**
+ * Check the cached data against what the server says the resource looks
+ * like now, throwing it away if it has changed.
+ *
+ * @param size the total size of the resource
+ * @param etag the entity tag of the resource, or NULL if unknown
+ */
+void
+xmms_curl_cache_validate (xmms_curl_cache_t *cache, gint64 size, const gchar *etag)
+{
+	g_return_if_fail (cache);
+
+	if (cache->size != size || (etag && cache->etag && strcmp (etag, cache->etag))) {
+		if (cache->ranges->len) {
+			XMMS_DBG ("Remote resource changed, dropping cached data");
+		}
+		xmms_curl_cache_reset (cache);
+	}
+
+	cache->size = size;
+
+	if (etag && g_strcmp0 (etag, cache->etag)) {
+		g_free (cache->etag);
+		cache->etag = g_strdup (etag);
+	}
+}
+
+/**
+ * Store data fetched at offset. Nothing is stored once the entry alone
+ * would exceed the size limit of the whole cache.
+ */
+void
+xmms_curl_cache_store (xmms_curl_cache_t *cache, gint64 offset,
+                       const void *buffer, gsize len)
+{
+	const guchar *ptr = buffer;
+	gssize ret;
+	gsize left;
+
+	g_return_if_fail (cache);
+
+	if (!len || cache->stored + (gint64) len > cache->limit) {
+		return;
+	}
+
+	if (lseek (cache->fd, offset, SEEK_SET) == -1) {
+		return;
+	}
+
+	for (left = len; left > 0; left -= ret, ptr += ret) {
+		ret = write (cache->fd, ptr, left);
+		if (ret == -1 && errno == EINTR) {
+			ret = 0;
+		} else if (ret <= 0) {
+			XMMS_DBG ("Couldn't write to cache: %s", strerror (errno));
+			return;
+		}
+	}
+
+	xmms_curl_cache_add_range (cache, offset, offset + len);
+}
+
+/**
+ * Read cached data starting at offset.
+ *
+ * @return the number of bytes read, 0 if offset isn't cached.
+ */
+gint
+xmms_curl_cache_read (xmms_curl_cache_t *cache, gint64 offset,
+                      void *buffer, gint len)
+{
+	xmms_curl_cache_range_t *range;
+	gssize ret;
+	guint i;
+
+	g_return_val_if_fail (cache, 0);
+
+	for (i = 0; i < cache->ranges->len; i++) {
+		range = &g_array_index (cache->ranges, xmms_curl_cache_range_t, i);
+
+		if (range->start > offset) {
+			break;
+		}
+
+		if (range->end > offset) {
+			len = MIN (len, range->end - offset);
+
+			if (lseek (cache->fd, offset, SEEK_SET) == -1) {
+				return 0;
+			}
+
+			do {
+				ret = read (cache->fd, buffer, len);
+			} while (ret == -1 && errno == EINTR);
+
+			return MAX (ret, 0);
+		}
+	}
+
+	return 0;
+}
+
+static gint
+xmms_curl_cache_entry_compare (gconstpointer a, gconstpointer b)
+{
+	const xmms_curl_cache_entry_t *ea = a, *eb = b;
+
+	if (ea->mtime == eb->mtime) {
+		return 0;
+	}
+
+	return ea->mtime < eb->mtime ? -1 : 1;
+}
+
+/**
+ * Remove the least recently used entries until the cache fits in limit.
+ * Entries that are currently open are skipped.
+ */
+void
+xmms_curl_cache_evict (const gchar *dir, gint64 limit)
+{
+	xmms_curl_cache_entry_t *entry;
+	const gchar *name;
+	gchar *path;
+	GArray *entries;
+	GDir *gdir;
+	struct stat st;
+	gint64 total = 0;
+	gboolean held;
+	guint i;
+
+	gdir = g_dir_open (dir, 0, NULL);
+	if (!gdir) {
+		return;
+	}
+
+	entries = g_array_new (FALSE, FALSE, sizeof (xmms_curl_cache_entry_t));
+
+	while ((name = g_dir_read_name (gdir))) {
+		xmms_curl_cache_entry_t new_entry;
+
+		if (!g_str_has_suffix (name, ".index")) {
+			continue;
+		}
+
+		new_entry.key = g_strndup (name, strlen (name) - strlen (".index"));
+
+		path = g_build_filename (dir, name, NULL);
+		new_entry.mtime = g_stat (path, &st) == 0 ? st.st_mtime : 0;
+		g_free (path);
+
+		/* the data files are sparse, count what's actually used */
+		path = xmms_curl_cache_path (dir, new_entry.key, ".data");
+		new_entry.usage = g_stat (path, &st) == 0 ? (gint64) st.st_blocks * 512 : 0;
+		g_free (path);
+
+		total += new_entry.usage;
+		g_array_append_val (entries, new_entry);
+	}
+
+	g_dir_close (gdir);
+
+	g_array_sort (entries, xmms_curl_cache_entry_compare);
+
+	G_LOCK (open_keys);
+
+	for (i = 0; i < entries->len; i++) {
+		entry = &g_array_index (entries, xmms_curl_cache_entry_t, i);
+
+		held = open_keys && g_hash_table_contains (open_keys, entry->key);
+
+		if (total > limit && !held) {
+			path = xmms_curl_cache_path (dir, entry->key, ".index");
+			g_unlink (path);
+			g_free (path);
+
+			path = xmms_curl_cache_path (dir, entry->key, ".data");
+			g_unlink (path);
+			g_free (path);
+
+			total -= entry->usage;
+		}
+
+		g_free (entry->key);
+	}
+
+	G_UNLOCK (open_keys);
+
+	g_array_free (entries, TRUE);
+}
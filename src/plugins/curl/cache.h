@@ -0,0 +1,33 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#ifndef __XMMS_CURL_CACHE_H__
+#define __XMMS_CURL_CACHE_H__
+
+#include <glib.h>
+
+typedef struct xmms_curl_cache_St xmms_curl_cache_t;
+
+xmms_curl_cache_t *xmms_curl_cache_open (const gchar *dir, const gchar *url, gint64 limit);
+void xmms_curl_cache_close (xmms_curl_cache_t *cache);
+
+void xmms_curl_cache_validate (xmms_curl_cache_t *cache, gint64 size, const gchar *etag);
+void xmms_curl_cache_store (xmms_curl_cache_t *cache, gint64 offset, const void *buffer, gsize len);
+gint xmms_curl_cache_read (xmms_curl_cache_t *cache, gint64 offset, void *buffer, gint len);
+
+void xmms_curl_cache_evict (const gchar *dir, gint64 limit);
+
+#endif
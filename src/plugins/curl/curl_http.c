@@ -28,13 +28,24 @@
 
 #include <curl/curl.h>
 
+#include <xmmsc/xmmsc_util.h>
+
+#include "cache.h"
+#include "pool.h"
+
+/* Reading through this much data beats doing a new request */
+#define XMMS_CURL_SKIP_LIMIT (256 * 1024)
+
+/* How much the pool may receive ahead of us before pausing */
+#define XMMS_CURL_QUEUE_SIZE (256 * 1024)
+
 /*
  * Type definitions
  */
 
 typedef struct {
 	CURL *curl_easy;
-	CURLM *curl_multi;
+	xmms_curl_transfer_t *transfer;
 
 	guint meta_offset;
 
@@ -45,14 +56,32 @@ typedef struct {
 
 	gchar *buffer;
 	guint bufferpos, bufferlen;
+	/* offset in the resource of the first byte in buffer */
+	gint64 buffer_offset;
 
-	gint curl_code;
+	/* offset of the next byte to hand to the reader */
+	gint64 pos;
+	/* size of the resource, or -1 if unknown */
+	gint64 size;
+	/* the server said it accepts byte ranges */
+	gboolean seekable;
+	gint http_status;
+	gchar *etag;
+
+	xmms_curl_cache_t *cache;
 
 	gboolean done;
+	gboolean restarted;
 
 	xmms_error_t status;
 
 	gboolean broken_version;
+
+	/* Header lines as received by the pool thread. They are handled by
+	 * the xform thread, before it uses any data that came after them.
+	 */
+	GMutex header_mutex;
+	GQueue headers;
 } xmms_curl_data_t;
 
 typedef void (*handler_func_t) (xmms_xform_t *xform, gchar *header);
@@ -61,6 +90,10 @@ static void header_handler_contentlength (xmms_xform_t *xform, gchar *header);
 static void header_handler_icy_metaint (xmms_xform_t *xform, gchar *header);
 static void header_handler_icy_name (xmms_xform_t *xform, gchar *header);
 static void header_handler_icy_genre (xmms_xform_t *xform, gchar *header);
+static void header_handler_status (xmms_xform_t *xform, gchar *header);
+static void header_handler_accept_ranges (xmms_xform_t *xform, gchar *header);
+static void header_handler_content_range (xmms_xform_t *xform, gchar *header);
+static void header_handler_etag (xmms_xform_t *xform, gchar *header);
 static handler_func_t header_handler_find (gchar *header);
 
 typedef struct {
@@ -73,6 +106,10 @@ handler_t handlers[] = {
 	{ "icy-metaint", header_handler_icy_metaint },
 	{ "icy-name", header_handler_icy_name },
 	{ "icy-genre", header_handler_icy_genre },
+	{ "http/", header_handler_status },
+	{ "accept-ranges", header_handler_accept_ranges },
+	{ "content-range", header_handler_content_range },
+	{ "etag", header_handler_etag },
 /*	{ "\r\n", header_handler_last }, */
 	{ NULL, NULL }
 };
@@ -86,9 +123,10 @@ static gboolean xmms_curl_init (xmms_xform_t *xform);
 static void xmms_curl_destroy (xmms_xform_t *xform);
 static gint fill_buffer (xmms_xform_t *xform, xmms_curl_data_t *data, xmms_error_t *error);
 static gint xmms_curl_read (xmms_xform_t *xform, void *buffer, gint len, xmms_error_t *error);
-/* static gint64 xmms_curl_seek (xmms_xform_t *xform, gint64 offset, xmms_xform_seek_mode_t whence, xmms_error_t *error); */
-static size_t xmms_curl_callback_write (void *ptr, size_t size, size_t nmemb, void *stream);
+static gint64 xmms_curl_seek (xmms_xform_t *xform, gint64 offset, xmms_xform_seek_mode_t whence, xmms_error_t *error);
 static size_t xmms_curl_callback_header (void *ptr, size_t size, size_t nmemb, void *stream);
+static void xmms_curl_headers_apply (xmms_xform_t *xform, xmms_curl_data_t *data);
+static void xmms_curl_headers_discard (xmms_curl_data_t *data);
 
 static void xmms_curl_free_data (xmms_curl_data_t *data);
 
@@ -110,9 +148,7 @@ xmms_curl_plugin_setup (xmms_xform_plugin_t *xform_plugin)
 	methods.init = xmms_curl_init;
 	methods.destroy = xmms_curl_destroy;
 	methods.read = xmms_curl_read;
-	/*
 	methods.seek = xmms_curl_seek;
-	*/
 
 	xmms_xform_plugin_methods_set (xform_plugin, &methods);
 
@@ -141,6 +177,9 @@ xmms_curl_plugin_setup (xmms_xform_plugin_t *xform_plugin)
 	                                            "user", NULL, NULL);
 	xmms_xform_plugin_config_property_register (xform_plugin, "proxypass",
 	                                            "password", NULL, NULL);
+	/* size of the on-disk cache in MiB, 0 disables it */
+	xmms_xform_plugin_config_property_register (xform_plugin, "cachesize",
+	                                            "256", NULL, NULL);
 
 	xmms_xform_plugin_indata_add (xform_plugin,
 	                              XMMS_STREAM_TYPE_MIMETYPE,
@@ -163,6 +202,93 @@ xmms_curl_plugin_setup (xmms_xform_plugin_t *xform_plugin)
  * Member functions
  */
 
+static void
+xmms_curl_cache_open_for (xmms_curl_data_t *data, gint64 limit)
+{
+	gchar cachedir[XMMS_PATH_MAX], *dir;
+
+	if (!xmms_usercachedir_get (cachedir, XMMS_PATH_MAX)) {
+		return;
+	}
+
+	dir = g_build_filename (cachedir, "curl", NULL);
+	data->cache = xmms_curl_cache_open (dir, data->url, limit);
+	g_free (dir);
+
+	if (!data->cache) {
+		return;
+	}
+
+	xmms_curl_cache_validate (data->cache, data->size, data->etag);
+}
+
+/* Drop data from the front of the buffer, once it has been used or
+ * skipped. The stream position stays where it is.
+ */
+static void
+xmms_curl_buffer_drop (xmms_curl_data_t *data, guint len)
+{
+	len = MIN (len, data->bufferlen);
+
+	if (data->cache) {
+		xmms_curl_cache_store (data->cache, data->buffer_offset,
+		                       data->buffer, len);
+	}
+
+	data->bufferlen -= len;
+	data->buffer_offset += len;
+
+	if (data->bufferlen) {
+		memmove (data->buffer, data->buffer + len, data->bufferlen);
+	}
+}
+
+/* Restart the transfer at offset, asking for a byte range if possible */
+static void
+xmms_curl_restart (xmms_curl_data_t *data, gint64 offset)
+{
+	gchar range[32];
+
+	if (!data->seekable) {
+		offset = 0;
+	}
+
+	XMMS_DBG ("Restarting transfer at offset %" G_GINT64_FORMAT, offset);
+
+	xmms_curl_transfer_stop (data->transfer);
+
+	/* whatever the old response had to say no longer matters */
+	xmms_curl_headers_discard (data);
+
+	if (offset > 0) {
+		g_snprintf (range, sizeof (range), "%" G_GINT64_FORMAT "-", offset);
+		curl_easy_setopt (data->curl_easy, CURLOPT_RANGE, range);
+	} else {
+		curl_easy_setopt (data->curl_easy, CURLOPT_RANGE, NULL);
+	}
+
+	data->bufferlen = 0;
+	data->buffer_offset = offset;
+	data->http_status = 0;
+	data->done = FALSE;
+
+	xmms_curl_transfer_start (data->transfer);
+}
+
+/* Whether the running transfer will get to pos without a new request */
+static gboolean
+xmms_curl_positioned (xmms_curl_data_t *data)
+{
+	gint64 stream_pos = data->buffer_offset + data->bufferlen;
+
+	if (data->done || stream_pos > data->pos) {
+		return FALSE;
+	}
+
+	return stream_pos == data->pos || !data->seekable ||
+	       data->pos - stream_pos < XMMS_CURL_SKIP_LIMIT;
+}
+
 static gboolean
 xmms_curl_init (xmms_xform_t *xform)
 {
@@ -170,6 +296,7 @@ xmms_curl_init (xmms_xform_t *xform)
 	xmms_config_property_t *val;
 	xmms_error_t error;
 	gint metaint, verbose, connecttimeout, readtimeout, useproxy, authproxy;
+	gint cachesize;
 	const gchar *proxyaddress, *proxyuser, *proxypass;
 	gchar proxyuserpass[90];
 	const gchar *url;
@@ -181,6 +308,10 @@ xmms_curl_init (xmms_xform_t *xform)
 
 	data = g_new0 (xmms_curl_data_t, 1);
 	data->broken_version = FALSE;
+	data->size = -1;
+
+	g_mutex_init (&data->header_mutex);
+	g_queue_init (&data->headers);
 
 	val = xmms_xform_config_lookup (xform, "connecttimeout");
 	connecttimeout = xmms_config_property_get_int (val);
@@ -209,6 +340,9 @@ xmms_curl_init (xmms_xform_t *xform)
 	val = xmms_xform_config_lookup (xform, "proxypass");
 	proxypass = xmms_config_property_get_string (val);
 
+	val = xmms_xform_config_lookup (xform, "cachesize");
+	cachesize = xmms_config_property_get_int (val);
+
 	g_snprintf (proxyuserpass, sizeof (proxyuserpass), "%s:%s", proxyuser,
 	            proxypass);
 
@@ -244,10 +378,7 @@ xmms_curl_init (xmms_xform_t *xform)
 	curl_easy_setopt (data->curl_easy, CURLOPT_NOPROGRESS, 1);
 	curl_easy_setopt (data->curl_easy, CURLOPT_USERAGENT,
 	                  "XMMS2/" XMMS_VERSION);
-	curl_easy_setopt (data->curl_easy, CURLOPT_WRITEHEADER, xform);
-	curl_easy_setopt (data->curl_easy, CURLOPT_WRITEDATA, xform);
-	curl_easy_setopt (data->curl_easy, CURLOPT_WRITEFUNCTION,
-	                  xmms_curl_callback_write);
+	curl_easy_setopt (data->curl_easy, CURLOPT_WRITEHEADER, data);
 	curl_easy_setopt (data->curl_easy, CURLOPT_HEADERFUNCTION,
 	                  xmms_curl_callback_header);
 	curl_easy_setopt (data->curl_easy, CURLOPT_CONNECTTIMEOUT, connecttimeout);
@@ -281,13 +412,14 @@ xmms_curl_init (xmms_xform_t *xform)
 		                  data->http_req_headers);
 	}
 
-	data->curl_multi = curl_multi_init ();
-	data->curl_code = CURLM_CALL_MULTI_PERFORM;
-
-	curl_multi_add_handle (data->curl_multi, data->curl_easy);
+	data->transfer = xmms_curl_transfer_new (data->curl_easy,
+	                                         XMMS_CURL_QUEUE_SIZE);
 
+	/* the header handlers need it once the first data comes in */
 	xmms_xform_private_data_set (xform, data);
 
+	xmms_curl_transfer_start (data->transfer);
+
 	/* perform initial fill to see if it contains shoutcast metadata or not */
 	if (fill_buffer (xform, data, &error) <= 0) {
 		/* something went wrong */
@@ -296,6 +428,11 @@ xmms_curl_init (xmms_xform_t *xform)
 		return FALSE;
 	}
 
+	/* Shoutcast streams go on forever, only cache things with an end */
+	if (cachesize > 0 && data->meta_offset == 0 && data->size > 0) {
+		xmms_curl_cache_open_for (data, (gint64) cachesize * 1024 * 1024);
+	}
+
 	if (data->meta_offset > 0) {
 		XMMS_DBG ("icy-metadata detected");
 		xmms_xform_auxdata_set_int (xform, "meta_offset", data->meta_offset);
@@ -314,83 +451,36 @@ xmms_curl_init (xmms_xform_t *xform)
 	return TRUE;
 }
 
+/* Move whatever the transfer has received into our buffer, waiting for
+ * it if needed.
+ */
 static gint
 fill_buffer (xmms_xform_t *xform, xmms_curl_data_t *data, xmms_error_t *error)
 {
-	gint handles;
+	gint ret;
 
 	g_return_val_if_fail (xform, -1);
 	g_return_val_if_fail (data, -1);
 	g_return_val_if_fail (error, -1);
 
-	while (TRUE) {
-		if (data->curl_code == CURLM_OK) {
-			fd_set fdread, fdwrite, fdexcp;
-			struct timeval timeout;
-			gint ret, maxfd;
-			glong milliseconds;
-
-			FD_ZERO (&fdread);
-			FD_ZERO (&fdwrite);
-			FD_ZERO (&fdexcp);
-
-			curl_multi_fdset (data->curl_multi, &fdread, &fdwrite, &fdexcp,
-			                  &maxfd);
-			curl_multi_timeout (data->curl_multi, &milliseconds);
-
-			if (milliseconds <= 0) {
-				milliseconds = 1000;
-			}
-
-			timeout.tv_sec = milliseconds / 1000;
-			timeout.tv_usec = (milliseconds % 1000) * 1000;
+	ret = xmms_curl_transfer_read (data->transfer,
+	                               data->buffer + data->bufferlen,
+	                               CURL_MAX_WRITE_SIZE - data->bufferlen,
+	                               error);
 
-			ret = select (maxfd + 1, &fdread, &fdwrite, &fdexcp, &timeout);
+	/* the headers arrived before the data, and may say where it goes */
+	xmms_curl_headers_apply (xform, data);
 
-			if (ret == -1) {
-				xmms_error_set (error, XMMS_ERROR_GENERIC, "Error select");
-				return -1;
-			}
-		}
-
-		data->curl_code = curl_multi_perform (data->curl_multi, &handles);
-
-		if (data->curl_code != CURLM_CALL_MULTI_PERFORM &&
-		    data->curl_code != CURLM_OK) {
-
-			xmms_error_set (error, XMMS_ERROR_GENERIC,
-			                curl_multi_strerror (data->curl_code));
-			return -1;
-		}
-
-		/* done */
-		if (handles == 0) {
-			CURLMsg *curlmsg;
-			gint messages;
-
-			do {
-				curlmsg = curl_multi_info_read (data->curl_multi, &messages);
-
-				if (curlmsg == NULL)
-					break;
-
-				if (curlmsg->msg == CURLMSG_DONE && curlmsg->data.result != CURLE_OK) {
-					xmms_log_error ("Curl fill_buffer returned error: (%d) %s",
-					                curlmsg->data.result,
-					                curl_easy_strerror (curlmsg->data.result));
-				} else {
-					XMMS_DBG ("Curl fill_buffer returned unknown message (%d)", curlmsg->msg);
-				}
-			} while (messages > 0);
-
-			data->done = TRUE;
-			return 0;
-		}
+	if (ret > 0) {
+		data->bufferlen += ret;
+		return 1;
+	}
 
-		if (data->bufferlen > 0) {
-			return 1;
-		}
+	if (ret == 0) {
+		data->done = TRUE;
 	}
+
+	return ret;
 }
 
 static gint
@@ -407,26 +497,55 @@ xmms_curl_read (xmms_xform_t *xform, void *buffer, gint len,
 	data = xmms_xform_private_data_get (xform);
 	g_return_val_if_fail (data, -1);
 
-	if (data->done)
-		return 0;
-
 	while (TRUE) {
+		/* skip data we've seeked past */
+		if (data->buffer_offset < data->pos) {
+			xmms_curl_buffer_drop (data, MIN (data->bufferlen,
+			                                  data->pos - data->buffer_offset));
+		}
 
 		/* if we have data available, just pick it up (even if there's
 		   less bytes available than was requested) */
-		if (data->bufferlen) {
+		if (data->bufferlen && data->buffer_offset == data->pos) {
 			len = MIN (len, data->bufferlen);
 			memcpy (buffer, data->buffer, len);
-			data->bufferlen -= len;
-			if (data->bufferlen) {
-				memmove (data->buffer, data->buffer + len, data->bufferlen);
-			}
+			xmms_curl_buffer_drop (data, len);
+			data->pos += len;
 			return len;
 		}
 
+		/* Don't let the cache interrupt a transfer we can't resume */
+		if (data->cache && (data->seekable || !xmms_curl_positioned (data))) {
+			ret = xmms_curl_cache_read (data->cache, data->pos, buffer, len);
+			if (ret > 0) {
+				data->pos += ret;
+				return ret;
+			}
+		}
+
+		if (data->size >= 0 && data->pos >= data->size) {
+			return 0;
+		}
+
+		if (!xmms_curl_positioned (data)) {
+			/* can't get there from here */
+			if (data->done && !data->seekable && data->pos >= data->buffer_offset) {
+				return 0;
+			}
+			xmms_curl_restart (data, data->pos);
+			data->restarted = TRUE;
+		}
+
 		ret = fill_buffer (xform, data, error);
 
-		if (ret == 0 || ret == -1) {
+		if (ret == 1) {
+			data->restarted = FALSE;
+		} else if (ret == 0 && data->seekable && !data->restarted &&
+		           data->size > data->pos) {
+			/* the connection went away early, pick up where it left */
+			xmms_curl_restart (data, data->pos);
+			data->restarted = TRUE;
+		} else {
 			return ret;
 		}
 	}
@@ -449,28 +568,6 @@ xmms_curl_destroy (xmms_xform_t *xform)
  * CURL callback functions
  */
 
-static size_t
-xmms_curl_callback_write (void *ptr, size_t size, size_t nmemb, void *stream)
-{
-	xmms_curl_data_t *data;
-	xmms_xform_t *xform = (xmms_xform_t *) stream;
-	gint len;
-
-	g_return_val_if_fail (xform, 0);
-
-	data = xmms_xform_private_data_get (xform);
-	g_return_val_if_fail (data, 0);
-
-	len = size * nmemb;
-
-	g_return_val_if_fail ((data->bufferlen + len) <= CURL_MAX_WRITE_SIZE, 0);
-
-	memcpy (data->buffer + data->bufferlen, ptr, len);
-	data->bufferlen = data->bufferlen + len;
-
-	return len;
-}
-
 static int
 strlen_no_crlf (char *ptr, int len) {
 	int ep = len - 1;
@@ -482,33 +579,65 @@ strlen_no_crlf (char *ptr, int len) {
 	return ep + 1;
 }
 
+/* Called from the pool thread, so only queue the header for
+ * xmms_curl_headers_apply.
+ */
 static size_t
 xmms_curl_callback_header (void *ptr, size_t size, size_t nmemb, void *stream)
 {
-	xmms_xform_t *xform = (xmms_xform_t *) stream;
-	handler_func_t func;
-	gchar *header;
+	xmms_curl_data_t *data = (xmms_curl_data_t *) stream;
 
 	XMMS_DBG ("%.*s", strlen_no_crlf ((char*)ptr, size * nmemb), (char*)ptr);
 
-	g_return_val_if_fail (xform, 0);
+	g_return_val_if_fail (data, 0);
 	g_return_val_if_fail (ptr, 0);
 
-	header = g_strndup ((gchar*)ptr, size * nmemb);
+	g_mutex_lock (&data->header_mutex);
+	g_queue_push_tail (&data->headers, g_strndup ((gchar*)ptr, size * nmemb));
+	g_mutex_unlock (&data->header_mutex);
 
-	func = header_handler_find (header);
-	if (func != NULL) {
-		gchar *val = strchr (header, ':');
-		if (val) {
-			g_strstrip (++val);
-		} else {
-			val = header;
+	return size * nmemb;
+}
+
+/* Run the handlers of the headers received so far, in order. */
+static void
+xmms_curl_headers_apply (xmms_xform_t *xform, xmms_curl_data_t *data)
+{
+	handler_func_t func;
+	GQueue headers;
+	gchar *header;
+
+	g_mutex_lock (&data->header_mutex);
+	headers = data->headers;
+	g_queue_init (&data->headers);
+	g_mutex_unlock (&data->header_mutex);
+
+	while ((header = g_queue_pop_head (&headers))) {
+		func = header_handler_find (header);
+		if (func != NULL) {
+			gchar *val = strchr (header, ':');
+			if (val) {
+				g_strstrip (++val);
+			} else {
+				val = header;
+			}
+			func (xform, val);
 		}
-		func (xform, val);
+
+		g_free (header);
 	}
+}
 
-	g_free (header);
-	return size * nmemb;
+static void
+xmms_curl_headers_discard (xmms_curl_data_t *data)
+{
+	gchar *header;
+
+	g_mutex_lock (&data->header_mutex);
+	while ((header = g_queue_pop_head (&data->headers))) {
+		g_free (header);
+	}
+	g_mutex_unlock (&data->header_mutex);
 }
 
 static handler_func_t
@@ -533,13 +662,95 @@ static void
 header_handler_contentlength (xmms_xform_t *xform,
                               gchar *header)
 {
-	int length;
+	xmms_curl_data_t *data;
+	gint64 length;
 	const gchar *metakey;
 
-	length = strtoul (header, NULL, 10);
+	data = xmms_xform_private_data_get (xform);
+
+	/* that's only the length of the range, Content-Range has the rest */
+	if (data->http_status == 206) {
+		return;
+	}
 
-	metakey = XMMS_MEDIALIB_ENTRY_PROPERTY_SIZE,
-	xmms_xform_metadata_set_int (xform, metakey, length);
+	length = g_ascii_strtoll (header, NULL, 10);
+	if (length < 0) {
+		return;
+	}
+
+	data->size = length;
+
+	/* the medialib can't hold the size of anything past 2 GiB */
+	if (length <= G_MAXINT32) {
+		metakey = XMMS_MEDIALIB_ENTRY_PROPERTY_SIZE;
+		xmms_xform_metadata_set_int (xform, metakey, length);
+	}
+}
+
+static void
+header_handler_status (xmms_xform_t *xform,
+                       gchar *header)
+{
+	xmms_curl_data_t *data;
+	gchar *code;
+
+	data = xmms_xform_private_data_get (xform);
+
+	code = strchr (header, ' ');
+	if (!code) {
+		return;
+	}
+
+	data->http_status = strtoul (code, NULL, 10);
+
+	/* every response (redirects too) has to tell us again */
+	data->seekable = FALSE;
+
+	/* the server ignored our Range and is starting over */
+	if (data->http_status == 200) {
+		data->buffer_offset = 0;
+	}
+}
+
+static void
+header_handler_accept_ranges (xmms_xform_t *xform,
+                              gchar *header)
+{
+	xmms_curl_data_t *data;
+
+	data = xmms_xform_private_data_get (xform);
+
+	data->seekable = g_ascii_strcasecmp (header, "bytes") == 0;
+}
+
+static void
+header_handler_content_range (xmms_xform_t *xform,
+                              gchar *header)
+{
+	xmms_curl_data_t *data;
+	gint64 start, end, total;
+
+	data = xmms_xform_private_data_get (xform);
+
+	/* bytes <start>-<end>/<total> */
+	if (sscanf (header, "bytes %" G_GINT64_FORMAT "-%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT,
+	            &start, &end, &total) == 3) {
+		data->buffer_offset = start;
+		data->size = total;
+		data->seekable = TRUE;
+	}
+}
+
+static void
+header_handler_etag (xmms_xform_t *xform,
+                     gchar *header)
+{
+	xmms_curl_data_t *data;
+
+	data = xmms_xform_private_data_get (xform);
+
+	g_free (data->etag);
+	data->etag = g_strdup (header);
 }
 
 static void
@@ -574,23 +785,73 @@ xmms_curl_free_data (xmms_curl_data_t *data)
 {
 	g_return_if_fail (data);
 
-	curl_multi_cleanup (data->curl_multi);
+	if (data->cache) {
+		xmms_curl_cache_close (data->cache);
+	}
+
+	if (data->transfer) {
+		xmms_curl_transfer_free (data->transfer);
+	}
 	curl_easy_cleanup (data->curl_easy);
 
+	xmms_curl_headers_discard (data);
+	g_mutex_clear (&data->header_mutex);
+
 	curl_slist_free_all (data->http_200_aliases);
 	curl_slist_free_all (data->http_req_headers);
 
 	g_free (data->buffer);
 
+	g_free (data->etag);
 	g_free (data->url);
 	g_free (data);
 }
 
-/*
+/* Seeking only moves the read position, the next read decides whether
+ * the cache, the running transfer or a new Range request serves it.
+ */
 static gint64
 xmms_curl_seek (xmms_xform_t *xform, gint64 offset,
-                xmms_xform_seek_mode_t whence, xmms_error_t *error) {
-	xmms_error_set (error, XMMS_ERROR_INVAL, "Couldn't seek");
-	return -1;
+                xmms_xform_seek_mode_t whence, xmms_error_t *error)
+{
+	xmms_curl_data_t *data;
+
+	g_return_val_if_fail (xform, -1);
+
+	data = xmms_xform_private_data_get (xform);
+	g_return_val_if_fail (data, -1);
+
+	if (data->meta_offset > 0 || (!data->seekable && !data->cache)) {
+		xmms_error_set (error, XMMS_ERROR_INVAL, "Couldn't seek");
+		return -1;
+	}
+
+	switch (whence) {
+		case XMMS_XFORM_SEEK_CUR:
+			offset += data->pos;
+			break;
+		case XMMS_XFORM_SEEK_END:
+			if (data->size < 0) {
+				xmms_error_set (error, XMMS_ERROR_INVAL, "Couldn't seek");
+				return -1;
+			}
+			offset += data->size;
+			break;
+		default:
+			break;
+	}
+
+	if (offset < 0) {
+		xmms_error_set (error, XMMS_ERROR_INVAL, "Couldn't seek");
+		return -1;
+	}
+
+	/* anything buffered before the new position is of no use */
+	if (offset < data->buffer_offset) {
+		xmms_curl_buffer_drop (data, data->bufferlen);
+	}
+
+	data->pos = offset;
+
+	return offset;
 }
-*/
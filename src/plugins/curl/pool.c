@@ -0,0 +1,475 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+/*
+ * All transfers of the process share a single curl multi handle, so
+ * keep-alive connections (and TLS sessions) left behind by one track
+ * are picked up by the next one from the same server.
+ *
+ * The multi handle is driven by a thread of its own, sleeping in
+ * epoll_wait until curl has something to do. Every call into curl,
+ * from any thread, is made with the pool mutex held. That includes the
+ * write and header callbacks, which therefore run with the mutex held
+ * too. Received data is queued per transfer until its xform reads it.
+ * A transfer whose queue is full is paused until the xform catches up.
+ *
+ * Without epoll, the thread falls back to curl_multi_wait.
+ */
+
+#include <xmms/xmms_log.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
+
+#include "pool.h"
+
+#define XMMS_CURL_POOL_MAX_EVENTS 16
+
+struct xmms_curl_transfer_St {
+	CURL *easy;
+
+	/* data received but not read yet */
+	GByteArray *queue;
+	gsize max_buffer;
+
+	gboolean active;
+	gboolean paused;
+	gboolean done;
+	CURLcode result;
+
+	GCond cond;
+};
+
+typedef struct {
+	GMutex mutex;
+	CURLM *multi;
+	GThread *thread;
+
+	/* written to whenever curl has new work between two waits */
+	gint wakeup[2];
+
+	/* when curl wants to be called, -1 if it doesn't care */
+	gint64 deadline;
+
+#ifdef HAVE_SYS_EPOLL_H
+	gint epfd;
+#endif
+} xmms_curl_pool_t;
+
+static xmms_curl_pool_t *pool;
+
+static gpointer xmms_curl_pool_thread (gpointer arg);
+
+static void
+xmms_curl_pool_wakeup (void)
+{
+	gchar c = 0;
+
+	if (write (pool->wakeup[1], &c, 1) == -1 && errno != EAGAIN) {
+		xmms_log_error ("Couldn't wake up curl thread: %s", strerror (errno));
+	}
+}
+
+static gint
+xmms_curl_pool_timer (CURLM *multi, long timeout_ms, void *userp)
+{
+	if (timeout_ms < 0) {
+		pool->deadline = -1;
+	} else {
+		pool->deadline = g_get_monotonic_time () + timeout_ms * 1000;
+	}
+
+	return 0;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static gint
+xmms_curl_pool_socket (CURL *easy, curl_socket_t s, int what,
+                       void *userp, void *socketp)
+{
+	struct epoll_event event;
+
+	if (what == CURL_POLL_REMOVE) {
+		/* the socket may already be closed, which removes it anyway */
+		epoll_ctl (pool->epfd, EPOLL_CTL_DEL, s, NULL);
+		return 0;
+	}
+
+	memset (&event, 0, sizeof (event));
+	event.data.fd = s;
+	if (what & CURL_POLL_IN) {
+		event.events |= EPOLLIN;
+	}
+	if (what & CURL_POLL_OUT) {
+		event.events |= EPOLLOUT;
+	}
+
+	if (epoll_ctl (pool->epfd, EPOLL_CTL_MOD, s, &event) == -1 && errno == ENOENT) {
+		epoll_ctl (pool->epfd, EPOLL_CTL_ADD, s, &event);
+	}
+
+	return 0;
+}
+#endif
+
+static void
+xmms_curl_pool_init (void)
+{
+	xmms_curl_pool_t *p;
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event event;
+#endif
+
+	p = g_new0 (xmms_curl_pool_t, 1);
+	g_mutex_init (&p->mutex);
+	p->deadline = -1;
+
+	if (pipe (p->wakeup) == -1) {
+		xmms_log_fatal ("Couldn't create curl wakeup pipe: %s", strerror (errno));
+	}
+	fcntl (p->wakeup[0], F_SETFL, O_NONBLOCK);
+	fcntl (p->wakeup[1], F_SETFL, O_NONBLOCK);
+
+	p->multi = curl_multi_init ();
+	curl_multi_setopt (p->multi, CURLMOPT_TIMERFUNCTION, xmms_curl_pool_timer);
+
+#ifdef HAVE_SYS_EPOLL_H
+	p->epfd = epoll_create1 (EPOLL_CLOEXEC);
+	if (p->epfd == -1) {
+		xmms_log_fatal ("Couldn't create epoll instance: %s", strerror (errno));
+	}
+
+	memset (&event, 0, sizeof (event));
+	event.events = EPOLLIN;
+	event.data.fd = p->wakeup[0];
+	epoll_ctl (p->epfd, EPOLL_CTL_ADD, p->wakeup[0], &event);
+
+	curl_multi_setopt (p->multi, CURLMOPT_SOCKETFUNCTION, xmms_curl_pool_socket);
+#endif
+
+	pool = p;
+
+	/* never joined, the connections are kept around for the next track */
+	p->thread = g_thread_new ("x2 curl", xmms_curl_pool_thread, p);
+}
+
+static void
+xmms_curl_pool_ensure (void)
+{
+	static gsize initialized = 0;
+
+	if (g_once_init_enter (&initialized)) {
+		xmms_curl_pool_init ();
+		g_once_init_leave (&initialized, 1);
+	}
+}
+
+static void
+xmms_curl_pool_drain_wakeup (void)
+{
+	gchar buf[64];
+
+	while (read (pool->wakeup[0], buf, sizeof (buf)) > 0);
+}
+
+/* Hand finished transfers their result. Called with the mutex held. */
+static void
+xmms_curl_pool_check_done (void)
+{
+	xmms_curl_transfer_t *transfer;
+	CURLMsg *msg;
+	gint messages;
+
+	while ((msg = curl_multi_info_read (pool->multi, &messages))) {
+		if (msg->msg != CURLMSG_DONE) {
+			continue;
+		}
+
+		curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, &transfer);
+		if (!transfer) {
+			continue;
+		}
+
+		transfer->done = TRUE;
+		transfer->result = msg->data.result;
+		g_cond_broadcast (&transfer->cond);
+	}
+}
+
+/* Milliseconds until curl wants to be called, or -1 for never */
+static gint
+xmms_curl_pool_timeout (void)
+{
+	gint64 now;
+
+	if (pool->deadline < 0) {
+		return -1;
+	}
+
+	now = g_get_monotonic_time ();
+	if (pool->deadline <= now) {
+		return 0;
+	}
+
+	return MIN ((pool->deadline - now + 999) / 1000, G_MAXINT);
+}
+
+static gpointer
+xmms_curl_pool_thread (gpointer arg)
+{
+	gint running;
+
+	g_mutex_lock (&pool->mutex);
+
+	while (TRUE) {
+#ifdef HAVE_SYS_EPOLL_H
+		struct epoll_event events[XMMS_CURL_POOL_MAX_EVENTS];
+		gint i, n, timeout;
+
+		timeout = xmms_curl_pool_timeout ();
+
+		g_mutex_unlock (&pool->mutex);
+		n = epoll_wait (pool->epfd, events, XMMS_CURL_POOL_MAX_EVENTS, timeout);
+		g_mutex_lock (&pool->mutex);
+
+		for (i = 0; i < n; i++) {
+			gint mask = 0;
+
+			if (events[i].data.fd == pool->wakeup[0]) {
+				xmms_curl_pool_drain_wakeup ();
+				continue;
+			}
+
+			if (events[i].events & EPOLLIN) {
+				mask |= CURL_CSELECT_IN;
+			}
+			if (events[i].events & EPOLLOUT) {
+				mask |= CURL_CSELECT_OUT;
+			}
+			if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+				mask |= CURL_CSELECT_ERR;
+			}
+
+			curl_multi_socket_action (pool->multi, events[i].data.fd,
+			                          mask, &running);
+		}
+
+		if (pool->deadline >= 0 && pool->deadline <= g_get_monotonic_time ()) {
+			pool->deadline = -1;
+			curl_multi_socket_action (pool->multi, CURL_SOCKET_TIMEOUT,
+			                          0, &running);
+		}
+#else
+		struct curl_waitfd wakeup;
+		gint timeout;
+
+		wakeup.fd = pool->wakeup[0];
+		wakeup.events = CURL_WAIT_POLLIN;
+		wakeup.revents = 0;
+
+		/* curl_multi_wait wants a timeout, it doesn't do "forever" */
+		timeout = xmms_curl_pool_timeout ();
+		if (timeout < 0) {
+			timeout = 1000;
+		}
+
+		g_mutex_unlock (&pool->mutex);
+		curl_multi_wait (pool->multi, &wakeup, 1, timeout, NULL);
+		g_mutex_lock (&pool->mutex);
+
+		if (wakeup.revents) {
+			xmms_curl_pool_drain_wakeup ();
+		}
+
+		curl_multi_perform (pool->multi, &running);
+#endif
+
+		xmms_curl_pool_check_done ();
+	}
+
+	g_mutex_unlock (&pool->mutex);
+
+	return NULL;
+}
+
+static size_t
+xmms_curl_transfer_write (void *ptr, size_t size, size_t nmemb, void *stream)
+{
+	xmms_curl_transfer_t *transfer = stream;
+	gsize len = size * nmemb;
+
+	/* curl keeps the data and hands it to us again once unpaused */
+	if (transfer->queue->len >= transfer->max_buffer) {
+		transfer->paused = TRUE;
+		return CURL_WRITEFUNC_PAUSE;
+	}
+
+	g_byte_array_append (transfer->queue, ptr, len);
+	g_cond_broadcast (&transfer->cond);
+
+	return len;
+}
+
+/**
+ * Set up a transfer on the shared connection pool.
+ *
+ * The easy handle has to be configured, except for its write function,
+ * which the pool takes over. Its header function, if any, will be
+ * called from the pool thread.
+ *
+ * @param max_buffer how much received data to queue before pausing
+ */
+xmms_curl_transfer_t *
+xmms_curl_transfer_new (CURL *easy, gsize max_buffer)
+{
+	xmms_curl_transfer_t *transfer;
+
+	g_return_val_if_fail (easy, NULL);
+
+	xmms_curl_pool_ensure ();
+
+	transfer = g_new0 (xmms_curl_transfer_t, 1);
+	transfer->easy = easy;
+	transfer->queue = g_byte_array_new ();
+	transfer->max_buffer = max_buffer;
+	g_cond_init (&transfer->cond);
+
+	curl_easy_setopt (easy, CURLOPT_PRIVATE, transfer);
+	curl_easy_setopt (easy, CURLOPT_WRITEFUNCTION, xmms_curl_transfer_write);
+	curl_easy_setopt (easy, CURLOPT_WRITEDATA, transfer);
+
+	return transfer;
+}
+
+void
+xmms_curl_transfer_free (xmms_curl_transfer_t *transfer)
+{
+	g_return_if_fail (transfer);
+
+	xmms_curl_transfer_stop (transfer);
+
+	g_cond_clear (&transfer->cond);
+	g_byte_array_free (transfer->queue, TRUE);
+	g_free (transfer);
+}
+
+/**
+ * Start (or restart) the transfer, dropping anything still queued.
+ */
+void
+xmms_curl_transfer_start (xmms_curl_transfer_t *transfer)
+{
+	g_return_if_fail (transfer);
+
+	g_mutex_lock (&pool->mutex);
+
+	if (transfer->active) {
+		curl_multi_remove_handle (pool->multi, transfer->easy);
+	}
+
+	g_byte_array_set_size (transfer->queue, 0);
+	transfer->paused = FALSE;
+	transfer->done = FALSE;
+	transfer->result = CURLE_OK;
+	transfer->active = TRUE;
+
+	curl_multi_add_handle (pool->multi, transfer->easy);
+
+	g_mutex_unlock (&pool->mutex);
+
+	xmms_curl_pool_wakeup ();
+}
+
+/**
+ * Stop the transfer. The easy handle may be reconfigured afterwards, its
+ * connection stays in the pool for others to use.
+ */
+void
+xmms_curl_transfer_stop (xmms_curl_transfer_t *transfer)
+{
+	g_return_if_fail (transfer);
+
+	g_mutex_lock (&pool->mutex);
+
+	if (transfer->active) {
+		curl_multi_remove_handle (pool->multi, transfer->easy);
+		transfer->active = FALSE;
+	}
+
+	g_mutex_unlock (&pool->mutex);
+}
+
+/**
+ * Read received data, waiting for some to arrive if needed.
+ *
+ * @return the number of bytes read, 0 once the transfer is over, or -1
+ * if it never started.
+ */
+gint
+xmms_curl_transfer_read (xmms_curl_transfer_t *transfer, void *buffer,
+                         gint len, xmms_error_t *error)
+{
+	gboolean unpause = FALSE;
+	gint ret;
+
+	g_return_val_if_fail (transfer, -1);
+	g_return_val_if_fail (buffer, -1);
+
+	g_mutex_lock (&pool->mutex);
+
+	if (!transfer->active) {
+		g_mutex_unlock (&pool->mutex);
+		xmms_error_set (error, XMMS_ERROR_GENERIC, "Transfer not started");
+		return -1;
+	}
+
+	while (!transfer->queue->len && !transfer->done) {
+		g_cond_wait (&transfer->cond, &pool->mutex);
+	}
+
+	if (transfer->queue->len) {
+		ret = MIN (len, transfer->queue->len);
+		memcpy (buffer, transfer->queue->data, ret);
+		g_byte_array_remove_range (transfer->queue, 0, ret);
+
+		if (transfer->paused && transfer->queue->len < transfer->max_buffer / 2) {
+			transfer->paused = FALSE;
+			curl_easy_pause (transfer->easy, CURLPAUSE_CONT);
+			unpause = TRUE;
+		}
+	} else {
+		if (transfer->result != CURLE_OK) {
+			xmms_log_error ("Curl transfer returned error: (%d) %s",
+			                transfer->result,
+			                curl_easy_strerror (transfer->result));
+		}
+		ret = 0;
+	}
+
+	g_mutex_unlock (&pool->mutex);
+
+	if (unpause) {
+		xmms_curl_pool_wakeup ();
+	}
+
+	return ret;
+}
@@ -0,0 +1,33 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#ifndef __XMMS_CURL_POOL_H__
+#define __XMMS_CURL_POOL_H__
+
+#include <xmms/xmms_xformplugin.h>
+#include <curl/curl.h>
+
+typedef struct xmms_curl_transfer_St xmms_curl_transfer_t;
+
+xmms_curl_transfer_t *xmms_curl_transfer_new (CURL *easy, gsize max_buffer);
+void xmms_curl_transfer_free (xmms_curl_transfer_t *transfer);
+
+void xmms_curl_transfer_start (xmms_curl_transfer_t *transfer);
+void xmms_curl_transfer_stop (xmms_curl_transfer_t *transfer);
+
+gint xmms_curl_transfer_read (xmms_curl_transfer_t *transfer, void *buffer, gint len, xmms_error_t *error);
+
+#endif
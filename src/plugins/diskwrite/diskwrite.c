@@ -34,6 +34,9 @@
  */
 #define WAVE_HEADER_SIZE 44
 
+/* stdio buffer used when rendering offline */
+#define OFFLINE_BUFFER_SIZE (1024 * 1024)
+
 #define PUT_16(buf, val) do { \
 	guint16 tmp = GUINT16_TO_LE (val); \
 	memcpy (buf, &tmp, 2); \
@@ -59,6 +62,7 @@
 typedef struct {
 	FILE *fp;
 	gchar destdir[XMMS_PATH_MAX];
+	gboolean offline;
 } xmms_diskwrite_data_t;
 
 /*
@@ -107,6 +111,10 @@ xmms_null_plugin_setup (xmms_output_plugin_t *plugin)
 	xmms_output_plugin_config_property_register (plugin,
 	                                             "destination_directory",
 	                                             "/tmp", NULL, NULL);
+
+	/* write as fast as the chain decodes instead of in realtime */
+	xmms_output_plugin_config_property_register (plugin, "offline",
+	                                             "0", NULL, NULL);
 	return TRUE;
 }
 
@@ -171,6 +179,7 @@ static gboolean
 xmms_diskwrite_open (xmms_output_t *output)
 {
 	xmms_diskwrite_data_t *data;
+	xmms_config_property_t *val;
 	gint ret;
 
 	g_return_val_if_fail (output, FALSE);
@@ -178,6 +187,10 @@ xmms_diskwrite_open (xmms_output_t *output)
 	data = xmms_output_private_data_get (output);
 	g_return_val_if_fail (data, FALSE);
 
+	val = xmms_output_config_lookup (output, "offline");
+	data->offline = !!xmms_config_property_get_int (val);
+	xmms_output_realtime_set (output, !data->offline);
+
 	/* create the destination directory if it doesn't exist yet */
 	if (!g_file_test (data->destdir, G_FILE_TEST_IS_DIR)) {
 		ret = g_mkdir_with_parents (data->destdir, 0755);
@@ -288,6 +301,11 @@ on_playlist_entry_changed (xmms_object_t *object, xmmsv_t *arg, gpointer udata)
 	data->fp = fopen (dest, "wb");
 	g_return_if_fail (data->fp);
 
+	/* fewer, larger writes when we're not bound to realtime */
+	if (data->offline) {
+		setvbuf (data->fp, NULL, _IOFBF, OFFLINE_BUFFER_SIZE);
+	}
+
 	/* skip the header, it's written later when we know how
 	 * large the actual payload is.
 	 */
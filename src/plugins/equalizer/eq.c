@@ -45,6 +45,8 @@ typedef struct xmms_equalizer_priv_St {
 	xmms_config_property_t *gain[EQ_MAX_BANDS];
 	xmms_config_property_t *legacy[EQ_BANDS_LEGACY];
 	gboolean enabled;
+	gint channels;
+	iir_state_t *iir;
 } xmms_equalizer_data_t;
 
 XMMS_XFORM_PLUGIN_DEFINE ("equalizer",
@@ -125,6 +127,8 @@ xmms_eq_plugin_setup (xmms_xform_plugin_t *xform_plugin)
 	                              11025,
 	                              XMMS_STREAM_TYPE_END);
 
+	init_iir ();
+
 	return TRUE;
 }
 
@@ -133,14 +137,28 @@ xmms_eq_init (xmms_xform_t *xform)
 {
 	xmms_equalizer_data_t *priv;
 	xmms_config_property_t *config;
-	gint i, j, srate;
+	gint i, j, srate, channels;
 	gfloat gain;
 
 	g_return_val_if_fail (xform, FALSE);
 
+	channels = xmms_xform_indata_get_int (xform, XMMS_STREAM_TYPE_FMT_CHANNELS);
+	if (channels < 1 || channels > EQ_MAX_CHANNELS) {
+		xmms_log_error ("Equalizer supports at most %d channels, got %d",
+		                EQ_MAX_CHANNELS, channels);
+		return FALSE;
+	}
+
 	priv = g_new0 (xmms_equalizer_data_t, 1);
 	g_return_val_if_fail (priv, FALSE);
 
+	priv->channels = channels;
+	priv->iir = iir_new (channels);
+	if (!priv->iir) {
+		g_free (priv);
+		return FALSE;
+	}
+
 	xmms_xform_private_data_set (xform, priv);
 
 	config = xmms_xform_config_lookup (xform, "enabled");
@@ -168,8 +186,8 @@ xmms_eq_init (xmms_xform_t *xform)
 	xmms_config_property_callback_set (config, xmms_eq_gain_changed, priv);
 	gain = xmms_config_property_get_float (config);
 
-	for (i=0; i<EQ_CHANNELS; i++) {
-		set_preamp (i, xmms_eq_gain_scale (gain, TRUE));
+	for (i=0; i<priv->channels; i++) {
+		set_preamp (priv->iir, i, xmms_eq_gain_scale (gain, TRUE));
 	}
 
 	for (i=0; i<EQ_BANDS_LEGACY; i++) {
@@ -184,8 +202,8 @@ xmms_eq_init (xmms_xform_t *xform)
 
 		gain = xmms_config_property_get_float (config);
 		if (priv->use_legacy) {
-			for (j = 0; j < EQ_CHANNELS; j++) {
-				set_gain (i, j, xmms_eq_gain_scale (gain, FALSE));
+			for (j = 0; j < priv->channels; j++) {
+				set_gain (priv->iir, i, j, xmms_eq_gain_scale (gain, FALSE));
 			}
 		}
 	}
@@ -202,18 +220,17 @@ xmms_eq_init (xmms_xform_t *xform)
 
 		gain = xmms_config_property_get_float (config);
 		if (!priv->use_legacy) {
-			for (j = 0; j < EQ_CHANNELS; j++) {
-				set_gain (i, j, xmms_eq_gain_scale (gain, FALSE));
+			for (j = 0; j < priv->channels; j++) {
+				set_gain (priv->iir, i, j, xmms_eq_gain_scale (gain, FALSE));
 			}
 		}
 	}
 
-	init_iir ();
 	srate = xmms_xform_indata_get_int (xform, XMMS_STREAM_TYPE_FMT_SAMPLERATE);
 	if (priv->use_legacy) {
-		config_iir (srate, EQ_BANDS_LEGACY, 1);
+		config_iir (priv->iir, srate, EQ_BANDS_LEGACY, 1);
 	} else {
-		config_iir (srate, priv->bands, 0);
+		config_iir (priv->iir, srate, priv->bands, 0);
 	}
 
 	xmms_xform_outdata_type_copy (xform);
@@ -227,7 +244,7 @@ static void
 xmms_eq_destroy (xmms_xform_t *xform)
 {
 	xmms_config_property_t *config;
-	gpointer priv;
+	xmms_equalizer_data_t *priv;
 	gchar buf[16];
 	gint i;
 
@@ -262,6 +279,7 @@ xmms_eq_destroy (xmms_xform_t *xform)
 		xmms_config_property_callback_remove (config, xmms_eq_gain_changed, priv);
 	}
 
+	iir_free (priv->iir);
 	g_free (priv);
 }
 
@@ -270,7 +288,7 @@ xmms_eq_read (xmms_xform_t *xform, xmms_sample_t *buf, gint len,
               xmms_error_t *error)
 {
 	xmms_equalizer_data_t *priv;
-	gint read, chan;
+	gint read;
 
 	g_return_val_if_fail (xform, -1);
 
@@ -278,9 +296,8 @@ xmms_eq_read (xmms_xform_t *xform, xmms_sample_t *buf, gint len,
 	g_return_val_if_fail (priv, -1);
 
 	read = xmms_xform_read (xform, buf, len, error);
-	chan = xmms_xform_indata_get_int (xform, XMMS_STREAM_TYPE_FMT_CHANNELS);
 	if (read > 0 && priv->enabled) {
-		iir (buf, read, chan, priv->extra_filtering);
+		iir (priv->iir, buf, read, priv->extra_filtering);
 	}
 
 	return read;
@@ -331,8 +348,8 @@ xmms_eq_gain_changed (xmms_object_t *object, xmmsv_t *_data,
 
 	if (!strcmp (name, "preamp")) {
 		/* scale the -20.0 - 20.0 value to correct one */
-		for (i=0; i<EQ_CHANNELS; i++) {
-			set_preamp (i, xmms_eq_gain_scale (gain, TRUE));
+		for (i=0; i<priv->channels; i++) {
+			set_preamp (priv->iir, i, xmms_eq_gain_scale (gain, TRUE));
 		}
 	} else {
 		gint band = -1;
@@ -345,8 +362,8 @@ xmms_eq_gain_changed (xmms_object_t *object, xmmsv_t *_data,
 
 		if (band >= 0) {
 			/* scale the -20.0 - 20.0 value to correct one */
-			for (i=0; i<EQ_CHANNELS; i++) {
-				set_gain (band, i, xmms_eq_gain_scale (gain, FALSE));
+			for (i=0; i<priv->channels; i++) {
+				set_gain (priv->iir, band, i, xmms_eq_gain_scale (gain, FALSE));
 			}
 		}
 	}
@@ -388,15 +405,15 @@ xmms_eq_config_changed (xmms_object_t * object, xmmsv_t *_data, gpointer userdat
 		if (priv->use_legacy) {
 			for (i=0; i<EQ_BANDS_LEGACY; i++) {
 				gain = xmms_config_property_get_float (priv->legacy[i]);
-				for (j=0; j<EQ_CHANNELS; j++) {
-					set_gain (j, i, xmms_eq_gain_scale (gain, FALSE));
+				for (j=0; j<priv->channels; j++) {
+					set_gain (priv->iir, i, j, xmms_eq_gain_scale (gain, FALSE));
 				}
 			}
 		} else {
 			for (i=0; i<priv->bands; i++) {
 				gain = xmms_config_property_get_float (priv->gain[i]);
-				for (j=0; j<EQ_CHANNELS; j++) {
-					set_gain (j, i, xmms_eq_gain_scale (gain, FALSE));
+				for (j=0; j<priv->channels; j++) {
+					set_gain (priv->iir, i, j, xmms_eq_gain_scale (gain, FALSE));
 				}
 			}
 		}
@@ -412,8 +429,8 @@ xmms_eq_config_changed (xmms_object_t * object, xmmsv_t *_data, gpointer userdat
 			for (i=0; i<EQ_MAX_BANDS; i++) {
 				xmms_config_property_set_data (priv->gain[i], "0.0");
 				if (!priv->use_legacy) {
-					for (j=0; j<EQ_CHANNELS; j++) {
-						set_gain (j, i, xmms_eq_gain_scale (0.0, FALSE));
+					for (j=0; j<priv->channels; j++) {
+						set_gain (priv->iir, i, j, xmms_eq_gain_scale (0.0, FALSE));
 					}
 				}
 			}
@@ -20,61 +20,100 @@
  *   $Id: iir.c,v 1.16 2006/01/15 00:26:32 liebremx Exp $
  */
 
+#include <stdint.h>
+#include <stdlib.h>
 #include "iir.h"
 
-/* Coefficients */
-sIIRCoefficients *iir_cf;
+/* Init the filters, the coefficient tables are shared by all instances */
+void init_iir(void)
+{
+  calc_coeffs();
+}
+
+iir_state_t *iir_new(int channels)
+{
+  iir_state_t *state;
+  void *mem;
+  int chn;
 
-/* Volume gain
- * values should be between 0.0 and 1.0
- * Use the preamp from XMMS for now
- * */
-float preamp[EQ_CHANNELS];
+  if (channels < 1 || channels > EQ_MAX_CHANNELS)
+    return NULL;
 
-#ifdef BENCHMARK
-#include "benchmark.h"
-double timex = 0.0;
-int count = 0;
-unsigned int blength = 0;
+  /* the vector members need stricter alignment than malloc promises */
+  mem = calloc(1, sizeof(iir_state_t) + sizeof(v4df));
+  if (!mem)
+    return NULL;
+
+  state = (iir_state_t *) (((uintptr_t) mem + sizeof(v4df) - 1)
+                           & ~(uintptr_t) (sizeof(v4df) - 1));
+  state->mem = mem;
+  state->channels = channels;
+
+  for (chn = 0; chn < EQ_MAX_CHANNELS; chn++)
+    state->preamp[chn] = 1.0;
+
+  state->func = iir_generic;
+#ifdef IIR_HAVE_AVX
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx"))
+    state->func = iir_avx;
 #endif
 
-/*
- * Global vars
- */
-int band_count;
+  return state;
+}
 
-void set_preamp(int chn, float val)
+void iir_free(iir_state_t *state)
 {
-  preamp[chn] = val;
+  if (state)
+    free(state->mem);
 }
 
-/* Init the filters */
-void init_iir(void)
+void config_iir(iir_state_t *state, int srate, int bands, int original)
 {
-  calc_coeffs();
+  sIIRCoefficients *cf;
+  int band;
+
+  cf = get_coeffs(&bands, srate, original);
+
+  memset(state->alpha, 0, sizeof(state->alpha));
+  memset(state->beta, 0, sizeof(state->beta));
+  memset(state->gamma, 0, sizeof(state->gamma));
+
+  for (band = 0; band < bands; band++)
+  {
+    state->alpha[band / EQ_LANES][band % EQ_LANES] = cf[band].alpha;
+    state->beta[band / EQ_LANES][band % EQ_LANES] = cf[band].beta;
+    state->gamma[band / EQ_LANES][band % EQ_LANES] = cf[band].gamma;
+  }
+
+  state->band_count = bands;
+  state->vectors = (bands + EQ_LANES - 1) / EQ_LANES;
+  clean_history(state);
 }
 
-void config_iir(int srate, int bands, int original)
+void clean_history(iir_state_t *state)
 {
-  band_count = bands;
-  iir_cf = get_coeffs(&band_count, srate, original);
-  clean_history();
+  int n;
+  /* Zero the history arrays */
+  memset(state->history, 0, sizeof(state->history));
+  memset(state->history2, 0, sizeof(state->history2));
+  for (n = 0; n < 256; n++) {
+      state->dither[n] = (rand() % 4) - 2;
+  }
+  state->di = 0;
 }
 
-#ifdef ARCH_X86
-/* Round function provided by Frank Klemm which saves around 100K
- * CPU cycles in my PIII for each call to the IIR function with 4K samples
- */
-int round_trick(float floatvalue_to_round)
+void set_gain(iir_state_t *state, int index, int chn, float val)
 {
-  float   floattmp ;
-  int     rounded_value ;
+  state->gain[chn][index / EQ_LANES][index % EQ_LANES] = val;
+}
 
-  floattmp      = (int) 0x00FD8000L + (floatvalue_to_round);
-  rounded_value = *(int*)(&floattmp) - (int)0x4B7D8000L;
+void set_preamp(iir_state_t *state, int chn, float val)
+{
+  state->preamp[chn] = val;
+}
 
-  if ( rounded_value != (short) rounded_value )
-    rounded_value = ( rounded_value >> 31 ) ^ 0x7FFF;
-  return rounded_value;
+int iir(iir_state_t *state, void *d, int length, int extra_filtering)
+{
+  return state->func(state, d, length, extra_filtering);
 }
-#endif
@@ -25,60 +25,86 @@
 #include <string.h>
 #include "iir_cfs.h"
 
-/*
- * Flush-to-zero to avoid flooding the CPU with underflow exceptions 
- */
-#ifdef SSE_MATH
-#define FTZ 0x8000
-#define FTZ_ON { \
-    unsigned int mxcsr; \
-  __asm__  __volatile__ ("stmxcsr %0" : "=m" (*&mxcsr)); \
-  mxcsr |= FTZ; \
-  __asm__  __volatile__ ("ldmxcsr %0" : : "m" (*&mxcsr)); \
-}
-#define FTZ_OFF { \
-    unsigned int mxcsr; \
-  __asm__  __volatile__ ("stmxcsr %0" : "=m" (*&mxcsr)); \
-  mxcsr &= ~FTZ; \
-  __asm__  __volatile__ ("ldmxcsr %0" : : "m" (*&mxcsr)); \
-}
-#else
-#define FTZ_ON
-#define FTZ_OFF
-#endif
+#define EQ_MAX_CHANNELS 8
+#define EQ_MAX_BANDS 31
 
 /*
- * Function prototypes
+ * The bands of a channel are filtered in vector lanes, EQ_LANES at a
+ * time. Bands past band_count have zero coefficients and gain, so the
+ * padding lanes never contribute to the output.
  */
-void init_iir(void);
-void config_iir(int srate, int bands, int original);
-void clean_history(void);
-void set_gain(int index, int chn, float val);
-void set_preamp(int chn, float val);
+#define EQ_LANES 4
+#define EQ_BAND_VECTORS ((EQ_MAX_BANDS + EQ_LANES - 1) / EQ_LANES)
 
+typedef double v4df __attribute__ ((vector_size (EQ_LANES * sizeof (double))));
 
-int iir(void *d, int length, int nch, int extra_filtering);
+/* Filter history of one channel, y[n-1] and y[n-2] for every band */
+typedef struct
+{
+  v4df y1[EQ_BAND_VECTORS];
+  v4df y2[EQ_BAND_VECTORS];
+  double x1; /* x[n-1] */
+  double x2; /* x[n-2] */
+} sIIRHistory;
 
-#ifdef ARCH_X86
-int round_trick(float floatvalue_to_round);
-#endif
-#ifdef ARCH_PPC
-int round_ppc(float x);
-#endif
+/* Second pass history of one channel, every band has its own input */
+typedef struct
+{
+  double x1[EQ_MAX_BANDS];
+  double x2[EQ_MAX_BANDS];
+  double y1[EQ_MAX_BANDS];
+  double y2[EQ_MAX_BANDS];
+} sIIRSerialHistory;
 
-#define EQ_CHANNELS 2
-#define EQ_MAX_BANDS 31
+typedef struct iir_state_St iir_state_t;
+
+typedef int (*iir_func_t) (iir_state_t *state, short *data, int length,
+                           int extra_filtering);
+
+struct iir_state_St
+{
+  v4df alpha[EQ_BAND_VECTORS];
+  v4df beta[EQ_BAND_VECTORS];
+  v4df gamma[EQ_BAND_VECTORS];
+  v4df gain[EQ_MAX_CHANNELS][EQ_BAND_VECTORS];
 
-extern float preamp[EQ_CHANNELS];
-extern sIIRCoefficients *iir_cf;
-extern int rate;
-extern int band_count;
+  sIIRHistory history[EQ_MAX_CHANNELS];
+  sIIRSerialHistory history2[EQ_MAX_CHANNELS];
 
-#ifdef BENCHMARK
-extern double timex;
-extern int count;
-extern unsigned int blength;
+  double preamp[EQ_MAX_CHANNELS];
+
+  /* random noise */
+  double dither[256];
+  int di;
+
+  int channels;
+  int band_count;
+  int vectors;
+
+  iir_func_t func;
+  void *mem;
+};
+
+/*
+ * Function prototypes
+ */
+void init_iir(void);
+iir_state_t *iir_new(int channels);
+void iir_free(iir_state_t *state);
+void config_iir(iir_state_t *state, int srate, int bands, int original);
+void clean_history(iir_state_t *state);
+void set_gain(iir_state_t *state, int index, int chn, float val);
+void set_preamp(iir_state_t *state, int chn, float val);
+
+int iir(iir_state_t *state, void *d, int length, int extra_filtering);
+
+/* Kernels, see iir_fpu.c */
+int iir_generic(iir_state_t *state, short *data, int length,
+                int extra_filtering);
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IIR_HAVE_AVX
+int iir_avx(iir_state_t *state, short *data, int length,
+            int extra_filtering);
 #endif
 
 #endif /* #define IIR_H */
-
@@ -139,6 +139,7 @@ sIIRCoefficients* get_coeffs(int *bands, int sfreq, int use_xmms_original_freqs)
                   case 25: iir_cf = iir_cf25_48000; break;
                   case 15: iir_cf = iir_cf15_48000; break;
                   default:
+                           *bands = 10;
                            iir_cf = use_xmms_original_freqs ?
                              iir_cforiginal10_48000 :
                              iir_cf10_48000;
@@ -152,6 +153,7 @@ sIIRCoefficients* get_coeffs(int *bands, int sfreq, int use_xmms_original_freqs)
                   case 25: iir_cf = iir_cf25_44100; break;
                   case 15: iir_cf = iir_cf15_44100; break;
                   default:
+                           *bands = 10;
                            iir_cf = use_xmms_original_freqs ?
                              iir_cforiginal10_44100 :
                              iir_cf10_44100;
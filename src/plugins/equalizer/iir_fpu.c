@@ -20,65 +20,101 @@
  *   $Id: iir_fpu.c,v 1.4 2006/01/15 00:26:32 liebremx Exp $
  */
 
-#include <stdlib.h>
 #include "iir.h"
-#include "iir_fpu.h"
 
-#ifdef BENCHMARK
-#include <stdio.h>
-#include "benchmark.h"
-#endif /* BENCHMARK */
-
-static sXYData data_history[EQ_MAX_BANDS][EQ_CHANNELS] __attribute__((aligned));
-static sXYData data_history2[EQ_MAX_BANDS][EQ_CHANNELS] __attribute__((aligned));
-static float gain[EQ_MAX_BANDS][EQ_CHANNELS] __attribute__((aligned));
-/* random noise */
-static sample_t dither[256];
-static int di;
+/*
+ * Run one filter pass of a channel over all bands and return the sum of
+ * the band outputs, weighted by their gain.
+ *
+ * IIR filter equation is
+ * y[n] = 2 * (alpha*(x[n]-x[n-2]) + gamma*y[n-1] - beta*y[n-2])
+ *
+ * NOTE: The 2 factor was introduced in the coefficients to save
+ * 			a multiplication
+ *
+ * x[n] is the same for every band, so only y[] has to be kept per band.
+ */
+static inline double
+iir_pass(const iir_state_t *state, sIIRHistory *history, const v4df *gain,
+         double x) __attribute__((always_inline));
 
-void set_gain(int index, int chn, float val)
+static inline double
+iir_pass(const iir_state_t *state, sIIRHistory *history, const v4df *gain,
+         double x)
 {
-  gain[index][chn] = val;
+  v4df acc = { 0., 0., 0., 0. };
+  v4df dx;
+  double d;
+  int v;
+
+  d = x - history->x2;
+  dx = (v4df) { d, d, d, d };
+  for (v = 0; v < state->vectors; v++)
+  {
+    v4df y = state->alpha[v] * dx
+      + state->gamma[v] * history->y1[v]
+      - state->beta[v] * history->y2[v];
+
+    history->y2[v] = history->y1[v];
+    history->y1[v] = y;
+    acc += y * gain[v];
+  }
+
+  history->x2 = history->x1;
+  history->x1 = x;
+
+  return acc[0] + acc[1] + acc[2] + acc[3];
 }
 
-void clean_history(void)
+/*
+ * The second pass of extra_filtering. Each band is fed the output so
+ * far, including the bands before it in this pass, so the bands depend
+ * on each other and are filtered one after the other.
+ */
+static inline double
+iir_pass_serial(const iir_state_t *state, sIIRSerialHistory *history,
+                const v4df *gain, double out) __attribute__((always_inline));
+
+static inline double
+iir_pass_serial(const iir_state_t *state, sIIRSerialHistory *history,
+                const v4df *gain, double out)
 {
-  int n;
-  /* Zero the history arrays */
-  memset(data_history, 0, sizeof(sXYData) * EQ_MAX_BANDS * EQ_CHANNELS);
-  memset(data_history2, 0, sizeof(sXYData) * EQ_MAX_BANDS * EQ_CHANNELS);
-  /* this is only needed if we use fpu code and there's no other place for
-  the moment to init the dither array*/
-  for (n = 0; n < 256; n++) {
-      dither[n] = (rand() % 4) - 2;
+  const double *alpha = (const double *) state->alpha;
+  const double *beta = (const double *) state->beta;
+  const double *gamma = (const double *) state->gamma;
+  const double *g = (const double *) gain;
+  int band;
+
+  for (band = 0; band < state->band_count; band++)
+  {
+    double y = alpha[band] * (out - history->x2[band])
+      + gamma[band] * history->y1[band]
+      - beta[band] * history->y2[band];
+
+    history->x2[band] = history->x1[band];
+    history->x1[band] = out;
+    history->y2[band] = history->y1[band];
+    history->y1[band] = y;
+
+    out += y * g[band];
   }
-  di = 0;
+
+  return out;
 }
 
-int iir(void *d, int length, int nch, int extra_filtering)
+static inline int
+iir_kernel(iir_state_t *state, short *data, int length,
+           int extra_filtering) __attribute__((always_inline));
+
+static inline int
+iir_kernel(iir_state_t *state, short *data, int length, int extra_filtering)
 {
-/*  FTZ_ON; */
-  short *data = d;
-  /* Indexes for the history arrays
-   * These have to be kept between calls to this function
-   * hence they are static */
-  static int i = 2, j = 1, k = 0;	
-
-  int index, band, channel;
+  int nch = state->channels;
+  int index, channel;
   int tempint, halflength;
-  sample_t out[EQ_CHANNELS], pcm[EQ_CHANNELS];
-
-#ifdef BENCHMARK
-  start_counter();
-#endif /* BENCHMARK */
-
-  /**
-   * IIR filter equation is
-   * y[n] = 2 * (alpha*(x[n]-x[n-2]) + gamma*y[n-1] - beta*y[n-2])
-   *
-   * NOTE: The 2 factor was introduced in the coefficients to save
-   * 			a multiplication
-   *
+  double out, pcm;
+
+  /*
    * This algorithm cascades two filters to get nice filtering
    * at the expense of extra CPU cycles
    */
@@ -86,63 +122,23 @@ int iir(void *d, int length, int nch, int extra_filtering)
    * the buffer (length is in bytes)
    */
   halflength = (length >> 1);
-  for (index = 0; index < halflength; index+=nch)
+  for (index = 0; index + nch <= halflength; index += nch)
   {
     /* For each channel */
     for (channel = 0; channel < nch; channel++)
     {
-      pcm[channel] = data[index+channel];
-      /* Preamp gain */
-      pcm[channel] *= preamp[channel];
+      /* Preamp gain, and add random noise */
+      pcm = data[index+channel] * state->preamp[channel]
+        + state->dither[state->di];
 
-      /* add random noise */
-      pcm[channel] += dither[di];
-
-      out[channel] = 0.;
-      /* For each band */
-      for (band = 0; band < band_count; band++)
-      {
-        /* Store Xi(n) */
-        data_history[band][channel].x[i] = pcm[channel];
-        /* Calculate and store Yi(n) */
-        data_history[band][channel].y[i] =
-          (
-           /* 		= alpha * [x(n)-x(n-2)] */
-           iir_cf[band].alpha * ( data_history[band][channel].x[i]
-             -  data_history[band][channel].x[k])
-           /* 		+ gamma * y(n-1) */
-           + iir_cf[band].gamma * data_history[band][channel].y[j]
-           /* 		- beta * y(n-2) */
-           - iir_cf[band].beta * data_history[band][channel].y[k]
-          );
-        /*
-         * The multiplication by 2.0 was 'moved' into the coefficients to save
-         * CPU cycles here */
-        /* Apply the gain  */
-        out[channel] +=  data_history[band][channel].y[i]*gain[band][channel]; /* * 2.0; */
-      } /* For each band */
+      out = iir_pass(state, &state->history[channel],
+                     state->gain[channel], pcm);
 
       if (extra_filtering)
       {
         /* Filter the sample again */
-        for (band = 0; band < band_count; band++)
-        {
-          /* Store Xi(n) */
-          data_history2[band][channel].x[i] = out[channel];
-          /* Calculate and store Yi(n) */
-          data_history2[band][channel].y[i] =
-            (
-             /* y(n) = alpha * [x(n)-x(n-2)] */
-             iir_cf[band].alpha * (data_history2[band][channel].x[i]
-               -  data_history2[band][channel].x[k])
-             /* 	    + gamma * y(n-1) */
-             + iir_cf[band].gamma * data_history2[band][channel].y[j]
-             /* 		- beta * y(n-2) */
-             - iir_cf[band].beta * data_history2[band][channel].y[k]
-            );
-          /* Apply the gain */
-          out[channel] +=  data_history2[band][channel].y[i]*gain[band][channel];
-        } /* For each band */
+        out = iir_pass_serial(state, &state->history2[channel],
+                              state->gain[channel], out);
       }
 
       /* Volume stuff
@@ -151,21 +147,13 @@ int iir(void *d, int length, int nch, int extra_filtering)
          Go back to use the floating point multiplication before the
          conversion to give more dynamic range
          */
-      out[channel] += pcm[channel]*0.25;
+      out += pcm*0.25;
 
       /* remove random noise */
-      out[channel] -= dither[di]*0.25;
-
-      /* Round and convert to integer */
-#ifdef ARCH_PPC
-      tempint = round_ppc(out[channel]);
-#else
-#ifdef ARCH_X86
-      tempint = round_trick(out[channel]);
-#else
-      tempint = (int)out[channel];
-#endif
-#endif
+      out -= state->dither[state->di]*0.25;
+
+      /* Convert to integer */
+      tempint = (int)out;
 
       /* Limit the output */
       if (tempint < -32768)
@@ -176,27 +164,26 @@ int iir(void *d, int length, int nch, int extra_filtering)
         data[index+channel] = tempint;
     } /* For each channel */
 
-    /* Wrap around the indexes */
-    i = (i+1)%3;
-    j = (j+1)%3;
-    k = (k+1)%3;
     /* random noise index */
-    di = (di + 1) % 256;
-
-  }/* For each pair of samples */
+    state->di = (state->di + 1) % 256;
 
-#ifdef BENCHMARK
-  timex += get_counter();
-  blength += length;
-  if (count++ == 1024)
-  {
-    printf("FLOATING POINT: %f %d\n",timex/1024.0, blength/1024);
-    blength = 0;
-    timex = 0.;
-    count = 0;
-  }
-#endif /* BENCHMARK */
+  }/* For each frame */
 
-/*  FTZ_OFF; */
   return length;
 }
+
+int iir_generic(iir_state_t *state, short *data, int length,
+                int extra_filtering)
+{
+  return iir_kernel(state, data, length, extra_filtering);
+}
+
+#ifdef IIR_HAVE_AVX
+/* Same kernel, with the lanes of a band vector in one AVX register */
+__attribute__((target("avx")))
+int iir_avx(iir_state_t *state, short *data, int length,
+            int extra_filtering)
+{
+  return iir_kernel(state, data, length, extra_filtering);
+}
+#endif
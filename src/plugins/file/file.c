@@ -25,18 +25,49 @@
 #include <stdio.h>
 #include <string.h>
 
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+
+#if defined(HAVE_SYS_VFS_H)
+# include <sys/vfs.h>
+#elif defined(HAVE_SYS_MOUNT_H)
+# include <sys/param.h>
+# include <sys/mount.h>
+#endif
+
 #include "browse/browse.h"
+#include "prefetch.h"
 
 /* not available everywhere. */
 #if !defined(O_BINARY)
 # define O_BINARY 0
 #endif
+
+/* size of the prefetch window, in KiB */
+#define XMMS_FILE_DEFAULT_READAHEAD "4096"
+
 /*
  * Type definitions
  */
 
+typedef enum {
+	XMMS_FILE_MODE_READ,
+	XMMS_FILE_MODE_MMAP,
+	XMMS_FILE_MODE_PREFETCH,
+} xmms_file_mode_t;
+
 typedef struct {
 	gint fd;
+	xmms_file_mode_t mode;
+	gint64 size;
+
+	/* mmap mode */
+	guchar *map;
+	gint64 pos;
+
+	/* prefetch mode */
+	xmms_file_prefetch_t *prefetch;
 } xmms_file_data_t;
 
 /*
@@ -72,6 +103,16 @@ xmms_file_plugin_setup (xmms_xform_plugin_t *xform_plugin)
 
 	xmms_xform_plugin_methods_set (xform_plugin, &methods);
 
+	/* one of "read", "auto" (prefetch on network filesystems, read
+	 * elsewhere), "mmap" or "prefetch". mmap is opt-in only, since a file
+	 * truncated while it's mapped takes the server down with SIGBUS.
+	 */
+	xmms_xform_plugin_config_property_register (xform_plugin, "mode",
+	                                            "read", NULL, NULL);
+	xmms_xform_plugin_config_property_register (xform_plugin, "readahead",
+	                                            XMMS_FILE_DEFAULT_READAHEAD,
+	                                            NULL, NULL);
+
 	xmms_xform_plugin_indata_add (xform_plugin,
 	                              XMMS_STREAM_TYPE_MIMETYPE,
 	                              "application/x-url",
@@ -85,6 +126,99 @@ xmms_file_plugin_setup (xmms_xform_plugin_t *xform_plugin)
 /*
  * Member functions
  */
+
+/* Network filesystems are where waiting on each read hurts. */
+static gboolean
+xmms_file_is_remote (gint fd)
+{
+#if defined(HAVE_SYS_VFS_H)
+	struct statfs sfs;
+
+	if (fstatfs (fd, &sfs) == -1) {
+		return FALSE;
+	}
+
+	switch ((guint32) sfs.f_type) {
+		case 0x6969: /* NFS */
+		case 0x517b: /* SMB */
+		case 0xff534d42: /* CIFS */
+		case 0xfe534d42: /* SMB2 */
+		case 0x564c: /* NCP */
+		case 0x01021997: /* 9P */
+		case 0x00c36400: /* Ceph */
+		case 0x65735546: /* FUSE, sshfs and friends */
+			return TRUE;
+		default:
+			return FALSE;
+	}
+#elif defined(HAVE_SYS_MOUNT_H) && defined(MNT_LOCAL)
+	struct statfs sfs;
+
+	if (fstatfs (fd, &sfs) == -1) {
+		return FALSE;
+	}
+
+	return !(sfs.f_flags & MNT_LOCAL);
+#else
+	return FALSE;
+#endif
+}
+
+static xmms_file_mode_t
+xmms_file_mode_get (xmms_xform_t *xform, gint fd)
+{
+	xmms_config_property_t *val;
+	const gchar *mode;
+
+	val = xmms_xform_config_lookup (xform, "mode");
+	mode = xmms_config_property_get_string (val);
+
+	if (g_ascii_strcasecmp (mode, "read") == 0) {
+		return XMMS_FILE_MODE_READ;
+	} else if (g_ascii_strcasecmp (mode, "mmap") == 0) {
+		return XMMS_FILE_MODE_MMAP;
+	} else if (g_ascii_strcasecmp (mode, "prefetch") == 0) {
+		return XMMS_FILE_MODE_PREFETCH;
+	} else if (g_ascii_strcasecmp (mode, "auto") != 0) {
+		xmms_log_error ("Unknown file.mode '%s', using read", mode);
+		return XMMS_FILE_MODE_READ;
+	}
+
+	if (xmms_file_is_remote (fd)) {
+		return XMMS_FILE_MODE_PREFETCH;
+	}
+
+	return XMMS_FILE_MODE_READ;
+}
+
+static gboolean
+xmms_file_mmap (xmms_file_data_t *data)
+{
+#ifdef HAVE_SYS_MMAN_H
+	void *map;
+
+	/* mmap can't do empty files, and might not cover huge ones */
+	if (data->size <= 0 || (guint64) data->size > G_MAXSIZE) {
+		return FALSE;
+	}
+
+	map = mmap (NULL, data->size, PROT_READ, MAP_PRIVATE, data->fd, 0);
+	if (map == MAP_FAILED) {
+		XMMS_DBG ("Couldn't mmap file: %s", strerror (errno));
+		return FALSE;
+	}
+
+	posix_madvise (map, data->size, POSIX_MADV_SEQUENTIAL);
+
+	data->map = map;
+	data->pos = 0;
+
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
 static gboolean
 xmms_file_init (xmms_xform_t *xform)
 {
@@ -119,6 +253,33 @@ xmms_file_init (xmms_xform_t *xform)
 
 	data = g_new0 (xmms_file_data_t, 1);
 	data->fd = fd;
+	data->size = st.st_size;
+	data->mode = xmms_file_mode_get (xform, fd);
+
+	if (data->mode == XMMS_FILE_MODE_MMAP && !xmms_file_mmap (data)) {
+		data->mode = XMMS_FILE_MODE_READ;
+	}
+
+	if (data->mode == XMMS_FILE_MODE_PREFETCH) {
+		xmms_config_property_t *val;
+		gint readahead;
+
+		val = xmms_xform_config_lookup (xform, "readahead");
+		readahead = xmms_config_property_get_int (val);
+
+		if (readahead > 0) {
+			data->prefetch = xmms_file_prefetch_new (fd, (gsize) readahead * 1024);
+		} else {
+			data->mode = XMMS_FILE_MODE_READ;
+		}
+	}
+
+#ifdef HAVE_POSIX_FADVISE
+	if (data->mode == XMMS_FILE_MODE_READ) {
+		posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	}
+#endif
+
 	xmms_xform_private_data_set (xform, data);
 
 	xmms_xform_outdata_type_add (xform,
@@ -145,6 +306,14 @@ xmms_file_destroy (xmms_xform_t *xform)
 	if (!data)
 		return;
 
+	if (data->prefetch)
+		xmms_file_prefetch_free (data->prefetch);
+
+#ifdef HAVE_SYS_MMAN_H
+	if (data->map)
+		munmap (data->map, data->size);
+#endif
+
 	if (data->fd != -1)
 		close (data->fd);
 
@@ -155,7 +324,7 @@ static gint
 xmms_file_read (xmms_xform_t *xform, void *buffer, gint len, xmms_error_t *error)
 {
 	xmms_file_data_t *data;
-	gint ret;
+	gint ret, errnum = 0;
 
 	g_return_val_if_fail (xform, -1);
 	g_return_val_if_fail (buffer, -1);
@@ -164,16 +333,66 @@ xmms_file_read (xmms_xform_t *xform, void *buffer, gint len, xmms_error_t *error
 	data = xmms_xform_private_data_get (xform);
 	g_return_val_if_fail (data, -1);
 
-	ret = read (data->fd, buffer, len);
+	switch (data->mode) {
+		case XMMS_FILE_MODE_MMAP:
+			ret = CLAMP (data->size - data->pos, 0, len);
+			if (ret > 0) {
+				memcpy (buffer, data->map + data->pos, ret);
+				data->pos += ret;
+			}
+			break;
+		case XMMS_FILE_MODE_PREFETCH:
+			ret = xmms_file_prefetch_read (data->prefetch, buffer, len, &errnum);
+			if (ret > 0) {
+				data->pos += ret;
+			}
+			break;
+		default:
+			ret = read (data->fd, buffer, len);
+			errnum = errno;
+			break;
+	}
 
 	if (ret == -1) {
-		xmms_log_error ("errno(%d) %s", errno, strerror (errno));
-		xmms_error_set (error, XMMS_ERROR_GENERIC, strerror (errno));
+		xmms_log_error ("errno(%d) %s", errnum, strerror (errnum));
+		xmms_error_set (error, XMMS_ERROR_GENERIC, strerror (errnum));
 	}
 
 	return ret;
 }
 
+/* Seeking in mmap and prefetch modes is just bookkeeping, the prefetcher
+ * only does new I/O when the target is outside of its window.
+ */
+static gint64
+xmms_file_seek_position (xmms_file_data_t *data, gint64 offset,
+                         xmms_xform_seek_mode_t whence, xmms_error_t *error)
+{
+	switch (whence) {
+		case XMMS_XFORM_SEEK_END:
+			offset += data->size;
+			break;
+		case XMMS_XFORM_SEEK_CUR:
+			offset += data->pos;
+			break;
+		default:
+			break;
+	}
+
+	if (offset < 0) {
+		xmms_error_set (error, XMMS_ERROR_INVAL, "Couldn't seek");
+		return -1;
+	}
+
+	data->pos = offset;
+
+	if (data->mode == XMMS_FILE_MODE_PREFETCH) {
+		xmms_file_prefetch_seek (data->prefetch, offset);
+	}
+
+	return offset;
+}
+
 static gint64
 xmms_file_seek (xmms_xform_t *xform, gint64 offset, xmms_xform_seek_mode_t whence, xmms_error_t *error)
 {
@@ -185,6 +404,10 @@ xmms_file_seek (xmms_xform_t *xform, gint64 offset, xmms_xform_seek_mode_t whenc
 	data = xmms_xform_private_data_get (xform);
 	g_return_val_if_fail (data, -1);
 
+	if (data->mode != XMMS_FILE_MODE_READ) {
+		return xmms_file_seek_position (data, offset, whence, error);
+	}
+
 	switch (whence) {
 		case XMMS_XFORM_SEEK_SET:
 			w = SEEK_SET;
@@ -0,0 +1,282 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+/*
+ * Read-ahead for files on slow or remote filesystems.
+ *
+ * A background thread keeps a ring buffer of the file filled ahead of
+ * the read position, so the playback thread only ever copies memory.
+ * The ring holds the file range [start, end), the reader is somewhere
+ * inside it. A quarter of the window is kept behind the reader so that
+ * short backwards seeks don't need any I/O either.
+ *
+ * The thread is the only one touching the file descriptor and the free
+ * part of the ring, which it fills without holding the lock. Seeks
+ * outside of the window bump the generation, which tells the thread to
+ * throw away whatever it was reading when it comes back.
+ */
+
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include "prefetch.h"
+
+#define PREFETCH_MIN_WINDOW (64 * 1024)
+#define PREFETCH_MIN_CHUNK (4 * 1024)
+#define PREFETCH_MAX_CHUNK (256 * 1024)
+
+struct xmms_file_prefetch_St {
+	gint fd;
+
+	guchar *ring;
+	gsize window;
+	gsize chunk;
+
+	GMutex mutex;
+	GCond cond;
+	GThread *thread;
+
+	/* everything below is protected by mutex */
+	gint64 start;
+	gint64 end;
+	gint64 pos;
+	guint generation;
+	gboolean eof;
+	gint errnum;
+	gboolean quit;
+};
+
+static gpointer xmms_file_prefetch_thread (gpointer arg);
+
+xmms_file_prefetch_t *
+xmms_file_prefetch_new (gint fd, gsize window)
+{
+	xmms_file_prefetch_t *prefetch;
+
+	g_return_val_if_fail (fd != -1, NULL);
+
+	prefetch = g_new0 (xmms_file_prefetch_t, 1);
+	prefetch->fd = fd;
+	prefetch->window = MAX (window, PREFETCH_MIN_WINDOW);
+	prefetch->chunk = CLAMP (prefetch->window / 8,
+	                         PREFETCH_MIN_CHUNK, PREFETCH_MAX_CHUNK);
+	prefetch->ring = g_malloc (prefetch->window);
+
+	prefetch->start = prefetch->end = prefetch->pos = lseek (fd, 0, SEEK_CUR);
+	if (prefetch->start < 0) {
+		prefetch->start = prefetch->end = prefetch->pos = 0;
+	}
+
+#ifdef HAVE_POSIX_FADVISE
+	posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	g_mutex_init (&prefetch->mutex);
+	g_cond_init (&prefetch->cond);
+
+	prefetch->thread = g_thread_new ("x2 file prefetch",
+	                                 xmms_file_prefetch_thread, prefetch);
+
+	return prefetch;
+}
+
+void
+xmms_file_prefetch_free (xmms_file_prefetch_t *prefetch)
+{
+	g_return_if_fail (prefetch);
+
+	g_mutex_lock (&prefetch->mutex);
+	prefetch->quit = TRUE;
+	g_cond_broadcast (&prefetch->cond);
+	g_mutex_unlock (&prefetch->mutex);
+
+	g_thread_join (prefetch->thread);
+
+	g_cond_clear (&prefetch->cond);
+	g_mutex_clear (&prefetch->mutex);
+
+	g_free (prefetch->ring);
+	g_free (prefetch);
+}
+
+gint
+xmms_file_prefetch_read (xmms_file_prefetch_t *prefetch, void *buffer,
+                         gint len, gint *errnum)
+{
+	gsize offset, first;
+	gint ret;
+
+	g_return_val_if_fail (prefetch, -1);
+	g_return_val_if_fail (buffer, -1);
+
+	g_mutex_lock (&prefetch->mutex);
+
+	while (prefetch->pos >= prefetch->end && !prefetch->eof && !prefetch->errnum) {
+		g_cond_wait (&prefetch->cond, &prefetch->mutex);
+	}
+
+	if (prefetch->pos < prefetch->end) {
+		ret = MIN (len, prefetch->end - prefetch->pos);
+
+		offset = prefetch->pos % prefetch->window;
+		first = MIN (ret, prefetch->window - offset);
+
+		memcpy (buffer, prefetch->ring + offset, first);
+		memcpy ((guchar *) buffer + first, prefetch->ring, ret - first);
+
+		prefetch->pos += ret;
+
+		/* the thread might be waiting for us to make room */
+		g_cond_broadcast (&prefetch->cond);
+	} else if (prefetch->errnum) {
+		if (errnum) {
+			*errnum = prefetch->errnum;
+		}
+		ret = -1;
+	} else {
+		ret = 0;
+	}
+
+	g_mutex_unlock (&prefetch->mutex);
+
+	return ret;
+}
+
+gint64
+xmms_file_prefetch_seek (xmms_file_prefetch_t *prefetch, gint64 offset)
+{
+	g_return_val_if_fail (prefetch, -1);
+	g_return_val_if_fail (offset >= 0, -1);
+
+	g_mutex_lock (&prefetch->mutex);
+
+	if (offset >= prefetch->start && offset <= prefetch->end) {
+		prefetch->pos = offset;
+	} else {
+		prefetch->generation++;
+		prefetch->start = prefetch->end = prefetch->pos = offset;
+		prefetch->eof = FALSE;
+		prefetch->errnum = 0;
+	}
+
+	g_cond_broadcast (&prefetch->cond);
+	g_mutex_unlock (&prefetch->mutex);
+
+	return offset;
+}
+
+/* Returns TRUE if there's room for another chunk in the ring, dropping
+ * data behind the reader if needed.
+ */
+static gboolean
+xmms_file_prefetch_make_room (xmms_file_prefetch_t *prefetch)
+{
+	gint64 room, behind, reclaimable;
+
+	room = prefetch->window - (prefetch->end - prefetch->start);
+	behind = prefetch->pos - prefetch->start;
+	reclaimable = MAX (0, behind - (gint64) prefetch->window / 4);
+
+	if (room + reclaimable < prefetch->chunk) {
+		return FALSE;
+	}
+
+	if (room < prefetch->chunk) {
+		prefetch->start += prefetch->chunk - room;
+	}
+
+	return TRUE;
+}
+
+static gpointer
+xmms_file_prefetch_thread (gpointer arg)
+{
+	xmms_file_prefetch_t *prefetch = arg;
+	gint64 fd_pos = -1, offset;
+	guint generation;
+#ifdef HAVE_POSIX_FADVISE
+	guint advised = G_MAXUINT;
+#endif
+	gsize ring_offset, len;
+	gssize ret;
+	gint errnum;
+
+	g_mutex_lock (&prefetch->mutex);
+
+	while (!prefetch->quit) {
+		if (prefetch->eof || prefetch->errnum ||
+		    !xmms_file_prefetch_make_room (prefetch)) {
+			g_cond_wait (&prefetch->cond, &prefetch->mutex);
+			continue;
+		}
+
+		offset = prefetch->end;
+		generation = prefetch->generation;
+
+		/* never wrap around within a single read */
+		ring_offset = offset % prefetch->window;
+		len = MIN (prefetch->chunk, prefetch->window - ring_offset);
+
+		g_mutex_unlock (&prefetch->mutex);
+
+#ifdef HAVE_POSIX_FADVISE
+		if (generation != advised) {
+			posix_fadvise (prefetch->fd, offset, prefetch->window,
+			               POSIX_FADV_WILLNEED);
+			advised = generation;
+		}
+#endif
+
+		if (fd_pos != offset && lseek (prefetch->fd, offset, SEEK_SET) == -1) {
+			ret = -1;
+		} else {
+			do {
+				ret = read (prefetch->fd, prefetch->ring + ring_offset, len);
+			} while (ret == -1 && errno == EINTR);
+		}
+
+		if (ret == -1) {
+			errnum = errno ? errno : EIO;
+			fd_pos = -1;
+		} else {
+			fd_pos = offset + ret;
+		}
+
+		g_mutex_lock (&prefetch->mutex);
+
+		/* the reader seeked away while we were busy */
+		if (generation != prefetch->generation) {
+			continue;
+		}
+
+		if (ret > 0) {
+			prefetch->end += ret;
+		} else if (ret == 0) {
+			prefetch->eof = TRUE;
+		} else {
+			prefetch->errnum = errnum;
+		}
+
+		g_cond_broadcast (&prefetch->cond);
+	}
+
+	g_mutex_unlock (&prefetch->mutex);
+
+	return NULL;
+}
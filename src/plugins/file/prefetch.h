@@ -0,0 +1,30 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#ifndef __XMMS_FILE_PREFETCH_H__
+#define __XMMS_FILE_PREFETCH_H__
+
+#include <glib.h>
+
+typedef struct xmms_file_prefetch_St xmms_file_prefetch_t;
+
+xmms_file_prefetch_t *xmms_file_prefetch_new (gint fd, gsize window);
+void xmms_file_prefetch_free (xmms_file_prefetch_t *prefetch);
+
+gint xmms_file_prefetch_read (xmms_file_prefetch_t *prefetch, void *buffer, gint len, gint *errnum);
+gint64 xmms_file_prefetch_seek (xmms_file_prefetch_t *prefetch, gint64 offset);
+
+#endif
@@ -30,6 +30,7 @@
 #include <xmms/xmms_sample.h>
 #include <xmms/xmms_log.h>
 #include "xing.h"
+#include "seekindex.h"
 #include <mad.h>
 
 #include <glib.h>
@@ -40,6 +41,10 @@
 
 #include "../mp3_common/id3v1.c"
 
+/* medialib property holding the bindata hash of the seek index */
+#define SEEK_INDEX_PROPERTY "mad_seek_index"
+#define SEEK_INDEX_INTERVAL 8
+
 /*
  * Type definitions
  */
@@ -51,6 +56,7 @@ typedef struct xmms_mad_data_St {
 
 	guchar buffer[4096];
 	guint buffer_length;
+	guint64 buffer_offset;
 	guint channels;
 	guint bitrate;
 	guint samplerate;
@@ -61,7 +67,14 @@ typedef struct xmms_mad_data_St {
 	gint64 samples_to_play;
 	gint frames_to_skip;
 
+	/* samples decoded before the first one played, and the total */
+	guint lead_in;
+	gint64 total_samples;
+
 	xmms_xing_t *xing;
+
+	xmms_mad_seek_index_t *index;
+	xmms_mad_seek_index_t *scan;
 } xmms_mad_data_t;
 
 
@@ -110,6 +123,9 @@ xmms_mad_plugin_setup (xmms_xform_plugin_t *xform_plugin)
 	xmms_xform_plugin_config_property_register (xform_plugin, "id3v1_enable",
 	                                            "1", NULL, NULL);
 
+	xmms_xform_plugin_config_property_register (xform_plugin, "seek_index",
+	                                            "1", NULL, NULL);
+
 	/* xmms_xform_indata_constraint_add */
 	xmms_xform_plugin_indata_add (xform_plugin,
 	                              XMMS_STREAM_TYPE_MIMETYPE,
@@ -145,10 +161,106 @@ xmms_mad_destroy (xmms_xform_t *xform)
 		xmms_xing_free (data->xing);
 	}
 
+	if (data->index) {
+		xmms_mad_seek_index_free (data->index);
+	}
+
+	if (data->scan) {
+		xmms_mad_seek_index_free (data->scan);
+	}
+
 	g_free (data);
 
 }
 
+/* Load the index left by an earlier playback, or start building one */
+static void
+xmms_mad_seek_index_setup (xmms_xform_t *xform, xmms_mad_data_t *data)
+{
+	xmms_config_property_t *val;
+	const gchar *metakey;
+	gint filesize;
+
+	val = xmms_xform_config_lookup (xform, "seek_index");
+	if (!xmms_config_property_get_int (val)) {
+		return;
+	}
+
+	/* the size tells us if the file changed since, no size no index */
+	metakey = XMMS_MEDIALIB_ENTRY_PROPERTY_SIZE;
+	if (!xmms_xform_metadata_get_int (xform, metakey, &filesize) || filesize <= 0) {
+		return;
+	}
+
+	data->index = xmms_mad_seek_index_load (xform, SEEK_INDEX_PROPERTY, filesize);
+	if (data->index) {
+		XMMS_DBG ("Using stored seek index");
+	} else {
+		data->scan = xmms_mad_seek_index_new (SEEK_INDEX_INTERVAL);
+	}
+}
+
+/* The whole file has been decoded in order, keep the index */
+static void
+xmms_mad_seek_index_store (xmms_xform_t *xform, xmms_mad_data_t *data)
+{
+	gint filesize = 0;
+
+	if (!data->scan) {
+		return;
+	}
+
+	xmms_xform_metadata_get_int (xform, XMMS_MEDIALIB_ENTRY_PROPERTY_SIZE, &filesize);
+
+	if (xmms_mad_seek_index_save (xform, SEEK_INDEX_PROPERTY, data->scan, filesize)) {
+		XMMS_DBG ("Stored seek index");
+	}
+
+	data->index = data->scan;
+	data->scan = NULL;
+}
+
+static void
+xmms_mad_seek_index_abandon (xmms_mad_data_t *data)
+{
+	if (data->scan) {
+		xmms_mad_seek_index_free (data->scan);
+		data->scan = NULL;
+	}
+}
+
+/* Count a frame towards the position, returns its length in samples */
+static guint
+xmms_mad_frame_seen (xmms_mad_data_t *data)
+{
+	guint samples = 32 * MAD_NSBSAMPLES (&data->frame.header);
+
+	if (data->scan) {
+		guint64 offset;
+
+		offset = data->buffer_offset + (data->stream.this_frame - data->buffer);
+		if (!xmms_mad_seek_index_add_frame (data->scan, offset, samples)) {
+			xmms_mad_seek_index_abandon (data);
+		}
+	}
+
+	return samples;
+}
+
+/* Forget everything buffered and decoded before seeking to offset */
+static void
+xmms_mad_flush (xmms_mad_data_t *data, gint64 offset)
+{
+	mad_stream_finish (&data->stream);
+	mad_stream_init (&data->stream);
+	mad_frame_mute (&data->frame);
+	mad_synth_mute (&data->synth);
+
+	data->buffer_length = 0;
+	data->buffer_offset = offset;
+	data->synthpos = 0x7fffffff;
+}
+
 static gint64
 xmms_mad_seek (xmms_xform_t *xform, gint64 samples, xmms_xform_seek_mode_t whence, xmms_error_t *err)
 {
@@ -161,6 +273,35 @@ xmms_mad_seek (xmms_xform_t *xform, gint64 samples, xmms_xform_seek_mode_t whenc
 
 	data = xmms_xform_private_data_get (xform);
 
+	/* the index can only be built from an uninterrupted decode */
+	xmms_mad_seek_index_abandon (data);
+
+	if (data->index) {
+		guint64 offset, start, wanted;
+
+		wanted = samples + data->lead_in;
+		if (xmms_mad_seek_index_lookup (data->index, wanted, &offset, &start)) {
+			XMMS_DBG ("Seek %" G_GINT64_FORMAT " samples -> %" G_GUINT64_FORMAT
+			          " bytes using index", samples, offset);
+
+			res = xmms_xform_seek (xform, offset, XMMS_XFORM_SEEK_SET, err);
+			if (res == -1) {
+				return -1;
+			}
+
+			xmms_mad_flush (data, res);
+
+			/* decode from the indexed frame and drop what comes before */
+			data->frames_to_skip = 0;
+			data->samples_to_skip = MIN (wanted - start, G_MAXINT);
+			if (data->total_samples >= 0) {
+				data->samples_to_play = MAX (data->total_samples - samples, 0);
+			}
+
+			return samples;
+		}
+	}
+
 	if (data->xing &&
 	    xmms_xing_has_flag (data->xing, XMMS_XING_FRAMES) &&
 	    xmms_xing_has_flag (data->xing, XMMS_XING_TOC)) {
@@ -180,6 +321,8 @@ xmms_mad_seek (xmms_xform_t *xform, gint64 samples, xmms_xform_seek_mode_t whenc
 		return -1;
 	}
 
+	xmms_mad_flush (data, res);
+
 	/* we don't have sample accuracy when seeking,
 	   so there is no use trying */
 	data->samples_to_skip = 0;
@@ -280,6 +423,7 @@ xmms_mad_init (xmms_xform_t *xform)
 			data->samples_to_skip = lame->start_delay;
 			data->samples_to_play = ((guint64) xmms_xing_get_frames (data->xing) * 1152ULL) -
 			                        lame->start_delay - lame->end_padding;
+			data->lead_in = 32 * MAD_NSBSAMPLES (&frame.header) + lame->start_delay;
 			XMMS_DBG ("Samples to skip in the beginning: %d, total: %" G_GINT64_FORMAT,
 			          data->samples_to_skip, data->samples_to_play);
 			/*
@@ -317,6 +461,9 @@ xmms_mad_init (xmms_xform_t *xform)
 
 	/* seeking needs bitrate */
 	data->bitrate = frame.header.bitrate;
+	data->total_samples = data->samples_to_play;
+
+	xmms_mad_seek_index_setup (xform, data);
 
 	if (xmms_id3v1_get_tags (xform) < 0) {
 		mad_stream_finish (&data->stream);
@@ -325,6 +472,12 @@ xmms_mad_init (xmms_xform_t *xform)
 		if (data->xing) {
 			xmms_xing_free (data->xing);
 		}
+		if (data->index) {
+			xmms_mad_seek_index_free (data->index);
+		}
+		if (data->scan) {
+			xmms_mad_seek_index_free (data->scan);
+		}
 		return FALSE;
 	}
 
@@ -389,6 +542,7 @@ xmms_mad_read (xmms_xform_t *xform, gpointer buf, gint len, xmms_error_t *err)
 
 		/* then try to decode another frame */
 		if (mad_frame_decode (&data->frame, &data->stream) != -1) {
+			xmms_mad_frame_seen (data);
 
 			/* mad_synthpop_frame - go Depeche! */
 			mad_synth_frame (&data->synth, &data->frame);
@@ -406,6 +560,7 @@ xmms_mad_read (xmms_xform_t *xform, gpointer buf, gint len, xmms_error_t *err)
 				}
 			} else {
 				if (data->samples_to_play == 0) {
+					xmms_mad_seek_index_store (xform, data);
 					return read;
 				} else if (data->samples_to_play > 0) {
 					if (data->synth.pcm.length > data->samples_to_play) {
@@ -418,11 +573,18 @@ xmms_mad_read (xmms_xform_t *xform, gpointer buf, gint len, xmms_error_t *err)
 			continue;
 		}
 
+		/* missing its bit reservoir, typically right after a seek */
+		if (data->stream.error == MAD_ERROR_BADDATAPTR) {
+			guint samples = xmms_mad_frame_seen (data);
+			data->samples_to_skip = MAX (data->samples_to_skip - (gint) samples, 0);
+			continue;
+		}
 
 		/* if there is no frame to decode stream more data */
 		if (data->stream.next_frame) {
 			guchar *buffer = data->buffer;
 			const guchar *nf = data->stream.next_frame;
+			data->buffer_offset += nf - buffer;
 			memmove (data->buffer, data->stream.next_frame,
 			         data->buffer_length = (&buffer[data->buffer_length] - nf));
 		}
@@ -432,6 +594,10 @@ xmms_mad_read (xmms_xform_t *xform, gpointer buf, gint len, xmms_error_t *err)
 		                       4096 - data->buffer_length,
 		                       err);
 
+		if (ret == 0) {
+			xmms_mad_seek_index_store (xform, data);
+		}
+
 		if (ret <= 0) {
 			return ret;
 		}
@@ -0,0 +1,289 @@
+/*  XMMS2 - X Music Multiplexer System
+ *
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+
+/** @file
+ * Sparse frame index, mapping every n:th frame to its byte offset
+ * and the number of samples decoded before it. Built while playing
+ * a file from start to end and kept in bindata, so seeks can land
+ * on the exact frame instead of guessing from bitrate or Xing TOC.
+ */
+
+#include "seekindex.h"
+
+#include <xmms/xmms_bindata.h>
+
+#include <string.h>
+
+#define SEEK_INDEX_MAGIC "MADI"
+#define SEEK_INDEX_VERSION 1
+#define SEEK_INDEX_HEADER_SIZE 24
+
+typedef struct {
+	guint32 offset;
+	guint32 sample;
+} xmms_mad_seek_point_t;
+
+struct xmms_mad_seek_index_St {
+	guint interval;
+	GArray *points;
+
+	/* only used while building */
+	guint frames;
+	guint64 samples;
+};
+
+xmms_mad_seek_index_t *
+xmms_mad_seek_index_new (guint interval)
+{
+	xmms_mad_seek_index_t *index;
+
+	index = g_new0 (xmms_mad_seek_index_t, 1);
+	index->interval = MAX (interval, 1);
+	index->points = g_array_new (FALSE, FALSE, sizeof (xmms_mad_seek_point_t));
+
+	return index;
+}
+
+void
+xmms_mad_seek_index_free (xmms_mad_seek_index_t *index)
+{
+	g_array_free (index->points, TRUE);
+	g_free (index);
+}
+
+/**
+ * Account for the next frame of the stream, in stream order.
+ * Returns FALSE if the file is too large to be indexed.
+ */
+gboolean
+xmms_mad_seek_index_add_frame (xmms_mad_seek_index_t *index, guint64 offset,
+                               guint samples)
+{
+	if (index->frames++ % index->interval == 0) {
+		xmms_mad_seek_point_t point;
+
+		if (offset > G_MAXUINT32 || index->samples > G_MAXUINT32) {
+			return FALSE;
+		}
+
+		point.offset = offset;
+		point.sample = index->samples;
+		g_array_append_val (index->points, point);
+	}
+
+	index->samples += samples;
+
+	return TRUE;
+}
+
+/**
+ * Find where to start decoding to reach sample. The point returned
+ * lies at least one interval before the wanted one, as a layer III
+ * frame may need data from the frames before it to decode.
+ */
+gboolean
+xmms_mad_seek_index_lookup (xmms_mad_seek_index_t *index, guint64 sample,
+                            guint64 *offset, guint64 *start)
+{
+	xmms_mad_seek_point_t *point;
+	guint low, high;
+
+	if (!index->points->len) {
+		return FALSE;
+	}
+
+	low = 0;
+	high = index->points->len - 1;
+
+	while (low < high) {
+		guint mid = low + (high - low + 1) / 2;
+
+		point = &g_array_index (index->points, xmms_mad_seek_point_t, mid);
+		if (point->sample <= sample) {
+			low = mid;
+		} else {
+			high = mid - 1;
+		}
+	}
+
+	if (low > 0) {
+		low--;
+	}
+
+	point = &g_array_index (index->points, xmms_mad_seek_point_t, low);
+	*offset = point->offset;
+	*start = point->sample;
+
+	return TRUE;
+}
+
+/* Layout, all little endian:
+ *   "MADI" version:u32 interval:u32 count:u32 filesize:u64
+ *   count * (offset:u32 sample:u32)
+ */
+guchar *
+xmms_mad_seek_index_serialize (xmms_mad_seek_index_t *index, guint64 filesize,
+                               gsize *len)
+{
+	guchar *data, *ptr;
+	guint32 tmp32;
+	guint64 tmp64;
+	guint i;
+
+	*len = SEEK_INDEX_HEADER_SIZE + index->points->len * 8;
+	ptr = data = g_malloc (*len);
+
+	memcpy (ptr, SEEK_INDEX_MAGIC, 4);
+	ptr += 4;
+
+	tmp32 = GUINT32_TO_LE (SEEK_INDEX_VERSION);
+	memcpy (ptr, &tmp32, 4);
+	ptr += 4;
+
+	tmp32 = GUINT32_TO_LE (index->interval);
+	memcpy (ptr, &tmp32, 4);
+	ptr += 4;
+
+	tmp32 = GUINT32_TO_LE (index->points->len);
+	memcpy (ptr, &tmp32, 4);
+	ptr += 4;
+
+	tmp64 = GUINT64_TO_LE (filesize);
+	memcpy (ptr, &tmp64, 8);
+	ptr += 8;
+
+	for (i = 0; i < index->points->len; i++) {
+		xmms_mad_seek_point_t *point;
+
+		point = &g_array_index (index->points, xmms_mad_seek_point_t, i);
+
+		tmp32 = GUINT32_TO_LE (point->offset);
+		memcpy (ptr, &tmp32, 4);
+		ptr += 4;
+
+		tmp32 = GUINT32_TO_LE (point->sample);
+		memcpy (ptr, &tmp32, 4);
+		ptr += 4;
+	}
+
+	return data;
+}
+
+/**
+ * Parse an index stored by xmms_mad_seek_index_serialize. Returns NULL
+ * if it is malformed or was made for a file of another size.
+ */
+xmms_mad_seek_index_t *
+xmms_mad_seek_index_deserialize (const guchar *data, gsize len, guint64 filesize)
+{
+	xmms_mad_seek_index_t *index;
+	guint32 version, interval, count, i;
+	guint64 size;
+
+	if (len < SEEK_INDEX_HEADER_SIZE || memcmp (data, SEEK_INDEX_MAGIC, 4) != 0) {
+		return NULL;
+	}
+
+	memcpy (&version, data + 4, 4);
+	memcpy (&interval, data + 8, 4);
+	memcpy (&count, data + 12, 4);
+	memcpy (&size, data + 16, 8);
+
+	version = GUINT32_FROM_LE (version);
+	interval = GUINT32_FROM_LE (interval);
+	count = GUINT32_FROM_LE (count);
+	size = GUINT64_FROM_LE (size);
+
+	if (version != SEEK_INDEX_VERSION || size != filesize) {
+		return NULL;
+	}
+
+	if ((len - SEEK_INDEX_HEADER_SIZE) / 8 != count ||
+	    (len - SEEK_INDEX_HEADER_SIZE) % 8 != 0) {
+		return NULL;
+	}
+
+	index = xmms_mad_seek_index_new (interval);
+	g_array_set_size (index->points, count);
+
+	data += SEEK_INDEX_HEADER_SIZE;
+	for (i = 0; i < count; i++) {
+		xmms_mad_seek_point_t *point;
+		guint32 tmp;
+
+		point = &g_array_index (index->points, xmms_mad_seek_point_t, i);
+
+		memcpy (&tmp, data, 4);
+		point->offset = GUINT32_FROM_LE (tmp);
+		data += 4;
+
+		memcpy (&tmp, data, 4);
+		point->sample = GUINT32_FROM_LE (tmp);
+		data += 4;
+	}
+
+	return index;
+}
+
+/**
+ * Load the index whose bindata hash is in the entry's property. The
+ * property is exported again when the index is usable, the medialib
+ * drops the plugin's properties each time the chain is set up.
+ */
+xmms_mad_seek_index_t *
+xmms_mad_seek_index_load (xmms_xform_t *xform, const gchar *property,
+                          guint64 filesize)
+{
+	xmms_mad_seek_index_t *index = NULL;
+	gchar *hash;
+	guchar *blob;
+	gsize len;
+
+	hash = xmms_xform_entry_property_get_str (xform, property);
+	if (hash && xmms_bindata_plugin_get (hash, &blob, &len)) {
+		index = xmms_mad_seek_index_deserialize (blob, len, filesize);
+		g_free (blob);
+	}
+
+	if (index) {
+		xmms_xform_metadata_set_str (xform, property, hash);
+	}
+	g_free (hash);
+
+	return index;
+}
+
+/**
+ * Keep the index in bindata and its hash in the entry's property.
+ */
+gboolean
+xmms_mad_seek_index_save (xmms_xform_t *xform, const gchar *property,
+                          xmms_mad_seek_index_t *index, guint64 filesize)
+{
+	gchar hash[33];
+	guchar *blob;
+	gsize len;
+	gboolean ret;
+
+	blob = xmms_mad_seek_index_serialize (index, filesize, &len);
+	ret = xmms_bindata_plugin_add (blob, len, hash);
+	if (ret) {
+		xmms_xform_metadata_set_str (xform, property, hash);
+	}
+	g_free (blob);
+
+	return ret;
+}
@@ -0,0 +1,35 @@
+/*  XMMS2 - X Music Multiplexer System
+ *
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+
+#ifndef __SEEKINDEX_H_
+#define __SEEKINDEX_H_
+
+#include <xmms/xmms_xformplugin.h>
+#include <glib.h>
+
+struct xmms_mad_seek_index_St;
+typedef struct xmms_mad_seek_index_St xmms_mad_seek_index_t;
+
+xmms_mad_seek_index_t *xmms_mad_seek_index_new (guint interval);
+void xmms_mad_seek_index_free (xmms_mad_seek_index_t *index);
+gboolean xmms_mad_seek_index_add_frame (xmms_mad_seek_index_t *index, guint64 offset, guint samples);
+gboolean xmms_mad_seek_index_lookup (xmms_mad_seek_index_t *index, guint64 sample, guint64 *offset, guint64 *start);
+guchar *xmms_mad_seek_index_serialize (xmms_mad_seek_index_t *index, guint64 filesize, gsize *len);
+xmms_mad_seek_index_t *xmms_mad_seek_index_deserialize (const guchar *data, gsize len, guint64 filesize);
+xmms_mad_seek_index_t *xmms_mad_seek_index_load (xmms_xform_t *xform, const gchar *property, guint64 filesize);
+gboolean xmms_mad_seek_index_save (xmms_xform_t *xform, const gchar *property, xmms_mad_seek_index_t *index, guint64 filesize);
+
+#endif
@@ -43,6 +43,7 @@ mp4ff_t *mp4ff_open_read(mp4ff_callback_t *f)
     ff->stream = f;
 
     parse_atoms(ff,0);
+    mp4ff_build_index(ff);
 
     return ff;
 }
@@ -88,6 +89,7 @@ void mp4ff_close(mp4ff_t *ff)
 				free(ff->track[i]->ctts_sample_count);
 			if (ff->track[i]->ctts_sample_offset)
 				free(ff->track[i]->ctts_sample_offset);
+            mp4ff_free_index(ff->track[i]);
 #ifdef ITUNES_DRM
             if (ff->track[i]->p_drms)
                 drms_free(ff->track[i]->p_drms);
@@ -367,6 +369,15 @@ int32_t mp4ff_get_sample_duration_use_offsets(const mp4ff_t *f, const int32_t tr
 int32_t mp4ff_get_sample_duration(const mp4ff_t *f, const int32_t track, const int32_t sample)
 {
     int32_t i, co = 0;
+    const mp4ff_track_t * p_track = f->track[track];
+
+    if (p_track->stts_first_sample)
+    {
+        if (sample < 0 || sample >= p_track->stts_first_sample[p_track->stts_entry_count])
+            return (int32_t)(-1);
+        i = mp4ff_index_search(p_track->stts_first_sample, p_track->stts_entry_count, sample);
+        return p_track->stts_sample_delta[i];
+    }
 
     for (i = 0; i < f->track[track]->stts_entry_count; i++)
     {
@@ -382,6 +393,16 @@ int64_t mp4ff_get_sample_position(const mp4ff_t *f, const int32_t track, const i
 {
     int32_t i, co = 0;
 	int64_t acc = 0;
+    const mp4ff_track_t * p_track = f->track[track];
+
+    if (p_track->stts_first_sample)
+    {
+        if (sample < 0 || sample >= p_track->stts_first_sample[p_track->stts_entry_count])
+            return (int64_t)(-1);
+        i = mp4ff_index_search(p_track->stts_first_sample, p_track->stts_entry_count, sample);
+        return p_track->stts_first_time[i] +
+            (int64_t)p_track->stts_sample_delta[i] * (sample - p_track->stts_first_sample[i]);
+    }
 
     for (i = 0; i < f->track[track]->stts_entry_count; i++)
     {
@@ -403,6 +424,15 @@ int64_t mp4ff_get_sample_position(const mp4ff_t *f, const int32_t track, const i
 int32_t mp4ff_get_sample_offset(const mp4ff_t *f, const int32_t track, const int32_t sample)
 {
     int32_t i, co = 0;
+    const mp4ff_track_t * p_track = f->track[track];
+
+    if (p_track->ctts_first_sample)
+    {
+        if (sample < 0 || sample >= p_track->ctts_first_sample[p_track->ctts_entry_count])
+            return 0;
+        i = mp4ff_index_search(p_track->ctts_first_sample, p_track->ctts_entry_count, sample);
+        return p_track->ctts_sample_offset[i];
+    }
 
     for (i = 0; i < f->track[track]->ctts_entry_count; i++)
     {
@@ -420,6 +450,20 @@ int32_t mp4ff_find_sample(const mp4ff_t *f, const int32_t track, const int64_t o
 	int64_t offset_total = 0;
 	mp4ff_track_t * p_track = f->track[track];
 
+	if (p_track->stts_first_time)
+	{
+		int64_t offset_fromstts;
+
+		if (offset < 0 || offset >= p_track->stts_first_time[p_track->stts_entry_count])
+			return (int32_t)(-1);
+
+		/* empty runs share their start with the next one, which wins */
+		i = mp4ff_index_search64(p_track->stts_first_time, p_track->stts_entry_count, offset);
+		offset_fromstts = offset - p_track->stts_first_time[i];
+		if (toskip) *toskip = (int32_t)(offset_fromstts % p_track->stts_sample_delta[i]);
+		return p_track->stts_first_sample[i] + (int32_t)(offset_fromstts / p_track->stts_sample_delta[i]);
+	}
+
 	for (i = 0; i < p_track->stts_entry_count; i++)
 	{
 		int32_t sample_count = p_track->stts_sample_count[i];
@@ -201,6 +201,14 @@ typedef struct
     int32_t *ctts_sample_count;
     int32_t *ctts_sample_offset;
 
+    /* prefix sums over the tables above, see mp4ff_build_index */
+    int32_t *stts_first_sample;
+    int64_t *stts_first_time;
+    int32_t *ctts_first_sample;
+    int32_t index_chunk_count;
+    int32_t *chunk_first_sample;
+    int32_t *sample_file_offset;
+
     /* esde */
     uint8_t *decoderConfig;
     int32_t decoderConfigLen;
@@ -283,6 +291,10 @@ int32_t mp4ff_chunk_to_offset(const mp4ff_t *f, const int32_t track, const int32
 int32_t mp4ff_sample_range_size(const mp4ff_t *f, const int32_t track,
                                 const int32_t chunk_sample, const int32_t sample);
 int32_t mp4ff_sample_to_offset(const mp4ff_t *f, const int32_t track, const int32_t sample);
+int32_t mp4ff_build_index(mp4ff_t *f);
+void mp4ff_free_index(mp4ff_track_t *p_track);
+int32_t mp4ff_index_search(const int32_t *table, const int32_t count, const int32_t value);
+int32_t mp4ff_index_search64(const int64_t *table, const int32_t count, const int64_t value);
 int32_t mp4ff_audio_frame_size(const mp4ff_t *f, const int32_t track, const int32_t sample);
 int32_t mp4ff_set_sample_position(mp4ff_t *f, const int32_t track, const int32_t sample);
 
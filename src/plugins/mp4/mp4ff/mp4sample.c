@@ -32,6 +32,207 @@
 #include "mp4ffint.h"
 
 
+/* returns the last entry of a sorted table that is <= value */
+int32_t mp4ff_index_search(const int32_t *table, const int32_t count, const int32_t value)
+{
+    int32_t low = 0, high = count - 1;
+
+    while (low < high)
+    {
+        int32_t mid = low + (high - low + 1) / 2;
+
+        if (table[mid] <= value)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+
+    return low;
+}
+
+int32_t mp4ff_index_search64(const int64_t *table, const int32_t count, const int64_t value)
+{
+    int32_t low = 0, high = count - 1;
+
+    while (low < high)
+    {
+        int32_t mid = low + (high - low + 1) / 2;
+
+        if (table[mid] <= value)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+
+    return low;
+}
+
+void mp4ff_free_index(mp4ff_track_t *p_track)
+{
+    free(p_track->stts_first_sample);
+    free(p_track->stts_first_time);
+    free(p_track->ctts_first_sample);
+    free(p_track->chunk_first_sample);
+    free(p_track->sample_file_offset);
+
+    p_track->stts_first_sample = NULL;
+    p_track->stts_first_time = NULL;
+    p_track->ctts_first_sample = NULL;
+    p_track->chunk_first_sample = NULL;
+    p_track->sample_file_offset = NULL;
+    p_track->index_chunk_count = 0;
+}
+
+/* Walks the stsc/stco tables once, recording where each chunk starts
+ * and the file offset of every sample. Same results as
+ * mp4ff_chunk_of_sample and mp4ff_sample_to_offset, minus the walking.
+ * Only chunks that have an stco entry are indexed, and stsc runs have
+ * to start at increasing chunks; tables that don't fit leave the
+ * lookups to the linear code.
+ */
+static int32_t mp4ff_build_chunk_index(const mp4ff_t *f, const int32_t track)
+{
+    mp4ff_track_t *p_track = f->track[track];
+    int32_t chunk = 0, entry, sample = 0;
+    int32_t samples = p_track->stsz_sample_count;
+    int32_t chunks = p_track->stco_entry_count;
+
+    if (samples <= 0 || chunks <= 0 || p_track->stsc_entry_count <= 0)
+        return 0;
+
+    p_track->sample_file_offset = (int32_t*)malloc(samples * sizeof(int32_t));
+    p_track->chunk_first_sample = (int32_t*)malloc(chunks * sizeof(int32_t));
+    if (!p_track->sample_file_offset || !p_track->chunk_first_sample)
+        return -1;
+
+    /* 'chunk' counts the chunks indexed so far, it never passes 'chunks' */
+    for (entry = 0; entry < p_track->stsc_entry_count && sample < samples; entry++)
+    {
+        int32_t first = p_track->stsc_first_chunk[entry];
+        int32_t per_chunk = p_track->stsc_samples_per_chunk[entry];
+        int32_t end = chunks;
+
+        if (first <= chunk || first > chunks)
+            break;
+
+        if (entry + 1 < p_track->stsc_entry_count)
+        {
+            int32_t next = p_track->stsc_first_chunk[entry + 1];
+
+            if (next <= first)
+                break;
+            if (next <= chunks)
+                end = next - 1;
+        }
+        else if (per_chunk <= 0)
+        {
+            /* the last run has no samples, there won't be any more */
+            break;
+        }
+
+        /* chunks before the first run have no samples */
+        while (chunk < first - 1)
+            p_track->chunk_first_sample[chunk++] = sample;
+
+        if (per_chunk <= 0)
+        {
+            /* an empty run, all of it starts where the next run does */
+            while (chunk < end)
+                p_track->chunk_first_sample[chunk++] = sample;
+            continue;
+        }
+
+        while (chunk < end && sample < samples)
+        {
+            int32_t i, offset;
+
+            p_track->chunk_first_sample[chunk++] = sample;
+
+            offset = mp4ff_chunk_to_offset(f, track, chunk);
+            for (i = 0; i < per_chunk && sample < samples; i++)
+            {
+                p_track->sample_file_offset[sample] = offset;
+                offset += mp4ff_audio_frame_size(f, track, sample);
+                sample++;
+            }
+        }
+    }
+
+    p_track->index_chunk_count = chunk;
+
+    /* malformed tables, let the lookups do what they always did */
+    if (sample < samples)
+    {
+        free(p_track->sample_file_offset);
+        free(p_track->chunk_first_sample);
+        p_track->sample_file_offset = NULL;
+        p_track->chunk_first_sample = NULL;
+        p_track->index_chunk_count = 0;
+    }
+
+    return 0;
+}
+
+/* Builds prefix sums over the sample tables of every track, so that
+ * seeking is a binary search and finding a sample in the file a lookup.
+ * Costs 4 bytes per sample plus a little per table entry and chunk.
+ */
+int32_t mp4ff_build_index(mp4ff_t *f)
+{
+    int32_t track, i;
+
+    for (track = 0; track < f->total_tracks; track++)
+    {
+        mp4ff_track_t *p_track = f->track[track];
+
+        if (p_track == NULL)
+            continue;
+
+        if (p_track->stts_entry_count > 0)
+        {
+            p_track->stts_first_sample = (int32_t*)malloc((p_track->stts_entry_count + 1) * sizeof(int32_t));
+            p_track->stts_first_time = (int64_t*)malloc((p_track->stts_entry_count + 1) * sizeof(int64_t));
+            if (!p_track->stts_first_sample || !p_track->stts_first_time)
+                goto error;
+
+            p_track->stts_first_sample[0] = 0;
+            p_track->stts_first_time[0] = 0;
+            for (i = 0; i < p_track->stts_entry_count; i++)
+            {
+                p_track->stts_first_sample[i + 1] = p_track->stts_first_sample[i] +
+                    p_track->stts_sample_count[i];
+                p_track->stts_first_time[i + 1] = p_track->stts_first_time[i] +
+                    (int64_t)p_track->stts_sample_delta[i] * p_track->stts_sample_count[i];
+            }
+        }
+
+        if (p_track->ctts_entry_count > 0)
+        {
+            p_track->ctts_first_sample = (int32_t*)malloc((p_track->ctts_entry_count + 1) * sizeof(int32_t));
+            if (!p_track->ctts_first_sample)
+                goto error;
+
+            p_track->ctts_first_sample[0] = 0;
+            for (i = 0; i < p_track->ctts_entry_count; i++)
+            {
+                p_track->ctts_first_sample[i + 1] = p_track->ctts_first_sample[i] +
+                    p_track->ctts_sample_count[i];
+            }
+        }
+
+        if (mp4ff_build_chunk_index(f, track) != 0)
+            goto error;
+
+        continue;
+
+error:
+        /* everything still works without an index, just slower */
+        mp4ff_free_index(p_track);
+    }
+
+    return 0;
+}
+
 int32_t mp4ff_chunk_of_sample(const mp4ff_t *f, const int32_t track, const int32_t sample,
                               int32_t *chunk_sample, int32_t *chunk)
 {
@@ -44,6 +245,16 @@ int32_t mp4ff_chunk_of_sample(const mp4ff_t *f, const int32_t track, const int32
         return -1;
     }
 
+    if (f->track[track]->sample_file_offset && sample >= 0 &&
+        sample < f->track[track]->stsz_sample_count)
+    {
+        int32_t i = mp4ff_index_search(f->track[track]->chunk_first_sample,
+                                       f->track[track]->index_chunk_count, sample);
+        *chunk = i + 1;
+        *chunk_sample = f->track[track]->chunk_first_sample[i];
+        return 0;
+    }
+
     total_entries = f->track[track]->stsc_entry_count;
 
     chunk1 = 1;
@@ -120,6 +331,12 @@ int32_t mp4ff_sample_range_size(const mp4ff_t *f, const int32_t track,
 int32_t mp4ff_sample_to_offset(const mp4ff_t *f, const int32_t track, const int32_t sample)
 {
     int32_t chunk, chunk_sample, chunk_offset1, chunk_offset2;
+    const mp4ff_track_t * p_track = f->track[track];
+
+    if (p_track->sample_file_offset && sample >= 0 && sample < p_track->stsz_sample_count)
+    {
+        return p_track->sample_file_offset[sample];
+    }
 
     mp4ff_chunk_of_sample(f, track, sample, &chunk_sample, &chunk);
 
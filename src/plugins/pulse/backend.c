@@ -53,6 +53,10 @@ struct xmms_pulse {
 	pa_channel_map channel_map;
 	int operation_success;
 	int volume;
+	void (*volume_cb) (void *userdata);
+	void (*volume_lost_cb) (void *userdata);
+	void *volume_userdata;
+	int subscribed;
 };
 
 static gboolean check_pulse_health (xmms_pulse *p, int *rerror)
@@ -85,12 +89,18 @@ static void signal_mainloop (void *userdata)
 
 static void context_state_cb (pa_context *c, void *userdata)
 {
+	xmms_pulse *p = userdata;
 	assert (c);
 
 	switch (pa_context_get_state (c)) {
+	case PA_CONTEXT_FAILED:
+		/* no more volume change events from this context */
+		if (p->subscribed) {
+			p->subscribed = 0;
+			p->volume_lost_cb (p->volume_userdata);
+		}
 	case PA_CONTEXT_READY:
 	case PA_CONTEXT_TERMINATED:
-	case PA_CONTEXT_FAILED:
 		signal_mainloop (userdata);
 
 	case PA_CONTEXT_UNCONNECTED:
@@ -127,6 +137,23 @@ static void stream_request_cb (pa_stream *s, size_t length, void *userdata)
 	signal_mainloop (userdata);
 }
 
+static void subscribe_cb (pa_context *c, pa_subscription_event_type_t t,
+                          uint32_t idx, void *userdata)
+{
+	xmms_pulse *p = userdata;
+	assert (p);
+
+	if ((t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) != PA_SUBSCRIPTION_EVENT_SINK_INPUT ||
+	    (t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) != PA_SUBSCRIPTION_EVENT_CHANGE)
+		return;
+
+	/* only our own stream is interesting */
+	if (!p->stream || pa_stream_get_index (p->stream) != idx)
+		return;
+
+	p->volume_cb (p->volume_userdata);
+}
+
 static void drain_result_cb (pa_stream *s, int success, void *userdata)
 {
 	xmms_pulse *p = userdata;
@@ -143,9 +170,12 @@ static void drain_result_cb (pa_stream *s, int success, void *userdata)
  */
 xmms_pulse *
 xmms_pulse_backend_new (const char *server, const char *name,
-                        int *rerror)
+                        void (*volume_cb) (void *userdata),
+                        void (*volume_lost_cb) (void *userdata),
+                        void *userdata, int *rerror)
 {
 	xmms_pulse *p;
+	pa_operation *o;
 	int error = PA_ERR_INTERNAL;
 
 	if (server && !*server) {
@@ -159,6 +189,9 @@ xmms_pulse_backend_new (const char *server, const char *name,
 		return NULL;
 
 	p->volume = 100;
+	p->volume_cb = volume_cb;
+	p->volume_lost_cb = volume_lost_cb;
+	p->volume_userdata = userdata;
 
 	p->mainloop = pa_threaded_mainloop_new ();
 	if (!p->mainloop)
@@ -188,6 +221,19 @@ xmms_pulse_backend_new (const char *server, const char *name,
 		goto unlock_and_fail;
 	}
 
+	/* Have the server tell us when the volume of our stream changes */
+	if (p->volume_cb) {
+		pa_context_set_subscribe_callback (p->context, subscribe_cb, p);
+		o = pa_context_subscribe (p->context, PA_SUBSCRIPTION_MASK_SINK_INPUT,
+		                          NULL, NULL);
+		if (o) {
+			pa_operation_unref (o);
+			p->subscribed = 1;
+		} else {
+			p->volume_lost_cb (p->volume_userdata);
+		}
+	}
+
 	pa_threaded_mainloop_unlock (p->mainloop);
 	return p;
 
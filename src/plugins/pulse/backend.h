@@ -4,7 +4,9 @@
 typedef struct xmms_pulse xmms_pulse;
 
 xmms_pulse* xmms_pulse_backend_new(const char *server, const char *name,
-                                   int *rerror);
+                                   void (*volume_cb)(void *userdata),
+                                   void (*volume_lost_cb)(void *userdata),
+                                   void *userdata, int *rerror);
 void xmms_pulse_backend_free(xmms_pulse *s);
 gboolean xmms_pulse_backend_set_stream(xmms_pulse *p,
                                        const char *stream_name,
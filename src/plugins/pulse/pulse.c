@@ -47,6 +47,9 @@ static gboolean xmms_pulse_format_set (xmms_output_t *output,
 static gboolean xmms_pulse_volume_set (xmms_output_t *output,
                                        const gchar *channel,
                                        guint volume);
+static gboolean xmms_pulse_volume_monitor (xmms_output_t *output);
+static void xmms_pulse_volume_changed (void *userdata);
+static void xmms_pulse_volume_lost (void *userdata);
 static gboolean xmms_pulse_volume_get (xmms_output_t *output,
                                        const gchar **names,
                                        guint *values,
@@ -76,6 +79,7 @@ xmms_pulse_plugin_setup (xmms_output_plugin_t *plugin)
 	methods.format_set = xmms_pulse_format_set;
 	methods.volume_set = xmms_pulse_volume_set;
 	methods.volume_get = xmms_pulse_volume_get;
+	methods.volume_monitor = xmms_pulse_volume_monitor;
 
 	xmms_output_plugin_methods_set (plugin, &methods);
 
@@ -156,7 +160,10 @@ xmms_pulse_open (xmms_output_t *output)
 	if (!name || *name == '\0')
 		name = XMMS_PULSE_DEFAULT_NAME;
 
-	data->pulse = xmms_pulse_backend_new (server, name, NULL);
+	data->pulse = xmms_pulse_backend_new (server, name,
+	                                      xmms_pulse_volume_changed,
+	                                      xmms_pulse_volume_lost,
+	                                      output, NULL);
 	if (!data->pulse)
 		return FALSE;
 
@@ -177,6 +184,9 @@ xmms_pulse_close (xmms_output_t *output)
 		xmms_pulse_backend_free (data->pulse);
 		data->pulse = NULL;
 	}
+
+	/* the volume is gone with the stream */
+	xmms_output_volume_changed (output);
 }
 
 
@@ -215,6 +225,9 @@ xmms_pulse_format_set (xmms_output_t *output, const xmms_stream_type_t *format)
 	                                    samplerate, channels, NULL))
 		return FALSE;
 
+	/* a new stream may start out at another volume */
+	xmms_output_volume_changed (output);
+
 	return TRUE;
 }
 
@@ -251,6 +264,30 @@ xmms_pulse_volume_set (xmms_output_t *output,
 }
 
 
+/* The stream volume is reported by the server, see xmms_pulse_open */
+static gboolean
+xmms_pulse_volume_monitor (xmms_output_t *output)
+{
+	return TRUE;
+}
+
+
+/* Called from the pulse mainloop thread */
+static void
+xmms_pulse_volume_changed (void *userdata)
+{
+	xmms_output_volume_changed ((xmms_output_t *) userdata);
+}
+
+
+/* Called from the pulse mainloop thread when the server went away */
+static void
+xmms_pulse_volume_lost (void *userdata)
+{
+	xmms_output_volume_monitor_lost ((xmms_output_t *) userdata);
+}
+
+
 static gboolean
 xmms_pulse_volume_get (xmms_output_t *output, const gchar **names,
                        guint *values, guint *num_channels)
@@ -28,8 +28,8 @@
 #include <stdlib.h>
 #include <string.h>
 
-typedef void (*xmms_replaygain_apply_func_t)
-	(void *buf, gint len, gfloat gain);
+/* length of the fade when the gain changes during playback */
+#define RAMP_MS 50
 
 /**
  * Replaygain modes.
@@ -47,7 +47,8 @@ typedef struct xmms_replaygain_data_St {
 	gfloat gain;
 	gboolean has_replaygain;
 	gboolean enabled;
-	xmms_replaygain_apply_func_t apply;
+	gint ramp;
+	xmms_sample_gain_t *stage;
 } xmms_replaygain_data_t;
 
 static const xmms_sample_format_t formats[] = {
@@ -73,15 +74,7 @@ static void xmms_replaygain_config_changed (xmms_object_t *obj, xmmsv_t *_val, g
 
 static void compute_gain (xmms_xform_t *xform, xmms_replaygain_data_t *data);
 static xmms_replaygain_mode_t parse_mode (const char *s);
-
-static void apply_s8 (void *buf, gint len, gfloat gain);
-static void apply_u8 (void *buf, gint len, gfloat gain);
-static void apply_s16 (void *buf, gint len, gfloat gain);
-static void apply_u16 (void *buf, gint len, gfloat gain);
-static void apply_s32 (void *buf, gint len, gfloat gain);
-static void apply_u32 (void *buf, gint len, gfloat gain);
-static void apply_float (void *buf, gint len, gfloat gain);
-static void apply_double (void *buf, gint len, gfloat gain);
+static gfloat current_gain (xmms_replaygain_data_t *data);
 
 /*
  * Plugin header
@@ -137,6 +130,7 @@ xmms_replaygain_init (xmms_xform_t *xform)
 	xmms_replaygain_data_t *data;
 	xmms_config_property_t *cfgv;
 	xmms_sample_format_t fmt;
+	gint channels, srate;
 
 	g_return_val_if_fail (xform, FALSE);
 
@@ -178,39 +172,15 @@ xmms_replaygain_init (xmms_xform_t *xform)
 	compute_gain (xform, data);
 
 	fmt = xmms_xform_indata_get_int (xform, XMMS_STREAM_TYPE_FMT_FORMAT);
+	channels = xmms_xform_indata_get_int (xform, XMMS_STREAM_TYPE_FMT_CHANNELS);
+	srate = xmms_xform_indata_get_int (xform, XMMS_STREAM_TYPE_FMT_SAMPLERATE);
 
-	switch (fmt) {
-		case XMMS_SAMPLE_FORMAT_S8:
-			data->apply = apply_s8;
-			break;
-		case XMMS_SAMPLE_FORMAT_U8:
-			data->apply = apply_u8;
-			break;
-		case XMMS_SAMPLE_FORMAT_S16:
-			data->apply = apply_s16;
-			break;
-		case XMMS_SAMPLE_FORMAT_U16:
-			data->apply = apply_u16;
-			break;
-		case XMMS_SAMPLE_FORMAT_S32:
-			data->apply = apply_s32;
-			break;
-		case XMMS_SAMPLE_FORMAT_U32:
-			data->apply = apply_u32;
-			break;
-		case XMMS_SAMPLE_FORMAT_FLOAT:
-			data->apply = apply_float;
-			break;
-		case XMMS_SAMPLE_FORMAT_DOUBLE:
-			data->apply = apply_double;
-			break;
-		default:
-			/* we shouldn't ever get here, since we told the daemon
-			 * earlier about this list of supported formats.
-			 */
-			g_assert_not_reached ();
-			break;
-	}
+	data->ramp = srate * RAMP_MS / 1000;
+	data->stage = xmms_sample_gain_new (fmt, channels);
+	g_return_val_if_fail (data->stage, FALSE);
+
+	/* start out at the right level, only later changes are faded */
+	xmms_sample_gain_set (data->stage, current_gain (data), 0);
 
 	return TRUE;
 }
@@ -218,11 +188,14 @@ xmms_replaygain_init (xmms_xform_t *xform)
 static void
 xmms_replaygain_destroy (xmms_xform_t *xform)
 {
+	xmms_replaygain_data_t *data;
 	xmms_config_property_t *cfgv;
 
 	g_return_if_fail (xform);
 
-	g_free (xmms_xform_private_data_get (xform));
+	data = xmms_xform_private_data_get (xform);
+	xmms_sample_gain_free (data->stage);
+	g_free (data);
 
 	cfgv = xmms_xform_config_lookup (xform, "mode");
 	xmms_config_property_callback_remove (cfgv,
@@ -246,7 +219,6 @@ xmms_replaygain_read (xmms_xform_t *xform, xmms_sample_t *buf, gint len,
                       xmms_error_t *error)
 {
 	xmms_replaygain_data_t *data;
-	xmms_sample_format_t fmt;
 	gint read;
 
 	g_return_val_if_fail (xform, -1);
@@ -255,15 +227,18 @@ xmms_replaygain_read (xmms_xform_t *xform, xmms_sample_t *buf, gint len,
 	g_return_val_if_fail (data, -1);
 
 	read = xmms_xform_read (xform, buf, len, error);
-
-	if (!data->has_replaygain || !data->enabled) {
+	if (read <= 0) {
 		return read;
 	}
 
-	fmt = xmms_xform_indata_get_int (xform, XMMS_STREAM_TYPE_FMT_FORMAT);
-	len /= xmms_sample_size_get (fmt);
+	/* the config callbacks only update data->gain, the stage itself is
+	 * only ever touched from the reading thread.
+	 */
+	xmms_sample_gain_set (data->stage, current_gain (data), data->ramp);
 
-	data->apply (buf, len, data->gain);
+	if (!xmms_sample_gain_is_unity (data->stage)) {
+		xmms_sample_gain_apply (data->stage, buf, read);
+	}
 
 	return read;
 }
@@ -353,6 +328,16 @@ compute_gain (xmms_xform_t *xform, xmms_replaygain_data_t *data)
 	data->has_replaygain = (fabs (data->gain - 1.0) > 0.001);
 }
 
+static gfloat
+current_gain (xmms_replaygain_data_t *data)
+{
+	if (!data->has_replaygain || !data->enabled) {
+		return 1.0;
+	}
+
+	return data->gain;
+}
+
 static xmms_replaygain_mode_t
 parse_mode (const char *s)
 {
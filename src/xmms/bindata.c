@@ -40,8 +40,34 @@
 struct xmms_bindata_St {
 	xmms_object_t obj;
 	const gchar *bindir;
+
+	/* md5 of everything added since startup, by size and fast hash */
+	GMutex known_lock;
+	GHashTable *known;
+
+	/* recently retrieved blobs by md5, most recently used first */
+	GMutex cache_lock;
+	GHashTable *cache;
+	GQueue cache_lru;
+	gsize cache_size;
+	gsize cache_limit;
+	guint cache_generation;
+	gint64 cache_hits;
+	gint64 cache_misses;
 };
 
+typedef struct xmms_bindata_key_St {
+	gsize size;
+	guint64 hash;
+} xmms_bindata_key_t;
+
+typedef struct xmms_bindata_cache_entry_St {
+	gchar *hash;
+	xmmsv_t *value;
+	gsize size;
+	GList *link;
+} xmms_bindata_cache_entry_t;
+
 static xmms_bindata_t *global_bindata;
 
 static void xmms_bindata_destroy (xmms_object_t *obj);
@@ -62,15 +88,41 @@ static void md5_append (md5_state_t *pms, const md5_byte_t *data, int nbytes);
 static void md5_finish (md5_state_t *pms, md5_byte_t digest[16]);
 
 static gchar *xmms_bindata_build_path (xmms_bindata_t *bindata, const gchar *hash);
+static guint64 xmms_bindata_fast_hash (const guchar *data, gsize len);
+static guint xmms_bindata_key_hash (gconstpointer v);
+static gboolean xmms_bindata_key_equal (gconstpointer a, gconstpointer b);
+static gboolean xmms_bindata_known_lookup (xmms_bindata_t *bindata, const xmms_bindata_key_t *key, gchar hash[33]);
+static void xmms_bindata_known_insert (xmms_bindata_t *bindata, const xmms_bindata_key_t *key, const gchar *hash);
+static void xmms_bindata_known_forget (xmms_bindata_t *bindata, const gchar *hash);
+static void xmms_bindata_cache_entry_free (gpointer data);
+static xmmsv_t *xmms_bindata_cache_lookup (xmms_bindata_t *bindata, const gchar *hash, guint *generation);
+static void xmms_bindata_cache_insert (xmms_bindata_t *bindata, const gchar *hash, xmmsv_t *value, guint generation);
+static void xmms_bindata_cache_forget (xmms_bindata_t *bindata, const gchar *hash);
+static void xmms_bindata_cache_trim (xmms_bindata_t *bindata);
 
 static gchar *xmms_bindata_client_add (xmms_bindata_t *bindata, GString *data, xmms_error_t *err);
 static xmmsv_t *xmms_bindata_client_retrieve (xmms_bindata_t *bindata, const gchar *hash, xmms_error_t *err);
 static void xmms_bindata_client_remove (xmms_bindata_t *bindata, const gchar *hash, xmms_error_t *);
 static xmmsv_t *xmms_bindata_client_list (xmms_bindata_t *bindata, xmms_error_t *err);
+static xmmsv_t *xmms_bindata_client_cache_stats (xmms_bindata_t *bindata, xmms_error_t *err);
 static gboolean _xmms_bindata_add (xmms_bindata_t *bindata, const guchar *data, gsize len, gchar hash[33], xmms_error_t *err);
 
 #include "bindata_ipc.c"
 
+static void
+on_cache_size_changed (xmms_object_t *object, xmmsv_t *_data, gpointer udata)
+{
+	xmms_bindata_t *bindata = udata;
+	gint value;
+
+	value = xmms_config_property_get_int ((xmms_config_property_t *) object);
+
+	g_mutex_lock (&bindata->cache_lock);
+	bindata->cache_limit = MAX (value, 0);
+	xmms_bindata_cache_trim (bindata);
+	g_mutex_unlock (&bindata->cache_lock);
+}
+
 xmms_bindata_t *
 xmms_bindata_init ()
 {
@@ -80,6 +132,16 @@ xmms_bindata_init ()
 
 	obj = xmms_object_new (xmms_bindata_t, xmms_bindata_destroy);
 
+	g_mutex_init (&obj->known_lock);
+	obj->known = g_hash_table_new_full (xmms_bindata_key_hash,
+	                                    xmms_bindata_key_equal,
+	                                    g_free, g_free);
+
+	g_mutex_init (&obj->cache_lock);
+	obj->cache = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+	                                    xmms_bindata_cache_entry_free);
+	g_queue_init (&obj->cache_lru);
+
 	xmms_bindata_register_ipc_commands (XMMS_OBJECT (obj));
 
 	tmp = XMMS_BUILD_PATH ("bindata");
@@ -88,6 +150,10 @@ xmms_bindata_init ()
 
 	obj->bindir = xmms_config_property_get_string (cv);
 
+	cv = xmms_config_property_register ("bindata.cache_size", "8388608",
+	                                    on_cache_size_changed, obj);
+	obj->cache_limit = MAX (xmms_config_property_get_int (cv), 0);
+
 	if (!g_file_test (obj->bindir, G_FILE_TEST_IS_DIR)) {
 		if (g_mkdir_with_parents (obj->bindir, 0755) == -1) {
 			xmms_log_error ("Couldn't create bindir %s", obj->bindir);
@@ -102,9 +168,22 @@ xmms_bindata_init ()
 static void
 xmms_bindata_destroy (xmms_object_t *obj)
 {
+	xmms_bindata_t *bindata = (xmms_bindata_t *) obj;
+	xmms_config_property_t *cv;
+
 	XMMS_DBG ("Deactivating bindata object.");
 
 	xmms_bindata_unregister_ipc_commands ();
+
+	cv = xmms_config_lookup ("bindata.cache_size");
+	xmms_config_property_callback_remove (cv, on_cache_size_changed, bindata);
+
+	g_hash_table_destroy (bindata->known);
+	g_mutex_clear (&bindata->known_lock);
+
+	g_queue_clear (&bindata->cache_lru);
+	g_hash_table_destroy (bindata->cache);
+	g_mutex_clear (&bindata->cache_lock);
 }
 
 gchar *
@@ -136,6 +215,200 @@ xmms_bindata_build_path (xmms_bindata_t *bindata, const gchar *hash)
 	return g_build_path (G_DIR_SEPARATOR_S, bindata->bindir, hash, NULL);
 }
 
+/*
+ * xxHash64 (seed 0). Works on four 64 bit lanes, several times faster
+ * than md5. Only good for finding candidates, not for telling them apart.
+ */
+#define PRIME64_1 G_GUINT64_CONSTANT (0x9E3779B185EBCA87)
+#define PRIME64_2 G_GUINT64_CONSTANT (0xC2B2AE3D27D4EB4F)
+#define PRIME64_3 G_GUINT64_CONSTANT (0x165667B19E3779F9)
+#define PRIME64_4 G_GUINT64_CONSTANT (0x85EBCA77C2B2AE63)
+#define PRIME64_5 G_GUINT64_CONSTANT (0x27D4EB2F165667C5)
+
+static inline guint64
+fast_hash_read64 (const guchar *p)
+{
+	guint64 v;
+	memcpy (&v, p, sizeof (v));
+	return GUINT64_FROM_LE (v);
+}
+
+static inline guint32
+fast_hash_read32 (const guchar *p)
+{
+	guint32 v;
+	memcpy (&v, p, sizeof (v));
+	return GUINT32_FROM_LE (v);
+}
+
+static inline guint64
+fast_hash_rotl (guint64 x, gint r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline guint64
+fast_hash_round (guint64 acc, guint64 input)
+{
+	acc += input * PRIME64_2;
+	acc = fast_hash_rotl (acc, 31);
+	return acc * PRIME64_1;
+}
+
+static inline guint64
+fast_hash_merge (guint64 acc, guint64 val)
+{
+	acc ^= fast_hash_round (0, val);
+	return acc * PRIME64_1 + PRIME64_4;
+}
+
+static guint64
+xmms_bindata_fast_hash (const guchar *data, gsize len)
+{
+	const guchar *p = data;
+	const guchar *end = data + len;
+	guint64 h;
+
+	if (len >= 32) {
+		const guchar *limit = end - 32;
+		guint64 v1 = PRIME64_1 + PRIME64_2;
+		guint64 v2 = PRIME64_2;
+		guint64 v3 = 0;
+		guint64 v4 = -PRIME64_1;
+
+		do {
+			v1 = fast_hash_round (v1, fast_hash_read64 (p));
+			v2 = fast_hash_round (v2, fast_hash_read64 (p + 8));
+			v3 = fast_hash_round (v3, fast_hash_read64 (p + 16));
+			v4 = fast_hash_round (v4, fast_hash_read64 (p + 24));
+			p += 32;
+		} while (p <= limit);
+
+		h = fast_hash_rotl (v1, 1) + fast_hash_rotl (v2, 7) +
+		    fast_hash_rotl (v3, 12) + fast_hash_rotl (v4, 18);
+		h = fast_hash_merge (h, v1);
+		h = fast_hash_merge (h, v2);
+		h = fast_hash_merge (h, v3);
+		h = fast_hash_merge (h, v4);
+	} else {
+		h = PRIME64_5;
+	}
+
+	h += (guint64) len;
+
+	for (; p + 8 <= end; p += 8) {
+		h ^= fast_hash_round (0, fast_hash_read64 (p));
+		h = fast_hash_rotl (h, 27) * PRIME64_1 + PRIME64_4;
+	}
+
+	if (p + 4 <= end) {
+		h ^= (guint64) fast_hash_read32 (p) * PRIME64_1;
+		h = fast_hash_rotl (h, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+
+	for (; p < end; p++) {
+		h ^= (*p) * PRIME64_5;
+		h = fast_hash_rotl (h, 11) * PRIME64_1;
+	}
+
+	h ^= h >> 33;
+	h *= PRIME64_2;
+	h ^= h >> 29;
+	h *= PRIME64_3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+static guint
+xmms_bindata_key_hash (gconstpointer v)
+{
+	const xmms_bindata_key_t *key = v;
+	return (guint) (key->hash ^ (key->hash >> 32));
+}
+
+static gboolean
+xmms_bindata_key_equal (gconstpointer a, gconstpointer b)
+{
+	const xmms_bindata_key_t *ka = a, *kb = b;
+	return ka->size == kb->size && ka->hash == kb->hash;
+}
+
+static gboolean
+xmms_bindata_known_lookup (xmms_bindata_t *bindata,
+                           const xmms_bindata_key_t *key, gchar hash[33])
+{
+	const gchar *known;
+
+	g_mutex_lock (&bindata->known_lock);
+	known = g_hash_table_lookup (bindata->known, key);
+	if (known) {
+		memcpy (hash, known, 33);
+	}
+	g_mutex_unlock (&bindata->known_lock);
+
+	return known != NULL;
+}
+
+static void
+xmms_bindata_known_insert (xmms_bindata_t *bindata,
+                           const xmms_bindata_key_t *key, const gchar *hash)
+{
+	xmms_bindata_key_t *copy;
+
+	copy = g_new (xmms_bindata_key_t, 1);
+	*copy = *key;
+
+	g_mutex_lock (&bindata->known_lock);
+	g_hash_table_replace (bindata->known, copy, g_strdup (hash));
+	g_mutex_unlock (&bindata->known_lock);
+}
+
+static gboolean
+xmms_bindata_known_match (gpointer key, gpointer value, gpointer user_data)
+{
+	return strcmp (value, user_data) == 0;
+}
+
+static void
+xmms_bindata_known_forget (xmms_bindata_t *bindata, const gchar *hash)
+{
+	g_mutex_lock (&bindata->known_lock);
+	g_hash_table_foreach_remove (bindata->known, xmms_bindata_known_match,
+	                             (gpointer) hash);
+	g_mutex_unlock (&bindata->known_lock);
+}
+
+/* Whether the file at path holds exactly data. */
+static gboolean
+xmms_bindata_file_equal (const gchar *path, const guchar *data, gsize len)
+{
+	gchar buf[4096];
+	gsize pos = 0;
+	FILE *fp;
+
+	fp = fopen (path, "rb");
+	if (!fp) {
+		return FALSE;
+	}
+
+	while (!feof (fp)) {
+		gsize l;
+
+		l = fread (buf, 1, sizeof (buf), fp);
+		if (ferror (fp) || l > len - pos || memcmp (buf, data + pos, l)) {
+			fclose (fp);
+			return FALSE;
+		}
+		pos += l;
+	}
+
+	fclose (fp);
+
+	return pos == len;
+}
+
 /** Add binary data from a plugin */
 gboolean
 xmms_bindata_plugin_add (const guchar *data, gsize size, gchar hash[33])
@@ -144,20 +417,57 @@ xmms_bindata_plugin_add (const guchar *data, gsize size, gchar hash[33])
 	return _xmms_bindata_add (global_bindata, data, size, hash, &err);
 }
 
+/**
+ * Read binary data previously added, for a plugin.
+ * The returned data should be freed with g_free.
+ */
+gboolean
+xmms_bindata_plugin_get (const gchar *hash, guchar **data, gsize *size)
+{
+	gboolean ret;
+	gchar *path;
+
+	g_return_val_if_fail (hash, FALSE);
+
+	path = xmms_bindata_build_path (global_bindata, hash);
+	ret = g_file_get_contents (path, (gchar **) data, size, NULL);
+	g_free (path);
+
+	return ret;
+}
+
 static gboolean
 _xmms_bindata_add (xmms_bindata_t *bindata, const guchar *data, gsize len, gchar hash[33], xmms_error_t *err)
 {
+	xmms_bindata_key_t key;
 	const guchar *ptr;
 	gsize left;
 	gchar *path;
 	FILE *fp;
 
+	/* The same cover art comes with every track of an album, so look
+	 * for it by size and a cheap hash before doing the md5. The cheap
+	 * hash is easily made to collide, so the bytes have the last word.
+	 */
+	key.size = len;
+	key.hash = xmms_bindata_fast_hash (data, len);
+
+	if (xmms_bindata_known_lookup (bindata, &key, hash)) {
+		path = xmms_bindata_build_path (bindata, hash);
+		if (xmms_bindata_file_equal (path, data, len)) {
+			g_free (path);
+			return TRUE;
+		}
+		g_free (path);
+	}
+
 	xmms_bindata_calculate_md5 (data, len, hash);
 
 	path = xmms_bindata_build_path (bindata, hash);
 
 	if (g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
 		XMMS_DBG ("file %s is already in bindata dir", hash);
+		xmms_bindata_known_insert (bindata, &key, hash);
 		g_free (path);
 		return TRUE;
 	}
@@ -197,6 +507,8 @@ _xmms_bindata_add (xmms_bindata_t *bindata, const guchar *data, gsize len, gchar
 	fclose (fp);
 	g_free (path);
 
+	xmms_bindata_known_insert (bindata, &key, hash);
+
 	return TRUE;
 }
 
@@ -217,6 +529,12 @@ xmms_bindata_client_retrieve (xmms_bindata_t *bindata, const gchar *hash,
 	gchar *path;
 	GString *str;
 	FILE *fp;
+	guint generation;
+
+	res = xmms_bindata_cache_lookup (bindata, hash, &generation);
+	if (res) {
+		return res;
+	}
 
 	path = xmms_bindata_build_path (bindata, hash);
 
@@ -252,6 +570,8 @@ xmms_bindata_client_retrieve (xmms_bindata_t *bindata, const gchar *hash,
 
 	g_string_free (str, TRUE);
 
+	xmms_bindata_cache_insert (bindata, hash, res, generation);
+
 	return res;
 }
 
@@ -260,6 +580,10 @@ xmms_bindata_client_remove (xmms_bindata_t *bindata, const gchar *hash,
                             xmms_error_t *err)
 {
 	gchar *path;
+
+	xmms_bindata_known_forget (bindata, hash);
+	xmms_bindata_cache_forget (bindata, hash);
+
 	path = xmms_bindata_build_path (bindata, hash);
 	if (unlink (path) == -1) {
 		xmms_error_set (err, XMMS_ERROR_GENERIC, "Couldn't remove file");
@@ -297,6 +621,141 @@ xmms_bindata_client_list (xmms_bindata_t *bindata, xmms_error_t *err)
 	return entries;
 }
 
+static xmmsv_t *
+xmms_bindata_client_cache_stats (xmms_bindata_t *bindata, xmms_error_t *err)
+{
+	xmmsv_t *ret;
+
+	g_mutex_lock (&bindata->cache_lock);
+	ret = xmmsv_build_dict (XMMSV_DICT_ENTRY_INT ("hits", bindata->cache_hits),
+	                        XMMSV_DICT_ENTRY_INT ("misses", bindata->cache_misses),
+	                        XMMSV_DICT_ENTRY_INT ("entries", g_hash_table_size (bindata->cache)),
+	                        XMMSV_DICT_ENTRY_INT ("size", bindata->cache_size),
+	                        XMMSV_DICT_ENTRY_INT ("limit", bindata->cache_limit),
+	                        XMMSV_DICT_END);
+	g_mutex_unlock (&bindata->cache_lock);
+
+	return ret;
+}
+
+static void
+xmms_bindata_cache_entry_free (gpointer data)
+{
+	xmms_bindata_cache_entry_t *entry = data;
+
+	xmmsv_unref (entry->value);
+	g_free (entry->hash);
+	g_free (entry);
+}
+
+/* Must be called with cache_lock held */
+static void
+xmms_bindata_cache_remove (xmms_bindata_t *bindata,
+                           xmms_bindata_cache_entry_t *entry)
+{
+	g_queue_delete_link (&bindata->cache_lru, entry->link);
+	bindata->cache_size -= entry->size;
+	g_hash_table_remove (bindata->cache, entry->hash);
+}
+
+/* Must be called with cache_lock held */
+static void
+xmms_bindata_cache_trim (xmms_bindata_t *bindata)
+{
+	while (bindata->cache_size > bindata->cache_limit) {
+		xmms_bindata_cache_remove (bindata, g_queue_peek_tail (&bindata->cache_lru));
+	}
+}
+
+/**
+ * Look for a blob in the cache. Returns a new reference to the shared
+ * value, or NULL and the generation to pass to xmms_bindata_cache_insert.
+ */
+static xmmsv_t *
+xmms_bindata_cache_lookup (xmms_bindata_t *bindata, const gchar *hash,
+                           guint *generation)
+{
+	xmms_bindata_cache_entry_t *entry;
+	xmmsv_t *ret = NULL;
+
+	g_mutex_lock (&bindata->cache_lock);
+
+	entry = g_hash_table_lookup (bindata->cache, hash);
+	if (entry) {
+		g_queue_unlink (&bindata->cache_lru, entry->link);
+		g_queue_push_head_link (&bindata->cache_lru, entry->link);
+		ret = xmmsv_ref (entry->value);
+		bindata->cache_hits++;
+	} else {
+		bindata->cache_misses++;
+	}
+
+	*generation = bindata->cache_generation;
+
+	g_mutex_unlock (&bindata->cache_lock);
+
+	return ret;
+}
+
+static void
+xmms_bindata_cache_insert (xmms_bindata_t *bindata, const gchar *hash,
+                           xmmsv_t *value, guint generation)
+{
+	xmms_bindata_cache_entry_t *entry;
+	const guchar *data;
+	guint size;
+
+	if (!xmmsv_get_bin (value, &data, &size)) {
+		return;
+	}
+
+	g_mutex_lock (&bindata->cache_lock);
+
+	/* Skip blobs that would not fit, that someone else has cached in
+	 * the meantime, or that were removed while we read them.
+	 */
+	if (size > bindata->cache_limit ||
+	    generation != bindata->cache_generation ||
+	    g_hash_table_lookup (bindata->cache, hash)) {
+		g_mutex_unlock (&bindata->cache_lock);
+		return;
+	}
+
+	/* handed to every client asking for it from now on */
+	xmmsv_freeze (value);
+
+	entry = g_new0 (xmms_bindata_cache_entry_t, 1);
+	entry->hash = g_strdup (hash);
+	entry->value = xmmsv_ref (value);
+	entry->size = size;
+
+	g_queue_push_head (&bindata->cache_lru, entry);
+	entry->link = g_queue_peek_head_link (&bindata->cache_lru);
+
+	g_hash_table_insert (bindata->cache, entry->hash, entry);
+	bindata->cache_size += size;
+
+	xmms_bindata_cache_trim (bindata);
+
+	g_mutex_unlock (&bindata->cache_lock);
+}
+
+static void
+xmms_bindata_cache_forget (xmms_bindata_t *bindata, const gchar *hash)
+{
+	xmms_bindata_cache_entry_t *entry;
+
+	g_mutex_lock (&bindata->cache_lock);
+
+	entry = g_hash_table_lookup (bindata->cache, hash);
+	if (entry) {
+		xmms_bindata_cache_remove (bindata, entry);
+	}
+	bindata->cache_generation++;
+
+	g_mutex_unlock (&bindata->cache_lock);
+}
+
 /*
   Copyright (C) 1999, 2000, 2002 Aladdin Enterprises.  All rights reserved.
 
@@ -1644,6 +1644,112 @@ xmms_collection_snapshot (xmms_coll_dag_t *dag)
 	return result;
 }
 
+/**
+ * Take a snapshot of a single collection, to be replayed on top of a
+ * full snapshot as returned by #xmms_collection_snapshot.
+ *
+ * @param dag  The collection DAG.
+ * @param name  The name of the collection.
+ * @param nsid  The namespace id of the collection.
+ * @return A dict with the namespace and name of the collection, a copy
+ * of the collection unless it has been removed, and the name of the
+ * active playlist.
+ */
+xmmsv_t *
+xmms_collection_snapshot_collection (xmms_coll_dag_t *dag, const gchar *name,
+                                     xmms_collection_namespace_id_t nsid)
+{
+	xmmsv_t *result, *coll, *active_playlist;
+	gchar *active_name;
+
+	result = xmmsv_new_dict ();
+
+	g_mutex_lock (&dag->mutex);
+
+	active_playlist = xmms_collection_get_pointer (dag, XMMS_ACTIVE_PLAYLIST,
+	                                               XMMS_COLLECTION_NSID_PLAYLISTS);
+
+	active_name = xmms_collection_find_alias (dag, XMMS_COLLECTION_NSID_PLAYLISTS,
+	                                          active_playlist, XMMS_ACTIVE_PLAYLIST);
+	if (active_name != NULL) {
+		xmmsv_dict_set_string (result, "active-playlist", active_name);
+	}
+
+	/* The active alias is never stored by name, only what it points to. */
+	if (nsid == XMMS_COLLECTION_NSID_PLAYLISTS &&
+	    strcmp (name, XMMS_ACTIVE_PLAYLIST) == 0) {
+		name = active_name;
+	}
+
+	if (name != NULL) {
+		xmmsv_dict_set_string (result, "namespace",
+		                       xmms_collection_get_namespace_string (nsid));
+		xmmsv_dict_set_string (result, "name", name);
+
+		coll = xmms_collection_get_pointer (dag, name, nsid);
+		if (coll != NULL) {
+			xmmsv_t *copy;
+
+			xmms_collection_apply_to_collection (dag, coll, unbind_all_references, NULL);
+			copy = xmmsv_copy (coll);
+			xmms_collection_apply_to_collection (dag, coll, bind_all_references, NULL);
+
+			xmmsv_dict_set (result, "collection", copy);
+			xmmsv_unref (copy);
+		}
+	}
+
+	g_mutex_unlock (&dag->mutex);
+
+	g_free (active_name);
+
+	return result;
+}
+
+/**
+ * Take a snapshot of the current position of a playlist, to be replayed
+ * on top of a full snapshot as returned by #xmms_collection_snapshot.
+ *
+ * @param dag  The collection DAG.
+ * @param name  The name of the playlist.
+ * @return A dict with the namespace and name of the playlist and its
+ * position, or NULL if there is no such playlist or it has no position.
+ */
+xmmsv_t *
+xmms_collection_snapshot_position (xmms_coll_dag_t *dag, const gchar *name)
+{
+	xmmsv_t *result = NULL, *coll;
+	gchar *active_name = NULL;
+	gint position;
+
+	g_mutex_lock (&dag->mutex);
+
+	/* The active alias is never stored by name, only what it points to. */
+	if (strcmp (name, XMMS_ACTIVE_PLAYLIST) == 0) {
+		coll = xmms_collection_get_pointer (dag, XMMS_ACTIVE_PLAYLIST,
+		                                    XMMS_COLLECTION_NSID_PLAYLISTS);
+		active_name = xmms_collection_find_alias (dag, XMMS_COLLECTION_NSID_PLAYLISTS,
+		                                          coll, XMMS_ACTIVE_PLAYLIST);
+		name = active_name;
+	}
+
+	if (name != NULL) {
+		coll = xmms_collection_get_pointer (dag, name, XMMS_COLLECTION_NSID_PLAYLISTS);
+		if (coll != NULL && xmms_collection_get_int_attr (coll, "position", &position)) {
+			result = xmmsv_build_dict (XMMSV_DICT_ENTRY_STR ("namespace", XMMS_COLLECTION_NS_PLAYLISTS),
+			                           XMMSV_DICT_ENTRY_STR ("name", name),
+			                           XMMSV_DICT_ENTRY_INT ("position", position),
+			                           XMMSV_DICT_END);
+		}
+	}
+
+	g_mutex_unlock (&dag->mutex);
+
+	g_free (active_name);
+
+	return result;
+}
+
 static void
 xmms_collection_restore_collection (const gchar *name, xmmsv_t *coll, void *udata)
 {
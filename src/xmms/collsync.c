@@ -18,6 +18,12 @@
 /** @file
  *  Manages the synchronization of collections to the database at 10 seconds
  *  after the last collections-change.
+ *
+ *  The database consists of a checkpoint holding a full snapshot of all
+ *  collections, and a journal next to it that the collections changed
+ *  since the checkpoint are appended to. Once the journal grows larger
+ *  than the checkpoint it is compacted into a new checkpoint. Moving the
+ *  current position of a playlist only journals the new position.
  */
 
 #include <xmmspriv/xmms_collsync.h>
@@ -28,6 +34,8 @@
 #include <xmms/xmms_log.h>
 
 #include <errno.h>
+#include <stdio.h>
+#include <string.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -35,7 +43,15 @@
 
 #define XMMS_COLL_SYNC_DELAY 10 * G_TIME_SPAN_SECOND
 
+/* Don't bother compacting journals smaller than this. */
+#define XMMS_COLL_SYNC_JOURNAL_MIN_SIZE (1024 * 1024)
+
 static void xmms_coll_sync_schedule_sync (xmms_object_t *object, xmmsv_t *val, gpointer udata);
+static void xmms_coll_sync_schedule_checkpoint (xmms_object_t *object, xmmsv_t *val, gpointer udata);
+static void xmms_coll_sync_collection_changed (xmms_object_t *object, xmmsv_t *val, gpointer udata);
+static void xmms_coll_sync_playlist_changed (xmms_object_t *object, xmmsv_t *val, gpointer udata);
+static void xmms_coll_sync_playlist_position_changed (xmms_object_t *object, xmmsv_t *val, gpointer udata);
+static void xmms_coll_sync_playlist_loaded (xmms_object_t *object, xmmsv_t *val, gpointer udata);
 static gpointer xmms_coll_sync_loop (gpointer udata);
 static void xmms_coll_sync_destroy (xmms_object_t *object);
 
@@ -68,6 +84,17 @@ struct xmms_coll_sync_St {
 	GCond cond;
 
 	xmms_coll_sync_state_t state;
+
+	/* names of the collections changed since the last sync, per namespace */
+	GHashTable *dirty[XMMS_COLLECTION_NUM_NAMESPACES];
+	/* names of the playlists whose position moved since the last sync */
+	GHashTable *positions;
+	/* set when the next sync must write a full checkpoint */
+	gboolean checkpoint;
+
+	gint64 generation;
+	gsize checkpoint_size;
+	gsize journal_size;
 };
 
 #include "collsync_ipc.c"
@@ -80,6 +107,7 @@ xmms_coll_sync_init (const gchar *uuid, xmms_coll_dag_t *dag, xmms_playlist_t *p
 {
 	xmms_coll_sync_t *sync;
 	gchar *path;
+	gint i;
 
 	sync = xmms_object_new (xmms_coll_sync_t, xmms_coll_sync_destroy);
 
@@ -88,6 +116,13 @@ xmms_coll_sync_init (const gchar *uuid, xmms_coll_dag_t *dag, xmms_playlist_t *p
 	g_cond_init (&sync->cond);
 	g_mutex_init (&sync->mutex);
 
+	for (i = 0; i < XMMS_COLLECTION_NUM_NAMESPACES; i++) {
+		sync->dirty[i] = g_hash_table_new_full (g_str_hash, g_str_equal,
+		                                        g_free, NULL);
+	}
+	sync->positions = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                         g_free, NULL);
+
 	xmms_object_ref (dag);
 	sync->dag = dag;
 
@@ -96,26 +131,26 @@ xmms_coll_sync_init (const gchar *uuid, xmms_coll_dag_t *dag, xmms_playlist_t *p
 
 	path = XMMS_BUILD_PATH ("collections", "${uuid}.db");
 	sync->config = xmms_config_property_register ("collection.directory", path,
-	                                              xmms_coll_sync_schedule_sync, sync);
+	                                              xmms_coll_sync_schedule_checkpoint, sync);
 	g_free (path);
 
 	/* Connection coll_sync_cb to some signals */
 	xmms_object_connect (XMMS_OBJECT (dag),
 	                     XMMS_IPC_SIGNAL_COLLECTION_CHANGED,
-	                     xmms_coll_sync_schedule_sync, sync);
+	                     xmms_coll_sync_collection_changed, sync);
 
 	/* FIXME: These signals should trigger COLLECTION_CHANGED */
 	xmms_object_connect (XMMS_OBJECT (playlist),
 	                     XMMS_IPC_SIGNAL_PLAYLIST_CHANGED,
-	                     xmms_coll_sync_schedule_sync, sync);
+	                     xmms_coll_sync_playlist_changed, sync);
 
 	xmms_object_connect (XMMS_OBJECT (playlist),
 	                     XMMS_IPC_SIGNAL_PLAYLIST_CURRENT_POS,
-	                     xmms_coll_sync_schedule_sync, sync);
+	                     xmms_coll_sync_playlist_position_changed, sync);
 
 	xmms_object_connect (XMMS_OBJECT (playlist),
 	                     XMMS_IPC_SIGNAL_PLAYLIST_LOADED,
-	                     xmms_coll_sync_schedule_sync, sync);
+	                     xmms_coll_sync_playlist_loaded, sync);
 
 	xmms_coll_sync_register_ipc_commands (XMMS_OBJECT (sync));
 
@@ -134,6 +169,7 @@ static void
 xmms_coll_sync_destroy (xmms_object_t *object)
 {
 	xmms_coll_sync_t *sync = (xmms_coll_sync_t *) object;
+	gint i;
 
 	g_return_if_fail (sync);
 
@@ -142,30 +178,35 @@ xmms_coll_sync_destroy (xmms_object_t *object)
 	xmms_coll_sync_unregister_ipc_commands ();
 
 	xmms_config_property_callback_remove (sync->config,
-	                                      xmms_coll_sync_schedule_sync,
+	                                      xmms_coll_sync_schedule_checkpoint,
 	                                      sync);
 
 	xmms_object_disconnect (XMMS_OBJECT (sync->playlist),
 	                        XMMS_IPC_SIGNAL_PLAYLIST_CHANGED,
-	                        xmms_coll_sync_schedule_sync, sync);
+	                        xmms_coll_sync_playlist_changed, sync);
 
 	xmms_object_disconnect (XMMS_OBJECT (sync->playlist),
 	                        XMMS_IPC_SIGNAL_PLAYLIST_CURRENT_POS,
-	                        xmms_coll_sync_schedule_sync, sync);
+	                        xmms_coll_sync_playlist_position_changed, sync);
 
 	xmms_object_disconnect (XMMS_OBJECT (sync->playlist),
 	                        XMMS_IPC_SIGNAL_PLAYLIST_LOADED,
-	                        xmms_coll_sync_schedule_sync, sync);
+	                        xmms_coll_sync_playlist_loaded, sync);
 
 	xmms_object_disconnect (XMMS_OBJECT (sync->dag),
 	                        XMMS_IPC_SIGNAL_COLLECTION_CHANGED,
-	                        xmms_coll_sync_schedule_sync, sync);
+	                        xmms_coll_sync_collection_changed, sync);
 
 	xmms_coll_sync_stop (sync);
 
 	xmms_object_unref (sync->playlist);
 	xmms_object_unref (sync->dag);
 
+	for (i = 0; i < XMMS_COLLECTION_NUM_NAMESPACES; i++) {
+		g_hash_table_unref (sync->dirty[i]);
+	}
+	g_hash_table_unref (sync->positions);
+
 	g_mutex_clear (&sync->mutex);
 	g_cond_clear (&sync->cond);
 	g_free (sync->uuid);
@@ -334,6 +375,12 @@ xmms_coll_sync_get_path (xmms_coll_sync_t *sync)
 	return g_string_free (result, FALSE);
 }
 
+static gchar *
+xmms_coll_sync_get_journal_path (const gchar *path)
+{
+	return g_strconcat (path, ".journal", NULL);
+}
+
 static void
 xmms_coll_sync_set_state (xmms_coll_sync_t *sync, xmms_coll_sync_state_t state)
 {
@@ -388,6 +435,131 @@ xmms_coll_sync_schedule_sync (xmms_object_t *object, xmmsv_t *val,
 	xmms_coll_sync_set_state (sync, XMMS_COLL_SYNC_STATE_DELAYED);
 }
 
+/**
+ * Schedule a synchronization that writes a full checkpoint, used when a
+ * change can't be expressed as a set of changed collections.
+ */
+static void
+xmms_coll_sync_schedule_checkpoint (xmms_object_t *object, xmmsv_t *val,
+                                    gpointer udata)
+{
+	xmms_coll_sync_t *sync = (xmms_coll_sync_t *) udata;
+
+	g_return_if_fail (sync);
+
+	g_mutex_lock (&sync->mutex);
+	sync->checkpoint = TRUE;
+	g_mutex_unlock (&sync->mutex);
+
+	xmms_coll_sync_set_state (sync, XMMS_COLL_SYNC_STATE_DELAYED);
+}
+
+/**
+ * Remember that a collection has changed and schedule a synchronization.
+ */
+static void
+xmms_coll_sync_mark_dirty (xmms_coll_sync_t *sync, const gchar *name,
+                           xmms_collection_namespace_id_t nsid)
+{
+	g_mutex_lock (&sync->mutex);
+	g_hash_table_add (sync->dirty[nsid], g_strdup (name));
+	g_mutex_unlock (&sync->mutex);
+
+	xmms_coll_sync_set_state (sync, XMMS_COLL_SYNC_STATE_DELAYED);
+}
+
+static void
+xmms_coll_sync_collection_changed (xmms_object_t *object, xmmsv_t *val,
+                                   gpointer udata)
+{
+	xmms_coll_sync_t *sync = (xmms_coll_sync_t *) udata;
+	xmms_collection_namespace_id_t nsid;
+	const gchar *name, *namespace;
+	gint type;
+
+	g_return_if_fail (sync);
+
+	if (!xmmsv_dict_entry_get_int (val, "type", &type) ||
+	    !xmmsv_dict_entry_get_string (val, "name", &name) ||
+	    !xmmsv_dict_entry_get_string (val, "namespace", &namespace)) {
+		xmms_coll_sync_schedule_checkpoint (object, val, udata);
+		return;
+	}
+
+	nsid = xmms_collection_get_namespace_id (namespace);
+
+	/* Renames and removals also rewrite the references held by other
+	 * collections, so they are not confined to a single collection.
+	 */
+	if (nsid == XMMS_COLLECTION_NSID_INVALID || nsid == XMMS_COLLECTION_NSID_ALL ||
+	    type == XMMS_COLLECTION_CHANGED_RENAME ||
+	    type == XMMS_COLLECTION_CHANGED_REMOVE) {
+		xmms_coll_sync_schedule_checkpoint (object, val, udata);
+		return;
+	}
+
+	xmms_coll_sync_mark_dirty (sync, name, nsid);
+}
+
+static void
+xmms_coll_sync_playlist_changed (xmms_object_t *object, xmmsv_t *val,
+                                 gpointer udata)
+{
+	xmms_coll_sync_t *sync = (xmms_coll_sync_t *) udata;
+	const gchar *name;
+
+	g_return_if_fail (sync);
+
+	if (!xmmsv_dict_entry_get_string (val, "name", &name)) {
+		xmms_coll_sync_schedule_checkpoint (object, val, udata);
+		return;
+	}
+
+	xmms_coll_sync_mark_dirty (sync, name, XMMS_COLLECTION_NSID_PLAYLISTS);
+}
+
+/**
+ * The current position moves with every track played, only remember
+ * the playlist it moved in rather than marking all of it dirty.
+ */
+static void
+xmms_coll_sync_playlist_position_changed (xmms_object_t *object, xmmsv_t *val,
+                                          gpointer udata)
+{
+	xmms_coll_sync_t *sync = (xmms_coll_sync_t *) udata;
+	const gchar *name;
+
+	g_return_if_fail (sync);
+
+	if (!xmmsv_dict_entry_get_string (val, "name", &name)) {
+		xmms_coll_sync_schedule_checkpoint (object, val, udata);
+		return;
+	}
+
+	g_mutex_lock (&sync->mutex);
+	g_hash_table_add (sync->positions, g_strdup (name));
+	g_mutex_unlock (&sync->mutex);
+
+	xmms_coll_sync_set_state (sync, XMMS_COLL_SYNC_STATE_DELAYED);
+}
+
+static void
+xmms_coll_sync_playlist_loaded (xmms_object_t *object, xmmsv_t *val,
+                                gpointer udata)
+{
+	xmms_coll_sync_t *sync = (xmms_coll_sync_t *) udata;
+	const gchar *name;
+
+	g_return_if_fail (sync);
+
+	if (!xmmsv_get_string (val, &name)) {
+		xmms_coll_sync_schedule_checkpoint (object, val, udata);
+		return;
+	}
+
+	xmms_coll_sync_mark_dirty (sync, name, XMMS_COLLECTION_NSID_PLAYLISTS);
+}
+
 /**
  * Schedule a collection-to-database-synchronization right away.
  */
@@ -399,32 +571,195 @@ xmms_coll_sync_client_sync (xmms_coll_sync_t *sync, xmms_error_t *err)
 	xmms_coll_sync_set_state (sync, XMMS_COLL_SYNC_STATE_IMMEDIATE);
 }
 
+static void
+xmms_coll_sync_journal_add_record (GString *records, xmmsv_t *record)
+{
+	xmmsv_t *serialized;
+	const guchar *buffer;
+	guint length;
+	guint32 header;
+
+	serialized = xmmsv_serialize (record);
+	xmmsv_get_bin (serialized, &buffer, &length);
+
+	header = GUINT32_TO_BE (length);
+	g_string_append_len (records, (const gchar *) &header, sizeof (header));
+	g_string_append_len (records, (const gchar *) buffer, length);
+
+	xmmsv_unref (serialized);
+}
+
+/**
+ * Append the current state of the changed collections, and the current
+ * position of the playlists it moved in, to the journal.
+ *
+ * @return FALSE if the journal could not be written or has grown too
+ * large, in which case a new checkpoint should be written instead.
+ */
+static gboolean
+xmms_coll_sync_journal_append (xmms_coll_sync_t *sync, const gchar *path,
+                               GHashTable **dirty, GHashTable *positions,
+                               GError **error)
+{
+	GHashTableIter iter;
+	GString *records;
+	gchar *journal, *name;
+	gboolean written = FALSE;
+	gsize limit;
+	FILE *fp;
+	gint i;
+
+	records = g_string_new (NULL);
+
+	/* The journal is only valid for the checkpoint it was started on. */
+	if (sync->journal_size == 0) {
+		xmmsv_t *header;
+
+		header = xmmsv_build_dict (XMMSV_DICT_ENTRY_INT ("generation", sync->generation),
+		                           XMMSV_DICT_END);
+		xmms_coll_sync_journal_add_record (records, header);
+		xmmsv_unref (header);
+	}
+
+	for (i = 0; i < XMMS_COLLECTION_NUM_NAMESPACES; i++) {
+		g_hash_table_iter_init (&iter, dirty[i]);
+		while (g_hash_table_iter_next (&iter, (gpointer *) &name, NULL)) {
+			xmmsv_t *record;
+
+			record = xmms_collection_snapshot_collection (sync->dag, name, i);
+			xmms_coll_sync_journal_add_record (records, record);
+			xmmsv_unref (record);
+		}
+	}
+
+	g_hash_table_iter_init (&iter, positions);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &name, NULL)) {
+		xmmsv_t *record;
+
+		/* already written along with the rest of the playlist */
+		if (g_hash_table_contains (dirty[XMMS_COLLECTION_NSID_PLAYLISTS], name)) {
+			continue;
+		}
+
+		record = xmms_collection_snapshot_position (sync->dag, name);
+		if (record != NULL) {
+			xmms_coll_sync_journal_add_record (records, record);
+			xmmsv_unref (record);
+		}
+	}
+
+	limit = MAX (sync->checkpoint_size, XMMS_COLL_SYNC_JOURNAL_MIN_SIZE);
+	if (sync->journal_size + records->len > limit) {
+		g_string_free (records, TRUE);
+		return FALSE;
+	}
+
+	journal = xmms_coll_sync_get_journal_path (path);
+
+	fp = g_fopen (journal, "ab");
+	if (fp != NULL) {
+		written = fwrite (records->str, 1, records->len, fp) == records->len;
+		written = fclose (fp) == 0 && written;
+	}
+
+	if (!written) {
+		g_set_error (error, G_FILE_ERROR,
+		             g_file_error_from_errno (errno),
+		             "Could not write '%s': %s", journal, g_strerror (errno));
+	} else {
+		sync->journal_size += records->len;
+	}
+
+	g_free (journal);
+	g_string_free (records, TRUE);
+
+	return written;
+}
+
+/**
+ * Write a full snapshot of all collections and start a new journal.
+ */
+static gboolean
+xmms_coll_sync_checkpoint (xmms_coll_sync_t *sync, const gchar *path,
+                           GError **error)
+{
+	xmmsv_t *snapshot, *serialized;
+	const guchar *buffer;
+	gchar *journal;
+	gint64 generation;
+	guint length;
+	gboolean ret;
+
+	generation = MAX (g_get_real_time (), sync->generation + 1);
+
+	snapshot = xmms_collection_snapshot (sync->dag);
+	xmmsv_dict_set_int (snapshot, "generation", generation);
+
+	serialized = xmmsv_serialize (snapshot);
+	xmmsv_unref (snapshot);
+
+	xmmsv_get_bin (serialized, &buffer, &length);
+
+	ret = g_file_set_contents (path, (const gchar *) buffer, (gssize) length, error);
+	if (ret) {
+		journal = xmms_coll_sync_get_journal_path (path);
+		g_unlink (journal);
+		g_free (journal);
+
+		sync->generation = generation;
+		sync->checkpoint_size = length;
+		sync->journal_size = 0;
+	}
+
+	xmmsv_unref (serialized);
+
+	return ret;
+}
+
 static void
 xmms_coll_sync_save (xmms_coll_sync_t *sync)
 {
+	GHashTable *dirty[XMMS_COLLECTION_NUM_NAMESPACES];
+	GHashTable *positions;
+	GHashTableIter iter;
 	GError *error = NULL;
+	gboolean checkpoint, saved = FALSE;
+	gchar *name;
+	gint i;
 
 	gchar *path = xmms_coll_sync_get_path (sync);
 
+	g_mutex_lock (&sync->mutex);
+	for (i = 0; i < XMMS_COLLECTION_NUM_NAMESPACES; i++) {
+		dirty[i] = sync->dirty[i];
+		sync->dirty[i] = g_hash_table_new_full (g_str_hash, g_str_equal,
+		                                        g_free, NULL);
+	}
+	positions = sync->positions;
+	sync->positions = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                         g_free, NULL);
+	checkpoint = sync->checkpoint;
+	sync->checkpoint = FALSE;
+	g_mutex_unlock (&sync->mutex);
+
 	XMMS_DBG ("Syncing collections to '%s'.", path);
 
 	if (xmms_coll_sync_prepare_path (path, &error)) {
-		xmmsv_t *snapshot, *serialized;
-		const guchar *buffer;
-		guint length;
-
-		snapshot = xmms_collection_snapshot (sync->dag);
-
-		serialized = xmmsv_serialize (snapshot);
-		xmmsv_unref (snapshot);
-
-		xmmsv_get_bin (serialized, &buffer, &length);
+		if (!checkpoint && sync->checkpoint_size > 0) {
+			checkpoint = !xmms_coll_sync_journal_append (sync, path, dirty,
+			                                             positions, &error);
+			if (error != NULL) {
+				XMMS_DBG ("Could not append to collection journal: %s", error->message);
+				g_clear_error (&error);
+			}
+		} else {
+			checkpoint = TRUE;
+		}
 
-		if (!g_file_set_contents (path, (const gchar *) buffer, (gssize) length, &error)) {
+		saved = !checkpoint || xmms_coll_sync_checkpoint (sync, path, &error);
+		if (!saved) {
 			xmms_log_error ("Could not save collections to disk.");
 		}
-
-		xmmsv_unref (serialized);
 	}
 
 	if (error != NULL) {
@@ -432,9 +767,151 @@ xmms_coll_sync_save (xmms_coll_sync_t *sync)
 		g_error_free (error);
 	}
 
+	/* Nothing made it to disk, so retry these changes on the next sync. */
+	if (!saved) {
+		g_mutex_lock (&sync->mutex);
+		for (i = 0; i < XMMS_COLLECTION_NUM_NAMESPACES; i++) {
+			g_hash_table_iter_init (&iter, dirty[i]);
+			while (g_hash_table_iter_next (&iter, (gpointer *) &name, NULL)) {
+				g_hash_table_add (sync->dirty[i], g_strdup (name));
+			}
+		}
+		g_hash_table_iter_init (&iter, positions);
+		while (g_hash_table_iter_next (&iter, (gpointer *) &name, NULL)) {
+			g_hash_table_add (sync->positions, g_strdup (name));
+		}
+		sync->checkpoint = sync->checkpoint || checkpoint;
+		g_mutex_unlock (&sync->mutex);
+	}
+
+	for (i = 0; i < XMMS_COLLECTION_NUM_NAMESPACES; i++) {
+		g_hash_table_unref (dirty[i]);
+	}
+	g_hash_table_unref (positions);
+
 	g_free (path);
 }
 
+/**
+ * Apply a journal record on top of a snapshot.
+ */
+static void
+xmms_coll_sync_journal_apply (xmmsv_t *snapshot, xmmsv_t *record)
+{
+	xmms_collection_namespace_id_t nsid;
+	const gchar *name, *namespace, *active;
+	xmmsv_t *collections, *coll;
+	const gchar *key;
+	gint position;
+
+	if (xmmsv_dict_entry_get_string (record, "active-playlist", &active)) {
+		xmmsv_dict_set_string (snapshot, "active-playlist", active);
+	}
+
+	if (!xmmsv_dict_entry_get_string (record, "name", &name) ||
+	    !xmmsv_dict_entry_get_string (record, "namespace", &namespace)) {
+		return;
+	}
+
+	nsid = xmms_collection_get_namespace_id (namespace);
+	if (nsid == XMMS_COLLECTION_NSID_COLLECTIONS) {
+		key = "collections";
+	} else if (nsid == XMMS_COLLECTION_NSID_PLAYLISTS) {
+		key = "playlists";
+	} else {
+		return;
+	}
+
+	if (!xmmsv_dict_get (snapshot, key, &collections)) {
+		collections = xmmsv_new_dict ();
+		xmmsv_dict_set (snapshot, key, collections);
+		xmmsv_unref (collections);
+	}
+
+	if (xmmsv_dict_get (record, "collection", &coll)) {
+		xmmsv_dict_set (collections, name, coll);
+	} else if (xmmsv_dict_entry_get_int (record, "position", &position)) {
+		if (xmmsv_dict_get (collections, name, &coll)) {
+			xmms_collection_set_int_attr (coll, "position", position);
+		}
+	} else {
+		xmmsv_dict_remove (collections, name);
+	}
+}
+
+/**
+ * Replay the journal belonging to the checkpoint on top of its snapshot.
+ */
+static void
+xmms_coll_sync_journal_replay (xmms_coll_sync_t *sync, const gchar *path,
+                               xmmsv_t *snapshot)
+{
+	gchar *journal, *buffer;
+	gsize length, offset;
+	int64_t generation;
+	gboolean stale = FALSE;
+
+	sync->journal_size = 0;
+
+	journal = xmms_coll_sync_get_journal_path (path);
+
+	if (!g_file_get_contents (journal, &buffer, &length, NULL)) {
+		g_free (journal);
+		return;
+	}
+
+	for (offset = 0; offset + sizeof (guint32) <= length; ) {
+		xmmsv_t *serialized, *record;
+		guint32 size;
+
+		memcpy (&size, buffer + offset, sizeof (size));
+		size = GUINT32_FROM_BE (size);
+
+		/* Partially written record, probably due to a crash. */
+		if (size > length - offset - sizeof (size))
+			break;
+
+		serialized = xmmsv_new_bin ((const guchar *) buffer + offset + sizeof (size), size);
+		record = xmmsv_deserialize (serialized);
+		xmmsv_unref (serialized);
+
+		if (record == NULL)
+			break;
+
+		if (offset == 0) {
+			if (!xmmsv_dict_entry_get_int64 (record, "generation", &generation) ||
+			    generation != sync->generation) {
+				stale = TRUE;
+				xmmsv_unref (record);
+				break;
+			}
+		} else {
+			xmms_coll_sync_journal_apply (snapshot, record);
+		}
+
+		xmmsv_unref (record);
+
+		offset += sizeof (size) + size;
+	}
+
+	if (stale) {
+		/* Left behind when a crash interrupted a checkpoint, which already
+		 * holds everything in it, so start over with an empty journal.
+		 */
+		XMMS_DBG ("Discarding collection journal of another checkpoint.");
+		g_unlink (journal);
+	} else if (offset == length) {
+		sync->journal_size = length;
+	} else {
+		/* Don't append to a broken journal, replace it on the next sync. */
+		xmms_log_error ("Collection journal '%s' is damaged, changes may have been lost.", journal);
+		sync->checkpoint = TRUE;
+	}
+
+	g_free (buffer);
+	g_free (journal);
+}
+
 static void
 xmms_coll_sync_restore (xmms_coll_sync_t *sync, gboolean sad_hack)
 {
@@ -457,6 +934,8 @@ xmms_coll_sync_restore (xmms_coll_sync_t *sync, gboolean sad_hack)
 			snapshot = xmmsv_deserialize (serialized);
 			xmmsv_unref (serialized);
 
+			sync->checkpoint_size = length;
+
 			/* TODO: Remove me, nasty hack because the new serialization
 			 * got merged a bit too early and now is not the time to add
 			 * versioning, should be removed before release.
@@ -480,6 +959,13 @@ xmms_coll_sync_restore (xmms_coll_sync_t *sync, gboolean sad_hack)
 	}
 
 	if (snapshot != NULL) {
+		int64_t generation = 0;
+
+		xmmsv_dict_entry_get_int64 (snapshot, "generation", &generation);
+		sync->generation = generation;
+
+		xmms_coll_sync_journal_replay (sync, path, snapshot);
+
 		xmms_collection_restore (sync->dag, snapshot);
 		xmmsv_unref (snapshot);
 	} else {
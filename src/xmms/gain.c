@@ -0,0 +1,293 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+/**
+ * @file
+ * Gain stage shared by the effect plugins.
+ *
+ * All gain factors of a stage are folded into a single multiplier, and
+ * the multiplication, the ramp between gain changes and the saturation
+ * to the sample range are done in one pass over the buffer. The steady
+ * state loops are kept free of branches and calls so that the compiler
+ * can vectorize them.
+ */
+
+#include <glib.h>
+#include <xmms/xmms_sample.h>
+
+#if defined(__GNUC__) && !defined(__clang__)
+/* the very cheap cost model gcc uses at -O2 leaves these loops scalar */
+# define GAIN_VECTORIZE \
+	__attribute__ ((optimize ("tree-vectorize", "vect-cost-model=cheap")))
+#else
+# define GAIN_VECTORIZE
+#endif
+
+struct xmms_sample_gain_St {
+	xmms_sample_format_t format;
+	gint channels;
+
+	/** gain applied to the next frame */
+	gfloat current;
+	/** gain to reach once the ramp is done */
+	gfloat target;
+	/** per frame increment while ramping */
+	gfloat step;
+	/** frames left of the current ramp */
+	gint remaining;
+};
+
+/* Unsigned formats are scaled around their midpoint, the float formats
+ * are left unclipped like everywhere else in the chain.
+ */
+#define GAIN_INT_FUNCS(name, type, calc_t, min, max, bias) \
+static GAIN_VECTORIZE void \
+gain_flat_##name (void *buf, gint n, gfloat gain) \
+{ \
+	type *samples = buf; \
+	calc_t g = gain; \
+	gint i; \
+\
+	for (i = 0; i < n; i++) { \
+		calc_t v = ((calc_t) samples[i] - (bias)) * g + (bias); \
+		v = v < (min) ? (min) : v; \
+		v = v > (max) ? (max) : v; \
+		samples[i] = (type) v; \
+	} \
+} \
+\
+static GAIN_VECTORIZE void \
+gain_ramp_##name (void *buf, gint frames, gint channels, \
+                  gfloat *gain, gfloat step) \
+{ \
+	type *samples = buf; \
+	gint i, c; \
+\
+	for (i = 0; i < frames; i++) { \
+		calc_t g = *gain; \
+		for (c = 0; c < channels; c++, samples++) { \
+			calc_t v = ((calc_t) *samples - (bias)) * g + (bias); \
+			v = v < (min) ? (min) : v; \
+			v = v > (max) ? (max) : v; \
+			*samples = (type) v; \
+		} \
+		*gain += step; \
+	} \
+}
+
+#define GAIN_FLOAT_FUNCS(name, type) \
+static GAIN_VECTORIZE void \
+gain_flat_##name (void *buf, gint n, gfloat gain) \
+{ \
+	type *samples = buf; \
+	gint i; \
+\
+	for (i = 0; i < n; i++) { \
+		samples[i] *= gain; \
+	} \
+} \
+\
+static GAIN_VECTORIZE void \
+gain_ramp_##name (void *buf, gint frames, gint channels, \
+                  gfloat *gain, gfloat step) \
+{ \
+	type *samples = buf; \
+	gint i, c; \
+\
+	for (i = 0; i < frames; i++) { \
+		for (c = 0; c < channels; c++, samples++) { \
+			*samples *= *gain; \
+		} \
+		*gain += step; \
+	} \
+}
+
+GAIN_INT_FUNCS (s8, xmms_samples8_t, gfloat,
+                XMMS_SAMPLES8_MIN, XMMS_SAMPLES8_MAX, 0)
+GAIN_INT_FUNCS (u8, xmms_sampleu8_t, gfloat,
+                0, XMMS_SAMPLEU8_MAX, 128)
+GAIN_INT_FUNCS (s16, xmms_samples16_t, gfloat,
+                XMMS_SAMPLES16_MIN, XMMS_SAMPLES16_MAX, 0)
+GAIN_INT_FUNCS (u16, xmms_sampleu16_t, gfloat,
+                0, XMMS_SAMPLEU16_MAX, 32768)
+GAIN_INT_FUNCS (s32, xmms_samples32_t, gdouble,
+                XMMS_SAMPLES32_MIN, XMMS_SAMPLES32_MAX, 0)
+GAIN_INT_FUNCS (u32, xmms_sampleu32_t, gdouble,
+                0, XMMS_SAMPLEU32_MAX, 2147483648.0)
+GAIN_FLOAT_FUNCS (float, xmms_samplefloat_t)
+GAIN_FLOAT_FUNCS (double, xmms_sampledouble_t)
+
+/**
+ * Create a new gain stage.
+ *
+ * @param format the sample format of the buffers to process
+ * @param channels number of interleaved channels
+ * @return a gain stage starting at unity gain, or NULL if the format
+ * is not supported
+ */
+xmms_sample_gain_t *
+xmms_sample_gain_new (xmms_sample_format_t format, gint channels)
+{
+	xmms_sample_gain_t *gain;
+
+	g_return_val_if_fail (channels > 0, NULL);
+
+	if (xmms_sample_size_get (format) <= 0) {
+		return NULL;
+	}
+
+	gain = g_new0 (xmms_sample_gain_t, 1);
+	gain->format = format;
+	gain->channels = channels;
+	gain->current = gain->target = 1.0;
+
+	return gain;
+}
+
+void
+xmms_sample_gain_free (xmms_sample_gain_t *gain)
+{
+	g_free (gain);
+}
+
+/**
+ * Change the gain.
+ *
+ * @param gain the gain stage
+ * @param value the new gain factor
+ * @param ramp number of frames over which the change is spread, 0 to
+ * apply it immediately
+ */
+void
+xmms_sample_gain_set (xmms_sample_gain_t *gain, gfloat value, gint ramp)
+{
+	g_return_if_fail (gain);
+
+	if (value == gain->target) {
+		return;
+	}
+
+	gain->target = value;
+
+	if (ramp > 0) {
+		gain->remaining = ramp;
+		gain->step = (gain->target - gain->current) / ramp;
+	} else {
+		gain->remaining = 0;
+		gain->current = value;
+	}
+}
+
+/**
+ * Get the gain the stage is at or ramping towards.
+ */
+gfloat
+xmms_sample_gain_get (xmms_sample_gain_t *gain)
+{
+	g_return_val_if_fail (gain, 1.0);
+
+	return gain->target;
+}
+
+/**
+ * Check if applying the stage would leave the samples unchanged.
+ */
+gboolean
+xmms_sample_gain_is_unity (xmms_sample_gain_t *gain)
+{
+	g_return_val_if_fail (gain, TRUE);
+
+	return gain->remaining == 0 && gain->current == 1.0;
+}
+
+/**
+ * Apply the gain to a buffer of interleaved samples.
+ *
+ * @param gain the gain stage
+ * @param buf samples, modified in place
+ * @param len length of buf in bytes
+ */
+void
+xmms_sample_gain_apply (xmms_sample_gain_t *gain, xmms_sample_t *buf, gint len)
+{
+	void (*flat) (void *, gint, gfloat);
+	void (*ramp) (void *, gint, gint, gfloat *, gfloat);
+	gint sample_size, frames, n;
+
+	g_return_if_fail (gain);
+	g_return_if_fail (buf);
+
+	switch (gain->format) {
+		case XMMS_SAMPLE_FORMAT_S8:
+			flat = gain_flat_s8;
+			ramp = gain_ramp_s8;
+			break;
+		case XMMS_SAMPLE_FORMAT_U8:
+			flat = gain_flat_u8;
+			ramp = gain_ramp_u8;
+			break;
+		case XMMS_SAMPLE_FORMAT_S16:
+			flat = gain_flat_s16;
+			ramp = gain_ramp_s16;
+			break;
+		case XMMS_SAMPLE_FORMAT_U16:
+			flat = gain_flat_u16;
+			ramp = gain_ramp_u16;
+			break;
+		case XMMS_SAMPLE_FORMAT_S32:
+			flat = gain_flat_s32;
+			ramp = gain_ramp_s32;
+			break;
+		case XMMS_SAMPLE_FORMAT_U32:
+			flat = gain_flat_u32;
+			ramp = gain_ramp_u32;
+			break;
+		case XMMS_SAMPLE_FORMAT_FLOAT:
+			flat = gain_flat_float;
+			ramp = gain_ramp_float;
+			break;
+		case XMMS_SAMPLE_FORMAT_DOUBLE:
+			flat = gain_flat_double;
+			ramp = gain_ramp_double;
+			break;
+		default:
+			g_return_if_reached ();
+	}
+
+	sample_size = xmms_sample_size_get (gain->format);
+	frames = len / (sample_size * gain->channels);
+
+	if (gain->remaining > 0) {
+		n = MIN (frames, gain->remaining);
+
+		ramp (buf, n, gain->channels, &gain->current, gain->step);
+
+		gain->remaining -= n;
+		if (gain->remaining == 0) {
+			/* don't let rounding errors of the steps stick around */
+			gain->current = gain->target;
+		}
+
+		n *= sample_size * gain->channels;
+		buf = (guchar *) buf + n;
+		len -= n;
+	}
+
+	/* a trailing partial frame still gets the current gain */
+	if (len >= sample_size && gain->current != 1.0) {
+		flat (buf, len / sample_size, gain->current);
+	}
+}
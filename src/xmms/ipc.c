@@ -83,6 +83,14 @@ typedef struct xmms_ipc_client_St {
 	guint pendingsignals[XMMS_IPC_SIGNAL_END];
 	GList *broadcasts[XMMS_IPC_SIGNAL_END];
 
+	/** minimum time between two deliveries of a signal, in microseconds */
+	gint64 signal_interval[XMMS_IPC_SIGNAL_END];
+	/** when each signal was last delivered */
+	gint64 signal_sent[XMMS_IPC_SIGNAL_END];
+	/** latest value held back until the interval has passed */
+	xmmsv_t *signal_held[XMMS_IPC_SIGNAL_END];
+	GSource *signal_timer[XMMS_IPC_SIGNAL_END];
+
 	gint32 id;
 } xmms_ipc_client_t;
 
@@ -106,6 +114,7 @@ static void xmms_ipc_register_signal (xmms_ipc_client_t *client, xmms_ipc_msg_t
 static void xmms_ipc_register_broadcast (xmms_ipc_client_t *client, xmms_ipc_msg_t *msg, xmmsv_t *arguments);
 static gboolean xmms_ipc_client_msg_write (xmms_ipc_client_t *client, xmms_ipc_msg_t *msg);
 static gboolean xmms_ipc_client_broadcast_write (guint broadcastid, xmms_ipc_client_t *cli, xmmsv_t *arg);
+static void xmms_ipc_client_signal_write (xmms_ipc_client_t *cli, guint signalid, xmmsv_t *arg);
 
 #include "ipc_manager_ipc.c"
 
@@ -122,7 +131,7 @@ xmms_ipc_register_signal (xmms_ipc_client_t *client,
                           xmms_ipc_msg_t *msg, xmmsv_t *arguments)
 {
 	xmmsv_t *arg;
-	gint32 signalid;
+	gint32 signalid, interval = 0;
 	int r;
 
 	if (!arguments || !xmmsv_list_get (arguments, 0, &arg)) {
@@ -142,8 +151,25 @@ xmms_ipc_register_signal (xmms_ipc_client_t *client,
 		return;
 	}
 
+	/* clients may ask for the signal to be delivered at most once
+	 * every interval milliseconds, older servers ignore this
+	 */
+	if (xmmsv_list_get (arguments, 1, &arg) &&
+	    (!xmmsv_get_int32 (arg, &interval) || interval < 0)) {
+		xmms_log_error ("Bad signal interval");
+		return;
+	}
+
 	g_mutex_lock (&client->lock);
 	client->pendingsignals[signalid] = xmms_ipc_msg_get_cookie (msg);
+	client->signal_interval[signalid] = (gint64) interval * 1000;
+
+	if (client->signal_held[signalid] && !client->signal_timer[signalid]) {
+		xmms_ipc_client_signal_write (client, signalid,
+		                              client->signal_held[signalid]);
+		xmmsv_unref (client->signal_held[signalid]);
+		client->signal_held[signalid] = NULL;
+	}
 	g_mutex_unlock (&client->lock);
 }
 
@@ -450,6 +476,14 @@ xmms_ipc_client_destroy (xmms_ipc_client_t *client)
 
 	for (i = 0; i < XMMS_IPC_SIGNAL_END; i++) {
 		g_list_free (client->broadcasts[i]);
+
+		if (client->signal_timer[i]) {
+			g_source_destroy (client->signal_timer[i]);
+			g_source_unref (client->signal_timer[i]);
+		}
+		if (client->signal_held[i]) {
+			xmmsv_unref (client->signal_held[i]);
+		}
 	}
 
 	g_mutex_unlock (&client->lock);
@@ -704,13 +738,104 @@ xmms_ipc_has_pending (guint signalid)
 	return FALSE;
 }
 
+/**
+ * Send a signal to a single client.
+ * Should hold cli->lock.
+ */
+static void
+xmms_ipc_client_signal_write (xmms_ipc_client_t *cli, guint signalid,
+                              xmmsv_t *arg)
+{
+	xmms_ipc_msg_t *msg;
+
+	msg = xmms_ipc_msg_new (XMMS_IPC_OBJECT_SIGNAL, XMMS_IPC_COMMAND_SIGNAL);
+	xmms_ipc_msg_set_cookie (msg, cli->pendingsignals[signalid]);
+	xmms_ipc_handle_cmd_value (msg, arg);
+	xmms_ipc_client_msg_write (cli, msg);
+
+	cli->pendingsignals[signalid] = 0;
+	cli->signal_sent[signalid] = g_get_monotonic_time ();
+}
+
+typedef struct xmms_ipc_signal_timer_St {
+	xmms_ipc_client_t *client;
+	guint signalid;
+} xmms_ipc_signal_timer_t;
+
+/**
+ * Runs in the client thread once the interval of a held back
+ * signal has passed.
+ */
+static gboolean
+xmms_ipc_client_signal_timeout (gpointer data)
+{
+	xmms_ipc_signal_timer_t *timer = data;
+	xmms_ipc_client_t *cli = timer->client;
+	guint signalid = timer->signalid;
+
+	g_mutex_lock (&cli->lock);
+
+	/* if the client hasn't asked for the signal again yet, the value
+	 * is sent as soon as it does
+	 */
+	if (cli->signal_held[signalid] && cli->pendingsignals[signalid]) {
+		xmms_ipc_client_signal_write (cli, signalid,
+		                              cli->signal_held[signalid]);
+		xmmsv_unref (cli->signal_held[signalid]);
+		cli->signal_held[signalid] = NULL;
+	}
+
+	g_source_unref (cli->signal_timer[signalid]);
+	cli->signal_timer[signalid] = NULL;
+
+	g_mutex_unlock (&cli->lock);
+
+	return FALSE;
+}
+
+/**
+ * Keep only the latest value of a signal that came too early, and
+ * deliver it when the interval the client asked for has passed.
+ * Should hold cli->lock.
+ */
+static void
+xmms_ipc_client_signal_hold (xmms_ipc_client_t *cli, guint signalid,
+                             xmmsv_t *arg, gint64 delay)
+{
+	xmms_ipc_signal_timer_t *timer;
+	GMainContext *context;
+	GSource *source;
+
+	if (cli->signal_held[signalid]) {
+		xmmsv_unref (cli->signal_held[signalid]);
+	}
+	cli->signal_held[signalid] = xmmsv_ref (arg);
+
+	if (cli->signal_timer[signalid]) {
+		return;
+	}
+
+	timer = g_new (xmms_ipc_signal_timer_t, 1);
+	timer->client = cli;
+	timer->signalid = signalid;
+
+	context = g_main_loop_get_context (cli->ml);
+	source = g_timeout_source_new ((delay + 999) / 1000);
+	g_source_set_callback (source, xmms_ipc_client_signal_timeout,
+	                       timer, g_free);
+	g_source_attach (source, context);
+	cli->signal_timer[signalid] = source;
+
+	g_main_context_wakeup (context);
+}
+
 static void
 xmms_ipc_signal_cb (xmms_object_t *object, xmmsv_t *arg, gpointer userdata)
 {
 	GList *c, *s;
 	guint signalid = GPOINTER_TO_UINT (userdata);
 	xmms_ipc_t *ipc;
-	xmms_ipc_msg_t *msg;
+	gint64 now = g_get_monotonic_time ();
 
 	g_mutex_lock (&ipc_servers_lock);
 
@@ -719,13 +844,16 @@ xmms_ipc_signal_cb (xmms_object_t *object, xmmsv_t *arg, gpointer userdata)
 		g_mutex_lock (&ipc->mutex_lock);
 		for (c = ipc->clients; c; c = g_list_next (c)) {
 			xmms_ipc_client_t *cli = c->data;
+			gint64 next;
+
 			g_mutex_lock (&cli->lock);
 			if (cli->pendingsignals[signalid]) {
-				msg = xmms_ipc_msg_new (XMMS_IPC_OBJECT_SIGNAL, XMMS_IPC_COMMAND_SIGNAL);
-				xmms_ipc_msg_set_cookie (msg, cli->pendingsignals[signalid]);
-				xmms_ipc_handle_cmd_value (msg, arg);
-				xmms_ipc_client_msg_write (cli, msg);
-				cli->pendingsignals[signalid] = 0;
+				next = cli->signal_sent[signalid] + cli->signal_interval[signalid];
+				if (cli->signal_interval[signalid] && now < next) {
+					xmms_ipc_client_signal_hold (cli, signalid, arg, next - now);
+				} else {
+					xmms_ipc_client_signal_write (cli, signalid, arg);
+				}
 			}
 			g_mutex_unlock (&cli->lock);
 		}
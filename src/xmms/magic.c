@@ -90,12 +90,51 @@ typedef struct xmms_magic_entry_St {
 	} value;
 } xmms_magic_entry_t;
 
+/*
+ * The trees are compiled into flat arrays when they are added, so that
+ * detection can peek the longest prefix any test needs once and then
+ * run through every tree without going back to the xform.
+ */
+
+/* A value read from the stream, shared by all tests that read the same
+ * number of bytes at the same offset in the same byte order. */
+typedef struct xmms_magic_field_St {
+	guint offset;
+	guint len;
+	gint endian;
+} xmms_magic_field_t;
+
+typedef struct xmms_magic_test_St {
+	const xmms_magic_entry_t *entry;
+	gint field; /* -1 for strings */
+	gint child; /* first child, -1 if none */
+	gint next; /* next sibling, -1 if none */
+} xmms_magic_test_t;
+
+typedef struct xmms_magic_set_St {
+	gint first; /* first top level test */
+	gpointer *data; /* description and mimetype of the tree */
+} xmms_magic_set_t;
+
+typedef struct xmms_magic_compiled_St {
+	GArray *fields;
+	GArray *tests;
+	GArray *sets;
+	guint needed;
+	gint ref;
+} xmms_magic_compiled_t;
+
+/* Adding a tree swaps in a new compiled set under the lock, detection
+ * holds a reference to the one it started with. */
+static GMutex magic_lock;
+static xmms_magic_compiled_t *magic_compiled;
+
 typedef struct xmms_magic_checker_St {
-	xmms_xform_t *xform;
+	const xmms_magic_compiled_t *magic;
 	gchar *buf;
-	guint alloc;
 	guint read;
-	guint offset;
+	guint32 *values;
+	guint8 *loaded;
 	gint dumpcount;
 } xmms_magic_checker_t;
 
@@ -343,62 +382,68 @@ xmms_magic_add_node (GNode *tree, const gchar *s, GNode *prev_node)
 	}
 }
 
-static gint
-read_data (xmms_magic_checker_t *c, guint needed)
+static guint32
+field_value (xmms_magic_checker_t *c, gint idx)
 {
-	xmms_error_t e;
+	const xmms_magic_field_t *field;
+	const gchar *ptr;
+	guint8 i8;
+	guint16 i16;
+	guint32 i32;
 
-	if (needed > c->alloc) {
-		c->alloc = needed;
-		c->buf = g_realloc (c->buf, c->alloc);
+	if (c->loaded[idx]) {
+		return c->values[idx];
 	}
 
-	xmms_error_reset (&e);
+	field = &g_array_index (c->magic->fields, xmms_magic_field_t, idx);
+	ptr = &c->buf[field->offset];
 
-	return xmms_xform_peek (c->xform, c->buf, needed, &e);
+	switch (field->len) {
+		case 1:
+			memcpy (&i8, ptr, sizeof (i8));
+			i32 = i8;
+			break;
+		case 2:
+			memcpy (&i16, ptr, sizeof (i16));
+			SWAP16 (i16, field->endian);
+			i32 = i16;
+			break;
+		default:
+			memcpy (&i32, ptr, sizeof (i32));
+			SWAP32 (i32, field->endian);
+			break;
+	}
+
+	c->values[idx] = i32;
+	c->loaded[idx] = TRUE;
+
+	return i32;
 }
 
 static gboolean
-node_match (xmms_magic_checker_t *c, GNode *node)
+test_match (xmms_magic_checker_t *c, const xmms_magic_test_t *test)
 {
-	xmms_magic_entry_t *entry = node->data;
-	guint needed = c->offset + entry->offset + entry->len;
-	guint8 i8;
-	guint16 i16;
-	guint32 i32;
-	gint tmp;
-	gchar *ptr;
-
-	/* do we have enough data ready for this check?
-	 * if not, read some more
-	 */
-	if (c->read < needed) {
-		tmp = read_data (c, needed);
-		if (tmp == -1) {
-			return FALSE;
-		}
+	const xmms_magic_entry_t *entry = test->entry;
+	const gchar *ptr;
+	guint32 v;
 
-		c->read = tmp;
-		if (c->read < needed) {
-			/* couldn't read enough data */
-			return FALSE;
-		}
+	/* the stream ended before the data this test looks at */
+	if (c->read < entry->offset + entry->len) {
+		return FALSE;
 	}
 
-	ptr = &c->buf[c->offset + entry->offset];
+	ptr = &c->buf[entry->offset];
 
 	switch (entry->type) {
 		case XMMS_MAGIC_ENTRY_TYPE_BYTE:
-			memcpy (&i8, ptr, sizeof (i8));
-			CMP (i8, entry, entry->value.i8); /* returns */
+			v = field_value (c, test->field);
+			CMP (v, entry, entry->value.i8); /* returns */
 		case XMMS_MAGIC_ENTRY_TYPE_INT16:
-			memcpy (&i16, ptr, sizeof (i16));
-			SWAP16 (i16, entry->endian);
-			CMP (i16, entry, entry->value.i16); /* returns */
+			v = field_value (c, test->field);
+			CMP (v, entry, entry->value.i16); /* returns */
 		case XMMS_MAGIC_ENTRY_TYPE_INT32:
-			memcpy (&i32, ptr, sizeof (i32));
-			SWAP32 (i32, entry->endian);
-			CMP (i32, entry, entry->value.i32); /* returns */
+			v = field_value (c, test->field);
+			CMP (v, entry, entry->value.i32); /* returns */
 		case XMMS_MAGIC_ENTRY_TYPE_STRING:
 			return !strncmp (ptr, entry->value.s, entry->len);
 		case XMMS_MAGIC_ENTRY_TYPE_STRINGC:
@@ -409,17 +454,20 @@ node_match (xmms_magic_checker_t *c, GNode *node)
 }
 
 static gboolean
-tree_match (xmms_magic_checker_t *c, GNode *tree)
+tests_match (xmms_magic_checker_t *c, gint first)
 {
-	GNode *n;
+	const xmms_magic_test_t *test;
+	gint i;
 
 	/* empty subtrees match anything */
-	if (!tree->children) {
+	if (first < 0) {
 		return TRUE;
 	}
 
-	for (n = tree->children; n; n = n->next) {
-		if (node_match (c, n) && tree_match (c, n)) {
+	for (i = first; i >= 0; i = test->next) {
+		test = &g_array_index (c->magic->tests, xmms_magic_test_t, i);
+
+		if (test_match (c, test) && tests_match (c, test->child)) {
 			return TRUE;
 		}
 	}
@@ -437,11 +485,13 @@ xmms_magic_match (xmms_magic_checker_t *c, const gchar *uri)
 	g_return_val_if_fail (c, NULL);
 
 	/* only one of the contained sets has to match */
-	for (l = magic_list; l; l = g_list_next (l)) {
-		GNode *tree = l->data;
+	for (i = 0; c->magic && i < c->magic->sets->len; i++) {
+		const xmms_magic_set_t *set;
+
+		set = &g_array_index (c->magic->sets, xmms_magic_set_t, i);
 
-		if (tree_match (c, tree)) {
-			gpointer *data = tree->data;
+		if (tests_match (c, set->first)) {
+			gpointer *data = set->data;
 			XMMS_DBG ("magic plugin detected '%s' (%s)",
 			          (char *)data[1], (char *)data[0]);
 			return (char *) (data[1]);
@@ -479,6 +529,124 @@ xmms_magic_match (xmms_magic_checker_t *c, const gchar *uri)
 	return NULL;
 }
 
+static xmms_magic_compiled_t *
+xmms_magic_compiled_get (void)
+{
+	xmms_magic_compiled_t *m;
+
+	g_mutex_lock (&magic_lock);
+	m = magic_compiled;
+	if (m) {
+		g_atomic_int_inc (&m->ref);
+	}
+	g_mutex_unlock (&magic_lock);
+
+	return m;
+}
+
+static void
+xmms_magic_compiled_unref (xmms_magic_compiled_t *m)
+{
+	if (!g_atomic_int_dec_and_test (&m->ref)) {
+		return;
+	}
+
+	g_array_free (m->fields, TRUE);
+	g_array_free (m->tests, TRUE);
+	g_array_free (m->sets, TRUE);
+	g_free (m);
+}
+
+static gint
+compile_field (xmms_magic_compiled_t *m, const xmms_magic_entry_t *entry)
+{
+	xmms_magic_field_t *field, tmp;
+	gint i;
+
+	switch (entry->type) {
+		case XMMS_MAGIC_ENTRY_TYPE_BYTE:
+		case XMMS_MAGIC_ENTRY_TYPE_INT16:
+		case XMMS_MAGIC_ENTRY_TYPE_INT32:
+			break;
+		default:
+			return -1;
+	}
+
+	tmp.offset = entry->offset;
+	tmp.len = entry->len;
+	/* a single byte reads the same in any byte order */
+	tmp.endian = entry->len == 1 ? G_BYTE_ORDER : entry->endian;
+
+	for (i = 0; i < m->fields->len; i++) {
+		field = &g_array_index (m->fields, xmms_magic_field_t, i);
+		if (field->offset == tmp.offset && field->len == tmp.len &&
+		    field->endian == tmp.endian) {
+			return i;
+		}
+	}
+
+	g_array_append_val (m->fields, tmp);
+
+	return i;
+}
+
+static gint
+compile_children (xmms_magic_compiled_t *m, GNode *parent)
+{
+	xmms_magic_test_t test;
+	GNode *n;
+	gint idx, child, first = -1, prev = -1;
+
+	for (n = parent->children; n; n = n->next) {
+		test.entry = n->data;
+		test.field = compile_field (m, test.entry);
+		test.child = test.next = -1;
+
+		m->needed = MAX (m->needed, test.entry->offset + test.entry->len);
+
+		idx = m->tests->len;
+		g_array_append_val (m->tests, test);
+
+		child = compile_children (m, n);
+		g_array_index (m->tests, xmms_magic_test_t, idx).child = child;
+
+		if (prev < 0) {
+			first = idx;
+		} else {
+			g_array_index (m->tests, xmms_magic_test_t, prev).next = idx;
+		}
+		prev = idx;
+	}
+
+	return first;
+}
+
+/* Flatten magic_list, keeping its order, so the most complex trees are
+ * still tried first. */
+static xmms_magic_compiled_t *
+xmms_magic_compile (void)
+{
+	xmms_magic_compiled_t *m;
+	xmms_magic_set_t set;
+	const GList *l;
+
+	m = g_new0 (xmms_magic_compiled_t, 1);
+	m->ref = 1;
+	m->fields = g_array_new (FALSE, FALSE, sizeof (xmms_magic_field_t));
+	m->tests = g_array_new (FALSE, FALSE, sizeof (xmms_magic_test_t));
+	m->sets = g_array_new (FALSE, FALSE, sizeof (xmms_magic_set_t));
+
+	for (l = magic_list; l; l = g_list_next (l)) {
+		GNode *tree = l->data;
+
+		set.data = tree->data;
+		set.first = compile_children (m, tree);
+		g_array_append_val (m->sets, set);
+	}
+
+	return m;
+}
+
 static guint
 xmms_magic_complexity (GNode *tree)
 {
@@ -507,10 +675,23 @@ gboolean
 xmms_magic_extension_add (const gchar *mime, const gchar *ext)
 {
 	xmms_magic_ext_data_t *e;
+	xmmsv_t *registration;
+	gboolean skip;
 
 	g_return_val_if_fail (mime, FALSE);
 	g_return_val_if_fail (ext, FALSE);
 
+	registration = xmmsv_build_list (XMMSV_LIST_ENTRY_STR ("extension"),
+	                                 XMMSV_LIST_ENTRY_STR (mime),
+	                                 XMMSV_LIST_ENTRY_STR (ext),
+	                                 XMMSV_LIST_END);
+	skip = !xmms_plugin_manifest_record (registration);
+	xmmsv_unref (registration);
+
+	if (skip) {
+		return TRUE;
+	}
+
 	e = g_new0 (xmms_magic_ext_data_t, 1);
 	e->pattern = g_strdup (ext);
 	e->type = g_strdup (mime);
@@ -523,21 +704,56 @@ xmms_magic_extension_add (const gchar *mime, const gchar *ext)
 gboolean
 xmms_magic_add (const gchar *desc, const gchar *mime, ...)
 {
-	GNode *tree, *node = NULL;
+	xmmsv_t *specs, *registration;
 	va_list ap;
 	gchar *s;
-	gpointer *root_props;
 	gboolean ret = TRUE;
 
 	g_return_val_if_fail (desc, FALSE);
 	g_return_val_if_fail (mime, FALSE);
 
-	/* now process the magic specs in the argument list */
+	specs = xmmsv_new_list ();
+
 	va_start (ap, mime);
+	while ((s = va_arg (ap, gchar *))) {
+		xmmsv_list_append_string (specs, s);
+	}
+	va_end (ap);
+
+	registration = xmmsv_build_list (XMMSV_LIST_ENTRY_STR ("magic"),
+	                                 XMMSV_LIST_ENTRY_STR (desc),
+	                                 XMMSV_LIST_ENTRY_STR (mime),
+	                                 XMMSV_LIST_ENTRY (xmmsv_ref (specs)),
+	                                 XMMSV_LIST_END);
+
+	if (xmms_plugin_manifest_record (registration)) {
+		ret = xmms_magic_add_list (desc, mime, specs);
+	}
+
+	xmmsv_unref (registration);
+	xmmsv_unref (specs);
+
+	return ret;
+}
+
+/**
+ * Like #xmms_magic_add, but with the magic specs in a list of strings.
+ */
+gboolean
+xmms_magic_add_list (const gchar *desc, const gchar *mime, xmmsv_t *specs)
+{
+	GNode *tree, *node = NULL;
+	const gchar *s;
+	gpointer *root_props;
+	gboolean ret = TRUE;
+	gint i;
 
-	s = va_arg (ap, gchar *);
-	if (!s) { /* no magic specs passed -> failure */
-		va_end (ap);
+	g_return_val_if_fail (desc, FALSE);
+	g_return_val_if_fail (mime, FALSE);
+	g_return_val_if_fail (specs, FALSE);
+
+	/* no magic specs passed -> failure */
+	if (!xmmsv_list_get_size (specs)) {
 		return FALSE;
 	}
 
@@ -547,33 +763,39 @@ xmms_magic_add (const gchar *desc, const gchar *mime, ...)
 	root_props[1] = g_strdup (mime);
 	tree = g_node_new (root_props);
 
-	do {
+	/* now process the magic specs in the list */
+	for (i = 0; xmmsv_list_get_string (specs, i, &s); i++) {
 		if (!*s) {
 			ret = FALSE;
 			xmms_log_error ("invalid magic spec: '%s'", s);
 			break;
 		}
 
-		s = g_strdup (s); /* we need our own copy */
 		node = xmms_magic_add_node (tree, s, node);
 
 		if (!node) {
 			xmms_log_error ("invalid magic spec: '%s'", s);
 			ret = FALSE;
-
-			g_free (s);
 			break;
 		}
-		g_free (s);
-	} while ((s = va_arg (ap, gchar *)));
-
-	va_end (ap);
+	}
 
 	/* only add this tree to the list if all spec chunks are valid */
 	if (ret) {
+		xmms_magic_compiled_t *old;
+
+		g_mutex_lock (&magic_lock);
 		magic_list =
 			g_list_insert_sorted (magic_list, tree,
 			                      (GCompareFunc) cb_sort_magic_list);
+
+		old = magic_compiled;
+		magic_compiled = xmms_magic_compile ();
+		g_mutex_unlock (&magic_lock);
+
+		if (old) {
+			xmms_magic_compiled_unref (old);
+		}
 	} else {
 		xmms_magic_tree_free (tree);
 	}
@@ -584,15 +806,34 @@ xmms_magic_add (const gchar *desc, const gchar *mime, ...)
 static gboolean
 xmms_magic_plugin_init (xmms_xform_t *xform)
 {
+	xmms_magic_compiled_t *magic;
 	xmms_magic_checker_t c;
+	xmms_error_t err;
 	gchar *res;
 	const gchar *url;
 	xmms_config_property_t *cv;
+	guint needed = 0, fields = 0;
+	gint ret;
+
+	magic = xmms_magic_compiled_get ();
+	c.magic = magic;
+	if (magic) {
+		needed = c.magic->needed;
+		fields = c.magic->fields->len;
+	}
 
-	c.xform = xform;
-	c.read = c.offset = 0;
-	c.alloc = 128; /* start with a 128 bytes buffer */
-	c.buf = g_malloc (c.alloc);
+	/* everything any of the tests looks at, in one go */
+	c.buf = g_malloc (MAX (needed, 1));
+	c.values = g_new (guint32, MAX (fields, 1));
+	c.loaded = g_new0 (guint8, MAX (fields, 1));
+
+	xmms_error_reset (&err);
+	ret = needed ? xmms_xform_peek (xform, c.buf, needed, &err) : 0;
+	if (ret < 0) {
+		/* the source failed part way, test what it did hand out */
+		ret = xmms_xform_peek_buffered (xform, c.buf, needed);
+	}
+	c.read = MAX (ret, 0);
 
 	cv = xmms_xform_config_lookup (xform, "dumpcount");
 	c.dumpcount = xmms_config_property_get_int (cv);
@@ -609,6 +850,12 @@ xmms_magic_plugin_init (xmms_xform_t *xform)
 	}
 
 	g_free (c.buf);
+	g_free (c.values);
+	g_free (c.loaded);
+
+	if (magic) {
+		xmms_magic_compiled_unref (magic);
+	}
 
 	return !!res;
 }
@@ -217,18 +217,34 @@ xmms_main_client_stats (xmms_object_t *object, xmms_error_t *error)
 	xmms_main_t *mainobj = (xmms_main_t *) object;
 	gint uptime = time (NULL) - mainobj->starttime;
 	int64_t size, duration, playtime;
+	xmmsv_dict_iter_t *it;
+	xmmsv_t *stats, *alloc, *value;
+	const gchar *key;
 
 	size = duration = playtime = 0;
 
 	query_total_playtime (mainobj, error, &playtime);
 	query_total_size_duration (mainobj, error, &size, &duration);
 
-	return xmmsv_build_dict (XMMSV_DICT_ENTRY_STR ("version", XMMS_VERSION),
-	                         XMMSV_DICT_ENTRY_INT ("uptime", uptime),
-	                         XMMSV_DICT_ENTRY_INT ("size", size),
-	                         XMMSV_DICT_ENTRY_INT ("duration", duration),
-	                         XMMSV_DICT_ENTRY_INT ("playtime", playtime),
-	                         XMMSV_DICT_END);
+	stats = xmmsv_build_dict (XMMSV_DICT_ENTRY_STR ("version", XMMS_VERSION),
+	                          XMMSV_DICT_ENTRY_INT ("uptime", uptime),
+	                          XMMSV_DICT_ENTRY_INT ("size", size),
+	                          XMMSV_DICT_ENTRY_INT ("duration", duration),
+	                          XMMSV_DICT_ENTRY_INT ("playtime", playtime),
+	                          XMMSV_DICT_END);
+
+	/* Value allocator statistics, flattened as "alloc.<name>" */
+	alloc = xmmsv_get_alloc_stats ();
+	xmmsv_get_dict_iter (alloc, &it);
+	while (xmmsv_dict_iter_pair (it, &key, &value)) {
+		gchar *name = g_strconcat ("alloc.", key, NULL);
+		xmmsv_dict_set (stats, name, value);
+		g_free (name);
+		xmmsv_dict_iter_next (it);
+	}
+	xmmsv_unref (alloc);
+
+	return stats;
 }
 
 static gboolean
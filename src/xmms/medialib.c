@@ -54,6 +54,7 @@ static void xmms_medialib_client_rehash (xmms_medialib_t *medialib, xmms_mediali
 static void xmms_medialib_client_set_property_string (xmms_medialib_t *medialib, xmms_medialib_entry_t entry, const gchar *source, const gchar *key, const gchar *value, xmms_error_t *error);
 static void xmms_medialib_client_set_property_int (xmms_medialib_t *medialib, xmms_medialib_entry_t entry, const gchar *source, const gchar *key, gint32 value, xmms_error_t *error);
 static void xmms_medialib_client_remove_property (xmms_medialib_t *medialib, xmms_medialib_entry_t entry, const gchar *source, const gchar *key, xmms_error_t *error);
+static void xmms_medialib_client_set_properties (xmms_medialib_t *medialib, const gchar *source, xmmsv_t *properties, xmms_error_t *error);
 static xmmsv_t *xmms_medialib_client_get_info (xmms_medialib_t *medialib, xmms_medialib_entry_t entry, xmms_error_t *err);
 static gint32 xmms_medialib_client_get_id (xmms_medialib_t *medialib, const gchar *url, xmms_error_t *error);
 
@@ -1160,6 +1161,140 @@ xmms_medialib_client_remove_property (xmms_medialib_t *medialib,
 	} while (!xmms_medialib_session_commit (session));
 }
 
+static gboolean
+xmms_medialib_entry_properties_set (xmms_medialib_session_t *session,
+                                    xmms_medialib_entry_t entry,
+                                    const gchar *source, xmmsv_t *properties,
+                                    xmms_error_t *error)
+{
+	xmmsv_dict_iter_t *it;
+	gboolean ret = TRUE;
+
+	if (!xmmsv_is_type (properties, XMMSV_TYPE_DICT)) {
+		xmms_error_set (error, XMMS_ERROR_INVAL, "Properties must be a dict");
+		return FALSE;
+	}
+
+	xmmsv_get_dict_iter (properties, &it);
+	while (ret && xmmsv_dict_iter_valid (it)) {
+		const gchar *key, *str;
+		xmmsv_t *value;
+		gint64 num;
+
+		xmmsv_dict_iter_pair (it, &key, &value);
+
+		switch (xmmsv_get_type (value)) {
+			case XMMSV_TYPE_STRING:
+				xmmsv_get_string (value, &str);
+				if (!xmms_medialib_entry_property_set_str_source (session, entry,
+				                                                  key, str, source)) {
+					xmms_error_set (error, XMMS_ERROR_INVAL, "Invalid string value");
+					ret = FALSE;
+				}
+				break;
+			case XMMSV_TYPE_INT64:
+				xmmsv_get_int64 (value, &num);
+				/* the medialib only stores 32 bit integers */
+				if (num < G_MININT32 || num > G_MAXINT32) {
+					xmms_error_set (error, XMMS_ERROR_INVAL,
+					                "Integer value out of range");
+					ret = FALSE;
+					break;
+				}
+				xmms_medialib_entry_property_set_int_source (session, entry,
+				                                             key, num, source);
+				break;
+			case XMMSV_TYPE_NONE:
+				xmms_medialib_property_remove (session, entry, source, key, error);
+				break;
+			default:
+				xmms_error_set (error, XMMS_ERROR_INVAL,
+				                "Property values must be strings, integers or none");
+				ret = FALSE;
+				break;
+		}
+
+		xmmsv_dict_iter_next (it);
+	}
+	xmmsv_dict_iter_explicit_destroy (it);
+
+	return ret;
+}
+
+static gboolean
+xmms_medialib_properties_set (xmms_medialib_session_t *session,
+                              const gchar *source, xmmsv_t *properties,
+                              xmms_error_t *error)
+{
+	xmmsv_dict_iter_t *it;
+	gboolean ret = TRUE;
+
+	xmmsv_get_dict_iter (properties, &it);
+	while (ret && xmmsv_dict_iter_valid (it)) {
+		xmms_medialib_entry_t entry;
+		const gchar *id;
+		xmmsv_t *entry_properties;
+		gchar *end;
+
+		xmmsv_dict_iter_pair (it, &id, &entry_properties);
+
+		entry = strtol (id, &end, 10);
+		if (*id == '\0' || *end != '\0') {
+			xmms_error_set (error, XMMS_ERROR_INVAL, "Invalid medialib id");
+			ret = FALSE;
+		} else if (!xmms_medialib_check_id (session, entry)) {
+			xmms_error_set (error, XMMS_ERROR_NOENT, "No such entry");
+			ret = FALSE;
+		} else {
+			ret = xmms_medialib_entry_properties_set (session, entry, source,
+			                                          entry_properties, error);
+		}
+
+		xmmsv_dict_iter_next (it);
+	}
+	xmmsv_dict_iter_explicit_destroy (it);
+
+	return ret;
+}
+
+/**
+ * Set or remove properties on several entries in one transaction.
+ *
+ * Either all changes are applied or none of them are, and each
+ * changed entry is only announced once to the clients.
+ *
+ * @param medialib Medialib pointer
+ * @param source The source to write the properties to
+ * @param properties dict of id (as string) -> dict of key -> value,
+ * where a none value removes the property
+ * @param error In case of error this will be filled.
+ */
+static void
+xmms_medialib_client_set_properties (xmms_medialib_t *medialib,
+                                     const gchar *source, xmmsv_t *properties,
+                                     xmms_error_t *error)
+{
+	xmms_medialib_session_t *session;
+
+	if (g_ascii_strcasecmp (source, "server") == 0) {
+		xmms_error_set (error, XMMS_ERROR_GENERIC, "Can't write to source server!");
+		return;
+	}
+
+	if (!xmmsv_is_type (properties, XMMSV_TYPE_DICT)) {
+		xmms_error_set (error, XMMS_ERROR_INVAL, "Properties must be a dict");
+		return;
+	}
+
+	do {
+		session = xmms_medialib_session_begin (medialib);
+		if (!xmms_medialib_properties_set (session, source, properties, error)) {
+			xmms_medialib_session_abort (session);
+			return;
+		}
+	} while (!xmms_medialib_session_commit (session));
+}
+
 /** @} */
 
 /**
@@ -210,6 +210,14 @@ xmms_object_emit (xmms_object_t *object, guint32 signalid, xmmsv_t *data)
 
 	g_mutex_unlock (&object->mutex);
 
+	/* Every handler, and every client through the broadcasts, gets the
+	 * same value, so don't let any of them change it underneath the
+	 * others.
+	 */
+	if (data != NULL) {
+		xmmsv_freeze (data);
+	}
+
 	while (list2) {
 		entry = list2->data;
 
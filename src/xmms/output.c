@@ -46,6 +46,7 @@ typedef struct xmms_volume_map_St {
 
 static gboolean xmms_output_format_set (xmms_output_t *output, xmms_stream_type_t *fmt);
 static gpointer xmms_output_monitor_volume_thread (gpointer data);
+static void xmms_output_monitor_volume_stop (xmms_output_t *output);
 
 static void xmms_playback_client_start (xmms_output_t *output, xmms_error_t *err);
 static void xmms_playback_client_stop (xmms_output_t *output, xmms_error_t *err);
@@ -106,6 +107,7 @@ struct xmms_output_St {
 
 	xmms_output_plugin_t *plugin;
 	gpointer plugin_data;
+	gboolean realtime;
 
 	/* */
 	GMutex playtime_mutex;
@@ -151,6 +153,14 @@ struct xmms_output_St {
 
 	GThread *monitor_volume_thread;
 	gboolean monitor_volume_running;
+
+	/** protects monitor_volume_running and the two below */
+	GMutex monitor_volume_mutex;
+	GCond monitor_volume_cond;
+	/** the plugin reports volume changes, no need to poll */
+	gboolean monitor_volume_pushed;
+	/** the plugin reported a change not yet looked at */
+	gboolean monitor_volume_changed;
 };
 
 /** @} */
@@ -177,6 +187,22 @@ xmms_output_private_data_set (xmms_output_t *output, gpointer data)
 	output->plugin_data = data;
 }
 
+void
+xmms_output_realtime_set (xmms_output_t *output, gboolean realtime)
+{
+	g_return_if_fail (output);
+
+	output->realtime = realtime;
+}
+
+gboolean
+xmms_output_is_realtime (xmms_output_t *output)
+{
+	g_return_val_if_fail (output, TRUE);
+
+	return output->realtime;
+}
+
 void
 xmms_output_stream_type_add (xmms_output_t *output, ...)
 {
@@ -523,7 +549,7 @@ xmms_output_filler (void *arg)
 gint
 xmms_output_read (xmms_output_t *output, char *buffer, gint len)
 {
-	gint ret;
+	gint ret, wanted;
 	xmms_error_t err;
 
 	xmms_error_reset (&err);
@@ -531,8 +557,15 @@ xmms_output_read (xmms_output_t *output, char *buffer, gint len)
 	g_return_val_if_fail (output, -1);
 	g_return_val_if_fail (buffer, -1);
 
+	wanted = len;
+	if (!output->realtime) {
+		/* nobody is listening, take what there is instead of
+		 * waiting for the filler to fill the whole chunk */
+		wanted = MIN (len, xmms_ringbuf_size (output->filler_buffer) / 2);
+	}
+
 	g_mutex_lock (&output->filler_mutex);
-	xmms_ringbuf_wait_used (output->filler_buffer, len, &output->filler_mutex);
+	xmms_ringbuf_wait_used (output->filler_buffer, wanted, &output->filler_mutex);
 	ret = xmms_ringbuf_read (output->filler_buffer, buffer, len);
 	if (ret == 0 && xmms_ringbuf_iseos (output->filler_buffer)) {
 		xmms_output_status_set (output, XMMS_PLAYBACK_STATUS_STOP);
@@ -543,7 +576,7 @@ xmms_output_read (xmms_output_t *output, char *buffer, gint len)
 
 	update_playtime (output, ret);
 
-	if (ret < len) {
+	if (ret < wanted) {
 		XMMS_DBG ("Underrun %d of %d (%d)", ret, len, xmms_sample_frame_size_get (output->format));
 
 		if ((ret % xmms_sample_frame_size_get (output->format)) != 0) {
@@ -858,11 +891,7 @@ xmms_output_destroy (xmms_object_t *object)
 
 	XMMS_DBG ("Deactivating output object.");
 
-	output->monitor_volume_running = FALSE;
-	if (output->monitor_volume_thread) {
-		g_thread_join (output->monitor_volume_thread);
-		output->monitor_volume_thread = NULL;
-	}
+	xmms_output_monitor_volume_stop (output);
 
 	xmms_output_filler_state (output, FILLER_QUIT);
 	g_thread_join (output->filler_thread);
@@ -880,6 +909,8 @@ xmms_output_destroy (xmms_object_t *object)
 	g_mutex_clear (&output->playtime_mutex);
 	g_mutex_clear (&output->filler_mutex);
 	g_cond_clear (&output->filler_state_cond);
+	g_mutex_clear (&output->monitor_volume_mutex);
+	g_cond_clear (&output->monitor_volume_cond);
 	xmms_ringbuf_destroy (output->filler_buffer);
 
 	xmms_playback_unregister_ipc_commands ();
@@ -949,6 +980,10 @@ xmms_output_new (xmms_output_plugin_t *plugin, xmms_playlist_t *playlist, xmms_m
 
 	g_mutex_init (&output->status_mutex);
 	g_mutex_init (&output->playtime_mutex);
+	g_mutex_init (&output->monitor_volume_mutex);
+	g_cond_init (&output->monitor_volume_cond);
+
+	output->realtime = TRUE;
 
 	prop = xmms_config_property_register ("output.buffersize", "32768", NULL, NULL);
 	size = xmms_config_property_get_int (prop);
@@ -1040,11 +1075,7 @@ set_plugin (xmms_output_t *output, xmms_output_plugin_t *plugin)
 	g_assert (output);
 	g_assert (plugin);
 
-	output->monitor_volume_running = FALSE;
-	if (output->monitor_volume_thread) {
-		g_thread_join (output->monitor_volume_thread);
-		output->monitor_volume_thread = NULL;
-	}
+	xmms_output_monitor_volume_stop (output);
 
 	if (output->plugin) {
 		xmms_output_plugin_method_destroy (output->plugin, output);
@@ -1056,12 +1087,27 @@ set_plugin (xmms_output_t *output, xmms_output_plugin_t *plugin)
 	 * NEW method
 	 */
 	output->plugin = plugin;
+	output->realtime = TRUE;
 	ret = xmms_output_plugin_method_new (output->plugin, output);
 
 	if (!ret) {
 		output->plugin = NULL;
 	} else if (!output->monitor_volume_thread) {
+		/* the plugin may give up on reporting changes before the
+		 * method even returns, that has to stick
+		 */
+		g_mutex_lock (&output->monitor_volume_mutex);
+		output->monitor_volume_pushed = TRUE;
+		output->monitor_volume_changed = FALSE;
 		output->monitor_volume_running = TRUE;
+		g_mutex_unlock (&output->monitor_volume_mutex);
+
+		if (!xmms_output_plugin_method_volume_monitor (output->plugin, output)) {
+			g_mutex_lock (&output->monitor_volume_mutex);
+			output->monitor_volume_pushed = FALSE;
+			g_mutex_unlock (&output->monitor_volume_mutex);
+		}
+
 		output->monitor_volume_thread = g_thread_new ("x2 volume mon",
 		                                              xmms_output_monitor_volume_thread,
 		                                              output);
@@ -1225,7 +1271,23 @@ xmms_output_monitor_volume_thread (gpointer data)
 
 		xmms_volume_map_copy (&cur, &old);
 
-		g_usleep (G_USEC_PER_SEC);
+		/* plugins reporting volume changes wake us up when needed,
+		 * the others are polled
+		 */
+		g_mutex_lock (&output->monitor_volume_mutex);
+		while (output->monitor_volume_running &&
+		       !output->monitor_volume_changed) {
+			if (output->monitor_volume_pushed) {
+				g_cond_wait (&output->monitor_volume_cond,
+				             &output->monitor_volume_mutex);
+			} else if (!g_cond_wait_until (&output->monitor_volume_cond,
+			                               &output->monitor_volume_mutex,
+			                               g_get_monotonic_time () + G_USEC_PER_SEC)) {
+				break;
+			}
+		}
+		output->monitor_volume_changed = FALSE;
+		g_mutex_unlock (&output->monitor_volume_mutex);
 	}
 
 	xmms_volume_map_free (&old);
@@ -1234,4 +1296,42 @@ xmms_output_monitor_volume_thread (gpointer data)
 	return NULL;
 }
 
+static void
+xmms_output_monitor_volume_stop (xmms_output_t *output)
+{
+	g_mutex_lock (&output->monitor_volume_mutex);
+	output->monitor_volume_running = FALSE;
+	g_cond_signal (&output->monitor_volume_cond);
+	g_mutex_unlock (&output->monitor_volume_mutex);
+
+	if (output->monitor_volume_thread) {
+		g_thread_join (output->monitor_volume_thread);
+		output->monitor_volume_thread = NULL;
+	}
+}
+
+void
+xmms_output_volume_changed (xmms_output_t *output)
+{
+	g_return_if_fail (output);
+
+	g_mutex_lock (&output->monitor_volume_mutex);
+	output->monitor_volume_changed = TRUE;
+	g_cond_signal (&output->monitor_volume_cond);
+	g_mutex_unlock (&output->monitor_volume_mutex);
+}
+
+void
+xmms_output_volume_monitor_lost (xmms_output_t *output)
+{
+	g_return_if_fail (output);
+
+	/* read the volume once now, and then poll it again */
+	g_mutex_lock (&output->monitor_volume_mutex);
+	output->monitor_volume_pushed = FALSE;
+	output->monitor_volume_changed = TRUE;
+	g_cond_signal (&output->monitor_volume_cond);
+	g_mutex_unlock (&output->monitor_volume_mutex);
+}
+
 /** @} */
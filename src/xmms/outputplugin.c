@@ -17,8 +17,13 @@
 #include <xmmspriv/xmms_outputplugin.h>
 #include <xmmspriv/xmms_plugin.h>
 #include <xmmspriv/xmms_thread_name.h>
+#include <xmmspriv/xmms_output.h>
 #include <xmms/xmms_log.h>
 
+/* bytes written at a time, for realtime and offline outputs */
+#define XMMS_OUTPUT_WRITE_SIZE 4096
+#define XMMS_OUTPUT_WRITE_SIZE_OFFLINE 65536
+
 struct xmms_output_plugin_St {
 	xmms_plugin_t plugin;
 
@@ -347,6 +352,23 @@ xmms_output_plugin_method_volume_get (xmms_output_plugin_t *plugin,
 }
 
 
+gboolean
+xmms_output_plugin_method_volume_monitor (xmms_output_plugin_t *plugin,
+                                          xmms_output_t *output)
+{
+	gboolean res = FALSE;
+
+	g_return_val_if_fail (output, FALSE);
+	g_return_val_if_fail (plugin, FALSE);
+
+	if (plugin->methods.volume_monitor) {
+		res = plugin->methods.volume_monitor (output);
+	}
+
+	return res;
+}
+
+
 /* Used when we have to drive the output... */
 
 static gboolean
@@ -387,8 +409,10 @@ xmms_output_plugin_writer (gpointer data)
 {
 	xmms_output_plugin_t *plugin = (xmms_output_plugin_t *) data;
 	xmms_output_t *output = NULL;
-	gchar buffer[4096];
-	gint ret;
+	gchar *buffer;
+	gint ret, len;
+
+	buffer = g_malloc (XMMS_OUTPUT_WRITE_SIZE_OFFLINE);
 
 	g_mutex_lock (&plugin->write_mutex);
 
@@ -450,7 +474,12 @@ xmms_output_plugin_writer (gpointer data)
 
 			g_mutex_unlock (&plugin->write_mutex);
 
-			ret = xmms_output_read (output, buffer, 4096);
+			len = XMMS_OUTPUT_WRITE_SIZE;
+			if (!xmms_output_is_realtime (output)) {
+				len = XMMS_OUTPUT_WRITE_SIZE_OFFLINE;
+			}
+
+			ret = xmms_output_read (output, buffer, len);
 			if (ret > 0) {
 				xmms_error_t err;
 
@@ -478,6 +507,8 @@ xmms_output_plugin_writer (gpointer data)
 
 	g_mutex_unlock (&plugin->write_mutex);
 
+	g_free (buffer);
+
 	XMMS_DBG ("Output driving thread exiting!");
 
 	return NULL;
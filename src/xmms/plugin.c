@@ -23,8 +23,13 @@
 #include <xmmspriv/xmms_playlist.h>
 #include <xmmspriv/xmms_outputplugin.h>
 #include <xmmspriv/xmms_xform.h>
+#include <xmmspriv/xmms_xform_plugin.h>
+
+#include <xmmsc/xmmsc_util.h>
 
 #include <gmodule.h>
+#include <glib/gstdio.h>
+#include <sys/stat.h>
 #include <string.h>
 #include <stdarg.h>
 
@@ -39,18 +44,48 @@
 #define get_module_ext(dir) g_module_build_path (dir, "*")
 #endif
 
+#define XMMS_PLUGIN_MANIFEST_NAME "plugins.manifest"
+
 extern xmms_plugin_desc_t *xmms_builtin_plugins[];
 
+/*
+ * What registrations made by a plugin's setup function should do,
+ * see #xmms_plugin_manifest_record.
+ */
+typedef enum {
+	XMMS_PLUGIN_SETUP_PLAIN,
+	XMMS_PLUGIN_SETUP_RECORD,
+	XMMS_PLUGIN_SETUP_DEFERRED
+} xmms_plugin_setup_mode_t;
+
+/*
+ * The setup function of a plugin being loaded, and what happens to its
+ * registrations. It's kept per thread, so that registrations made by
+ * other threads in the meantime are neither recorded nor skipped.
+ */
+typedef struct {
+	xmms_plugin_setup_mode_t mode;
+	xmmsv_t *registrations;
+} xmms_plugin_setup_state_t;
+
 /*
  * Global variables
  */
 static GList *xmms_plugin_list;
 
+/* Serializes loading plugins, deferred plugins are loaded from the
+ * xform and output threads.
+ */
+static GMutex xmms_plugin_load_mutex;
+static GPrivate xmms_plugin_setup_state = G_PRIVATE_INIT (NULL);
+
 /*
  * Function prototypes
  */
+static xmms_plugin_t *xmms_plugin_load_desc (const xmms_plugin_desc_t *desc, GModule *module);
 static gboolean xmms_plugin_setup (xmms_plugin_t *plugin, const xmms_plugin_desc_t *desc);
-static gboolean xmms_plugin_scan_directory (const gchar *dir);
+static gboolean xmms_plugin_scan_directory (const gchar *dir, xmmsv_t *cached, xmmsv_t *manifest);
+static xmms_plugin_setup_mode_t xmms_plugin_setup_mode_get (void);
 
 /*
  * Public functions
@@ -117,6 +152,17 @@ xmms_plugin_config_property_register (xmms_plugin_t *plugin,
 	g_snprintf (fullpath, sizeof (fullpath), "%s.%s",
 	            xmms_plugin_shortname_get (plugin), name);
 
+	if (xmms_plugin_setup_mode_get () == XMMS_PLUGIN_SETUP_RECORD) {
+		xmmsv_t *registration;
+
+		registration = xmmsv_build_list (XMMSV_LIST_ENTRY_STR ("config"),
+		                                 XMMSV_LIST_ENTRY_STR (name),
+		                                 XMMSV_LIST_ENTRY_STR (default_value),
+		                                 XMMSV_LIST_END);
+		xmms_plugin_manifest_record (registration);
+		xmmsv_unref (registration);
+	}
+
 	prop = xmms_config_property_register (fullpath, default_value, cb,
 	                                      userdata);
 
@@ -223,13 +269,157 @@ xmms_plugin_add_builtin_plugins (void)
  * @param[in] path Absolute path to the plugins directory.
  * @return Whether the initialisation was successful or not.
  */
+static gchar *
+xmms_plugin_manifest_filename (void)
+{
+	gchar cachedir[XMMS_PATH_MAX];
+
+	if (!xmms_usercachedir_get (cachedir, XMMS_PATH_MAX)) {
+		return NULL;
+	}
+
+	return g_build_filename (cachedir, XMMS_PLUGIN_MANIFEST_NAME, NULL);
+}
+
+static gchar *
+xmms_plugin_manifest_version (void)
+{
+	return g_strdup_printf ("%s/%d/%d", XMMS_VERSION,
+	                        XMMS_XFORM_API_VERSION, XMMS_OUTPUT_API_VERSION);
+}
+
+/**
+ * @internal Read the plugin manifest.
+ * @param[in] filename The manifest file
+ * @return A dict of manifest entries keyed by plugin path, or NULL if
+ * there is no usable manifest.
+ */
+static xmmsv_t *
+xmms_plugin_manifest_read (const gchar *filename)
+{
+	xmmsv_t *serialized, *manifest, *plugins, *entries, *entry;
+	xmmsv_list_iter_t *it;
+	const gchar *version, *path;
+	gchar *contents, *expected;
+	gsize length;
+	gboolean valid;
+
+	if (!g_file_get_contents (filename, &contents, &length, NULL)) {
+		return NULL;
+	}
+
+	serialized = xmmsv_new_bin ((const guchar *) contents, length);
+	manifest = xmmsv_deserialize (serialized);
+	xmmsv_unref (serialized);
+	g_free (contents);
+
+	if (!manifest) {
+		xmms_log_info ("Ignoring broken plugin manifest %s", filename);
+		return NULL;
+	}
+
+	/* plugins are not rescanned when the daemon is upgraded in place */
+	expected = xmms_plugin_manifest_version ();
+	valid = xmmsv_dict_entry_get_string (manifest, "version", &version) &&
+	        !strcmp (version, expected) &&
+	        xmmsv_dict_get (manifest, "plugins", &plugins) &&
+	        xmmsv_get_list_iter (plugins, &it);
+	g_free (expected);
+
+	if (!valid) {
+		xmmsv_unref (manifest);
+		return NULL;
+	}
+
+	entries = xmmsv_new_dict ();
+
+	for (; xmmsv_list_iter_valid (it); xmmsv_list_iter_next (it)) {
+		xmmsv_list_iter_entry (it, &entry);
+		if (xmmsv_dict_entry_get_string (entry, "path", &path)) {
+			xmmsv_dict_set (entries, path, entry);
+		}
+	}
+
+	xmmsv_unref (manifest);
+
+	return entries;
+}
+
+static void
+xmms_plugin_manifest_write (const gchar *filename, xmmsv_t *plugins)
+{
+	xmmsv_t *manifest, *serialized;
+	const guchar *buffer;
+	guint length;
+	GError *error = NULL;
+	gchar *version, *dir;
+
+	version = xmms_plugin_manifest_version ();
+	manifest = xmmsv_build_dict (XMMSV_DICT_ENTRY_STR ("version", version),
+	                             XMMSV_DICT_ENTRY ("plugins", xmmsv_ref (plugins)),
+	                             XMMSV_DICT_END);
+	g_free (version);
+
+	serialized = xmmsv_serialize (manifest);
+	xmmsv_get_bin (serialized, &buffer, &length);
+
+	dir = g_path_get_dirname (filename);
+	g_mkdir_with_parents (dir, 0755);
+	g_free (dir);
+
+	if (!g_file_set_contents (filename, (const gchar *) buffer, length, &error)) {
+		xmms_log_info ("Could not write plugin manifest: %s", error->message);
+		g_error_free (error);
+	}
+
+	xmmsv_unref (serialized);
+	xmmsv_unref (manifest);
+}
+
+/**
+ * @internal Initialise the plugin system
+ *
+ * Plugins already listed in the plugin manifest with the same size and
+ * modification time are registered from there, and only opened once
+ * they are needed. All others are loaded right away, and the manifest
+ * is updated.
+ *
+ * @param[in] path Absolute path to the plugins directory.
+ * @return Whether the initialisation was successful or not.
+ */
 gboolean
 xmms_plugin_init (const gchar *path)
 {
+	xmmsv_t *cached = NULL, *manifest;
+	gchar *filename;
+	gboolean changed;
+
 	if (!path)
 		path = PKGLIBDIR;
 
-	xmms_plugin_scan_directory (path);
+	filename = xmms_plugin_manifest_filename ();
+	if (filename) {
+		cached = xmms_plugin_manifest_read (filename);
+	}
+
+	manifest = xmmsv_new_list ();
+
+	changed = xmms_plugin_scan_directory (path, cached, manifest);
+
+	/* plugins may have been removed too */
+	if (!cached || xmmsv_dict_get_size (cached) != xmmsv_list_get_size (manifest)) {
+		changed = TRUE;
+	}
+
+	if (filename && changed) {
+		xmms_plugin_manifest_write (filename, manifest);
+	}
+
+	if (cached) {
+		xmmsv_unref (cached);
+	}
+	xmmsv_unref (manifest);
+	g_free (filename);
 
 	xmms_plugin_add_builtin_plugins ();
 	return TRUE;
@@ -272,89 +462,464 @@ xmms_plugin_shutdown ()
 	}
 }
 
-/**
- * @internal Load a plugin.
- * @param[in] desc The plugin description.
- * @param[in] module The model reference if dynamically loaded, otherwise NULL.
- * @return TRUE if the plugin was loaded, otherwise FALSE.
- */
-gboolean
-xmms_plugin_load (const xmms_plugin_desc_t *desc, GModule *module)
+static gboolean
+xmms_plugin_type_check (xmms_plugin_type_t type, gint api_version)
 {
-	xmms_plugin_t *plugin;
-	xmms_plugin_t *(*allocer) (void);
-	gboolean (*verifier) (xmms_plugin_t *);
 	gint expected_ver;
 
-	XMMS_DBG ("Loading plugin '%s'", desc->name);
-
-	switch (desc->type) {
+	switch (type) {
 	case XMMS_PLUGIN_TYPE_OUTPUT:
 		expected_ver = XMMS_OUTPUT_API_VERSION;
-		allocer = xmms_output_plugin_new;
-		verifier = xmms_output_plugin_verify;
 		break;
 	case XMMS_PLUGIN_TYPE_XFORM:
 		expected_ver = XMMS_XFORM_API_VERSION;
-		allocer = xmms_xform_plugin_new;
-		verifier = xmms_xform_plugin_verify;
 		break;
 	default:
 		XMMS_DBG ("Unknown plugin type!");
 		return FALSE;
 	}
 
-	if (desc->api_version != expected_ver) {
+	if (api_version != expected_ver) {
 		XMMS_DBG ("Bad api version!");
 		return FALSE;
 	}
 
-	plugin = allocer ();
-	if (!plugin) {
-		XMMS_DBG ("Alloc failed!");
-		return FALSE;
+	return TRUE;
+}
+
+static xmms_plugin_t *
+xmms_plugin_alloc (xmms_plugin_type_t type)
+{
+	if (type == XMMS_PLUGIN_TYPE_OUTPUT) {
+		return xmms_output_plugin_new ();
 	}
 
-	if (!xmms_plugin_setup (plugin, desc)) {
-		xmms_log_error ("Setup failed for plugin '%s'!", desc->name);
-		xmms_object_unref (plugin);
-		return FALSE;
+	return xmms_xform_plugin_new ();
+}
+
+/* Run the plugin's own setup function and check what it registered */
+static gboolean
+xmms_plugin_run_setup (xmms_plugin_t *plugin, const xmms_plugin_desc_t *desc)
+{
+	gboolean (*verifier) (xmms_plugin_t *);
+
+	if (desc->type == XMMS_PLUGIN_TYPE_OUTPUT) {
+		verifier = xmms_output_plugin_verify;
+	} else {
+		verifier = xmms_xform_plugin_verify;
 	}
 
 	if (!desc->setup_func (plugin)) {
 		xmms_log_error ("Setup function failed for plugin '%s'!",
 		                desc->name);
-		xmms_object_unref (plugin);
 		return FALSE;
 	}
 
 	if (!verifier (plugin)) {
 		xmms_log_error ("Verify failed for plugin '%s'!", desc->name);
-		xmms_object_unref (plugin);
 		return FALSE;
 	}
 
+	return TRUE;
+}
+
+/**
+ * @internal Load a plugin.
+ * @param[in] desc The plugin description.
+ * @param[in] module The model reference if dynamically loaded, otherwise NULL.
+ * @return TRUE if the plugin was loaded, otherwise FALSE.
+ */
+gboolean
+xmms_plugin_load (const xmms_plugin_desc_t *desc, GModule *module)
+{
+	xmms_plugin_t *plugin;
+
+	g_mutex_lock (&xmms_plugin_load_mutex);
+	plugin = xmms_plugin_load_desc (desc, module);
+	g_mutex_unlock (&xmms_plugin_load_mutex);
+
+	return !!plugin;
+}
+
+static xmms_plugin_t *
+xmms_plugin_load_desc (const xmms_plugin_desc_t *desc, GModule *module)
+{
+	xmms_plugin_t *plugin;
+
+	XMMS_DBG ("Loading plugin '%s'", desc->name);
+
+	if (!xmms_plugin_type_check (desc->type, desc->api_version)) {
+		return NULL;
+	}
+
+	plugin = xmms_plugin_alloc (desc->type);
+	if (!plugin) {
+		XMMS_DBG ("Alloc failed!");
+		return NULL;
+	}
+
+	if (!xmms_plugin_setup (plugin, desc)) {
+		xmms_log_error ("Setup failed for plugin '%s'!", desc->name);
+		xmms_object_unref (plugin);
+		return NULL;
+	}
+
+	if (!xmms_plugin_run_setup (plugin, desc)) {
+		xmms_object_unref (plugin);
+		return NULL;
+	}
+
 	plugin->module = module;
 
 	xmms_plugin_list = g_list_prepend (xmms_plugin_list, plugin);
+	return plugin;
+}
+
+/**
+ * @internal Load a plugin, recording everything its setup function
+ * registers.
+ * @return The manifest entry for the plugin, or NULL if it could not
+ * be loaded.
+ */
+static xmmsv_t *
+xmms_plugin_load_recorded (const xmms_plugin_desc_t *desc, GModule *module,
+                           const gchar *path, GStatBuf *st)
+{
+	xmms_plugin_setup_state_t state;
+	xmms_plugin_t *plugin;
+	xmmsv_t *entry = NULL;
+
+	g_mutex_lock (&xmms_plugin_load_mutex);
+
+	state.mode = XMMS_PLUGIN_SETUP_RECORD;
+	state.registrations = xmmsv_new_list ();
+	g_private_set (&xmms_plugin_setup_state, &state);
+
+	plugin = xmms_plugin_load_desc (desc, module);
+
+	g_private_set (&xmms_plugin_setup_state, NULL);
+
+	if (plugin) {
+		entry = xmmsv_build_dict (XMMSV_DICT_ENTRY_STR ("path", path),
+		                          XMMSV_DICT_ENTRY_INT ("mtime", st->st_mtime),
+		                          XMMSV_DICT_ENTRY_INT ("size", st->st_size),
+		                          XMMSV_DICT_ENTRY_INT ("type", desc->type),
+		                          XMMSV_DICT_ENTRY_STR ("shortname", desc->shortname),
+		                          XMMSV_DICT_ENTRY_STR ("name", desc->name),
+		                          XMMSV_DICT_ENTRY_STR ("version", desc->version),
+		                          XMMSV_DICT_ENTRY_STR ("description", desc->description),
+		                          XMMSV_DICT_ENTRY ("registrations", state.registrations),
+		                          XMMSV_DICT_END);
+	} else {
+		xmmsv_unref (state.registrations);
+	}
+
+	g_mutex_unlock (&xmms_plugin_load_mutex);
+
+	return entry;
+}
+
+/**
+ * @internal Hook for functions a plugin's setup function uses to
+ * register things outside of the plugin object.
+ *
+ * While a plugin is loaded for the manifest, the registration is
+ * recorded so it can be replayed on later starts. When a plugin
+ * registered from the manifest is finally loaded, its registrations
+ * have already been replayed and must not be done again.
+ *
+ * @param[in] registration A list of the registration kind followed
+ * by its arguments.
+ * @return FALSE if the registration should be skipped.
+ */
+gboolean
+xmms_plugin_manifest_record (xmmsv_t *registration)
+{
+	xmms_plugin_setup_state_t *state;
+
+	state = g_private_get (&xmms_plugin_setup_state);
+	if (!state) {
+		return TRUE;
+	}
+
+	switch (state->mode) {
+	case XMMS_PLUGIN_SETUP_RECORD:
+		xmmsv_list_append (state->registrations, registration);
+		return TRUE;
+	case XMMS_PLUGIN_SETUP_DEFERRED:
+		return FALSE;
+	default:
+		return TRUE;
+	}
+}
+
+/* The setup mode of the setup function running on this thread, if any */
+static xmms_plugin_setup_mode_t
+xmms_plugin_setup_mode_get (void)
+{
+	xmms_plugin_setup_state_t *state;
+
+	state = g_private_get (&xmms_plugin_setup_state);
+
+	return state ? state->mode : XMMS_PLUGIN_SETUP_PLAIN;
+}
+
+static void
+xmms_plugin_manifest_replay (xmms_plugin_t *plugin, xmmsv_t *registration)
+{
+	const gchar *kind, *a, *b;
+	xmmsv_t *value;
+
+	if (!xmmsv_list_get_string (registration, 0, &kind)) {
+		return;
+	}
+
+	if (!strcmp (kind, "config") &&
+	    xmmsv_list_get_string (registration, 1, &a) &&
+	    xmmsv_list_get_string (registration, 2, &b)) {
+		xmms_plugin_config_property_register (plugin, a, b, NULL, NULL);
+	} else if (!strcmp (kind, "magic") &&
+	           xmmsv_list_get_string (registration, 1, &a) &&
+	           xmmsv_list_get_string (registration, 2, &b) &&
+	           xmmsv_list_get (registration, 3, &value)) {
+		xmms_magic_add_list (a, b, value);
+	} else if (!strcmp (kind, "extension") &&
+	           xmmsv_list_get_string (registration, 1, &a) &&
+	           xmmsv_list_get_string (registration, 2, &b)) {
+		xmms_magic_extension_add (a, b);
+	} else if (!strcmp (kind, "indata") &&
+	           plugin->type == XMMS_PLUGIN_TYPE_XFORM &&
+	           xmmsv_list_get (registration, 1, &value)) {
+		xmms_stream_type_t *t = xmms_stream_type_from_value (value);
+		if (t) {
+			xmms_xform_plugin_indata_add_type ((xmms_xform_plugin_t *) plugin, t);
+		}
+	} else {
+		xmms_log_error ("Bad '%s' registration in manifest of plugin '%s'",
+		                kind, plugin->shortname);
+	}
+}
+
+/**
+ * @internal Register a plugin from its manifest entry without loading
+ * it.
+ * @return TRUE if the plugin was registered.
+ */
+static gboolean
+xmms_plugin_register_deferred (xmmsv_t *entry, const gchar *path, GStatBuf *st)
+{
+	xmms_plugin_t *plugin;
+	xmmsv_list_iter_t *it;
+	xmmsv_t *registrations, *registration;
+	gint64 mtime, size;
+	gint32 type;
+	const gchar *shortname, *name;
+
+	if (!xmmsv_dict_entry_get_int64 (entry, "mtime", &mtime) ||
+	    !xmmsv_dict_entry_get_int64 (entry, "size", &size) ||
+	    mtime != st->st_mtime || size != st->st_size) {
+		return FALSE;
+	}
+
+	if (!xmmsv_dict_entry_get_int32 (entry, "type", &type) ||
+	    !xmmsv_dict_entry_get_string (entry, "shortname", &shortname) ||
+	    !xmmsv_dict_entry_get_string (entry, "name", &name) ||
+	    !xmmsv_dict_get (entry, "registrations", &registrations) ||
+	    !xmmsv_get_list_iter (registrations, &it)) {
+		return FALSE;
+	}
+
+	if (type != XMMS_PLUGIN_TYPE_OUTPUT && type != XMMS_PLUGIN_TYPE_XFORM) {
+		return FALSE;
+	}
+
+	XMMS_DBG ("Registering plugin '%s' from manifest", name);
+
+	plugin = xmms_plugin_alloc (type);
+	if (!plugin) {
+		return FALSE;
+	}
+
+	plugin->type = type;
+	plugin->shortname = shortname;
+	plugin->name = name;
+	xmmsv_dict_entry_get_string (entry, "version", &plugin->version);
+	xmmsv_dict_entry_get_string (entry, "description", &plugin->description);
+
+	plugin->manifest = xmmsv_ref (entry);
+	plugin->path = g_strdup (path);
+	plugin->deferred = TRUE;
+
+	for (; xmmsv_list_iter_valid (it); xmmsv_list_iter_next (it)) {
+		xmmsv_list_iter_entry (it, &registration);
+		xmms_plugin_manifest_replay (plugin, registration);
+	}
+
+	xmms_plugin_list = g_list_prepend (xmms_plugin_list, plugin);
+	return TRUE;
+}
+
+static gboolean
+xmms_plugin_load_deferred (xmms_plugin_t *plugin)
+{
+	xmms_plugin_setup_state_t state = { XMMS_PLUGIN_SETUP_DEFERRED, NULL };
+	const xmms_plugin_desc_t *desc;
+	GModule *module;
+	gpointer sym;
+	gboolean ret;
+
+	XMMS_DBG ("Loading deferred plugin '%s' from %s",
+	          plugin->shortname, plugin->path);
+
+	module = g_module_open (plugin->path, G_MODULE_BIND_LOCAL);
+	if (!module) {
+		xmms_log_error ("Failed to open plugin %s: %s",
+		                plugin->path, g_module_error ());
+		return FALSE;
+	}
+
+	if (!g_module_symbol (module, "XMMS_PLUGIN_DESC", &sym)) {
+		xmms_log_error ("Failed to find plugin header in %s", plugin->path);
+		g_module_close (module);
+		return FALSE;
+	}
+
+	desc = (const xmms_plugin_desc_t *) sym;
+
+	/* the file may have been replaced since the daemon started */
+	if (desc->type != plugin->type ||
+	    !xmms_plugin_type_check (desc->type, desc->api_version) ||
+	    strcmp (desc->shortname, plugin->shortname) != 0) {
+		xmms_log_error ("Plugin %s does not match the plugin manifest",
+		                plugin->path);
+		g_module_close (module);
+		return FALSE;
+	}
+
+	g_private_set (&xmms_plugin_setup_state, &state);
+	ret = xmms_plugin_run_setup (plugin, desc);
+	g_private_set (&xmms_plugin_setup_state, NULL);
+
+	if (!ret) {
+		g_module_close (module);
+		return FALSE;
+	}
+
+	plugin->module = module;
+
 	return TRUE;
 }
 
+/**
+ * @internal Make sure a plugin registered from the manifest has been
+ * loaded.
+ * @param[in] plugin The plugin
+ * @return TRUE if the plugin is usable, FALSE if loading it failed.
+ */
+gboolean
+xmms_plugin_ensure_loaded (xmms_plugin_t *plugin)
+{
+	gboolean ret;
+
+	g_return_val_if_fail (plugin, FALSE);
+
+	g_mutex_lock (&xmms_plugin_load_mutex);
+
+	if (plugin->deferred) {
+		plugin->broken = !xmms_plugin_load_deferred (plugin);
+		plugin->deferred = FALSE;
+	}
+
+	ret = !plugin->broken;
+
+	g_mutex_unlock (&xmms_plugin_load_mutex);
+
+	return ret;
+}
+
+/**
+ * @internal The manifest entry of a file that could not be loaded as
+ * a plugin. It is tried again on every start, the entry only tells
+ * whether failing again is news.
+ */
+static xmmsv_t *
+xmms_plugin_manifest_failed (const gchar *path, GStatBuf *st)
+{
+	return xmmsv_build_dict (XMMSV_DICT_ENTRY_STR ("path", path),
+	                         XMMSV_DICT_ENTRY_INT ("mtime", st->st_mtime),
+	                         XMMSV_DICT_ENTRY_INT ("size", st->st_size),
+	                         XMMSV_DICT_ENTRY_INT ("failed", 1),
+	                         XMMSV_DICT_END);
+}
+
+/* Whether an entry records the very same file failing to load */
+static gboolean
+xmms_plugin_manifest_failed_before (xmmsv_t *entry, GStatBuf *st)
+{
+	gint64 mtime, size;
+	gint32 failed;
+
+	return xmmsv_dict_entry_get_int32 (entry, "failed", &failed) && failed &&
+	       xmmsv_dict_entry_get_int64 (entry, "mtime", &mtime) &&
+	       xmmsv_dict_entry_get_int64 (entry, "size", &size) &&
+	       mtime == st->st_mtime && size == st->st_size;
+}
+
+/**
+ * @internal Load a plugin file and get its manifest entry.
+ * @return The manifest entry, which records the failure if the file
+ * could not be loaded.
+ */
+static xmmsv_t *
+xmms_plugin_load_file (const gchar *path, GStatBuf *st)
+{
+	GModule *module;
+	xmmsv_t *entry;
+	gpointer sym;
+
+	XMMS_DBG ("Trying to load file: %s", path);
+	module = g_module_open (path, G_MODULE_BIND_LOCAL);
+	if (!module) {
+		xmms_log_error ("Failed to open plugin %s: %s",
+		                path, g_module_error ());
+		return xmms_plugin_manifest_failed (path, st);
+	}
+
+	if (!g_module_symbol (module, "XMMS_PLUGIN_DESC", &sym)) {
+		xmms_log_error ("Failed to find plugin header in %s", path);
+		g_module_close (module);
+		return xmms_plugin_manifest_failed (path, st);
+	}
+
+	entry = xmms_plugin_load_recorded ((const xmms_plugin_desc_t *) sym,
+	                                   module, path, st);
+	if (!entry) {
+		g_module_close (module);
+		return xmms_plugin_manifest_failed (path, st);
+	}
+
+	return entry;
+}
+
 /**
  * @internal Scan a particular directory for plugins to load
  * @param[in] dir Absolute path to plugins directory
- * @return TRUE if directory successfully scanned for plugins
+ * @param[in] cached Manifest entries from the last run, or NULL
+ * @param[in] manifest List the manifest entries of all plugins found
+ * are appended to
+ * @return TRUE if any entry differs from the cached one
  */
 static gboolean
-xmms_plugin_scan_directory (const gchar *dir)
+xmms_plugin_scan_directory (const gchar *dir, xmmsv_t *cached, xmmsv_t *manifest)
 {
 	GDir *d;
 	const char *name;
 	gchar *path;
 	gchar *temp;
 	gchar *pattern;
-	GModule *module;
-	gpointer sym;
+	GStatBuf st;
+	xmmsv_t *entry, *known;
+	gboolean changed = FALSE;
 
 	temp = get_module_ext (dir);
 
@@ -376,37 +941,39 @@ xmms_plugin_scan_directory (const gchar *dir)
 			continue;
 
 		path = g_build_filename (dir, name, NULL);
-		if (!g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
+		if (g_stat (path, &st) != 0 || !S_ISREG (st.st_mode)) {
 			g_free (path);
 			continue;
 		}
 
-		XMMS_DBG ("Trying to load file: %s", path);
-		module = g_module_open (path, G_MODULE_BIND_LOCAL);
-		if (!module) {
-			xmms_log_error ("Failed to open plugin %s: %s",
-			                path, g_module_error ());
-			g_free (path);
-			continue;
+		if (!cached || !xmmsv_dict_get (cached, path, &known)) {
+			known = NULL;
 		}
 
-		if (!g_module_symbol (module, "XMMS_PLUGIN_DESC", &sym)) {
-			xmms_log_error ("Failed to find plugin header in %s", path);
-			g_module_close (module);
+		if (known && xmms_plugin_register_deferred (known, path, &st)) {
+			xmmsv_list_append (manifest, known);
 			g_free (path);
 			continue;
 		}
-		g_free (path);
 
-		if (!xmms_plugin_load ((const xmms_plugin_desc_t *) sym, module)) {
-			g_module_close (module);
+		entry = xmms_plugin_load_file (path, &st);
+		xmmsv_list_append (manifest, entry);
+
+		/* failing the same way as last time leaves the manifest be */
+		if (!known || !xmms_plugin_manifest_failed_before (known, &st) ||
+		    !xmms_plugin_manifest_failed_before (entry, &st)) {
+			changed = TRUE;
 		}
+
+		xmmsv_unref (entry);
+
+		g_free (path);
 	}
 
 	g_dir_close (d);
 	g_free (pattern);
 
-	return TRUE;
+	return changed;
 }
 
 /**
@@ -423,6 +990,10 @@ xmms_plugin_foreach (xmms_plugin_type_t type, xmms_plugin_foreach_func_t func, g
 	for (node = xmms_plugin_list; node; node = g_list_next (node)) {
 		xmms_plugin_t *plugin = node->data;
 
+		if (plugin->broken) {
+			continue;
+		}
+
 		if (plugin->type == type || type == XMMS_PLUGIN_TYPE_ALL) {
 			if (!func (plugin, user_data))
 				break;
@@ -459,6 +1030,12 @@ xmms_plugin_find (xmms_plugin_type_t type, const gchar *name)
 {
 	xmms_plugin_find_foreach_data_t data = {name, NULL};
 	xmms_plugin_foreach (type, xmms_plugin_find_foreach, &data);
+
+	if (data.plugin && !xmms_plugin_ensure_loaded (data.plugin)) {
+		xmms_object_unref (data.plugin);
+		return NULL;
+	}
+
 	return data.plugin;
 }
 
@@ -480,4 +1057,9 @@ xmms_plugin_destroy (xmms_plugin_t *plugin)
 {
 	if (plugin->module)
 		g_module_close (plugin->module);
+
+	if (plugin->manifest)
+		xmmsv_unref (plugin->manifest);
+
+	g_free (plugin->path);
 }
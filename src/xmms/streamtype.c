@@ -358,6 +358,88 @@ xmms_stream_type_coerce (const xmms_stream_type_t *in, const GList *goal_types)
 
 */
 
+/**
+ * Flatten a stream type into a list of name, priority and then key and
+ * value pairs, so that it can be stored away and recreated with
+ * #xmms_stream_type_from_value.
+ */
+xmmsv_t *
+xmms_stream_type_to_value (const xmms_stream_type_t *st)
+{
+	xmmsv_t *list;
+	GList *n;
+
+	g_return_val_if_fail (st, NULL);
+
+	list = xmmsv_new_list ();
+	xmmsv_list_append_string (list, st->name);
+	xmmsv_list_append_int (list, st->priority);
+
+	for (n = st->list; n; n = g_list_next (n)) {
+		xmms_stream_type_val_t *val = n->data;
+
+		xmmsv_list_append_int (list, val->key);
+		if (val->type == STRING) {
+			xmmsv_list_append_string (list, val->d.string);
+		} else {
+			xmmsv_list_append_int (list, val->d.num);
+		}
+	}
+
+	return list;
+}
+
+xmms_stream_type_t *
+xmms_stream_type_from_value (xmmsv_t *list)
+{
+	xmms_stream_type_t *res;
+	const gchar *name, *str;
+	gint32 priority, key, num;
+	gint i, size;
+
+	g_return_val_if_fail (list, NULL);
+
+	size = xmmsv_list_get_size (list);
+
+	if (size < 2 || size % 2 ||
+	    !xmmsv_list_get_string (list, 0, &name) ||
+	    !xmmsv_list_get_int32 (list, 1, &priority)) {
+		return NULL;
+	}
+
+	res = xmms_object_new (xmms_stream_type_t, xmms_stream_type_destroy);
+	res->name = g_strdup (name);
+	res->priority = priority;
+
+	for (i = 2; i < size; i += 2) {
+		xmms_stream_type_val_t *val;
+
+		if (!xmmsv_list_get_int32 (list, i, &key)) {
+			xmms_object_unref (res);
+			return NULL;
+		}
+
+		val = g_new0 (xmms_stream_type_val_t, 1);
+		val->key = key;
+
+		if (xmmsv_list_get_string (list, i + 1, &str)) {
+			val->type = STRING;
+			val->d.string = g_strdup (str);
+		} else if (xmmsv_list_get_int32 (list, i + 1, &num)) {
+			val->type = INT;
+			val->d.num = num;
+		} else {
+			g_free (val);
+			xmms_object_unref (res);
+			return NULL;
+		}
+
+		res->list = g_list_append (res->list, val);
+	}
+
+	return res;
+}
+
 xmms_stream_type_t *
 _xmms_stream_type_new (const gchar *begin, ...)
 {
@@ -63,6 +63,11 @@ struct xmms_xform_St {
 	GHashTable *privdata;
 	GQueue *hotspots;
 
+	/** counters for xmms_xform_chain_stats */
+	guint64 bytes_read;
+	guint64 bytes_copied;
+	gint64 read_time;
+
 	xmmsv_t *browse_list;
 	xmmsv_t *browse_dict;
 	gint browse_index;
@@ -393,6 +398,28 @@ xmms_xform_entry_get (xmms_xform_t *xform)
 	return xform->entry;
 }
 
+gchar *
+xmms_xform_entry_property_get_str (xmms_xform_t *xform, const gchar *key)
+{
+	xmms_medialib_session_t *session;
+	gchar *ret = NULL;
+
+	g_return_val_if_fail (xform, NULL);
+	g_return_val_if_fail (key, NULL);
+
+	if (!xform->entry || !xform->medialib) {
+		return NULL;
+	}
+
+	do {
+		g_free (ret);
+		session = xmms_medialib_session_begin_ro (xform->medialib);
+		ret = xmms_medialib_entry_property_get_str (session, xform->entry, key);
+	} while (!xmms_medialib_session_commit (session));
+
+	return ret;
+}
+
 gpointer
 xmms_xform_private_data_get (xmms_xform_t *xform)
 {
@@ -928,6 +955,8 @@ xmms_xform_this_read (xmms_xform_t *xform, gpointer buf, gint siz,
 		read = MIN (siz, xform->buffered);
 		memcpy (buf, xform->buffer, read);
 		xform->buffered -= read;
+		xform->bytes_read += read;
+		xform->bytes_copied += read;
 
 		/* buffer edited, update hotspot positions */
 		g_queue_foreach (xform->hotspots, &xmms_xform_hotspot_callback, &read);
@@ -944,9 +973,12 @@ xmms_xform_this_read (xmms_xform_t *xform, gpointer buf, gint siz,
 	}
 
 	while (read < siz) {
+		gint64 started;
 		gint res;
 
+		started = g_get_monotonic_time ();
 		res = xmms_xform_plugin_read (xform->plugin, xform, buf + read, siz - read, err);
+		xform->read_time += g_get_monotonic_time () - started;
 		if (xform->metadata_collected && xform->metadata_changed)
 			xmms_xform_metadata_update (xform);
 
@@ -975,15 +1007,49 @@ xmms_xform_this_read (xmms_xform_t *xform, gpointer buf, gint siz,
 
 				g_memmove (xform->buffer + xform->buffered, buf + read, res);
 				xform->buffered += res;
+				xform->bytes_copied += res;
 				break;
 			}
 			read += res;
+			xform->bytes_read += res;
 		}
 	}
 
 	return read;
 }
 
+/**
+ * Collect read statistics of every xform in the chain ending with xform,
+ * first to last. Each entry is a dict holding the plugin name, the bytes
+ * it produced and copied, and the time spent in its read method in
+ * microseconds, including the time spent reading from earlier xforms.
+ */
+xmmsv_t *
+xmms_xform_chain_stats (xmms_xform_t *xform)
+{
+	xmmsv_t *list;
+
+	list = xmmsv_new_list ();
+
+	for (; xform; xform = xform->prev) {
+		xmmsv_t *dict;
+
+		if (!xform->plugin) {
+			continue;
+		}
+
+		dict = xmmsv_build_dict (XMMSV_DICT_ENTRY_STR ("plugin", xmms_xform_shortname (xform)),
+		                         XMMSV_DICT_ENTRY_INT ("bytes", xform->bytes_read),
+		                         XMMSV_DICT_ENTRY_INT ("copied", xform->bytes_copied),
+		                         XMMSV_DICT_ENTRY_INT ("time", xform->read_time),
+		                         XMMSV_DICT_END);
+		xmmsv_list_insert (list, 0, dict);
+		xmmsv_unref (dict);
+	}
+
+	return list;
+}
+
 gint64
 xmms_xform_this_seek (xmms_xform_t *xform, gint64 offset,
                       xmms_xform_seek_mode_t whence, xmms_error_t *err)
@@ -1031,6 +1097,22 @@ xmms_xform_peek (xmms_xform_t *xform, gpointer buf, gint siz,
 	return xmms_xform_this_peek (xform->prev, buf, siz, err);
 }
 
+/**
+ * Copy up to siz bytes of what the previous xform has already
+ * buffered, without reading any more. Useful after a peek that failed
+ * part way through.
+ */
+gint
+xmms_xform_peek_buffered (xmms_xform_t *xform, gpointer buf, gint siz)
+{
+	g_return_val_if_fail (xform->prev, -1);
+
+	siz = MIN (siz, xform->prev->buffered);
+	memcpy (buf, xform->prev->buffer, siz);
+
+	return siz;
+}
+
 gchar *
 xmms_xform_read_line (xmms_xform_t *xform, gchar *line, xmms_error_t *err)
 {
@@ -1107,60 +1189,27 @@ xmms_xform_get_url (xmms_xform_t *xform)
 }
 
 
-typedef struct match_state_St {
-	xmms_xform_plugin_t *match;
-	const xmms_stream_type_t *out_type;
-	gint priority;
-} match_state_t;
-
-static gboolean
-xmms_xform_match (xmms_plugin_t *plugin, gpointer user_data)
-{
-	xmms_xform_plugin_t *xform_plugin = (xmms_xform_plugin_t *) plugin;
-	match_state_t *state = (match_state_t *) user_data;
-	gint priority = 0;
-
-	g_assert (plugin->type == XMMS_PLUGIN_TYPE_XFORM);
-
-	XMMS_DBG ("Trying plugin '%s'", xmms_plugin_shortname_get (plugin));
-	if (!xmms_xform_plugin_supports (xform_plugin, state->out_type, &priority)) {
-		return TRUE;
-	}
-
-	XMMS_DBG ("Plugin '%s' matched (priority %d)",
-	          xmms_plugin_shortname_get (plugin), priority);
-
-	if (priority > state->priority) {
-		if (state->match) {
-			xmms_plugin_t *previous_plugin = (xmms_plugin_t *) state->match;
-			XMMS_DBG ("Using plugin '%s' (priority %d) instead of '%s' (priority %d)",
-			          xmms_plugin_shortname_get (plugin), priority,
-			          xmms_plugin_shortname_get (previous_plugin),
-			          state->priority);
-		}
-
-		state->match = xform_plugin;
-		state->priority = priority;
-	}
-
-	return TRUE;
-}
-
 xmms_xform_t *
 xmms_xform_find (xmms_xform_t *prev, xmms_medialib_entry_t entry,
                  GList *goal_hints)
 {
-	match_state_t state;
+	const xmms_stream_type_t *out_type;
+	xmms_xform_plugin_t *match;
 	xmms_xform_t *xform = NULL;
+	gint priority;
 
-	state.out_type = xmms_xform_get_out_stream_type (prev);
-	state.match = NULL;
-	state.priority = -1;
-
-	xmms_plugin_foreach (XMMS_PLUGIN_TYPE_XFORM, xmms_xform_match, &state);
+	out_type = xmms_xform_get_out_stream_type (prev);
 
-	if (state.match) {
-		xform = xmms_xform_new (state.match, prev, prev->medialib, entry, goal_hints);
+	/* a plugin that fails to load is skipped from then on */
+	do {
+		match = xmms_xform_plugin_find (out_type, &priority);
+	} while (match && !xmms_plugin_ensure_loaded ((xmms_plugin_t *) match));
+
+	if (match) {
+		XMMS_DBG ("Using plugin '%s' (priority %d)",
+		          xmms_plugin_shortname_get ((xmms_plugin_t *) match),
+		          priority);
+		xform = xmms_xform_new (match, prev, prev->medialib, entry, goal_hints);
 	} else {
 		XMMS_DBG ("Found no matching plugin...");
 	}
@@ -27,13 +27,120 @@ struct xmms_xform_plugin_St {
 	xmms_stream_type_t *default_out_type;
 };
 
+/*
+ * Index of the input types of all xform plugins, used to find the
+ * plugin for a stream without asking each plugin in turn.
+ *
+ * Input types with a plain mimetype are found through a hash table
+ * keyed by it, those with a wildcard or without a mimetype are kept in
+ * a residual list that is always searched. Both are ordered from the
+ * last registered input type to the first, which is the order the
+ * plugin list and the input type lists of the plugins are in. The
+ * index is only changed while plugins are loaded at startup and freed
+ * at shutdown.
+ */
+typedef struct xmms_xform_plugin_index_entry_St {
+	xmms_xform_plugin_t *plugin;
+	xmms_stream_type_t *type;
+	gchar *priority_key;
+	guint serial;
+} xmms_xform_plugin_index_entry_t;
+
+static GHashTable *index_by_mime;
+static GList *index_residual;
+static guint index_serial;
+
+static void
+xmms_xform_plugin_index_add (xmms_xform_plugin_t *plugin,
+                             xmms_stream_type_t *type,
+                             const gchar *priority_key)
+{
+	xmms_xform_plugin_index_entry_t *entry;
+	const gchar *mime;
+	GList *list;
+
+	entry = g_new0 (xmms_xform_plugin_index_entry_t, 1);
+	entry->plugin = plugin;
+	entry->type = type;
+	entry->priority_key = g_strdup (priority_key);
+	entry->serial = ++index_serial;
+
+	mime = xmms_stream_type_get_str (type, XMMS_STREAM_TYPE_MIMETYPE);
+	if (!mime || strpbrk (mime, "*?")) {
+		index_residual = g_list_prepend (index_residual, entry);
+		return;
+	}
+
+	if (!index_by_mime) {
+		index_by_mime = g_hash_table_new_full (g_str_hash, g_str_equal,
+		                                       g_free, NULL);
+	}
+
+	list = g_hash_table_lookup (index_by_mime, mime);
+	list = g_list_prepend (list, entry);
+	g_hash_table_replace (index_by_mime, g_strdup (mime), list);
+}
+
+static GList *
+xmms_xform_plugin_index_list_remove (GList *list, xmms_xform_plugin_t *plugin)
+{
+	GList *n, *next;
+
+	for (n = list; n; n = next) {
+		xmms_xform_plugin_index_entry_t *entry = n->data;
+
+		next = g_list_next (n);
+		if (entry->plugin == plugin) {
+			g_free (entry->priority_key);
+			g_free (entry);
+			list = g_list_delete_link (list, n);
+		}
+	}
+
+	return list;
+}
+
+static void
+xmms_xform_plugin_index_remove (xmms_xform_plugin_t *plugin)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+
+	index_residual = xmms_xform_plugin_index_list_remove (index_residual, plugin);
+
+	if (!index_by_mime) {
+		return;
+	}
+
+	g_hash_table_iter_init (&iter, index_by_mime);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		value = xmms_xform_plugin_index_list_remove (value, plugin);
+		if (value) {
+			g_hash_table_iter_replace (&iter, value);
+		} else {
+			g_hash_table_iter_remove (&iter);
+		}
+	}
+
+	if (!g_hash_table_size (index_by_mime)) {
+		g_hash_table_destroy (index_by_mime);
+		index_by_mime = NULL;
+	}
+}
+
 static void
 destroy (xmms_object_t *obj)
 {
 	xmms_xform_plugin_t *plugin = (xmms_xform_plugin_t *) obj;
 
+	xmms_xform_plugin_index_remove (plugin);
+
 	g_list_free_full (plugin->in_types, xmms_object_unref);
-	xmms_object_unref (plugin->default_out_type);
+
+	/* not set on plugins that were never loaded, see xmms_plugin_init */
+	if (plugin->default_out_type != NULL) {
+		xmms_object_unref (plugin->default_out_type);
+	}
 
 	if (plugin->metadata_mapper != NULL) {
 		g_hash_table_unref (plugin->metadata_mapper);
@@ -82,14 +189,36 @@ void
 xmms_xform_plugin_indata_add (xmms_xform_plugin_t *plugin, ...)
 {
 	xmms_stream_type_t *t;
+	xmmsv_t *registration;
 	va_list ap;
-	gchar *config_key, config_value[32];
-	gint priority;
 
 	va_start (ap, plugin);
 	t = xmms_stream_type_parse (ap);
 	va_end (ap);
 
+	registration = xmmsv_build_list (XMMSV_LIST_ENTRY_STR ("indata"),
+	                                 XMMSV_LIST_ENTRY (xmms_stream_type_to_value (t)),
+	                                 XMMSV_LIST_END);
+
+	if (xmms_plugin_manifest_record (registration)) {
+		xmms_xform_plugin_indata_add_type (plugin, t);
+	} else {
+		xmms_object_unref (t);
+	}
+
+	xmmsv_unref (registration);
+}
+
+/**
+ * Add an input type to the plugin, taking over the reference to it.
+ */
+void
+xmms_xform_plugin_indata_add_type (xmms_xform_plugin_t *plugin,
+                                   xmms_stream_type_t *t)
+{
+	gchar *config_key, config_value[32];
+	gint priority;
+
 	config_key = g_strconcat ("priority.",
 	                          xmms_stream_type_get_str (t, XMMS_STREAM_TYPE_NAME),
 	                          NULL);
@@ -97,9 +226,11 @@ xmms_xform_plugin_indata_add (xmms_xform_plugin_t *plugin, ...)
 	g_snprintf (config_value, sizeof (config_value), "%d", priority);
 	xmms_xform_plugin_config_property_register (plugin, config_key,
 	                                            config_value, NULL, NULL);
-	g_free (config_key);
 
 	plugin->in_types = g_list_prepend (plugin->in_types, t);
+
+	xmms_xform_plugin_index_add (plugin, t, config_key);
+	g_free (config_key);
 }
 
 void
@@ -157,6 +288,84 @@ xmms_xform_plugin_supports (const xmms_xform_plugin_t *plugin, const xmms_stream
 	return FALSE;
 }
 
+/**
+ * Find the xform plugin with the highest priority for a stream type.
+ *
+ * Gives the same result as asking #xmms_xform_plugin_supports of every
+ * xform plugin in the plugin list, where the first plugin wins a tie,
+ * but only looks at the input types that can match.
+ *
+ * @param st the stream type to find a plugin for
+ * @param priority the priority of the returned plugin
+ * @return the plugin, or NULL if none supports the stream type. No
+ * reference is taken.
+ */
+xmms_xform_plugin_t *
+xmms_xform_plugin_find (const xmms_stream_type_t *st, gint *priority)
+{
+	xmms_xform_plugin_t *match = NULL, *last = NULL;
+	GList *exact = NULL, *residual = index_residual;
+	const gchar *mime;
+	gint best = -1;
+
+	g_return_val_if_fail (st, NULL);
+	g_return_val_if_fail (priority, NULL);
+
+	mime = xmms_stream_type_get_str (st, XMMS_STREAM_TYPE_MIMETYPE);
+	if (mime && index_by_mime) {
+		exact = g_hash_table_lookup (index_by_mime, mime);
+	}
+
+	/* merge both lists, newest entry first */
+	while (exact || residual) {
+		xmms_xform_plugin_index_entry_t *entry;
+		xmms_config_property_t *config_priority;
+		gint prio;
+
+		if (!residual || (exact &&
+		    ((xmms_xform_plugin_index_entry_t *) exact->data)->serial >
+		    ((xmms_xform_plugin_index_entry_t *) residual->data)->serial)) {
+			entry = exact->data;
+			exact = g_list_next (exact);
+		} else {
+			entry = residual->data;
+			residual = g_list_next (residual);
+		}
+
+		/* only the first matching input type of a plugin counts */
+		if (entry->plugin == last || entry->plugin->plugin.broken) {
+			continue;
+		}
+
+		if (!xmms_stream_type_match (entry->type, st)) {
+			continue;
+		}
+
+		last = entry->plugin;
+
+		config_priority = xmms_plugin_config_lookup ((xmms_plugin_t *) entry->plugin,
+		                                             entry->priority_key);
+		if (config_priority) {
+			prio = xmms_config_property_get_int (config_priority);
+		} else {
+			prio = XMMS_STREAM_TYPE_PRIORITY_DEFAULT;
+		}
+
+		XMMS_DBG ("Plugin '%s' matched (priority %d)",
+		          xmms_plugin_shortname_get ((xmms_plugin_t *) entry->plugin),
+		          prio);
+
+		if (prio > best) {
+			match = entry->plugin;
+			best = prio;
+		}
+	}
+
+	*priority = best;
+
+	return match;
+}
+
 void
 xmms_xform_plugin_metadata_basic_mapper_init (xmms_xform_plugin_t *xform_plugin,
                                                const xmms_xform_metadata_basic_mapping_t *mappings,
@@ -0,0 +1,224 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <xmmsc/xmmsv.h>
+#include <xmmsc/xmmsc_ipc_msg.h>
+#include <xmmsc/xmmsc_ipc_transport.h>
+
+#define DEFAULT_MEGABYTES 256
+
+static const int payload_sizes[] = {
+	1024,
+	1024 * 1024,
+	64 * 1024 * 1024
+};
+
+static double
+now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+wait_fd (xmms_ipc_transport_t *transport, short events)
+{
+	struct pollfd pfd;
+
+	pfd.fd = xmms_ipc_transport_fd_get (transport);
+	pfd.events = events;
+
+	poll (&pfd, 1, -1);
+}
+
+/* Runs in the child, sends count messages carrying size bytes of binary */
+static int
+writer (const char *path, int size, int count)
+{
+	xmms_ipc_transport_t *transport;
+	unsigned char *payload;
+	xmmsv_t *bin;
+	int i;
+
+	transport = xmms_ipc_client_init (path);
+	if (!transport) {
+		fprintf (stderr, "could not connect to %s\n", path);
+		return EXIT_FAILURE;
+	}
+
+	payload = malloc (size);
+	memset (payload, 0x5a, size);
+	bin = xmmsv_new_bin (payload, size);
+	free (payload);
+
+	for (i = 0; i < count; i++) {
+		xmms_ipc_msg_t *msg;
+		bool disconnected = false;
+
+		msg = xmms_ipc_msg_new (0, 0);
+		xmms_ipc_msg_put_value (msg, bin);
+
+		while (!xmms_ipc_msg_write_transport (msg, transport, &disconnected)) {
+			if (disconnected) {
+				fprintf (stderr, "reader went away\n");
+				return EXIT_FAILURE;
+			}
+			wait_fd (transport, POLLOUT);
+		}
+
+		xmms_ipc_msg_destroy (msg);
+	}
+
+	xmmsv_unref (bin);
+	xmms_ipc_transport_destroy (transport);
+
+	return EXIT_SUCCESS;
+}
+
+/* Receives and decodes count messages, returns the number of good ones */
+static int
+reader (xmms_ipc_transport_t *transport, int size, int count)
+{
+	xmms_ipc_msg_t *msg = NULL;
+	int received = 0;
+
+	while (received < count) {
+		bool disconnected = false;
+		const unsigned char *data;
+		unsigned int len;
+		xmmsv_t *value;
+
+		if (!msg) {
+			msg = xmms_ipc_msg_alloc ();
+		}
+
+		if (!xmms_ipc_msg_read_transport (msg, transport, &disconnected)) {
+			if (disconnected) {
+				break;
+			}
+			wait_fd (transport, POLLIN);
+			continue;
+		}
+
+		if (xmms_ipc_msg_get_value (msg, &value)) {
+			if (xmmsv_get_bin (value, &data, &len) && len == size &&
+			    data[0] == 0x5a && data[len - 1] == 0x5a) {
+				received++;
+			}
+			xmmsv_unref (value);
+		}
+
+		xmms_ipc_msg_destroy (msg);
+		msg = NULL;
+	}
+
+	if (msg) {
+		xmms_ipc_msg_destroy (msg);
+	}
+
+	return received;
+}
+
+static int
+run_size (const char *path, xmms_ipc_transport_t *server, int size, int megabytes)
+{
+	xmms_ipc_transport_t *transport;
+	int count, received, status;
+	double start, elapsed;
+	pid_t pid;
+
+	count = ((long long) megabytes * 1024 * 1024) / size;
+	if (count < 1) {
+		count = 1;
+	}
+
+	/* don't let the child print our buffered output again */
+	fflush (stdout);
+
+	pid = fork ();
+	if (pid == 0) {
+		xmms_ipc_transport_destroy (server);
+		exit (writer (path, size, count));
+	}
+
+	start = now ();
+
+	while (!(transport = xmms_ipc_server_accept (server))) {
+		wait_fd (server, POLLIN);
+	}
+
+	received = reader (transport, size, count);
+	elapsed = now () - start;
+
+	xmms_ipc_transport_destroy (transport);
+	waitpid (pid, &status, 0);
+
+	printf ("%9d byte messages: %7d in %7.3fs  %8.1f MB/s\n",
+	        size, received, elapsed,
+	        (double) received * size / (1024 * 1024) / elapsed);
+
+	return received == count && WIFEXITED (status) &&
+	       WEXITSTATUS (status) == EXIT_SUCCESS;
+}
+
+/**
+ * Measure how fast binary payloads of different sizes make it through
+ * the IPC message code over a unix socket.
+ *
+ * Usage: ipc-bench [megabytes per payload size]
+ */
+int
+main (int argc, char **argv)
+{
+	xmms_ipc_transport_t *server;
+	char path[128];
+	int i, megabytes = DEFAULT_MEGABYTES, ok = 1;
+
+	if (argc > 1) {
+		megabytes = atoi (argv[1]);
+		if (megabytes < 1) {
+			megabytes = 1;
+		}
+	}
+
+	snprintf (path, sizeof (path), "unix:///tmp/xmms-ipc-bench.%d", (int) getpid ());
+
+	server = xmms_ipc_server_init (path);
+	if (!server) {
+		fprintf (stderr, "could not listen on %s\n", path);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < sizeof (payload_sizes) / sizeof (payload_sizes[0]); i++) {
+		ok &= run_size (path, server, payload_sizes[i], megabytes);
+	}
+
+	xmms_ipc_transport_destroy (server);
+	unlink (path + strlen ("unix://"));
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,378 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+extern "C" {
+#include <xmmsc/xmmsc_ipc_msg.h>
+#include <xmmsc/xmmsc_ipc_transport.h>
+}
+
+#include <xmmsclient/xmmsclient++.h>
+
+#include <boost/bind.hpp>
+
+#include <stdexcept>
+#include <vector>
+
+#define DEFAULT_CLIENTS 500
+#define DEFAULT_CALLS 200
+
+/* Commands each client keeps in flight */
+#define IN_FLIGHT 4
+
+/* Give up after this many seconds */
+#define TIMEOUT 60
+
+static double
+now()
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* CPU time used by this process, the server runs in the child */
+static double
+cpu()
+{
+	struct rusage usage;
+
+	getrusage( RUSAGE_SELF, &usage );
+
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+	       usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+struct Connection
+{
+	xmms_ipc_transport_t* transport;
+	xmms_ipc_msg_t* msg;
+};
+
+static void
+reply( xmms_ipc_transport_t* transport, xmms_ipc_msg_t* msg, xmmsv_t* value )
+{
+	xmms_ipc_msg_t* reply;
+	bool disconnected = false;
+
+	reply = xmms_ipc_msg_new( xmms_ipc_msg_get_object( msg ),
+	                          XMMS_IPC_COMMAND_REPLY );
+	xmms_ipc_msg_set_cookie( reply, xmms_ipc_msg_get_cookie( msg ) );
+	xmms_ipc_msg_put_value( reply, value );
+
+	while( !xmms_ipc_msg_write_transport( reply, transport, &disconnected ) ) {
+		struct pollfd pfd;
+
+		if( disconnected ) {
+			break;
+		}
+
+		pfd.fd = xmms_ipc_transport_fd_get( transport );
+		pfd.events = POLLOUT;
+		poll( &pfd, 1, -1 );
+	}
+
+	xmms_ipc_msg_destroy( reply );
+}
+
+/* Runs in the child, answers every command on every connection with
+ * the integer 1 until it is killed.
+ */
+static int
+server( xmms_ipc_transport_t* listener )
+{
+	std::vector< Connection > conns;
+	std::vector< struct pollfd > pfds;
+	xmmsv_t* one = xmmsv_new_int( 1 );
+
+	while( true ) {
+		pfds.resize( conns.size() + 1 );
+		pfds[0].fd = xmms_ipc_transport_fd_get( listener );
+		pfds[0].events = POLLIN;
+		for( size_t i = 0; i < conns.size(); ++i ) {
+			pfds[i + 1].fd = xmms_ipc_transport_fd_get( conns[i].transport );
+			pfds[i + 1].events = POLLIN;
+		}
+
+		if( poll( &pfds[0], pfds.size(), -1 ) < 0 ) {
+			continue;
+		}
+
+		for( size_t i = conns.size(); i > 0; --i ) {
+			Connection& conn = conns[i - 1];
+			bool disconnected = false;
+
+			if( !pfds[i].revents ) {
+				continue;
+			}
+
+			while( true ) {
+				if( !conn.msg ) {
+					conn.msg = xmms_ipc_msg_alloc();
+				}
+				if( !xmms_ipc_msg_read_transport( conn.msg, conn.transport,
+				                                  &disconnected ) ) {
+					break;
+				}
+				reply( conn.transport, conn.msg, one );
+				xmms_ipc_msg_destroy( conn.msg );
+				conn.msg = 0;
+			}
+
+			if( disconnected ) {
+				xmms_ipc_msg_destroy( conn.msg );
+				xmms_ipc_transport_destroy( conn.transport );
+				conns.erase( conns.begin() + ( i - 1 ) );
+			}
+		}
+
+		if( pfds[0].revents & POLLIN ) {
+			Connection conn;
+
+			while( ( conn.transport = xmms_ipc_server_accept( listener ) ) ) {
+				conn.msg = 0;
+				conns.push_back( conn );
+			}
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+struct Stress
+{
+	Xmms::MainLoop* loop;
+	int remaining;
+	int good;
+	int bad;
+};
+
+/* Keeps IN_FLIGHT playtime requests going until it has made its calls */
+class Driver
+{
+	public:
+		Driver( Xmms::Client& client, Stress& stress, int calls )
+			: client_( client ), stress_( stress ), calls_( calls )
+		{
+		}
+
+		void start()
+		{
+			for( int i = 0; i < IN_FLIGHT && calls_ > 0; ++i ) {
+				send();
+			}
+		}
+
+		bool done( const int& value )
+		{
+			if( value == 1 ) {
+				stress_.good++;
+			}
+			else {
+				stress_.bad++;
+			}
+
+			if( --stress_.remaining == 0 ) {
+				stress_.loop->quit();
+			}
+			else if( calls_ > 0 ) {
+				send();
+			}
+
+			return false;
+		}
+
+	private:
+		void send()
+		{
+			calls_--;
+			client_.playback.getPlaytime()( boost::bind( &Driver::done,
+			                                             this, _1 ) );
+		}
+
+		Xmms::Client& client_;
+		Stress& stress_;
+		int calls_;
+};
+
+static bool
+timeout( Stress* stress, double* deadline )
+{
+	if( now() < *deadline ) {
+		return true;
+	}
+
+	fprintf( stderr, "timed out with %d calls left\n", stress->remaining );
+	stress->loop->quit();
+
+	return false;
+}
+
+static bool
+run_backend( const char* name, Xmms::MainLoop::Backend backend,
+             const char* path, int clients, int active, int calls )
+{
+	std::vector< Xmms::Client* > xmms;
+	std::vector< Driver* > drivers;
+	double start, elapsed, start_cpu, used_cpu, deadline;
+	Stress stress;
+
+	Xmms::MainLoop loop( backend );
+
+	stress.loop = &loop;
+	stress.remaining = active * calls;
+	stress.good = 0;
+	stress.bad = 0;
+
+	try {
+		for( int i = 0; i < clients; ++i ) {
+			Xmms::Client* client = new Xmms::Client( "mainloop-stress" );
+			xmms.push_back( client );
+			client->connect( path );
+			client->useMainLoop( loop );
+			if( i < active ) {
+				drivers.push_back( new Driver( *client, stress, calls ) );
+			}
+		}
+	}
+	catch( Xmms::connection_error& err ) {
+		fprintf( stderr, "%s: could not connect client %d: %s\n",
+		         name, (int) xmms.size(), err.what() );
+		stress.remaining = -1;
+	}
+
+	start = now();
+	start_cpu = cpu();
+
+	if( stress.remaining > 0 ) {
+		for( size_t i = 0; i < drivers.size(); ++i ) {
+			drivers[i]->start();
+		}
+
+		deadline = now() + TIMEOUT;
+		loop.addTimer( 1000, boost::bind( &timeout, &stress, &deadline ) );
+
+		loop.run();
+	}
+
+	elapsed = now() - start;
+	used_cpu = cpu() - start_cpu;
+
+	for( size_t i = 0; i < xmms.size(); ++i ) {
+		delete xmms[i];
+	}
+	for( size_t i = 0; i < drivers.size(); ++i ) {
+		delete drivers[i];
+	}
+
+	printf( "%-6s %4d/%-4d clients  %7d calls in %7.3fs  %8.0f calls/s  "
+	        "%6.2f us cpu per call\n",
+	        name, active, clients, stress.good, elapsed, stress.good / elapsed,
+	        used_cpu * 1e6 / stress.good );
+
+	return stress.remaining == 0 && stress.bad == 0;
+}
+
+/**
+ * Drive hundreds of clients through one MainLoop against a server
+ * that answers right away, once with each backend.  Only the first
+ * active clients make calls, the rest sit idle in the loop.
+ *
+ * Usage: mainloop-stress [clients] [calls per client] [active]
+ */
+int
+main( int argc, char** argv )
+{
+	xmms_ipc_transport_t* listener;
+	char path[128];
+	int clients = DEFAULT_CLIENTS, calls = DEFAULT_CALLS, active, status;
+	bool ok = true;
+	pid_t pid;
+
+	if( argc > 1 ) {
+		clients = atoi( argv[1] );
+		if( clients < 1 ) {
+			clients = 1;
+		}
+	}
+
+	if( argc > 2 ) {
+		calls = atoi( argv[2] );
+		if( calls < 1 ) {
+			calls = 1;
+		}
+	}
+
+	active = clients;
+	if( argc > 3 ) {
+		active = atoi( argv[3] );
+		if( active < 1 || active > clients ) {
+			active = clients;
+		}
+	}
+
+	snprintf( path, sizeof( path ), "unix:///tmp/xmms-mainloop-stress.%d",
+	          (int) getpid() );
+
+	listener = xmms_ipc_server_init( path );
+	if( !listener ) {
+		fprintf( stderr, "could not listen on %s\n", path );
+		return EXIT_FAILURE;
+	}
+
+	fflush( stdout );
+
+	pid = fork();
+	if( pid == 0 ) {
+		exit( server( listener ) );
+	}
+
+	xmms_ipc_transport_destroy( listener );
+
+	/* select() can't go past FD_SETSIZE */
+	if( clients < FD_SETSIZE - 16 ) {
+		ok &= run_backend( "select", Xmms::MainLoop::Select,
+		                   path, clients, active, calls );
+	}
+	else {
+		printf( "select skipped, too many clients for FD_SETSIZE\n" );
+	}
+
+	try {
+		ok &= run_backend( "epoll", Xmms::MainLoop::Epoll,
+		                   path, clients, active, calls );
+	}
+	catch( std::runtime_error& err ) {
+		printf( "epoll skipped: %s\n", err.what() );
+	}
+
+	kill( pid, SIGTERM );
+	waitpid( pid, &status, 0 );
+	unlink( path + strlen( "unix://" ) );
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,183 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <xmmsclient/xmmsclient.h>
+#include <xmmsc/xmmsv.h>
+#include <xmmsc/xmmsc_ipc_msg.h>
+#include <xmmsc/xmmsc_ipc_transport.h>
+
+#define DEFAULT_CALLS 100000
+
+static double
+now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+wait_fd (xmms_ipc_transport_t *transport, short events)
+{
+	struct pollfd pfd;
+
+	pfd.fd = xmms_ipc_transport_fd_get (transport);
+	pfd.events = events;
+
+	poll (&pfd, 1, -1);
+}
+
+/* Runs in the child, answers every command with the integer 1 */
+static int
+server (xmms_ipc_transport_t *listener)
+{
+	xmms_ipc_transport_t *transport;
+	xmms_ipc_msg_t *msg = NULL, *reply;
+	xmmsv_t *one;
+
+	while (!(transport = xmms_ipc_server_accept (listener))) {
+		wait_fd (listener, POLLIN);
+	}
+
+	one = xmmsv_new_int (1);
+
+	while (true) {
+		bool disconnected = false;
+
+		if (!msg) {
+			msg = xmms_ipc_msg_alloc ();
+		}
+
+		if (!xmms_ipc_msg_read_transport (msg, transport, &disconnected)) {
+			if (disconnected) {
+				break;
+			}
+			wait_fd (transport, POLLIN);
+			continue;
+		}
+
+		reply = xmms_ipc_msg_new (xmms_ipc_msg_get_object (msg),
+		                          XMMS_IPC_COMMAND_REPLY);
+		xmms_ipc_msg_set_cookie (reply, xmms_ipc_msg_get_cookie (msg));
+		xmms_ipc_msg_put_value (reply, one);
+
+		while (!xmms_ipc_msg_write_transport (reply, transport, &disconnected)) {
+			if (disconnected) {
+				break;
+			}
+			wait_fd (transport, POLLOUT);
+		}
+
+		xmms_ipc_msg_destroy (reply);
+		xmms_ipc_msg_destroy (msg);
+		msg = NULL;
+	}
+
+	if (msg) {
+		xmms_ipc_msg_destroy (msg);
+	}
+
+	xmmsv_unref (one);
+	xmms_ipc_transport_destroy (transport);
+
+	return EXIT_SUCCESS;
+}
+
+/**
+ * Measure how many synchronous calls per second libxmmsclient makes
+ * against a server that answers right away.
+ *
+ * Usage: sync-bench [calls]
+ */
+int
+main (int argc, char **argv)
+{
+	xmms_ipc_transport_t *listener;
+	xmmsc_connection_t *conn;
+	xmmsc_result_t *res;
+	char path[128];
+	double start, elapsed;
+	int i, calls = DEFAULT_CALLS, good = 0, status;
+	pid_t pid;
+
+	if (argc > 1) {
+		calls = atoi (argv[1]);
+		if (calls < 1) {
+			calls = 1;
+		}
+	}
+
+	snprintf (path, sizeof (path), "unix:///tmp/xmms-sync-bench.%d", (int) getpid ());
+
+	listener = xmms_ipc_server_init (path);
+	if (!listener) {
+		fprintf (stderr, "could not listen on %s\n", path);
+		return EXIT_FAILURE;
+	}
+
+	fflush (stdout);
+
+	pid = fork ();
+	if (pid == 0) {
+		exit (server (listener));
+	}
+
+	xmms_ipc_transport_destroy (listener);
+
+	conn = xmmsc_init ("sync-bench");
+	if (!xmmsc_connect (conn, path)) {
+		fprintf (stderr, "could not connect: %s\n", xmmsc_get_last_error (conn));
+		kill (pid, SIGTERM);
+		return EXIT_FAILURE;
+	}
+
+	start = now ();
+
+	for (i = 0; i < calls; i++) {
+		int32_t value;
+
+		res = xmmsc_playback_playtime (conn);
+		xmmsc_result_wait (res);
+
+		if (xmmsv_get_int32 (xmmsc_result_get_value (res), &value) && value == 1) {
+			good++;
+		}
+
+		xmmsc_result_unref (res);
+	}
+
+	elapsed = now () - start;
+
+	xmmsc_unref (conn);
+	waitpid (pid, &status, 0);
+	unlink (path + strlen ("unix://"));
+
+	printf ("%d calls in %.3fs, %.0f calls/s, %.2f us per call\n",
+	        good, elapsed, good / elapsed, elapsed * 1e6 / calls);
+
+	return good == calls ? EXIT_SUCCESS : EXIT_FAILURE;
+}
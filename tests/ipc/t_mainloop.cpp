@@ -0,0 +1,310 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include "xcu.h"
+
+#include <xmmsclient/xmmsclient++/mainloop.h>
+
+#include <boost/bind.hpp>
+
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+using Xmms::MainLoop;
+
+static const MainLoop::Backend backends[] = {
+	MainLoop::Select,
+#ifdef __linux__
+	MainLoop::Epoll,
+#endif
+};
+
+static const int n_backends = sizeof (backends) / sizeof (backends[0]);
+
+/* One end of a socketpair, readable once something is written to the
+ * other end. Handling it runs 'func' instead of reading, so the socket
+ * stays readable until the test is done with it.
+ */
+class TestListener : public Xmms::ListenerInterface
+{
+	public:
+		TestListener( int* handled )
+			: handled_( handled ), func(), closed_( false )
+		{
+			socketpair( AF_UNIX, SOCK_STREAM, 0, fds_ );
+		}
+
+		virtual ~TestListener()
+		{
+			if( !closed_ ) {
+				close( fds_[0] );
+			}
+			close( fds_[1] );
+		}
+
+		void makeReadable()
+		{
+			CU_ASSERT_EQUAL( 1, write( fds_[1], "x", 1 ) );
+		}
+
+		// Keeps reporting the now closed descriptor
+		void closeDescriptor()
+		{
+			close( fds_[0] );
+			closed_ = true;
+		}
+
+		virtual int32_t getFileDescriptor() const { return fds_[0]; }
+		virtual bool listenIn() const { return true; }
+		virtual bool listenOut() const { return false; }
+
+		virtual void handleIn()
+		{
+			++*handled_;
+			if( func ) {
+				func( this );
+			}
+		}
+
+		virtual void handleOut() {}
+
+		int* handled_;
+		boost::function< void( TestListener* ) > func;
+
+	private:
+		int fds_[2];
+		bool closed_;
+};
+
+static long long
+now_ms (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+static bool
+count_to (std::vector<int>* log, int id, int* count, int until)
+{
+	log->push_back (id);
+	return ++*count < until;
+}
+
+static bool
+quit_loop (MainLoop* loop, int* count)
+{
+	++*count;
+	loop->quit ();
+	return true;
+}
+
+static void
+quit_from_handler (MainLoop* loop, TestListener*)
+{
+	loop->quit ();
+}
+
+static void
+replace_all (MainLoop* loop, std::list<TestListener*>* all, TestListener*)
+{
+	std::list<TestListener*>::iterator it;
+	for (it = all->begin (); it != all->end (); ++it) {
+		loop->removeListener (*it);
+	}
+
+	/* never readable, keeps the loop from running out of listeners */
+	loop->addListener (new TestListener (all->front ()->handled_));
+	loop->quit ();
+}
+
+SETUP (mainloop) {
+	return 0;
+}
+
+CLEANUP () {
+	return 0;
+}
+
+CASE (test_mainloop_timers)
+{
+	for (int b = 0; b < n_backends; b++) {
+		MainLoop loop (backends[b]);
+		std::vector<int> log;
+		int fast = 0, slow = 0;
+		long long start;
+
+		loop.addTimer (40, boost::bind (&count_to, &log, 2, &slow, 1));
+		loop.addTimer (10, boost::bind (&count_to, &log, 1, &fast, 3));
+
+		/* returns once the last timer has removed itself */
+		start = now_ms ();
+		loop.run ();
+
+		CU_ASSERT_FALSE (loop.isRunning ());
+		CU_ASSERT_EQUAL (3, fast);
+		CU_ASSERT_EQUAL (1, slow);
+		CU_ASSERT_TRUE (now_ms () - start >= 40);
+
+		/* fast fires at 10, 20 and 30, slow at 40 */
+		CU_ASSERT_EQUAL_FATAL (4U, log.size ());
+		CU_ASSERT_EQUAL (1, log[0]);
+		CU_ASSERT_EQUAL (1, log[1]);
+		CU_ASSERT_EQUAL (1, log[2]);
+		CU_ASSERT_EQUAL (2, log[3]);
+	}
+}
+
+CASE (test_mainloop_quit_from_timer)
+{
+	for (int b = 0; b < n_backends; b++) {
+		MainLoop loop (backends[b]);
+		int handled = 0, quits = 0;
+
+		/* never readable, without quit() this would wait for ever */
+		loop.addListener (new TestListener (&handled));
+		loop.addTimer (10, boost::bind (&quit_loop, &loop, &quits));
+
+		loop.run ();
+		CU_ASSERT_FALSE (loop.isRunning ());
+		CU_ASSERT_EQUAL (1, quits);
+
+		/* quitting doesn't stick to the next run */
+		loop.run ();
+		CU_ASSERT_EQUAL (2, quits);
+		CU_ASSERT_EQUAL (0, handled);
+	}
+}
+
+CASE (test_mainloop_quit_from_handler)
+{
+	for (int b = 0; b < n_backends; b++) {
+		MainLoop loop (backends[b]);
+		TestListener* listener;
+		int handled = 0;
+
+		listener = new TestListener (&handled);
+		listener->func = boost::bind (&quit_from_handler, &loop, _1);
+		listener->makeReadable ();
+		loop.addListener (listener);
+
+		/* still readable, so only quit() ends this */
+		loop.run ();
+		CU_ASSERT_EQUAL (1, handled);
+
+		loop.run ();
+		CU_ASSERT_EQUAL (2, handled);
+	}
+}
+
+CASE (test_mainloop_remove_during_dispatch)
+{
+	for (int b = 0; b < n_backends; b++) {
+		MainLoop loop (backends[b]);
+		std::list<TestListener*> all;
+		std::list<TestListener*>::iterator it;
+		int handled = 0;
+
+		/* all ready in the same wait, whichever is handled first
+		 * replaces them all before the others' turn
+		 */
+		for (int i = 0; i < 4; i++) {
+			TestListener* listener = new TestListener (&handled);
+			listener->func = boost::bind (&replace_all, &loop, &all, _1);
+			listener->makeReadable ();
+			loop.addListener (listener);
+			all.push_back (listener);
+		}
+
+		loop.run ();
+		CU_ASSERT_EQUAL (1, handled);
+
+		for (it = all.begin (); it != all.end (); ++it) {
+			delete *it;
+		}
+	}
+}
+
+CASE (test_mainloop_select_error)
+{
+	MainLoop loop (MainLoop::Select);
+	TestListener* listener;
+	int handled = 0;
+	bool thrown = false;
+
+	listener = new TestListener (&handled);
+	loop.addListener (listener);
+	listener->closeDescriptor ();
+
+	try {
+		loop.run ();
+	} catch (std::runtime_error&) {
+		thrown = true;
+	}
+
+	CU_ASSERT_TRUE (thrown);
+	CU_ASSERT_FALSE (loop.isRunning ());
+	CU_ASSERT_EQUAL (0, handled);
+
+	loop.removeListener (listener);
+	delete listener;
+}
+
+#ifdef __linux__
+CASE (test_mainloop_epoll_error)
+{
+	char path[64], target[64];
+	ssize_t len;
+	int quits = 0;
+	int fd;
+	bool thrown = false;
+
+	/* the epoll instance gets the lowest free descriptor */
+	fd = open ("/dev/null", O_RDONLY);
+	CU_ASSERT_TRUE_FATAL (fd >= 0);
+	close (fd);
+
+	MainLoop loop (MainLoop::Epoll);
+
+	snprintf (path, sizeof (path), "/proc/self/fd/%d", fd);
+	len = readlink (path, target, sizeof (target) - 1);
+	CU_ASSERT_TRUE_FATAL (len > 0);
+	target[len] = '\0';
+	CU_ASSERT_TRUE_FATAL (strstr (target, "eventpoll") != NULL);
+
+	/* pulled from under the loop, epoll_wait can't go on */
+	close (fd);
+
+	loop.addTimer (10, boost::bind (&quit_loop, &loop, &quits));
+	try {
+		loop.run ();
+	} catch (std::runtime_error&) {
+		thrown = true;
+	}
+
+	CU_ASSERT_TRUE (thrown);
+	CU_ASSERT_FALSE (loop.isRunning ());
+}
+#endif
@@ -0,0 +1,299 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include "xcu.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <xmmsc/xmmsv.h>
+#include <xmmsc/xmmsc_ipc_msg.h>
+#include <xmmsc/xmmsc_ipc_transport.h>
+
+/* An in-memory transport. Reads hand out at most 'chunk' bytes and
+ * block (EAGAIN) once 'avail' bytes have been consumed, like a socket
+ * the peer hasn't finished writing to.
+ */
+typedef struct {
+	char *buf;
+	int len;
+	int pos;
+	int avail;
+	int chunk;
+	int reads;
+} memory_t;
+
+static int
+memory_write (xmms_ipc_transport_t *transport, char *buffer, int len)
+{
+	memory_t *mem = transport->data;
+
+	mem->buf = realloc (mem->buf, mem->len + len);
+	memcpy (mem->buf + mem->len, buffer, len);
+	mem->len += len;
+	mem->avail = mem->len;
+
+	return len;
+}
+
+static int
+memory_read (xmms_ipc_transport_t *transport, char *buffer, int len)
+{
+	memory_t *mem = transport->data;
+
+	mem->reads++;
+
+	if (mem->pos == mem->len) {
+		return 0;
+	}
+
+	if (mem->pos == mem->avail) {
+		errno = EAGAIN;
+		return SOCKET_ERROR;
+	}
+
+	if (len > mem->avail - mem->pos)
+		len = mem->avail - mem->pos;
+	if (mem->chunk && len > mem->chunk)
+		len = mem->chunk;
+
+	memcpy (buffer, mem->buf + mem->pos, len);
+	mem->pos += len;
+
+	return len;
+}
+
+static void
+memory_destroy (xmms_ipc_transport_t *transport)
+{
+	memory_t *mem = transport->data;
+
+	free (mem->buf);
+	free (mem);
+}
+
+static xmms_ipc_transport_t *
+memory_transport_new (void)
+{
+	xmms_ipc_transport_t *transport;
+
+	transport = calloc (1, sizeof (xmms_ipc_transport_t));
+	transport->data = calloc (1, sizeof (memory_t));
+	transport->fd = -1;
+	transport->read_func = memory_read;
+	transport->write_func = memory_write;
+	transport->destroy_func = memory_destroy;
+
+	return transport;
+}
+
+static memory_t *
+memory_get (xmms_ipc_transport_t *transport)
+{
+	return transport->data;
+}
+
+/* Queue a message carrying a binary of the given size and fill byte */
+static void
+write_bin_msg (xmms_ipc_transport_t *transport, uint32_t cookie,
+               int size, unsigned char fill)
+{
+	xmms_ipc_msg_t *msg;
+	unsigned char *payload;
+	bool disconnected = false;
+	xmmsv_t *bin;
+
+	payload = malloc (size);
+	memset (payload, fill, size);
+	bin = xmmsv_new_bin (payload, size);
+	free (payload);
+
+	msg = xmms_ipc_msg_new (1, 2);
+	xmms_ipc_msg_set_cookie (msg, cookie);
+	xmms_ipc_msg_put_value (msg, bin);
+	CU_ASSERT_TRUE (xmms_ipc_msg_write_transport (msg, transport, &disconnected));
+	CU_ASSERT_FALSE (disconnected);
+
+	xmms_ipc_msg_destroy (msg);
+	xmmsv_unref (bin);
+}
+
+static void
+check_bin_msg (xmms_ipc_msg_t *msg, uint32_t cookie,
+               int size, unsigned char fill)
+{
+	const unsigned char *data;
+	unsigned int len;
+	xmmsv_t *value;
+	int i;
+
+	CU_ASSERT_EQUAL (1, xmms_ipc_msg_get_object (msg));
+	CU_ASSERT_EQUAL (2, xmms_ipc_msg_get_cmd (msg));
+	CU_ASSERT_EQUAL (cookie, xmms_ipc_msg_get_cookie (msg));
+
+	CU_ASSERT_TRUE (xmms_ipc_msg_get_value (msg, &value));
+	CU_ASSERT_TRUE (xmmsv_get_bin (value, &data, &len));
+	CU_ASSERT_EQUAL (size, len);
+
+	for (i = 0; i < len; i++) {
+		if (data[i] != fill) {
+			break;
+		}
+	}
+	CU_ASSERT_EQUAL (size, i);
+
+	xmmsv_unref (value);
+}
+
+SETUP (msg) {
+	return 0;
+}
+
+CLEANUP () {
+	return 0;
+}
+
+CASE (test_msg_read_small)
+{
+	xmms_ipc_transport_t *transport;
+	xmms_ipc_msg_t *msg;
+	bool disconnected = false;
+	int i;
+
+	transport = memory_transport_new ();
+
+	for (i = 0; i < 10; i++) {
+		write_bin_msg (transport, i, 10 + i, 'a' + i);
+	}
+
+	/* a burst of small messages comes out of the read-ahead buffer */
+	for (i = 0; i < 10; i++) {
+		msg = xmms_ipc_msg_alloc ();
+		CU_ASSERT_TRUE (xmms_ipc_msg_read_transport (msg, transport, &disconnected));
+		CU_ASSERT_FALSE (disconnected);
+		check_bin_msg (msg, i, 10 + i, 'a' + i);
+		xmms_ipc_msg_destroy (msg);
+	}
+
+	CU_ASSERT_EQUAL (1, memory_get (transport)->reads);
+	CU_ASSERT_EQUAL (0, xmms_ipc_transport_pending (transport));
+
+	xmms_ipc_transport_destroy (transport);
+}
+
+CASE (test_msg_read_large)
+{
+	xmms_ipc_transport_t *transport;
+	xmms_ipc_msg_t *msg;
+	bool disconnected = false;
+	int size = 5 * 1024 * 1024;
+
+	transport = memory_transport_new ();
+	write_bin_msg (transport, 42, size, 'x');
+
+	msg = xmms_ipc_msg_alloc ();
+	CU_ASSERT_TRUE (xmms_ipc_msg_read_transport (msg, transport, &disconnected));
+	CU_ASSERT_FALSE (disconnected);
+	check_bin_msg (msg, 42, size, 'x');
+	xmms_ipc_msg_destroy (msg);
+
+	/* large bodies are read in big chunks rather than in 512 byte steps */
+	CU_ASSERT (memory_get (transport)->reads < 20);
+
+	xmms_ipc_transport_destroy (transport);
+}
+
+CASE (test_msg_read_partial)
+{
+	xmms_ipc_transport_t *transport;
+	xmms_ipc_msg_t *msg;
+	memory_t *mem;
+	bool disconnected = false;
+	int size = 100000;
+
+	transport = memory_transport_new ();
+	write_bin_msg (transport, 7, size, 'p');
+	write_bin_msg (transport, 8, 3, 'q');
+
+	mem = memory_get (transport);
+	mem->chunk = 1000;
+
+	/* the data trickles in, the message picks up where it left off */
+	msg = xmms_ipc_msg_alloc ();
+	for (mem->avail = 5; mem->avail < size; mem->avail += 33333) {
+		CU_ASSERT_FALSE (xmms_ipc_msg_read_transport (msg, transport, &disconnected));
+		CU_ASSERT_FALSE (disconnected);
+	}
+
+	mem->avail = mem->len;
+	CU_ASSERT_TRUE (xmms_ipc_msg_read_transport (msg, transport, &disconnected));
+	check_bin_msg (msg, 7, size, 'p');
+	xmms_ipc_msg_destroy (msg);
+
+	/* without eating into the next one */
+	msg = xmms_ipc_msg_alloc ();
+	CU_ASSERT_TRUE (xmms_ipc_msg_read_transport (msg, transport, &disconnected));
+	CU_ASSERT_FALSE (disconnected);
+	check_bin_msg (msg, 8, 3, 'q');
+	xmms_ipc_msg_destroy (msg);
+
+	xmms_ipc_transport_destroy (transport);
+}
+
+CASE (test_msg_read_disconnected)
+{
+	xmms_ipc_transport_t *transport;
+	xmms_ipc_msg_t *msg;
+	memory_t *mem;
+	bool disconnected = false;
+
+	/* the peer goes away in the middle of a message */
+	transport = memory_transport_new ();
+	write_bin_msg (transport, 1, 1000, 'd');
+	mem = memory_get (transport);
+	mem->len = mem->avail = 500;
+
+	msg = xmms_ipc_msg_alloc ();
+	CU_ASSERT_FALSE (xmms_ipc_msg_read_transport (msg, transport, &disconnected));
+	CU_ASSERT_TRUE (disconnected);
+	xmms_ipc_msg_destroy (msg);
+
+	xmms_ipc_transport_destroy (transport);
+}
+
+CASE (test_msg_read_bogus_length)
+{
+	const unsigned char header[XMMS_IPC_MSG_HEAD_LEN] = {
+		0, 0, 0, 1,  0, 0, 0, 2,  0, 0, 0, 3,  0xff, 0xff, 0xff, 0xf0
+	};
+	xmms_ipc_transport_t *transport;
+	xmms_ipc_msg_t *msg;
+	bool disconnected = false;
+
+	/* a length that can't be represented is a broken connection,
+	 * not an attempt to allocate 4GiB */
+	transport = memory_transport_new ();
+	xmms_ipc_transport_write (transport, (char *) header, sizeof (header));
+	xmms_ipc_transport_write (transport, (char *) header, sizeof (header));
+
+	msg = xmms_ipc_msg_alloc ();
+	CU_ASSERT_FALSE (xmms_ipc_msg_read_transport (msg, transport, &disconnected));
+	CU_ASSERT_TRUE (disconnected);
+	xmms_ipc_msg_destroy (msg);
+
+	xmms_ipc_transport_destroy (transport);
+}
@@ -0,0 +1,98 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include "xcu.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <xmmsc/xmmsc_sockets.h>
+
+static int fds[2];
+
+SETUP (socket) {
+	CU_ASSERT_EQUAL_FATAL (0, socketpair (AF_UNIX, SOCK_STREAM, 0, fds));
+	return 0;
+}
+
+CLEANUP () {
+	if (fds[0] >= 0) {
+		close (fds[0]);
+	}
+	if (fds[1] >= 0) {
+		close (fds[1]);
+	}
+	return 0;
+}
+
+CASE (test_socket_wait_timeout)
+{
+	bool readable = false, writable = false;
+
+	CU_ASSERT_EQUAL (0, xmms_socket_wait (fds[0], &readable, &writable, 10));
+	CU_ASSERT_FALSE (readable);
+	CU_ASSERT_FALSE (writable);
+}
+
+CASE (test_socket_wait_readable)
+{
+	bool readable = false, writable = false;
+
+	CU_ASSERT_EQUAL (1, write (fds[1], "x", 1));
+
+	CU_ASSERT_TRUE (xmms_socket_wait (fds[0], &readable, &writable, -1) > 0);
+	CU_ASSERT_TRUE (readable);
+	CU_ASSERT_FALSE (writable);
+}
+
+CASE (test_socket_wait_writable)
+{
+	bool readable = false, writable = true;
+
+	CU_ASSERT_TRUE (xmms_socket_wait (fds[0], &readable, &writable, -1) > 0);
+	CU_ASSERT_FALSE (readable);
+	CU_ASSERT_TRUE (writable);
+}
+
+CASE (test_socket_wait_hangup)
+{
+	bool readable = false, writable = false;
+
+	close (fds[1]);
+	fds[1] = -1;
+
+	/* the hangup is left for the read to find */
+	CU_ASSERT_TRUE (xmms_socket_wait (fds[0], &readable, &writable, -1) > 0);
+	CU_ASSERT_TRUE (readable);
+}
+
+CASE (test_socket_wait_closed)
+{
+	bool readable = true, writable = true;
+	int fd = fds[0];
+
+	close (fds[0]);
+	fds[0] = -1;
+
+	/* must not report readiness nothing will ever come of */
+	errno = 0;
+	CU_ASSERT_EQUAL (SOCKET_ERROR, xmms_socket_wait (fd, &readable, &writable, -1));
+	CU_ASSERT_EQUAL (EBADF, errno);
+	CU_ASSERT_FALSE (xmms_socket_error_recoverable ());
+	CU_ASSERT_FALSE (readable);
+	CU_ASSERT_FALSE (writable);
+}
@@ -0,0 +1,229 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include "xcu.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "iir.h"
+
+#define SRATE 44100
+#define FRAMES 4096
+
+static float gains[EQ_MAX_CHANNELS][EQ_MAX_BANDS];
+static float preamps[EQ_MAX_CHANNELS];
+
+SETUP (equalizer) {
+	init_iir ();
+	memset (gains, 0, sizeof (gains));
+	return 0;
+}
+
+CLEANUP () {
+	return 0;
+}
+
+/* The filter the way it was written before it kept any per-instance
+ * state, one sample at a time, one band at a time.
+ */
+static void
+reference_iir (short *data, int frames, int nch, int bands,
+               int extra_filtering)
+{
+	double x[EQ_MAX_BANDS][EQ_MAX_CHANNELS][3];
+	double y[EQ_MAX_BANDS][EQ_MAX_CHANNELS][3];
+	double x2[EQ_MAX_BANDS][EQ_MAX_CHANNELS][3];
+	double y2[EQ_MAX_BANDS][EQ_MAX_CHANNELS][3];
+	sIIRCoefficients *cf;
+	int i = 2, j = 1, k = 0, di = 0;
+	int index, band, channel, tempint;
+
+	memset (x, 0, sizeof (x));
+	memset (y, 0, sizeof (y));
+	memset (x2, 0, sizeof (x2));
+	memset (y2, 0, sizeof (y2));
+
+	cf = get_coeffs (&bands, SRATE, 0);
+
+	for (index = 0; index < frames * nch; index += nch) {
+		for (channel = 0; channel < nch; channel++) {
+			double pcm, out = 0.;
+			double dither = (di % 4) - 2;
+
+			pcm = data[index + channel] * preamps[channel] + dither;
+
+			for (band = 0; band < bands; band++) {
+				x[band][channel][i] = pcm;
+				y[band][channel][i] =
+					cf[band].alpha * (x[band][channel][i] - x[band][channel][k])
+					+ cf[band].gamma * y[band][channel][j]
+					- cf[band].beta * y[band][channel][k];
+				out += y[band][channel][i] * gains[channel][band];
+			}
+
+			if (extra_filtering) {
+				for (band = 0; band < bands; band++) {
+					x2[band][channel][i] = out;
+					y2[band][channel][i] =
+						cf[band].alpha * (x2[band][channel][i] - x2[band][channel][k])
+						+ cf[band].gamma * y2[band][channel][j]
+						- cf[band].beta * y2[band][channel][k];
+					out += y2[band][channel][i] * gains[channel][band];
+				}
+			}
+
+			out += pcm * 0.25;
+			out -= dither * 0.25;
+
+			tempint = (int) out;
+			if (tempint < -32768) {
+				data[index + channel] = -32768;
+			} else if (tempint > 32767) {
+				data[index + channel] = 32767;
+			} else {
+				data[index + channel] = tempint;
+			}
+		}
+
+		i = (i + 1) % 3;
+		j = (j + 1) % 3;
+		k = (k + 1) % 3;
+		di = (di + 1) % 256;
+	}
+}
+
+/* A sweep up through the audible range, loud enough to clip when boosted */
+static short *
+make_input (int nch)
+{
+	short *data;
+	int n, c;
+
+	data = malloc (FRAMES * nch * sizeof (short));
+	for (n = 0; n < FRAMES; n++) {
+		double t = (double) n / SRATE;
+		for (c = 0; c < nch; c++) {
+			data[n * nch + c] = 20000 * sin (2 * M_PI * (50 + 40000 * t) * t + c);
+		}
+	}
+
+	return data;
+}
+
+static void
+run_kernel (iir_func_t func, short *data, int nch, int bands, int extra_filtering)
+{
+	iir_state_t *state;
+	int band, chn, n;
+
+	state = iir_new (nch);
+	CU_ASSERT_PTR_NOT_NULL_FATAL (state);
+
+	config_iir (state, SRATE, bands, 0);
+	for (chn = 0; chn < nch; chn++) {
+		set_preamp (state, chn, preamps[chn]);
+		for (band = 0; band < bands; band++) {
+			set_gain (state, band, chn, gains[chn][band]);
+		}
+	}
+
+	/* the same noise as the reference */
+	for (n = 0; n < 256; n++) {
+		state->dither[n] = (n % 4) - 2;
+	}
+
+	/* in uneven pieces, the state has to carry over */
+	func (state, data, 1000 * nch * sizeof (short), extra_filtering);
+	func (state, data + 1000 * nch, (FRAMES - 1000) * nch * sizeof (short),
+	      extra_filtering);
+
+	iir_free (state);
+}
+
+static void
+compare_kernel (iir_func_t func, int nch, int bands, int extra_filtering)
+{
+	short *expected, *data;
+	int n, off = 0;
+
+	expected = make_input (nch);
+	data = make_input (nch);
+
+	reference_iir (expected, FRAMES, nch, bands, extra_filtering);
+	run_kernel (func, data, nch, bands, extra_filtering);
+
+	/* summing the bands in another order may round the other way */
+	for (n = 0; n < FRAMES * nch; n++) {
+		if (abs (expected[n] - data[n]) > 1) {
+			off++;
+		}
+	}
+	CU_ASSERT_EQUAL (0, off);
+
+	free (expected);
+	free (data);
+}
+
+static void
+compare (int nch, int bands, int extra_filtering)
+{
+	compare_kernel (iir_generic, nch, bands, extra_filtering);
+#ifdef IIR_HAVE_AVX
+	__builtin_cpu_init ();
+	if (__builtin_cpu_supports ("avx")) {
+		compare_kernel (iir_avx, nch, bands, extra_filtering);
+	}
+#endif
+}
+
+CASE (test_one_band_mono)
+{
+	preamps[0] = 1.0;
+	gains[0][3] = 0.6;
+
+	compare (1, 10, 0);
+	compare (1, 10, 1);
+}
+
+CASE (test_one_band_stereo)
+{
+	/* different settings per channel, so mixing them up shows */
+	preamps[0] = 1.0;
+	preamps[1] = 0.7;
+	gains[0][3] = 0.6;
+	gains[1][3] = -0.2;
+
+	compare (2, 10, 0);
+	compare (2, 10, 1);
+}
+
+CASE (test_all_bands_extra_filtering)
+{
+	int band;
+
+	/* the second pass feeds every band the bands before it */
+	preamps[0] = 0.9;
+	preamps[1] = 1.1;
+	for (band = 0; band < 15; band++) {
+		gains[0][band] = 0.05 * (band % 5) - 0.1;
+		gains[1][band] = 0.3 - 0.04 * band;
+	}
+
+	compare (2, 15, 0);
+	compare (2, 15, 1);
+}
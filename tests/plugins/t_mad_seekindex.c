@@ -0,0 +1,319 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include "xcu.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#include <xmmspriv/xmms_bindata.h>
+#include <xmmspriv/xmms_config.h>
+#include <xmmspriv/xmms_ipc.h>
+#include <xmmspriv/xmms_log.h>
+#include <xmmspriv/xmms_medialib.h>
+#include <xmmspriv/xmms_plugin.h>
+#include <xmmspriv/xmms_xform.h>
+
+#include "seekindex.h"
+
+#define TEST_PROPERTY "mad_seek_index"
+#define TEST_FILESIZE 100000
+#define TEST_FRAMES 100
+
+static xmms_medialib_t *medialib;
+static xmms_bindata_t *bindata;
+static gchar *bindir;
+
+static gint loaded, saved;
+
+SETUP (mad_seekindex)
+{
+	xmms_ipc_init ();
+	xmms_log_init (0);
+
+	xmms_config_init ("memory://");
+	xmms_config_property_register ("medialib.path", "memory://", NULL, NULL);
+
+	bindir = g_dir_make_tmp ("xmms-t-mad-XXXXXX", NULL);
+	xmms_config_property_register ("bindata.path", bindir, NULL, NULL);
+
+	medialib = xmms_medialib_init ();
+	bindata = xmms_bindata_init ();
+
+	loaded = saved = 0;
+
+	return 1;
+}
+
+CLEANUP ()
+{
+	const gchar *name;
+	GDir *dir;
+
+	xmms_object_unref (bindata); bindata = NULL;
+	xmms_object_unref (medialib); medialib = NULL;
+
+	dir = g_dir_open (bindir, 0, NULL);
+	while ((name = g_dir_read_name (dir))) {
+		gchar *path = g_build_filename (bindir, name, NULL);
+		g_unlink (path);
+		g_free (path);
+	}
+	g_dir_close (dir);
+	g_rmdir (bindir);
+	g_free (bindir); bindir = NULL;
+
+	xmms_config_shutdown ();
+	xmms_ipc_shutdown ();
+
+	return 0;
+}
+
+/* frame n at 400 * n, 1152 samples each */
+static xmms_mad_seek_index_t *
+build_index (guint interval)
+{
+	xmms_mad_seek_index_t *index;
+	gint i;
+
+	index = xmms_mad_seek_index_new (interval);
+	for (i = 0; i < TEST_FRAMES; i++) {
+		CU_ASSERT_TRUE (xmms_mad_seek_index_add_frame (index, 400 * i, 1152));
+	}
+
+	return index;
+}
+
+CASE (test_lookup)
+{
+	xmms_mad_seek_index_t *index;
+	guint64 offset, start;
+
+	index = xmms_mad_seek_index_new (4);
+	CU_ASSERT_FALSE (xmms_mad_seek_index_lookup (index, 0, &offset, &start));
+	xmms_mad_seek_index_free (index);
+
+	index = build_index (4);
+
+	/* nothing before the first point */
+	CU_ASSERT_TRUE (xmms_mad_seek_index_lookup (index, 0, &offset, &start));
+	CU_ASSERT_EQUAL (0, offset);
+	CU_ASSERT_EQUAL (0, start);
+
+	/* frame 9 is after the point at frame 8, so start at frame 4 */
+	CU_ASSERT_TRUE (xmms_mad_seek_index_lookup (index, 9 * 1152 + 10, &offset, &start));
+	CU_ASSERT_EQUAL (4 * 400, offset);
+	CU_ASSERT_EQUAL (4 * 1152, start);
+
+	/* right on a point still starts an interval earlier */
+	CU_ASSERT_TRUE (xmms_mad_seek_index_lookup (index, 8 * 1152, &offset, &start));
+	CU_ASSERT_EQUAL (4 * 400, offset);
+
+	/* past the end, from the next to last point */
+	CU_ASSERT_TRUE (xmms_mad_seek_index_lookup (index, G_MAXUINT32, &offset, &start));
+	CU_ASSERT_EQUAL (92 * 400, offset);
+	CU_ASSERT_EQUAL (92 * 1152, start);
+
+	xmms_mad_seek_index_free (index);
+}
+
+CASE (test_serialize_roundtrip)
+{
+	xmms_mad_seek_index_t *index, *copy;
+	guchar *blob, *again;
+	guint64 sample, offset, start, offset2, start2;
+	gsize len, len2;
+
+	index = build_index (8);
+	blob = xmms_mad_seek_index_serialize (index, TEST_FILESIZE, &len);
+	CU_ASSERT_EQUAL (24 + 13 * 8, len);
+
+	copy = xmms_mad_seek_index_deserialize (blob, len, TEST_FILESIZE);
+	CU_ASSERT_PTR_NOT_NULL_FATAL (copy);
+
+	again = xmms_mad_seek_index_serialize (copy, TEST_FILESIZE, &len2);
+	CU_ASSERT_EQUAL (len, len2);
+	CU_ASSERT_EQUAL (0, memcmp (blob, again, len));
+
+	for (sample = 0; sample < TEST_FRAMES * 1152; sample += 1000) {
+		CU_ASSERT_TRUE (xmms_mad_seek_index_lookup (index, sample, &offset, &start));
+		CU_ASSERT_TRUE (xmms_mad_seek_index_lookup (copy, sample, &offset2, &start2));
+		CU_ASSERT_EQUAL (offset, offset2);
+		CU_ASSERT_EQUAL (start, start2);
+	}
+
+	g_free (again);
+	g_free (blob);
+	xmms_mad_seek_index_free (copy);
+	xmms_mad_seek_index_free (index);
+}
+
+CASE (test_deserialize_rejects)
+{
+	xmms_mad_seek_index_t *index;
+	guchar *blob, *copy;
+	gsize len;
+
+	index = build_index (8);
+	blob = xmms_mad_seek_index_serialize (index, TEST_FILESIZE, &len);
+	xmms_mad_seek_index_free (index);
+
+	/* made for another file */
+	CU_ASSERT_PTR_NULL (xmms_mad_seek_index_deserialize (blob, len, TEST_FILESIZE + 1));
+
+	/* truncated in the header, mid point and by a whole point */
+	CU_ASSERT_PTR_NULL (xmms_mad_seek_index_deserialize (blob, 20, TEST_FILESIZE));
+	CU_ASSERT_PTR_NULL (xmms_mad_seek_index_deserialize (blob, len - 3, TEST_FILESIZE));
+	CU_ASSERT_PTR_NULL (xmms_mad_seek_index_deserialize (blob, len - 8, TEST_FILESIZE));
+
+	/* trailing bytes the count doesn't account for */
+	copy = g_malloc0 (len + 8);
+	memcpy (copy, blob, len);
+	CU_ASSERT_PTR_NULL (xmms_mad_seek_index_deserialize (copy, len + 8, TEST_FILESIZE));
+
+	/* not an index at all */
+	memcpy (copy, "MADX", 4);
+	CU_ASSERT_PTR_NULL (xmms_mad_seek_index_deserialize (copy, len, TEST_FILESIZE));
+
+	/* unknown version */
+	memcpy (copy, blob, len);
+	copy[4] = 2;
+	CU_ASSERT_PTR_NULL (xmms_mad_seek_index_deserialize (copy, len, TEST_FILESIZE));
+
+	g_free (copy);
+	g_free (blob);
+}
+
+/* Plays the part of the mad plugin: use the stored index if there is
+ * one, otherwise build one and store it.
+ */
+static gboolean
+xmms_seekindex_test_init (xmms_xform_t *xform)
+{
+	xmms_mad_seek_index_t *index;
+
+	index = xmms_mad_seek_index_load (xform, TEST_PROPERTY, TEST_FILESIZE);
+	if (index) {
+		loaded++;
+	} else {
+		index = build_index (8);
+		if (xmms_mad_seek_index_save (xform, TEST_PROPERTY, index, TEST_FILESIZE)) {
+			saved++;
+		}
+	}
+	xmms_mad_seek_index_free (index);
+
+	xmms_xform_outdata_type_add (xform,
+	                             XMMS_STREAM_TYPE_MIMETYPE, "audio/pcm",
+	                             XMMS_STREAM_TYPE_END);
+
+	return TRUE;
+}
+
+static gboolean
+xmms_seekindex_test_plugin_setup (xmms_xform_plugin_t *xform_plugin)
+{
+	xmms_xform_methods_t methods;
+
+	XMMS_XFORM_METHODS_INIT (methods);
+	methods.init = xmms_seekindex_test_init;
+	xmms_xform_plugin_methods_set (xform_plugin, &methods);
+
+	xmms_xform_plugin_indata_add (xform_plugin,
+	                              XMMS_STREAM_TYPE_MIMETYPE, "application/x-url",
+	                              XMMS_STREAM_TYPE_URL, "seekindextest://*",
+	                              XMMS_STREAM_TYPE_END);
+
+	return TRUE;
+}
+
+XMMS_XFORM_BUILTIN_DEFINE (seekindex_test,
+                           "seek index test xform",
+                           XMMS_VERSION,
+                           "seek index test xform",
+                           xmms_seekindex_test_plugin_setup);
+
+static gchar *
+setup_chain (xmms_medialib_entry_t entry)
+{
+	xmms_medialib_session_t *session;
+	xmms_stream_type_t *format;
+	xmms_xform_t *xform;
+	GList *goal_format;
+	gchar *hash = NULL;
+
+	format = _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                XMMS_STREAM_TYPE_MIMETYPE, "audio/pcm",
+	                                XMMS_STREAM_TYPE_END);
+	goal_format = g_list_prepend (NULL, format);
+
+	xform = xmms_xform_chain_setup_url (medialib, entry, "seekindextest://file",
+	                                    goal_format, TRUE);
+	CU_ASSERT_PTR_NOT_NULL (xform);
+	if (xform) {
+		xmms_object_unref (xform);
+	}
+
+	g_list_free (goal_format);
+	xmms_object_unref (format);
+
+	do {
+		g_free (hash);
+		session = xmms_medialib_session_begin_ro (medialib);
+		hash = xmms_medialib_entry_property_get_str (session, entry, TEST_PROPERTY);
+	} while (!xmms_medialib_session_commit (session));
+
+	return hash;
+}
+
+CASE (test_property_survives_chain_setup)
+{
+	xmms_medialib_session_t *session;
+	xmms_medialib_entry_t entry;
+	xmms_error_t err;
+	gchar *first, *hash;
+	gint i;
+
+	xmms_plugin_load (&xmms_builtin_seekindex_test, NULL);
+
+	xmms_error_reset (&err);
+	do {
+		session = xmms_medialib_session_begin (medialib);
+		entry = xmms_medialib_entry_new (session, "seekindextest://file", &err);
+	} while (!xmms_medialib_session_commit (session));
+	CU_ASSERT_TRUE_FATAL (entry > 0);
+
+	/* the first setup builds the index */
+	first = setup_chain (entry);
+	CU_ASSERT_PTR_NOT_NULL_FATAL (first);
+	CU_ASSERT_EQUAL (1, saved);
+	CU_ASSERT_EQUAL (0, loaded);
+
+	/* every one after that finds it, and leaves it for the next */
+	for (i = 1; i <= 2; i++) {
+		hash = setup_chain (entry);
+		CU_ASSERT_PTR_NOT_NULL (hash);
+		if (hash) {
+			CU_ASSERT_STRING_EQUAL (first, hash);
+		}
+		CU_ASSERT_EQUAL (1, saved);
+		CU_ASSERT_EQUAL (i, loaded);
+		g_free (hash);
+	}
+
+	g_free (first);
+}
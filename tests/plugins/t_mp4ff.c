@@ -0,0 +1,149 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include "xcu.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mp4ffint.h"
+
+static mp4ff_t *f;
+static mp4ff_track_t *t;
+
+/* stsc runs as {first chunk, samples per chunk} pairs */
+static void
+set_tables (const int32_t *stsc, int32_t runs, int32_t chunks, int32_t samples)
+{
+	int32_t i;
+
+	t->stsc_entry_count = runs;
+	t->stsc_first_chunk = calloc (runs, sizeof (int32_t));
+	t->stsc_samples_per_chunk = calloc (runs, sizeof (int32_t));
+	for (i = 0; i < runs; i++) {
+		t->stsc_first_chunk[i] = stsc[2 * i];
+		t->stsc_samples_per_chunk[i] = stsc[2 * i + 1];
+	}
+
+	/* chunk n at 1000 * n */
+	t->stco_entry_count = chunks;
+	t->stco_chunk_offset = calloc (chunks, sizeof (int32_t));
+	for (i = 0; i < chunks; i++) {
+		t->stco_chunk_offset[i] = 1000 * (i + 1);
+	}
+
+	t->stsz_sample_count = samples;
+	t->stsz_sample_size = 10;
+}
+
+SETUP (mp4ff) {
+	f = calloc (1, sizeof (mp4ff_t));
+	t = calloc (1, sizeof (mp4ff_track_t));
+	f->total_tracks = 1;
+	f->track[0] = t;
+	return 0;
+}
+
+CLEANUP () {
+	mp4ff_free_index (t);
+	free (t->stsc_first_chunk);
+	free (t->stsc_samples_per_chunk);
+	free (t->stco_chunk_offset);
+	free (t);
+	free (f);
+	return 0;
+}
+
+CASE (test_chunk_index)
+{
+	const int32_t stsc[] = { 1, 2, 3, 1 };
+	const int32_t expected[] = { 1000, 1010, 2000, 2010, 3000, 4000 };
+	int32_t i, chunk, chunk_sample;
+
+	set_tables (stsc, 2, 4, 6);
+	mp4ff_build_index (f);
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL (t->sample_file_offset);
+	CU_ASSERT_EQUAL (4, t->index_chunk_count);
+
+	for (i = 0; i < 6; i++) {
+		CU_ASSERT_EQUAL (expected[i], mp4ff_sample_to_offset (f, 0, i));
+	}
+
+	mp4ff_chunk_of_sample (f, 0, 3, &chunk_sample, &chunk);
+	CU_ASSERT_EQUAL (2, chunk);
+	CU_ASSERT_EQUAL (2, chunk_sample);
+}
+
+CASE (test_chunk_index_empty_run)
+{
+	/* the second chunk is empty, the third starts where it does */
+	const int32_t stsc[] = { 1, 2, 2, 0, 3, 2 };
+	const int32_t expected[] = { 1000, 1010, 3000, 3010 };
+	int32_t i, chunk, chunk_sample;
+
+	set_tables (stsc, 3, 3, 4);
+	mp4ff_build_index (f);
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL (t->sample_file_offset);
+	CU_ASSERT_EQUAL (3, t->index_chunk_count);
+
+	for (i = 0; i < 4; i++) {
+		CU_ASSERT_EQUAL (expected[i], mp4ff_sample_to_offset (f, 0, i));
+	}
+
+	mp4ff_chunk_of_sample (f, 0, 2, &chunk_sample, &chunk);
+	CU_ASSERT_EQUAL (3, chunk);
+	CU_ASSERT_EQUAL (2, chunk_sample);
+}
+
+CASE (test_chunk_index_runs_past_stco)
+{
+	/* an empty run claiming 134M chunks where the file has one */
+	const int32_t stsc[] = { 1, 0, 0x08000000, 1 };
+
+	set_tables (stsc, 2, 1, 10);
+	mp4ff_build_index (f);
+
+	CU_ASSERT_PTR_NULL (t->sample_file_offset);
+	CU_ASSERT_PTR_NULL (t->chunk_first_sample);
+	CU_ASSERT_EQUAL (0, t->index_chunk_count);
+}
+
+CASE (test_chunk_index_runs_not_increasing)
+{
+	const int32_t stsc[] = { 1, 1, 3, 1, 2, 1 };
+
+	set_tables (stsc, 3, 4, 4);
+	mp4ff_build_index (f);
+
+	CU_ASSERT_PTR_NULL (t->sample_file_offset);
+	CU_ASSERT_PTR_NULL (t->chunk_first_sample);
+}
+
+CASE (test_chunk_index_too_few_chunks)
+{
+	/* 3 samples per chunk, but only room for 6 of the 8 */
+	const int32_t stsc[] = { 1, 3 };
+
+	set_tables (stsc, 1, 2, 8);
+	mp4ff_build_index (f);
+
+	CU_ASSERT_PTR_NULL (t->sample_file_offset);
+
+	/* the linear lookups still work the way they always did */
+	CU_ASSERT_EQUAL (2010, mp4ff_sample_to_offset (f, 0, 4));
+}
@@ -0,0 +1,178 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <xmms/xmms_log.h>
+#include <xmms/xmms_bindata.h>
+#include <xmmspriv/xmms_log.h>
+#include <xmmspriv/xmms_ipc.h>
+#include <xmmspriv/xmms_config.h>
+#include <xmmspriv/xmms_bindata.h>
+
+#define DEFAULT_ALBUMS 200
+#define DEFAULT_TRACKS 12
+#define ART_SIZE (300 * 1024)
+
+/* How xmms_bindata_plugin_add used to store a blob, kept as the reference */
+static void
+reference_add (const gchar *dir, const guchar *data, gsize len, gchar hash[33])
+{
+	gchar *path;
+
+	xmms_bindata_calculate_md5 (data, len, hash);
+
+	path = g_build_filename (dir, hash, NULL);
+	if (!g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
+		g_file_set_contents (path, (const gchar *) data, len, NULL);
+	}
+	g_free (path);
+}
+
+static void
+remove_dir (const gchar *path)
+{
+	const gchar *name;
+	GDir *dir;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (dir) {
+		while ((name = g_dir_read_name (dir))) {
+			gchar *file = g_build_filename (path, name, NULL);
+			g_unlink (file);
+			g_free (file);
+		}
+		g_dir_close (dir);
+	}
+
+	g_rmdir (path);
+}
+
+static void
+quiet_log_handler (const gchar *log_domain, GLogLevelFlags log_level,
+                   const gchar *message, gpointer user_data)
+{
+	if (log_level & (G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL)) {
+		g_printerr ("%s: %s\n", log_domain, message);
+	}
+}
+
+/**
+ * Time an import where every track of an album carries the same cover
+ * art, with the old md5-per-add and with the bindata pre-check.
+ *
+ * Usage: bindata-bench [albums] [tracks per album]
+ */
+gint
+main (gint argc, gchar **argv)
+{
+	xmms_bindata_t *bindata;
+	gchar *refdir, *bindir;
+	guchar **art;
+	gint64 t0, t1, t2;
+	gint i, j, albums = DEFAULT_ALBUMS, tracks = DEFAULT_TRACKS;
+	gboolean ok = TRUE;
+
+	if (argc > 1) {
+		albums = MAX (1, atoi (argv[1]));
+	}
+
+	if (argc > 2) {
+		tracks = MAX (1, atoi (argv[2]));
+	}
+
+	xmms_log_init (0);
+	g_log_set_default_handler (quiet_log_handler, NULL);
+
+	xmms_ipc_init ();
+	xmms_config_init ("memory://");
+
+	refdir = g_dir_make_tmp ("xmms-bindata-ref-XXXXXX", NULL);
+	bindir = g_dir_make_tmp ("xmms-bindata-bench-XXXXXX", NULL);
+	if (!refdir || !bindir) {
+		g_printerr ("Could not create temporary directories\n");
+		return EXIT_FAILURE;
+	}
+
+	xmms_config_property_register ("bindata.path", bindir, NULL, NULL);
+	bindata = xmms_bindata_init ();
+
+	art = g_new (guchar *, albums);
+	for (i = 0; i < albums; i++) {
+		art[i] = g_malloc (ART_SIZE);
+		for (j = 0; j < ART_SIZE; j++) {
+			art[i][j] = g_random_int ();
+		}
+	}
+
+	t0 = g_get_monotonic_time ();
+	for (i = 0; i < albums; i++) {
+		for (j = 0; j < tracks; j++) {
+			gchar hash[33];
+			reference_add (refdir, art[i], ART_SIZE, hash);
+		}
+	}
+
+	t1 = g_get_monotonic_time ();
+	for (i = 0; i < albums; i++) {
+		for (j = 0; j < tracks; j++) {
+			gchar hash[33], expected[33];
+
+			if (!xmms_bindata_plugin_add (art[i], ART_SIZE, hash)) {
+				ok = FALSE;
+			}
+
+			if (j == 0) {
+				xmms_bindata_calculate_md5 (art[i], ART_SIZE, expected);
+				if (strcmp (hash, expected) != 0) {
+					g_printerr ("album %d stored as %s, expected %s\n",
+					            i, hash, expected);
+					ok = FALSE;
+				}
+			}
+		}
+	}
+
+	t2 = g_get_monotonic_time ();
+
+	g_print ("%d albums of %d tracks, %d byte cover art\n",
+	         albums, tracks, ART_SIZE);
+	g_print ("md5 per add  %8.2f us/track\n",
+	         (gdouble) (t1 - t0) / (albums * tracks));
+	g_print ("pre-check    %8.2f us/track  speedup %.1fx\n",
+	         (gdouble) (t2 - t1) / (albums * tracks),
+	         (gdouble) (t1 - t0) / MAX (1, t2 - t1));
+
+	for (i = 0; i < albums; i++) {
+		g_free (art[i]);
+	}
+	g_free (art);
+
+	xmms_object_unref (bindata);
+
+	remove_dir (refdir);
+	remove_dir (bindir);
+	g_free (refdir);
+	g_free (bindir);
+
+	xmms_config_shutdown ();
+	xmms_ipc_shutdown ();
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
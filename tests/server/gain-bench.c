@@ -0,0 +1,217 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include <glib.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <xmms/xmms_sample.h>
+
+#define CHANNELS 2
+#define BUFFER_SIZE 4096
+#define DEFAULT_SECONDS 600
+#define GAIN 1.7
+
+/*
+ * The per-sample loops replaygain used before the shared gain stage,
+ * kept here as the reference to compare against.
+ */
+static void
+reference_s16 (void *buf, gint len, gfloat gain)
+{
+	xmms_samples16_t *samples = (xmms_samples16_t *) buf;
+	gint i;
+
+	for (i = 0; i < len; i++) {
+		gfloat sample = samples[i] * gain;
+		samples[i] = CLAMP (sample, XMMS_SAMPLES16_MIN,
+		                    XMMS_SAMPLES16_MAX);
+	}
+}
+
+static void
+reference_s32 (void *buf, gint len, gfloat gain)
+{
+	xmms_samples32_t *samples = (xmms_samples32_t *) buf;
+	gint i;
+
+	for (i = 0; i < len; i++) {
+		gdouble sample = samples[i] * gain;
+		samples[i] = CLAMP (sample, XMMS_SAMPLES32_MIN,
+		                    XMMS_SAMPLES32_MAX);
+	}
+}
+
+static void
+reference_float (void *buf, gint len, gfloat gain)
+{
+	xmms_samplefloat_t *samples = (xmms_samplefloat_t *) buf;
+	gint i;
+
+	for (i = 0; i < len; i++) {
+		samples[i] *= gain;
+	}
+}
+
+typedef struct {
+	xmms_sample_format_t format;
+	void (*reference) (void *buf, gint len, gfloat gain);
+} bench_format_t;
+
+static const bench_format_t bench_formats[] = {
+	{ XMMS_SAMPLE_FORMAT_S16, reference_s16 },
+	{ XMMS_SAMPLE_FORMAT_S32, reference_s32 },
+	{ XMMS_SAMPLE_FORMAT_FLOAT, reference_float },
+};
+
+/* A loud sine, so that a fair share of the samples saturate */
+static void
+fill (xmms_sample_format_t format, void *buf, gint samples)
+{
+	gint i;
+
+	for (i = 0; i < samples; i++) {
+		gdouble v = 0.9 * sin (i / CHANNELS * 0.01);
+
+		switch (format) {
+			case XMMS_SAMPLE_FORMAT_S16:
+				((xmms_samples16_t *) buf)[i] = v * XMMS_SAMPLES16_MAX;
+				break;
+			case XMMS_SAMPLE_FORMAT_S32:
+				((xmms_samples32_t *) buf)[i] = v * XMMS_SAMPLES32_MAX;
+				break;
+			case XMMS_SAMPLE_FORMAT_FLOAT:
+				((xmms_samplefloat_t *) buf)[i] = v;
+				break;
+			default:
+				g_assert_not_reached ();
+		}
+	}
+}
+
+static gdouble
+max_difference (xmms_sample_format_t format, void *a, void *b, gint samples)
+{
+	gdouble diff, max = 0.0;
+	gint i;
+
+	for (i = 0; i < samples; i++) {
+		switch (format) {
+			case XMMS_SAMPLE_FORMAT_S16:
+				diff = ((xmms_samples16_t *) a)[i] - ((xmms_samples16_t *) b)[i];
+				break;
+			case XMMS_SAMPLE_FORMAT_S32:
+				/* the reference loses precision by multiplying in float */
+				diff = (((gdouble) ((xmms_samples32_t *) a)[i]) -
+				        ((xmms_samples32_t *) b)[i]) / 256.0;
+				break;
+			case XMMS_SAMPLE_FORMAT_FLOAT:
+				diff = (((xmms_samplefloat_t *) a)[i] -
+				        ((xmms_samplefloat_t *) b)[i]) * XMMS_SAMPLES16_MAX;
+				break;
+			default:
+				g_assert_not_reached ();
+		}
+		max = MAX (max, fabs (diff));
+	}
+
+	return max;
+}
+
+/**
+ * Time the reference loop and the gain stage on the same audio,
+ * a buffer at a time like replaygain sees it.
+ */
+static gboolean
+run_format (const bench_format_t *bench, gint seconds)
+{
+	xmms_sample_gain_t *stage;
+	gint sample_size, samples, buffers, i;
+	gint64 t0, t1, t2;
+	gdouble reference_ns, stage_ns, diff;
+	guchar *src, *a, *b;
+
+	sample_size = xmms_sample_size_get (bench->format);
+	samples = BUFFER_SIZE / sample_size;
+	buffers = seconds * 44100 * CHANNELS / samples;
+
+	src = g_malloc (BUFFER_SIZE);
+	a = g_malloc (BUFFER_SIZE);
+	b = g_malloc (BUFFER_SIZE);
+
+	fill (bench->format, src, samples);
+
+	t0 = g_get_monotonic_time ();
+	for (i = 0; i < buffers; i++) {
+		memcpy (a, src, BUFFER_SIZE);
+		bench->reference (a, samples, GAIN);
+	}
+
+	t1 = g_get_monotonic_time ();
+
+	stage = xmms_sample_gain_new (bench->format, CHANNELS);
+	xmms_sample_gain_set (stage, GAIN, 0);
+	for (i = 0; i < buffers; i++) {
+		memcpy (b, src, BUFFER_SIZE);
+		xmms_sample_gain_apply (stage, b, BUFFER_SIZE);
+	}
+
+	t2 = g_get_monotonic_time ();
+
+	diff = max_difference (bench->format, a, b, samples);
+
+	reference_ns = (t1 - t0) * 1000.0 / ((gdouble) buffers * samples);
+	stage_ns = (t2 - t1) * 1000.0 / ((gdouble) buffers * samples);
+
+	g_print ("%-6s reference %6.3f ns/sample  gain stage %6.3f ns/sample  "
+	         "speedup %5.2fx  max diff %.2f\n",
+	         xmms_sample_name_get (bench->format), reference_ns, stage_ns,
+	         reference_ns / stage_ns, diff);
+
+	xmms_sample_gain_free (stage);
+	g_free (src);
+	g_free (a);
+	g_free (b);
+
+	/* rounding may differ by one step, anything more is a bug */
+	return diff <= 1.0;
+}
+
+/**
+ * Compare the shared gain stage against the old replaygain loops.
+ *
+ * Usage: gain-bench [seconds of stereo audio per format]
+ */
+gint
+main (gint argc, gchar **argv)
+{
+	gint i, seconds = DEFAULT_SECONDS;
+	gboolean ok = TRUE;
+
+	if (argc > 1) {
+		seconds = MAX (1, atoi (argv[1]));
+	}
+
+	g_print ("%d seconds of 44.1kHz stereo, %d byte buffers, gain %.2f\n",
+	         seconds, BUFFER_SIZE, GAIN);
+
+	for (i = 0; i < G_N_ELEMENTS (bench_formats); i++) {
+		ok &= run_format (&bench_formats[i], seconds);
+	}
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,76 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+/* A plugin for the plugin manifest tests in t_plugin.c */
+
+#include <glib.h>
+
+#include <xmms/xmms_xformplugin.h>
+
+static gboolean xmms_manifest_test_setup (xmms_xform_plugin_t *xform_plugin);
+
+XMMS_XFORM_PLUGIN_DEFINE ("manifest_test",
+                          "Manifest Test",
+                          "1.0",
+                          "Registers a bit of everything",
+                          xmms_manifest_test_setup);
+
+static gpointer
+xmms_manifest_test_elsewhere (gpointer udata)
+{
+	xmms_magic_extension_add ("application/x-manifest-test", "*.elsewhere");
+
+	return NULL;
+}
+
+static gboolean
+xmms_manifest_test_init (xmms_xform_t *xform)
+{
+	return TRUE;
+}
+
+static gboolean
+xmms_manifest_test_setup (xmms_xform_plugin_t *xform_plugin)
+{
+	xmms_xform_methods_t methods;
+	GThread *thread;
+
+	/* for the tests of plugins that fail to load */
+	if (g_getenv ("MANIFEST_TEST_FAIL")) {
+		return FALSE;
+	}
+
+	XMMS_XFORM_METHODS_INIT (methods);
+	methods.init = xmms_manifest_test_init;
+
+	xmms_xform_plugin_methods_set (xform_plugin, &methods);
+
+	xmms_xform_plugin_indata_add (xform_plugin,
+	                              XMMS_STREAM_TYPE_MIMETYPE,
+	                              "application/x-manifest-test",
+	                              XMMS_STREAM_TYPE_END);
+
+	xmms_xform_plugin_config_property_register (xform_plugin, "answer",
+	                                            "42", NULL, NULL);
+
+	xmms_magic_extension_add ("application/x-manifest-test", "*.mt");
+
+	/* stands in for another thread registering something meanwhile */
+	thread = g_thread_new ("manifest test", xmms_manifest_test_elsewhere, NULL);
+	g_thread_join (thread);
+
+	return TRUE;
+}
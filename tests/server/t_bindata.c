@@ -0,0 +1,439 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include "xcu.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#include <xmmspriv/xmms_bindata.h>
+#include <xmmspriv/xmms_config.h>
+#include <xmmspriv/xmms_log.h>
+#include <xmmspriv/xmms_ipc.h>
+
+#include "server-utils/ipc_call.h"
+
+#define BLOB_SIZE 400
+
+static xmms_bindata_t *bindata;
+static gchar *bindir;
+
+SETUP (bindata)
+{
+	xmms_ipc_init ();
+	xmms_log_init (0);
+
+	xmms_config_init ("memory://");
+
+	bindir = g_dir_make_tmp ("xmms-t-bindata-XXXXXX", NULL);
+	xmms_config_property_register ("bindata.path", bindir, NULL, NULL);
+
+	/* room for two blobs */
+	xmms_config_property_register ("bindata.cache_size", "1000", NULL, NULL);
+
+	bindata = xmms_bindata_init ();
+
+	return 1;
+}
+
+CLEANUP ()
+{
+	const gchar *name;
+	GDir *dir;
+
+	xmms_object_unref (bindata); bindata = NULL;
+
+	dir = g_dir_open (bindir, 0, NULL);
+	while ((name = g_dir_read_name (dir))) {
+		gchar *path = g_build_filename (bindir, name, NULL);
+		g_unlink (path);
+		g_free (path);
+	}
+	g_dir_close (dir);
+	g_rmdir (bindir);
+	g_free (bindir); bindir = NULL;
+
+	xmms_config_shutdown ();
+	xmms_ipc_shutdown ();
+
+	return 0;
+}
+
+static gchar *
+add_data (const guchar *data, gsize len)
+{
+	const gchar *hash;
+	xmmsv_t *result;
+	gchar *ret;
+
+	result = XMMS_IPC_CALL (bindata, XMMS_IPC_COMMAND_BINDATA_ADD,
+	                        xmmsv_new_bin (data, len));
+	CU_ASSERT (xmmsv_get_string (result, &hash));
+	ret = g_strdup (hash);
+	xmmsv_unref (result);
+
+	return ret;
+}
+
+static gchar *
+add_blob (guchar fill)
+{
+	guchar data[BLOB_SIZE];
+
+	memset (data, fill, sizeof (data));
+
+	return add_data (data, sizeof (data));
+}
+
+/* xxHash64, as used to find known blobs before doing the md5 */
+#define PRIME64_1 G_GUINT64_CONSTANT (0x9E3779B185EBCA87)
+#define PRIME64_2 G_GUINT64_CONSTANT (0xC2B2AE3D27D4EB4F)
+
+static guint64
+rotl64 (guint64 x, gint r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static guint64
+xxh64_round (guint64 acc, guint64 input)
+{
+	return rotl64 (acc + input * PRIME64_2, 31) * PRIME64_1;
+}
+
+/* multiplicative inverse of an odd number modulo 2^64 */
+static guint64
+inverse64 (guint64 a)
+{
+	guint64 x = a;
+	gint i;
+
+	for (i = 0; i < 5; i++) {
+		x *= 2 - a * x;
+	}
+
+	return x;
+}
+
+static void
+put64 (guchar *p, guint64 v)
+{
+	v = GUINT64_TO_LE (v);
+	memcpy (p, &v, sizeof (v));
+}
+
+static guint64
+get64 (const guchar *p)
+{
+	guint64 v;
+	memcpy (&v, p, sizeof (v));
+	return GUINT64_FROM_LE (v);
+}
+
+/* Make b differ from a but hash the same: change the first lane of
+ * the first stripe, then pick its second stripe so that the lane ends
+ * up in the same state. A round is invertible in its input.
+ */
+static void
+make_collision (const guchar *a, guchar *b, gsize len)
+{
+	guint64 v1 = PRIME64_1 + PRIME64_2;
+	guint64 target, acc;
+
+	g_assert (len >= 64);
+
+	memcpy (b, a, len);
+	put64 (b, get64 (a) ^ 1);
+
+	target = xxh64_round (xxh64_round (v1, get64 (a)), get64 (a + 32));
+	acc = xxh64_round (v1, get64 (b));
+
+	put64 (b + 32, ((rotl64 (target * inverse64 (PRIME64_1), 33) - acc)
+	                * inverse64 (PRIME64_2)));
+	g_assert (xxh64_round (acc, get64 (b + 32)) == target);
+}
+
+static gboolean
+retrieve_blob (const gchar *hash, guchar fill)
+{
+	xmmsv_t *result;
+	const guchar *data;
+	guint len;
+	gboolean ret;
+
+	result = XMMS_IPC_CALL (bindata, XMMS_IPC_COMMAND_BINDATA_RETRIEVE,
+	                        xmmsv_new_string (hash));
+	ret = xmmsv_get_bin (result, &data, &len);
+	if (ret) {
+		CU_ASSERT_EQUAL (BLOB_SIZE, len);
+		CU_ASSERT_EQUAL (fill, data[0]);
+		CU_ASSERT_EQUAL (fill, data[BLOB_SIZE - 1]);
+	}
+	xmmsv_unref (result);
+
+	return ret;
+}
+
+static void
+remove_blob (const gchar *hash)
+{
+	xmmsv_t *result;
+
+	result = XMMS_IPC_CALL (bindata, XMMS_IPC_COMMAND_BINDATA_REMOVE,
+	                        xmmsv_new_string (hash));
+	CU_ASSERT_FALSE (xmmsv_is_type (result, XMMSV_TYPE_ERROR));
+	xmmsv_unref (result);
+}
+
+static gint
+cache_stat (const gchar *key)
+{
+	xmmsv_t *stats;
+	gint value = -1;
+
+	stats = XMMS_IPC_CALL (bindata, XMMS_IPC_COMMAND_BINDATA_CACHE_STATS, NULL);
+	CU_ASSERT (xmmsv_dict_entry_get_int (stats, key, &value));
+	xmmsv_unref (stats);
+
+	return value;
+}
+
+CASE (test_retrieve_cached)
+{
+	xmmsv_t *first, *second;
+	const guchar *data;
+	guint len;
+	gchar *hash;
+
+	hash = add_blob ('a');
+
+	first = XMMS_IPC_CALL (bindata, XMMS_IPC_COMMAND_BINDATA_RETRIEVE,
+	                       xmmsv_new_string (hash));
+	CU_ASSERT (xmmsv_get_bin (first, &data, &len));
+	CU_ASSERT_EQUAL (BLOB_SIZE, len);
+	CU_ASSERT_EQUAL ('a', data[0]);
+
+	/* shared from the cache, so nobody gets to change it */
+	CU_ASSERT_TRUE (xmmsv_is_frozen (first));
+
+	CU_ASSERT_EQUAL (0, cache_stat ("hits"));
+	CU_ASSERT_EQUAL (1, cache_stat ("misses"));
+	CU_ASSERT_EQUAL (1, cache_stat ("entries"));
+	CU_ASSERT_EQUAL (BLOB_SIZE, cache_stat ("size"));
+	CU_ASSERT_EQUAL (1000, cache_stat ("limit"));
+
+	/* a hit hands out the cached value itself */
+	second = XMMS_IPC_CALL (bindata, XMMS_IPC_COMMAND_BINDATA_RETRIEVE,
+	                        xmmsv_new_string (hash));
+	CU_ASSERT_PTR_EQUAL (first, second);
+	CU_ASSERT_EQUAL (1, cache_stat ("hits"));
+	CU_ASSERT_EQUAL (1, cache_stat ("misses"));
+
+	xmmsv_unref (first);
+	xmmsv_unref (second);
+	g_free (hash);
+}
+
+CASE (test_remove_invalidates)
+{
+	xmmsv_t *result;
+	gchar *hash;
+
+	hash = add_blob ('b');
+
+	result = XMMS_IPC_CALL (bindata, XMMS_IPC_COMMAND_BINDATA_RETRIEVE,
+	                        xmmsv_new_string (hash));
+	CU_ASSERT (xmmsv_is_type (result, XMMSV_TYPE_BIN));
+	xmmsv_unref (result);
+
+	result = XMMS_IPC_CALL (bindata, XMMS_IPC_COMMAND_BINDATA_REMOVE,
+	                        xmmsv_new_string (hash));
+	xmmsv_unref (result);
+
+	CU_ASSERT_EQUAL (0, cache_stat ("entries"));
+	CU_ASSERT_EQUAL (0, cache_stat ("size"));
+
+	result = XMMS_IPC_CALL (bindata, XMMS_IPC_COMMAND_BINDATA_RETRIEVE,
+	                        xmmsv_new_string (hash));
+	CU_ASSERT (xmmsv_is_type (result, XMMSV_TYPE_ERROR));
+	xmmsv_unref (result);
+
+	g_free (hash);
+}
+
+CASE (test_size_limit)
+{
+	xmms_config_property_t *cv;
+	xmmsv_t *result;
+	gchar *hashes[3];
+	gint i;
+
+	for (i = 0; i < 3; i++) {
+		hashes[i] = add_blob ('c' + i);
+		result = XMMS_IPC_CALL (bindata, XMMS_IPC_COMMAND_BINDATA_RETRIEVE,
+		                        xmmsv_new_string (hashes[i]));
+		xmmsv_unref (result);
+	}
+
+	/* the least recently used one made room for the third */
+	CU_ASSERT_EQUAL (2, cache_stat ("entries"));
+	CU_ASSERT_EQUAL (2 * BLOB_SIZE, cache_stat ("size"));
+
+	result = XMMS_IPC_CALL (bindata, XMMS_IPC_COMMAND_BINDATA_RETRIEVE,
+	                        xmmsv_new_string (hashes[0]));
+	CU_ASSERT (xmmsv_is_type (result, XMMSV_TYPE_BIN));
+	xmmsv_unref (result);
+
+	CU_ASSERT_EQUAL (0, cache_stat ("hits"));
+	CU_ASSERT_EQUAL (4, cache_stat ("misses"));
+
+	/* shrinking the limit drops what no longer fits */
+	cv = xmms_config_lookup ("bindata.cache_size");
+	xmms_config_property_set_data (cv, "500");
+
+	CU_ASSERT_EQUAL (1, cache_stat ("entries"));
+	CU_ASSERT_EQUAL (BLOB_SIZE, cache_stat ("size"));
+
+	/* and the most recently used one stays */
+	result = XMMS_IPC_CALL (bindata, XMMS_IPC_COMMAND_BINDATA_RETRIEVE,
+	                        xmmsv_new_string (hashes[0]));
+	xmmsv_unref (result);
+	CU_ASSERT_EQUAL (1, cache_stat ("hits"));
+
+	for (i = 0; i < 3; i++) {
+		g_free (hashes[i]);
+	}
+}
+
+CASE (test_eviction_order)
+{
+	gchar *a, *b, *c;
+
+	a = add_blob ('a');
+	b = add_blob ('b');
+	c = add_blob ('c');
+
+	CU_ASSERT (retrieve_blob (a, 'a'));
+	CU_ASSERT (retrieve_blob (b, 'b'));
+
+	/* a is used again, which leaves b the least recently used */
+	CU_ASSERT (retrieve_blob (a, 'a'));
+	CU_ASSERT_EQUAL (1, cache_stat ("hits"));
+
+	CU_ASSERT (retrieve_blob (c, 'c'));
+	CU_ASSERT_EQUAL (2, cache_stat ("entries"));
+	CU_ASSERT_EQUAL (3, cache_stat ("misses"));
+
+	CU_ASSERT (retrieve_blob (a, 'a'));
+	CU_ASSERT_EQUAL (2, cache_stat ("hits"));
+
+	/* b was dropped, reading it back in drops c */
+	CU_ASSERT (retrieve_blob (b, 'b'));
+	CU_ASSERT_EQUAL (4, cache_stat ("misses"));
+
+	CU_ASSERT (retrieve_blob (a, 'a'));
+	CU_ASSERT (retrieve_blob (b, 'b'));
+	CU_ASSERT_EQUAL (4, cache_stat ("hits"));
+
+	CU_ASSERT (retrieve_blob (c, 'c'));
+	CU_ASSERT_EQUAL (5, cache_stat ("misses"));
+
+	CU_ASSERT_EQUAL (2, cache_stat ("entries"));
+	CU_ASSERT_EQUAL (2 * BLOB_SIZE, cache_stat ("size"));
+
+	g_free (a);
+	g_free (b);
+	g_free (c);
+}
+
+CASE (test_remove_keeps_others)
+{
+	gchar *a, *b, *again;
+
+	a = add_blob ('a');
+	b = add_blob ('b');
+
+	CU_ASSERT (retrieve_blob (a, 'a'));
+	CU_ASSERT (retrieve_blob (b, 'b'));
+	CU_ASSERT_EQUAL (2, cache_stat ("entries"));
+
+	remove_blob (a);
+
+	/* only a's entry goes */
+	CU_ASSERT_EQUAL (1, cache_stat ("entries"));
+	CU_ASSERT_EQUAL (BLOB_SIZE, cache_stat ("size"));
+
+	CU_ASSERT (retrieve_blob (b, 'b'));
+	CU_ASSERT_EQUAL (1, cache_stat ("hits"));
+
+	/* a failed retrieve caches nothing */
+	CU_ASSERT_FALSE (retrieve_blob (a, 'a'));
+	CU_ASSERT_EQUAL (1, cache_stat ("entries"));
+
+	/* adding a again has to write it out again, not just hand back
+	 * the hash it had before
+	 */
+	again = add_blob ('a');
+	CU_ASSERT_STRING_EQUAL (a, again);
+	CU_ASSERT (retrieve_blob (a, 'a'));
+	CU_ASSERT_EQUAL (2, cache_stat ("entries"));
+
+	g_free (again);
+	g_free (a);
+	g_free (b);
+}
+
+CASE (test_fast_hash_collision)
+{
+	guchar a[BLOB_SIZE], b[BLOB_SIZE];
+	xmmsv_t *result;
+	const guchar *data;
+	gchar *hash_a, *hash_b, *again;
+	guint len;
+	gint i;
+
+	for (i = 0; i < BLOB_SIZE; i++) {
+		a[i] = i * 7;
+	}
+	make_collision (a, b, BLOB_SIZE);
+	CU_ASSERT (memcmp (a, b, BLOB_SIZE) != 0);
+
+	hash_a = add_data (a, BLOB_SIZE);
+	hash_b = add_data (b, BLOB_SIZE);
+
+	/* same size and fast hash, still two blobs */
+	CU_ASSERT_STRING_NOT_EQUAL (hash_a, hash_b);
+
+	result = XMMS_IPC_CALL (bindata, XMMS_IPC_COMMAND_BINDATA_RETRIEVE,
+	                        xmmsv_new_string (hash_b));
+	CU_ASSERT (xmmsv_get_bin (result, &data, &len));
+	CU_ASSERT_EQUAL (BLOB_SIZE, len);
+	CU_ASSERT (memcmp (data, b, BLOB_SIZE) == 0);
+	xmmsv_unref (result);
+
+	/* and both are still found again */
+	again = add_data (a, BLOB_SIZE);
+	CU_ASSERT_STRING_EQUAL (hash_a, again);
+	g_free (again);
+
+	again = add_data (b, BLOB_SIZE);
+	CU_ASSERT_STRING_EQUAL (hash_b, again);
+	g_free (again);
+
+	g_free (hash_a);
+	g_free (hash_b);
+}
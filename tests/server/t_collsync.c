@@ -0,0 +1,377 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include "xcu.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <xmmspriv/xmms_log.h>
+#include <xmmspriv/xmms_ipc.h>
+#include <xmmspriv/xmms_config.h>
+#include <xmmspriv/xmms_medialib.h>
+#include <xmmspriv/xmms_collection.h>
+#include <xmmspriv/xmms_collsync.h>
+#include <xmmspriv/xmms_playlist.h>
+
+#include "server-utils/ipc_call.h"
+
+static xmms_medialib_t *medialib;
+static xmms_coll_dag_t *dag;
+static xmms_playlist_t *playlist;
+static xmms_coll_sync_t *collsync;
+
+static gchar *dbdir, *dbpath, *journal;
+
+/* Tear down the synchronizer, which writes pending changes on the way out. */
+static void
+shutdown_sync (void)
+{
+	xmms_object_unref (collsync); collsync = NULL;
+	xmms_object_unref (playlist); playlist = NULL;
+	xmms_object_unref (dag); dag = NULL;
+}
+
+/* Restore from disk into a fresh collection dag. */
+static void
+reopen (void)
+{
+	if (collsync != NULL) {
+		shutdown_sync ();
+	}
+
+	dag = xmms_collection_init (medialib);
+	playlist = xmms_playlist_init (medialib, dag);
+	collsync = xmms_coll_sync_init ("unittest", dag, playlist);
+}
+
+SETUP (collsync) {
+	xmms_ipc_init ();
+	xmms_log_init (0);
+
+	xmms_config_init ("memory://");
+	xmms_config_property_register ("medialib.path", "memory://", NULL, NULL);
+	xmms_config_property_register ("playlist.repeat_one", "0", NULL, NULL);
+	xmms_config_property_register ("playlist.repeat_all", "0", NULL, NULL);
+
+	dbdir = g_dir_make_tmp ("xmms-t-collsync-XXXXXX", NULL);
+	dbpath = g_build_filename (dbdir, "collections.db", NULL);
+	journal = g_strconcat (dbpath, ".journal", NULL);
+	xmms_config_property_register ("collection.directory", dbpath, NULL, NULL);
+
+	medialib = xmms_medialib_init ();
+
+	reopen ();
+
+	return 0;
+}
+
+CLEANUP () {
+	shutdown_sync ();
+	xmms_object_unref (medialib); medialib = NULL;
+
+	g_unlink (journal);
+	g_unlink (dbpath);
+	g_rmdir (dbdir);
+
+	g_free (journal); journal = NULL;
+	g_free (dbpath); dbpath = NULL;
+	g_free (dbdir); dbdir = NULL;
+
+	xmms_config_shutdown ();
+	xmms_ipc_shutdown ();
+
+	return 0;
+}
+
+static void
+save_idlist (const gchar *name, gint size)
+{
+	xmmsv_t *coll, *result;
+	gint i;
+
+	coll = xmmsv_new_coll (XMMS_COLLECTION_TYPE_IDLIST);
+	for (i = 0; i < size; i++) {
+		xmmsv_coll_idlist_append (coll, i + 1);
+	}
+
+	result = XMMS_IPC_CALL (dag, XMMS_IPC_COMMAND_COLLECTION_SAVE,
+	                        xmmsv_new_string (name),
+	                        xmmsv_new_string (XMMS_COLLECTION_NS_COLLECTIONS),
+	                        coll);
+	CU_ASSERT (xmmsv_is_type (result, XMMSV_TYPE_NONE));
+	xmmsv_unref (result);
+}
+
+static void
+remove_collection (const gchar *name)
+{
+	xmmsv_t *result;
+
+	result = XMMS_IPC_CALL (dag, XMMS_IPC_COMMAND_COLLECTION_REMOVE,
+	                        xmmsv_new_string (name),
+	                        xmmsv_new_string (XMMS_COLLECTION_NS_COLLECTIONS));
+	CU_ASSERT (xmmsv_is_type (result, XMMSV_TYPE_NONE));
+	xmmsv_unref (result);
+}
+
+static void
+save_playlist (const gchar *name, gint size)
+{
+	xmmsv_t *coll, *result;
+	gint i;
+
+	coll = xmmsv_new_coll (XMMS_COLLECTION_TYPE_IDLIST);
+	for (i = 0; i < size; i++) {
+		xmmsv_coll_idlist_append (coll, i + 1);
+	}
+
+	result = XMMS_IPC_CALL (dag, XMMS_IPC_COMMAND_COLLECTION_SAVE,
+	                        xmmsv_new_string (name),
+	                        xmmsv_new_string (XMMS_COLLECTION_NS_PLAYLISTS),
+	                        coll);
+	CU_ASSERT (xmmsv_is_type (result, XMMSV_TYPE_NONE));
+	xmmsv_unref (result);
+
+	result = XMMS_IPC_CALL (playlist, XMMS_IPC_COMMAND_PLAYLIST_LOAD,
+	                        xmmsv_new_string (name));
+	CU_ASSERT (xmmsv_is_type (result, XMMSV_TYPE_NONE));
+	xmmsv_unref (result);
+}
+
+static void
+set_next (gint position)
+{
+	xmmsv_t *result;
+
+	result = XMMS_IPC_CALL (playlist, XMMS_IPC_COMMAND_PLAYLIST_SET_NEXT,
+	                        xmmsv_new_int (position));
+	CU_ASSERT (xmmsv_is_type (result, XMMSV_TYPE_INT64));
+	xmmsv_unref (result);
+}
+
+/* The restored position of a playlist, or -2 if it has none. */
+static gint
+playlist_position (const gchar *name)
+{
+	xmmsv_t *coll;
+	gint position;
+
+	coll = xmms_collection_get_pointer (dag, name, XMMS_COLLECTION_NSID_PLAYLISTS);
+	if (coll == NULL || !xmms_collection_get_int_attr (coll, "position", &position))
+		return -2;
+
+	return position;
+}
+
+/* The size of a restored idlist, or -1 if it's missing. */
+static gint
+idlist_size (const gchar *name)
+{
+	xmmsv_t *coll;
+
+	coll = xmms_collection_get_pointer (dag, name, XMMS_COLLECTION_NSID_COLLECTIONS);
+	if (coll == NULL)
+		return -1;
+
+	return xmmsv_coll_idlist_get_size (coll);
+}
+
+static gsize
+file_size (const gchar *path)
+{
+	GStatBuf st;
+
+	if (g_stat (path, &st) != 0)
+		return 0;
+
+	return st.st_size;
+}
+
+static gchar *
+file_contents (const gchar *path, gsize *length)
+{
+	gchar *contents = NULL;
+
+	CU_ASSERT (g_file_get_contents (path, &contents, length, NULL));
+
+	return contents;
+}
+
+CASE (test_journal_append_and_replay)
+{
+	gchar *checkpoint, *current;
+	gsize length, current_length;
+
+	/* the first collsync writes a checkpoint */
+	save_idlist ("First", 1);
+	reopen ();
+
+	CU_ASSERT_EQUAL (1, idlist_size ("First"));
+	CU_ASSERT (g_file_test (dbpath, G_FILE_TEST_IS_REGULAR));
+
+	checkpoint = file_contents (dbpath, &length);
+
+	/* and later changes only go to the journal */
+	save_idlist ("Second", 2);
+	save_idlist ("First", 3);
+	reopen ();
+
+	current = file_contents (dbpath, &current_length);
+	CU_ASSERT_EQUAL (length, current_length);
+	CU_ASSERT (memcmp (checkpoint, current, length) == 0);
+	CU_ASSERT (file_size (journal) > 0);
+
+	CU_ASSERT_EQUAL (3, idlist_size ("First"));
+	CU_ASSERT_EQUAL (2, idlist_size ("Second"));
+
+	/* replay leaves the journal in place for further changes */
+	save_idlist ("Second", 4);
+	reopen ();
+
+	CU_ASSERT_EQUAL (3, idlist_size ("First"));
+	CU_ASSERT_EQUAL (4, idlist_size ("Second"));
+
+	g_free (checkpoint);
+	g_free (current);
+}
+
+CASE (test_journal_remove_checkpoints)
+{
+	save_idlist ("First", 1);
+	reopen ();
+
+	save_idlist ("Second", 2);
+	reopen ();
+	CU_ASSERT (file_size (journal) > 0);
+
+	/* removals touch other collections too, and replace the journal */
+	remove_collection ("First");
+	reopen ();
+
+	CU_ASSERT_FALSE (g_file_test (journal, G_FILE_TEST_EXISTS));
+	CU_ASSERT_EQUAL (-1, idlist_size ("First"));
+	CU_ASSERT_EQUAL (2, idlist_size ("Second"));
+}
+
+CASE (test_journal_truncated)
+{
+	gsize length;
+
+	save_idlist ("First", 1);
+	reopen ();
+
+	save_idlist ("Second", 2);
+	reopen ();
+
+	length = file_size (journal);
+
+	save_idlist ("Third", 3);
+	shutdown_sync ();
+
+	/* a crash in the middle of appending the last record */
+	CU_ASSERT (file_size (journal) > length);
+	CU_ASSERT_EQUAL (0, truncate (journal, file_size (journal) - 1));
+
+	reopen ();
+
+	CU_ASSERT_EQUAL (1, idlist_size ("First"));
+	CU_ASSERT_EQUAL (2, idlist_size ("Second"));
+	CU_ASSERT_EQUAL (-1, idlist_size ("Third"));
+
+	/* the damaged journal is folded into a new checkpoint on the next collsync */
+	reopen ();
+
+	CU_ASSERT_FALSE (g_file_test (journal, G_FILE_TEST_EXISTS));
+	CU_ASSERT_EQUAL (1, idlist_size ("First"));
+	CU_ASSERT_EQUAL (2, idlist_size ("Second"));
+
+	save_idlist ("Fourth", 4);
+	reopen ();
+
+	CU_ASSERT (file_size (journal) > 0);
+	CU_ASSERT_EQUAL (4, idlist_size ("Fourth"));
+}
+
+CASE (test_journal_stale)
+{
+	gchar *stale;
+	gsize length;
+
+	save_idlist ("First", 1);
+	reopen ();
+
+	save_idlist ("First", 2);
+	reopen ();
+
+	stale = file_contents (journal, &length);
+
+	/* a checkpoint that crashed before it could remove the journal */
+	save_idlist ("First", 3);
+	save_idlist ("Second", 1);
+	remove_collection ("Second");
+	shutdown_sync ();
+
+	CU_ASSERT (g_file_set_contents (journal, stale, length, NULL));
+	reopen ();
+
+	/* the journal of the old checkpoint must not roll it back */
+	CU_ASSERT_EQUAL (3, idlist_size ("First"));
+
+	/* and is thrown away rather than appended to */
+	CU_ASSERT_FALSE (g_file_test (journal, G_FILE_TEST_EXISTS));
+
+	save_idlist ("Second", 2);
+	reopen ();
+
+	CU_ASSERT_EQUAL (3, idlist_size ("First"));
+	CU_ASSERT_EQUAL (2, idlist_size ("Second"));
+
+	g_free (stale);
+}
+
+CASE (test_journal_position_only)
+{
+	gsize length;
+
+	save_playlist ("Big", 5000);
+	reopen ();
+
+	CU_ASSERT_EQUAL (-2, playlist_position ("Big"));
+
+	/* moving on in a playlist journals the position, not the playlist */
+	length = file_size (journal);
+	set_next (3);
+	set_next (4);
+	reopen ();
+
+	CU_ASSERT (file_size (journal) > length);
+	CU_ASSERT (file_size (journal) - length < 200);
+	CU_ASSERT_EQUAL (4, playlist_position ("Big"));
+
+	/* and it sticks across another replay and a checkpoint */
+	save_idlist ("Other", 1);
+	reopen ();
+	CU_ASSERT_EQUAL (4, playlist_position ("Big"));
+
+	remove_collection ("Other");
+	reopen ();
+	CU_ASSERT_FALSE (g_file_test (journal, G_FILE_TEST_EXISTS));
+	CU_ASSERT_EQUAL (4, playlist_position ("Big"));
+}
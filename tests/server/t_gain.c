@@ -0,0 +1,152 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include "xcu.h"
+
+#include <glib.h>
+
+#include <xmms/xmms_sample.h>
+
+SETUP (gain) {
+	return 0;
+}
+
+CLEANUP () {
+	return 0;
+}
+
+CASE (test_gain_unity)
+{
+	xmms_sample_gain_t *gain;
+	gint16 samples[4] = { 1000, -1000, 32767, -32768 };
+
+	CU_ASSERT_PTR_NULL (xmms_sample_gain_new (XMMS_SAMPLE_FORMAT_UNKNOWN, 2));
+
+	gain = xmms_sample_gain_new (XMMS_SAMPLE_FORMAT_S16, 2);
+	CU_ASSERT_PTR_NOT_NULL (gain);
+	CU_ASSERT (xmms_sample_gain_is_unity (gain));
+	CU_ASSERT_DOUBLE_EQUAL (1.0, xmms_sample_gain_get (gain), 0.0);
+
+	xmms_sample_gain_apply (gain, samples, sizeof (samples));
+	CU_ASSERT_EQUAL (1000, samples[0]);
+	CU_ASSERT_EQUAL (-1000, samples[1]);
+	CU_ASSERT_EQUAL (32767, samples[2]);
+	CU_ASSERT_EQUAL (-32768, samples[3]);
+
+	xmms_sample_gain_set (gain, 0.5, 0);
+	CU_ASSERT_FALSE (xmms_sample_gain_is_unity (gain));
+
+	xmms_sample_gain_set (gain, 1.0, 0);
+	CU_ASSERT (xmms_sample_gain_is_unity (gain));
+
+	xmms_sample_gain_free (gain);
+}
+
+CASE (test_gain_flat_saturates)
+{
+	xmms_sample_gain_t *gain;
+	gint16 samples[4] = { 1000, -1000, 20000, -20000 };
+
+	gain = xmms_sample_gain_new (XMMS_SAMPLE_FORMAT_S16, 2);
+
+	xmms_sample_gain_set (gain, 2.0, 0);
+	CU_ASSERT_DOUBLE_EQUAL (2.0, xmms_sample_gain_get (gain), 0.0);
+
+	xmms_sample_gain_apply (gain, samples, sizeof (samples));
+	CU_ASSERT_EQUAL (2000, samples[0]);
+	CU_ASSERT_EQUAL (-2000, samples[1]);
+	CU_ASSERT_EQUAL (32767, samples[2]);
+	CU_ASSERT_EQUAL (-32768, samples[3]);
+
+	xmms_sample_gain_free (gain);
+}
+
+CASE (test_gain_unsigned_midpoint)
+{
+	xmms_sample_gain_t *gain;
+	guint8 samples[4] = { 128, 138, 118, 255 };
+
+	gain = xmms_sample_gain_new (XMMS_SAMPLE_FORMAT_U8, 1);
+
+	/* silence stays at the midpoint instead of being pulled towards 0 */
+	xmms_sample_gain_set (gain, 0.5, 0);
+	xmms_sample_gain_apply (gain, samples, sizeof (samples));
+	CU_ASSERT_EQUAL (128, samples[0]);
+	CU_ASSERT_EQUAL (133, samples[1]);
+	CU_ASSERT_EQUAL (123, samples[2]);
+	CU_ASSERT_EQUAL (191, samples[3]);
+
+	xmms_sample_gain_free (gain);
+}
+
+CASE (test_gain_float_unclipped)
+{
+	xmms_sample_gain_t *gain;
+	gfloat samples[2] = { 0.75, -0.75 };
+
+	gain = xmms_sample_gain_new (XMMS_SAMPLE_FORMAT_FLOAT, 2);
+
+	xmms_sample_gain_set (gain, 2.0, 0);
+	xmms_sample_gain_apply (gain, samples, sizeof (samples));
+	CU_ASSERT_DOUBLE_EQUAL (1.5, samples[0], 0.0001);
+	CU_ASSERT_DOUBLE_EQUAL (-1.5, samples[1], 0.0001);
+
+	xmms_sample_gain_free (gain);
+}
+
+CASE (test_gain_ramp)
+{
+	xmms_sample_gain_t *gain;
+	gfloat samples[12];
+	gint i;
+
+	for (i = 0; i < G_N_ELEMENTS (samples); i++) {
+		samples[i] = 1.0;
+	}
+
+	gain = xmms_sample_gain_new (XMMS_SAMPLE_FORMAT_FLOAT, 2);
+
+	/* the target is reported right away, the samples follow over 4 frames */
+	xmms_sample_gain_set (gain, 0.0, 4);
+	CU_ASSERT_DOUBLE_EQUAL (0.0, xmms_sample_gain_get (gain), 0.0);
+	CU_ASSERT_FALSE (xmms_sample_gain_is_unity (gain));
+
+	/* split in the middle of the ramp, both channels share the frame gain */
+	xmms_sample_gain_apply (gain, samples, 2 * 2 * sizeof (gfloat));
+	xmms_sample_gain_apply (gain, samples + 4, 4 * 2 * sizeof (gfloat));
+
+	CU_ASSERT_DOUBLE_EQUAL (1.0, samples[0], 0.0001);
+	CU_ASSERT_DOUBLE_EQUAL (1.0, samples[1], 0.0001);
+	CU_ASSERT_DOUBLE_EQUAL (0.75, samples[2], 0.0001);
+	CU_ASSERT_DOUBLE_EQUAL (0.75, samples[3], 0.0001);
+	CU_ASSERT_DOUBLE_EQUAL (0.5, samples[4], 0.0001);
+	CU_ASSERT_DOUBLE_EQUAL (0.5, samples[5], 0.0001);
+	CU_ASSERT_DOUBLE_EQUAL (0.25, samples[6], 0.0001);
+	CU_ASSERT_DOUBLE_EQUAL (0.25, samples[7], 0.0001);
+
+	/* after the ramp the target gain is applied exactly */
+	for (i = 8; i < G_N_ELEMENTS (samples); i++) {
+		CU_ASSERT_EQUAL (0.0, samples[i]);
+	}
+
+	/* ramping back up ends at unity */
+	xmms_sample_gain_set (gain, 1.0, 2);
+	CU_ASSERT_FALSE (xmms_sample_gain_is_unity (gain));
+	xmms_sample_gain_apply (gain, samples, 2 * 2 * sizeof (gfloat));
+	CU_ASSERT (xmms_sample_gain_is_unity (gain));
+
+	xmms_sample_gain_free (gain);
+}
@@ -0,0 +1,386 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include "xcu.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <fcntl.h>
+#include <poll.h>
+
+#include <xmmsc/xmmsc_ipc_msg.h>
+#include <xmmsc/xmmsc_ipc_transport.h>
+
+#include <xmmspriv/xmms_log.h>
+#include <xmmspriv/xmms_ipc.h>
+
+#define PING_COOKIE 999
+#define INTERVAL 300
+
+static gchar *tmpdir, *socketpath, *url;
+static GMainLoop *mainloop;
+static GThread *mainloop_thread;
+static xmms_object_t *object;
+
+static GMutex disconnect_lock;
+static GCond disconnect_cond;
+static gint disconnects;
+
+/* A connection speaking the raw protocol. Signals that come in while
+ * waiting for something else are kept for later. */
+typedef struct {
+	xmms_ipc_transport_t *transport;
+	GQueue *received;
+} client_t;
+
+typedef struct {
+	guint32 cookie;
+	xmmsv_t *value;
+	gint64 time;
+} received_t;
+
+static void
+ping (xmms_object_t *obj, xmms_object_cmd_arg_t *arg)
+{
+	arg->retval = xmmsv_new_none ();
+}
+
+static void
+on_disconnect (xmms_object_t *obj, xmmsv_t *value, gpointer udata)
+{
+	g_mutex_lock (&disconnect_lock);
+	disconnects++;
+	g_cond_signal (&disconnect_cond);
+	g_mutex_unlock (&disconnect_lock);
+}
+
+static gpointer
+mainloop_run (gpointer udata)
+{
+	g_main_loop_run (mainloop);
+	return NULL;
+}
+
+static client_t *
+client_new (void)
+{
+	client_t *client;
+	int fd;
+
+	client = g_new0 (client_t, 1);
+	client->transport = xmms_ipc_client_init (url);
+	CU_ASSERT_PTR_NOT_NULL_FATAL (client->transport);
+	client->received = g_queue_new ();
+
+	fd = xmms_ipc_transport_fd_get (client->transport);
+	fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+
+	return client;
+}
+
+static void
+received_free (received_t *r)
+{
+	xmmsv_unref (r->value);
+	g_free (r);
+}
+
+/* Disconnect, and wait for the server to notice */
+static void
+client_free (client_t *client)
+{
+	gint64 deadline = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+	gint expected;
+
+	g_mutex_lock (&disconnect_lock);
+	expected = disconnects + 1;
+
+	xmms_ipc_transport_destroy (client->transport);
+
+	while (disconnects < expected) {
+		if (!g_cond_wait_until (&disconnect_cond, &disconnect_lock, deadline)) {
+			break;
+		}
+	}
+	CU_ASSERT (disconnects >= expected);
+	g_mutex_unlock (&disconnect_lock);
+
+	g_queue_free_full (client->received, (GDestroyNotify) received_free);
+	g_free (client);
+}
+
+static void
+client_send (client_t *client, guint32 objid, guint32 cmd, guint32 cookie,
+             xmmsv_t *args)
+{
+	xmms_ipc_msg_t *msg;
+	bool disconnected = false;
+
+	msg = xmms_ipc_msg_new (objid, cmd);
+	xmms_ipc_msg_set_cookie (msg, cookie);
+	xmms_ipc_msg_put_value (msg, args);
+
+	while (!xmms_ipc_msg_write_transport (msg, client->transport, &disconnected)) {
+		CU_ASSERT_FALSE_FATAL (disconnected);
+		g_usleep (1000);
+	}
+
+	xmms_ipc_msg_destroy (msg);
+	xmmsv_unref (args);
+}
+
+/* Wait up to timeout milliseconds for the next message from the server */
+static received_t *
+client_read (client_t *client, gint timeout)
+{
+	gint64 deadline = g_get_monotonic_time () + timeout * 1000;
+	xmms_ipc_msg_t *msg;
+	received_t *r = NULL;
+	bool disconnected = false;
+	struct pollfd pfd;
+
+	pfd.fd = xmms_ipc_transport_fd_get (client->transport);
+	pfd.events = POLLIN;
+
+	msg = xmms_ipc_msg_alloc ();
+
+	while (!xmms_ipc_msg_read_transport (msg, client->transport, &disconnected)) {
+		gint64 left = deadline - g_get_monotonic_time ();
+
+		CU_ASSERT_FALSE_FATAL (disconnected);
+
+		if (left <= 0) {
+			xmms_ipc_msg_destroy (msg);
+			return NULL;
+		}
+
+		poll (&pfd, 1, left / 1000 + 1);
+	}
+
+	r = g_new0 (received_t, 1);
+	r->cookie = xmms_ipc_msg_get_cookie (msg);
+	r->time = g_get_monotonic_time ();
+	CU_ASSERT_TRUE (xmms_ipc_msg_get_value (msg, &r->value));
+
+	xmms_ipc_msg_destroy (msg);
+
+	return r;
+}
+
+/* Make sure the server has handled everything sent so far */
+static void
+client_sync (client_t *client)
+{
+	received_t *r;
+
+	client_send (client, XMMS_IPC_OBJECT_MAIN, XMMS_IPC_COMMAND_MAIN_HELLO,
+	             PING_COOKIE, xmmsv_new_list ());
+
+	while ((r = client_read (client, 5000))) {
+		if (r->cookie == PING_COOKIE) {
+			received_free (r);
+			return;
+		}
+		g_queue_push_tail (client->received, r);
+	}
+
+	CU_FAIL_FATAL ("no reply from the server");
+}
+
+static received_t *
+client_receive (client_t *client, gint timeout)
+{
+	if (!g_queue_is_empty (client->received)) {
+		return g_queue_pop_head (client->received);
+	}
+	return client_read (client, timeout);
+}
+
+/* Ask for the next emission of a signal, interval < 0 leaves it out */
+static void
+client_signal (client_t *client, guint signalid, guint32 cookie, gint interval)
+{
+	xmmsv_t *args;
+
+	args = xmmsv_new_list ();
+	xmmsv_list_append_int (args, signalid);
+	if (interval >= 0) {
+		xmmsv_list_append_int (args, interval);
+	}
+
+	client_send (client, XMMS_IPC_OBJECT_SIGNAL, XMMS_IPC_COMMAND_SIGNAL,
+	             cookie, args);
+	client_sync (client);
+}
+
+static void
+emit (guint signalid, gint value)
+{
+	xmms_object_emit (object, signalid, xmmsv_new_int (value));
+}
+
+/* The next message has to be the given signal with the given value */
+static gint64
+check_receive (client_t *client, guint32 cookie, gint value)
+{
+	received_t *r;
+	gint64 time;
+	gint i = -1;
+
+	r = client_receive (client, 5000);
+	CU_ASSERT_PTR_NOT_NULL_FATAL (r);
+
+	CU_ASSERT_EQUAL (cookie, r->cookie);
+	CU_ASSERT_TRUE (xmmsv_get_int (r->value, &i));
+	CU_ASSERT_EQUAL (value, i);
+
+	time = r->time;
+	received_free (r);
+
+	return time;
+}
+
+SETUP (ipc) {
+	xmms_ipc_init ();
+	xmms_log_init (0);
+
+	tmpdir = g_dir_make_tmp ("xmms-t-ipc-XXXXXX", NULL);
+	socketpath = g_build_filename (tmpdir, "socket", NULL);
+	url = g_strconcat ("unix://", socketpath, NULL);
+
+	xmms_object_connect (XMMS_OBJECT (xmms_ipc_manager_get ()),
+	                     XMMS_IPC_SIGNAL_IPC_MANAGER_CLIENT_DISCONNECTED,
+	                     on_disconnect, NULL);
+
+	object = xmms_object_new (xmms_object_t, NULL);
+	xmms_object_cmd_add (object, XMMS_IPC_COMMAND_MAIN_HELLO, ping);
+	xmms_ipc_object_register (XMMS_IPC_OBJECT_MAIN, object);
+	xmms_ipc_signal_register (object, XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME);
+	xmms_ipc_signal_register (object, XMMS_IPC_SIGNAL_PLAYBACK_CURRENT_ID);
+
+	/* clients are accepted in the default main context */
+	mainloop = g_main_loop_new (NULL, FALSE);
+	CU_ASSERT_TRUE (xmms_ipc_setup_server (url));
+	mainloop_thread = g_thread_new ("t_ipc", mainloop_run, NULL);
+
+	return 0;
+}
+
+CLEANUP () {
+	g_main_loop_quit (mainloop);
+	g_thread_join (mainloop_thread);
+	g_main_loop_unref (mainloop);
+
+	xmms_ipc_signal_unregister (XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME);
+	xmms_ipc_signal_unregister (XMMS_IPC_SIGNAL_PLAYBACK_CURRENT_ID);
+	xmms_ipc_object_unregister (XMMS_IPC_OBJECT_MAIN);
+	xmms_object_unref (object);
+
+	xmms_ipc_shutdown ();
+
+	g_unlink (socketpath);
+	g_rmdir (tmpdir);
+
+	g_free (url);
+	g_free (socketpath);
+	g_free (tmpdir);
+
+	return 0;
+}
+
+CASE (test_signal_coalesce)
+{
+	client_t *client = client_new ();
+	gint64 sent;
+
+	/* the first one goes out right away */
+	client_signal (client, XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 1, INTERVAL);
+	emit (XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 1);
+	sent = check_receive (client, 1, 1);
+
+	/* a burst within the interval is one message with the last value */
+	client_signal (client, XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 2, INTERVAL);
+	emit (XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 2);
+	emit (XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 3);
+	emit (XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 4);
+
+	client_sync (client);
+	CU_ASSERT_TRUE (g_queue_is_empty (client->received));
+
+	CU_ASSERT (check_receive (client, 2, 4) - sent >= (INTERVAL - 10) * 1000);
+
+	client_sync (client);
+	CU_ASSERT_TRUE (g_queue_is_empty (client->received));
+
+	client_free (client);
+}
+
+CASE (test_signal_flush)
+{
+	client_t *client = client_new ();
+	gint64 sent;
+
+	client_signal (client, XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 1, INTERVAL);
+	emit (XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 1);
+	sent = check_receive (client, 1, 1);
+
+	/* a value held back is sent once the interval is up, without
+	 * waiting for another emission */
+	client_signal (client, XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 2, INTERVAL);
+	emit (XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 2);
+	CU_ASSERT (check_receive (client, 2, 2) - sent >= (INTERVAL - 10) * 1000);
+
+	/* after a quiet interval the next one goes out right away */
+	g_usleep (INTERVAL * 1000);
+	client_signal (client, XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 3, INTERVAL);
+	emit (XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 3);
+	client_sync (client);
+	CU_ASSERT_FALSE (g_queue_is_empty (client->received));
+	check_receive (client, 3, 3);
+
+	client_free (client);
+}
+
+CASE (test_signal_unthrottled_order)
+{
+	client_t *throttled = client_new ();
+	client_t *plain = client_new ();
+
+	client_signal (throttled, XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 1, INTERVAL);
+	client_signal (plain, XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 1, -1);
+	emit (XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 1);
+	check_receive (throttled, 1, 1);
+	check_receive (plain, 1, 1);
+
+	client_signal (throttled, XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 2, INTERVAL);
+	client_signal (throttled, XMMS_IPC_SIGNAL_PLAYBACK_CURRENT_ID, 3, -1);
+	client_signal (plain, XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 2, -1);
+
+	/* a signal without interval overtakes the one held back */
+	emit (XMMS_IPC_SIGNAL_PLAYBACK_PLAYTIME, 2);
+	emit (XMMS_IPC_SIGNAL_PLAYBACK_CURRENT_ID, 42);
+	check_receive (throttled, 3, 42);
+	check_receive (throttled, 2, 2);
+
+	/* and other clients aren't held back at all */
+	client_sync (plain);
+	CU_ASSERT_FALSE (g_queue_is_empty (plain->received));
+	check_receive (plain, 2, 2);
+
+	client_free (throttled);
+	client_free (plain);
+}
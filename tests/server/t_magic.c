@@ -0,0 +1,627 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include "xcu.h"
+
+#include <glib.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <xmmspriv/xmms_log.h>
+#include <xmmspriv/xmms_ipc.h>
+#include <xmmspriv/xmms_config.h>
+#include <xmmspriv/xmms_plugin.h>
+#include <xmmspriv/xmms_xform.h>
+
+/* The magic the plugins in src/plugins register */
+typedef struct {
+	const gchar *desc;
+	const gchar *mime;
+	const gchar *specs[6];
+} magic_set_t;
+
+static const magic_set_t shipped[] = {
+	{ "mpc header", "audio/x-ape", { "0 string MAC " } },
+	{ "asf header", "video/x-ms-asf", { "0 belong 0x3026b275" } },
+	{ "ASX header", "application/x-asx-playlist", { "0 string/c <asx version=\"3.0\">" } },
+	{ "Shorten header", "audio/x-ffmpeg-shorten", { "0 string ajkg" } },
+	{ "A/52 (AC-3) header", "audio/x-ffmpeg-ac3", { "0 beshort 0x0b77" } },
+	{ "DTS header", "audio/x-ffmpeg-dca", { "0 belong 0x7ffe8001" } },
+	{ "mpeg aac header", "audio/aac", { "0 beshort&0xfff6 0xfff0" } },
+	{ "adif header", "audio/aac", { "0 string ADIF" } },
+	{ "flac header", "audio/x-flac", { "0 string fLaC" } },
+	{ "FLV header", "video/x-flv", { "0 string FLV" } },
+	{ "SPC700 save state", "application/x-spc", { "0 string SNES-SPC700 Sound File Data" } },
+	{ "NSF file", "application/x-nsf", { "0 string NESM" } },
+	{ "NSFE file", "application/x-nsfe", { "0 string NSFE" } },
+	{ "GBS file", "application/x-gbs", { "0 string GBS" } },
+	{ "GYM file", "application/x-gym", { "0 string GYMX" } },
+	{ "VGM file", "application/x-vgm", { "0 string Vgm" } },
+	{ "SAP file", "application/x-sap", { "0 string SAP" } },
+	{ "AY file", "application/x-ay", { "0 string ZXAYEMU" } },
+	{ "html doctype", "text/html", { "0 string/c <!DOCTYPE HTML " } },
+	{ "html tag", "text/html", { "0 string/c <html " } },
+	{ "html header tag", "text/html", { "0 string/c <head " } },
+	{ "id3 header", "application/id3v2", { "0 string ID3", ">3 byte <0xff", ">>4 byte <0xff" } },
+	{ "Extended M3U header", "audio/x-mpegurl", { "0 string #EXTM3U" } },
+	{ "Monkey's Audio Magic", "audio/x-ape", { "0 string MAC " } },
+	{ "mpeg header", "audio/mpeg", { "0 beshort&0xfff6 0xfff6", "0 beshort&0xfff6 0xfff4", "0 beshort&0xffe6 0xffe2" } },
+	{ "Standard MIDI file (format-0)", "audio/mid-0", { "0 string MThd", ">8 beshort 0" } },
+	{ "Standard MIDI file (format-1)", "audio/mid-1", { "0 string MThd", ">8 beshort 1" } },
+	{ "Microsoft RIFF MIDI file", "audio/riffmidi", { "0 string RIFF", ">8 string RMID" } },
+	{ "Fasttracker II module", "audio/xm", { "0 string Extended Module:" } },
+	{ "ScreamTracker III module", "audio/s3m", { "44 string SCRM" } },
+	{ "Impulse Tracker module", "audio/it", { "0 string IMPM" } },
+	{ "MED module", "audio/med", { "0 string MMD" } },
+	{ "AMF module", "audio/amf", { "0 string AMF" } },
+	{ "Unreal Engine package", "audio/umx", { "0 belong 0xc1832a9e" } },
+	{ "4-channel Protracker module", "audio/mod", { "1080 string M.K." } },
+	{ "4-channel Protracker module", "audio/mod", { "1080 string M!K!" } },
+	{ "4-channel Startracker module", "audio/mod", { "1080 string FLT4" } },
+	{ "8-channel Startracker module", "audio/mod", { "1080 string FLT8" } },
+	{ "4-channel Fasttracker module", "audio/mod", { "1080 string 4CHN" } },
+	{ "6-channel Fasttracker module", "audio/mod", { "1080 string 6CHN" } },
+	{ "8-channel Fasttracker module", "audio/mod", { "1080 string 8CHN" } },
+	{ "8-channel Octalyzer module", "audio/mod", { "1080 string CD81" } },
+	{ "8-channel Octalyzer module", "audio/mod", { "1080 string OKTA" } },
+	{ "16-channel Taketracker module", "audio/mod", { "1080 string 16CN" } },
+	{ "32-channel Taketracker module", "audio/mod", { "1080 string 32CN" } },
+	{ "mpeg-4 header", "video/mp4", { "4 string ftyp", ">8 string isom", ">8 string mp41", ">8 string mp42" } },
+	{ "iTunes header", "audio/mp4", { "4 string ftyp", ">8 string M4A " } },
+	{ "mpeg header", "audio/mpeg", { "0 beshort&0xfff6 0xfff6", "0 beshort&0xfff6 0xfff4", "0 beshort&0xffe6 0xffe2" } },
+	{ "mpc header", "audio/x-mpc", { "0 string MP+" } },
+	{ "mpc header", "audio/x-mpc", { "0 string MPCK" } },
+	{ "NUL padded", "application/x-nul-padded", { "0 byte 0x0" } },
+	{ "Opus header", "audio/ogg; codecs=opus", { "0 string OggS", ">28 string OpusHead" } },
+	{ "pls header", "audio/x-scpls", { "0 string [playlist]\r\n", "0 string [playlist]\n" } },
+	{ "sc68 header", "audio/stsound", { "0 string SC68 Music-file / (c) (BeN)jamin Gerard /" " SasHipA-Dev  " } },
+	{ "sndh header", "audio/stsound", { "0 string ICE!" } },
+	{ "sidplay infofile", "audio/prs.sid", { "0 string SIDPLAY INFOFILE" } },
+	{ "psid header", "audio/prs.sid", { "0 string PSID" } },
+	{ "rsid header", "audio/prs.sid", { "0 string RSID" } },
+	{ "aiff header", "audio/x-aiff", { "0 string FORM", ">8 string AIFF" } },
+	{ "aiff-c header", "audio/x-aiff", { "0 string FORM", ">8 string AIFC" } },
+	{ "au header", "audio/x-au", { "0 string .snd" } },
+	{ "caf header", "audio/x-caf", { "0 string caff", ">8 string desc" } },
+	{ "paf header", "audio/x-paf", { "0 byte 0x20", ">1 string paf" } },
+	{ "ogg/speex header", "audio/x-speex", { "0 string OggS", ">4 byte 0", ">>28 string Speex   " } },
+	{ "TTA header", "audio/x-tta", { "0 string TTA1" } },
+	{ "ogg/vorbis header", "application/ogg", { "0 string OggS", ">4 byte 0", ">>28 string \x01vorbis" } },
+	{ "wave header", "audio/x-wav", { "0 string RIFF", ">8 string WAVE", ">>12 string fmt " } },
+	{ "wavpack header v4", "audio/x-wavpack", { "0 string wvpk" } },
+	{ "xml header", "application/xml", { "0 string <?xml" } },
+	{ "xml header", "application/xml", { "0 string \xef\xbb\xbf<?xml" } },
+};
+
+/* A straightforward tree walker over the same specs, testing one entry
+ * at a time against the data, to check the compiled matcher against. */
+typedef enum {
+	REF_BYTE,
+	REF_INT16,
+	REF_INT32,
+	REF_STRING,
+	REF_STRINGC
+} ref_type_t;
+
+typedef struct {
+	guint offset;
+	ref_type_t type;
+	gint endian;
+	guint32 mask;
+	gchar oper;
+	guint32 value;
+	gchar s[32];
+	guint len;
+} ref_entry_t;
+
+typedef struct {
+	GNode *tree;
+	const gchar *mime;
+} ref_set_t;
+
+static GList *ref_list;
+
+static ref_entry_t *
+ref_parse (const gchar *spec, guint *depth)
+{
+	static const struct {
+		const gchar *name;
+		ref_type_t type;
+		gint endian;
+	} types[] = {
+		{ "byte", REF_BYTE, G_BYTE_ORDER },
+		{ "short", REF_INT16, G_BYTE_ORDER },
+		{ "long", REF_INT16, G_BYTE_ORDER },
+		{ "beshort", REF_INT16, G_BIG_ENDIAN },
+		{ "belong", REF_INT32, G_BIG_ENDIAN },
+		{ "leshort", REF_INT16, G_LITTLE_ENDIAN },
+		{ "lelong", REF_INT32, G_LITTLE_ENDIAN },
+		{ "string/c", REF_STRINGC, G_BYTE_ORDER },
+		{ "string", REF_STRING, G_BYTE_ORDER },
+	};
+	ref_entry_t *e;
+	gchar *end;
+	gint i;
+
+	for (*depth = 0; *spec == '>'; spec++) {
+		(*depth)++;
+	}
+
+	e = g_new0 (ref_entry_t, 1);
+	e->offset = strtoul (spec, &end, 0);
+	end++;
+
+	for (i = 0; i < G_N_ELEMENTS (types); i++) {
+		if (g_str_has_prefix (end, types[i].name)) {
+			e->type = types[i].type;
+			e->endian = types[i].endian;
+			end += strlen (types[i].name);
+			break;
+		}
+	}
+	g_assert (i < G_N_ELEMENTS (types));
+
+	if (*end == '&') {
+		e->mask = strtoul (end + 1, &end, 0);
+	} else {
+		end++;
+	}
+
+	e->oper = '=';
+	switch (e->type) {
+		case REF_STRING:
+		case REF_STRINGC:
+			g_strlcpy (e->s, end, sizeof (e->s));
+			e->len = strlen (e->s);
+			return e;
+		default:
+			if (*end && strchr ("=<>&^", *end)) {
+				e->oper = *end++;
+			}
+			e->value = strtoul (end, NULL, 0);
+			break;
+	}
+
+	switch (e->type) {
+		case REF_BYTE:
+			e->value = (guint8) e->value;
+			e->len = 1;
+			break;
+		case REF_INT16:
+			e->value = (guint16) e->value;
+			e->len = 2;
+			break;
+		default:
+			e->len = 4;
+			break;
+	}
+
+	return e;
+}
+
+static gint
+ref_cmp (ref_set_t *a, ref_set_t *b)
+{
+	guint n1 = g_node_n_nodes (a->tree, G_TRAVERSE_ALL);
+	guint n2 = g_node_n_nodes (b->tree, G_TRAVERSE_ALL);
+
+	return n1 > n2 ? -1 : n1 < n2 ? 1 : 0;
+}
+
+static void
+ref_add (const magic_set_t *set)
+{
+	GNode *last[8] = { NULL };
+	ref_set_t *ref;
+	guint depth;
+	gint i;
+
+	ref = g_new0 (ref_set_t, 1);
+	ref->mime = set->mime;
+	ref->tree = last[0] = g_node_new (NULL);
+
+	for (i = 0; set->specs[i]; i++) {
+		ref_entry_t *e = ref_parse (set->specs[i], &depth);
+		last[depth + 1] = g_node_append_data (last[depth], e);
+	}
+
+	ref_list = g_list_insert_sorted (ref_list, ref, (GCompareFunc) ref_cmp);
+}
+
+static gboolean
+ref_entry_match (const ref_entry_t *e, const guchar *buf, gint len)
+{
+	guint16 i16;
+	guint32 v, i32;
+
+	if (len < e->offset + e->len) {
+		return FALSE;
+	}
+
+	switch (e->type) {
+		case REF_STRING:
+			return !strncmp ((const gchar *) buf + e->offset, e->s, e->len);
+		case REF_STRINGC:
+			return !g_ascii_strncasecmp ((const gchar *) buf + e->offset, e->s, e->len);
+		case REF_BYTE:
+			v = buf[e->offset];
+			break;
+		case REF_INT16:
+			memcpy (&i16, buf + e->offset, 2);
+			if (e->endian == G_BIG_ENDIAN) {
+				i16 = GUINT16_FROM_BE (i16);
+			} else if (e->endian == G_LITTLE_ENDIAN) {
+				i16 = GUINT16_FROM_LE (i16);
+			}
+			v = i16;
+			break;
+		default:
+			memcpy (&i32, buf + e->offset, 4);
+			if (e->endian == G_BIG_ENDIAN) {
+				i32 = GUINT32_FROM_BE (i32);
+			} else if (e->endian == G_LITTLE_ENDIAN) {
+				i32 = GUINT32_FROM_LE (i32);
+			}
+			v = i32;
+			break;
+	}
+
+	if (e->mask) {
+		v &= e->mask;
+	}
+
+	switch (e->oper) {
+		case '<':
+			return v < e->value;
+		case '>':
+			return v > e->value;
+		case '&':
+			return (v & e->value) == e->value;
+		case '^':
+			return (v & e->value) != e->value;
+		default:
+			return v == e->value;
+	}
+}
+
+static gboolean
+ref_tree_match (GNode *tree, const guchar *buf, gint len)
+{
+	GNode *n;
+
+	if (!tree->children) {
+		return TRUE;
+	}
+
+	for (n = tree->children; n; n = n->next) {
+		if (ref_entry_match (n->data, buf, len) && ref_tree_match (n, buf, len)) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static const gchar *
+ref_detect (const guchar *buf, gint len)
+{
+	GList *l;
+
+	for (l = ref_list; l; l = g_list_next (l)) {
+		ref_set_t *ref = l->data;
+		if (ref_tree_match (ref->tree, buf, len)) {
+			return ref->mime;
+		}
+	}
+
+	return NULL;
+}
+
+/* A source handing out the data in chunks of a given size, then either
+ * ending the stream or failing. */
+static struct {
+	const guchar *data;
+	gint len;
+	gint pos;
+	gint chunk;
+	gboolean fail;
+} source;
+
+static gboolean
+source_init (xmms_xform_t *xform)
+{
+	xmms_xform_outdata_type_add (xform,
+	                             XMMS_STREAM_TYPE_MIMETYPE,
+	                             "application/octet-stream",
+	                             XMMS_STREAM_TYPE_END);
+	return TRUE;
+}
+
+static gint
+source_read (xmms_xform_t *xform, xmms_sample_t *buf, gint len,
+             xmms_error_t *err)
+{
+	if (source.pos == source.len) {
+		return source.fail ? -1 : 0;
+	}
+
+	len = MIN (len, source.len - source.pos);
+	len = MIN (len, source.chunk);
+
+	memcpy (buf, source.data + source.pos, len);
+	source.pos += len;
+
+	return len;
+}
+
+static gboolean
+source_setup (xmms_xform_plugin_t *xform_plugin)
+{
+	xmms_xform_methods_t methods;
+
+	XMMS_XFORM_METHODS_INIT (methods);
+	methods.init = source_init;
+	methods.read = source_read;
+
+	xmms_xform_plugin_methods_set (xform_plugin, &methods);
+
+	return TRUE;
+}
+
+extern const xmms_plugin_desc_t xmms_builtin_magic;
+
+XMMS_XFORM_BUILTIN_DEFINE (magic_source, "magic source", "1.0", "magic source", source_setup);
+
+/* Run the magic xform over the data, returns the detected mimetype */
+static gchar *
+detect (const guchar *data, gint len, gint chunk, gboolean fail)
+{
+	xmms_xform_t *head, *src, *xform;
+	gchar *mime = NULL;
+
+	source.data = data;
+	source.len = len;
+	source.pos = 0;
+	source.chunk = chunk;
+	source.fail = fail;
+
+	head = xmms_xform_new (NULL, NULL, NULL, 0, NULL);
+	xmms_xform_outdata_type_add (head,
+	                             XMMS_STREAM_TYPE_MIMETYPE,
+	                             "application/x-url",
+	                             XMMS_STREAM_TYPE_URL,
+	                             "magictest://",
+	                             XMMS_STREAM_TYPE_END);
+
+	src = xmms_xform_new (xmms_xform_find_plugin ("magic_source"),
+	                      head, NULL, 1, NULL);
+	xmms_object_unref (head);
+	CU_ASSERT_PTR_NOT_NULL_FATAL (src);
+
+	xform = xmms_xform_new (xmms_xform_find_plugin ("magic"), src, NULL, 1, NULL);
+	if (xform) {
+		mime = g_strdup (xmms_xform_outtype_get_str (xform, XMMS_STREAM_TYPE_MIMETYPE));
+		xmms_object_unref (xform);
+	}
+
+	xmms_object_unref (src);
+
+	return mime;
+}
+
+static void
+check_detect (const guchar *data, gint len)
+{
+	static const gint chunks[] = { 4096, 7 };
+	const gchar *expected;
+	gchar *mime;
+	gint i;
+
+	expected = ref_detect (data, len);
+
+	for (i = 0; i < G_N_ELEMENTS (chunks); i++) {
+		mime = detect (data, len, chunks[i], FALSE);
+		CU_ASSERT_STRING_EQUAL (expected ? expected : "(none)", mime ? mime : "(none)");
+		g_free (mime);
+
+		/* a source failing after the data is tested on what it gave */
+		mime = detect (data, len, chunks[i], TRUE);
+		CU_ASSERT_STRING_EQUAL (expected ? expected : "(none)", mime ? mime : "(none)");
+		g_free (mime);
+	}
+}
+
+/* Write data that satisfies the entry into buf */
+static void
+write_witness (const ref_entry_t *e, guchar *buf)
+{
+	guint32 v = e->value;
+	guint16 i16;
+
+	switch (e->type) {
+		case REF_STRING:
+		case REF_STRINGC:
+			memcpy (buf + e->offset, e->s, e->len);
+			return;
+		default:
+			break;
+	}
+
+	switch (e->oper) {
+		case '<':
+		case '^':
+			v = 0;
+			break;
+		case '>':
+			v++;
+			break;
+		default:
+			break;
+	}
+
+	switch (e->type) {
+		case REF_BYTE:
+			buf[e->offset] = v;
+			break;
+		case REF_INT16:
+			i16 = v;
+			if (e->endian == G_BIG_ENDIAN) {
+				i16 = GUINT16_TO_BE (i16);
+			} else if (e->endian == G_LITTLE_ENDIAN) {
+				i16 = GUINT16_TO_LE (i16);
+			}
+			memcpy (buf + e->offset, &i16, 2);
+			break;
+		default:
+			if (e->endian == G_BIG_ENDIAN) {
+				v = GUINT32_TO_BE (v);
+			} else if (e->endian == G_LITTLE_ENDIAN) {
+				v = GUINT32_TO_LE (v);
+			}
+			memcpy (buf + e->offset, &v, 4);
+			break;
+	}
+}
+
+#define BUFSIZE 1200
+
+/* For the path from the root to a leaf, check the data satisfying it,
+ * cut off inside and right after each test, and with each byte a test
+ * looks at changed. */
+static gboolean
+check_path (GNode *leaf, GRand *rand)
+{
+	guchar buf[BUFSIZE];
+	GNode *n;
+	gint i;
+
+	for (i = 0; i < BUFSIZE; i++) {
+		buf[i] = g_rand_int (rand);
+	}
+
+	for (n = leaf; n->data; n = n->parent) {
+		write_witness (n->data, buf);
+	}
+
+	check_detect (buf, BUFSIZE);
+
+	for (n = leaf; n->data; n = n->parent) {
+		ref_entry_t *e = n->data;
+
+		check_detect (buf, e->offset + e->len - 1);
+		check_detect (buf, e->offset + e->len);
+
+		for (i = e->offset; i < e->offset + e->len; i++) {
+			buf[i] ^= 0x20;
+			check_detect (buf, BUFSIZE);
+			buf[i] ^= 0x20;
+		}
+	}
+
+	return FALSE;
+}
+
+SETUP (magic) {
+	static gboolean added = FALSE;
+	gint i, j;
+
+	xmms_ipc_init ();
+	xmms_log_init (0);
+
+	xmms_config_init ("memory://");
+
+	xmms_plugin_load (&xmms_builtin_magic, NULL);
+	xmms_plugin_load (&xmms_builtin_magic_source, NULL);
+
+	/* the magic lives on for the rest of the process */
+	if (!added) {
+		for (i = 0; i < G_N_ELEMENTS (shipped); i++) {
+			xmmsv_t *specs = xmmsv_new_list ();
+
+			for (j = 0; shipped[i].specs[j]; j++) {
+				xmmsv_list_append_string (specs, shipped[i].specs[j]);
+			}
+
+			CU_ASSERT_TRUE (xmms_magic_add_list (shipped[i].desc,
+			                                     shipped[i].mime, specs));
+			ref_add (&shipped[i]);
+
+			xmmsv_unref (specs);
+		}
+		added = TRUE;
+	}
+
+	return 0;
+}
+
+CLEANUP () {
+	xmms_plugin_shutdown ();
+
+	xmms_config_shutdown ();
+	xmms_ipc_shutdown ();
+
+	return 0;
+}
+
+CASE (test_magic_shipped_sets)
+{
+	GRand *rand = g_rand_new_with_seed (42);
+	GList *l;
+
+	for (l = ref_list; l; l = g_list_next (l)) {
+		ref_set_t *ref = l->data;
+
+		g_node_traverse (ref->tree, G_IN_ORDER, G_TRAVERSE_LEAVES, -1,
+		                 (GNodeTraverseFunc) check_path, rand);
+	}
+
+	g_rand_free (rand);
+}
+
+CASE (test_magic_random_data)
+{
+	GRand *rand = g_rand_new_with_seed (4711);
+	guchar buf[BUFSIZE];
+	gint i, j;
+
+	memset (buf, 0, sizeof (buf));
+	check_detect (buf, BUFSIZE);
+	check_detect (buf, 0);
+
+	for (i = 0; i < 200; i++) {
+		for (j = 0; j < BUFSIZE; j++) {
+			buf[j] = g_rand_int (rand);
+		}
+		check_detect (buf, g_rand_int_range (rand, 0, BUFSIZE));
+	}
+
+	g_rand_free (rand);
+}
+
+CASE (test_magic_short_read)
+{
+	guchar buf[100];
+	gchar *mime;
+
+	/* the source fails long before the mod check's 1084 bytes */
+	memset (buf, 'x', sizeof (buf));
+	memcpy (buf, "fLaC", 4);
+
+	mime = detect (buf, sizeof (buf), 64, TRUE);
+	CU_ASSERT_STRING_EQUAL ("audio/x-flac", mime);
+	g_free (mime);
+}
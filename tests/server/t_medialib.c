@@ -779,6 +779,112 @@ CASE(test_client_property_remove)
 	xmmsv_unref (result);
 }
 
+CASE(test_client_set_properties)
+{
+	xmms_medialib_entry_t first, second;
+	xmmsv_t *result, *properties, *entry, *title, *tracknr, *client;
+	gchar first_id[16], second_id[16];
+	const gchar *string_value;
+	gint int_value;
+
+	first = xmms_mock_entry (medialib, 1, "Red Fang", "Red Fang", "Prehistoric Dog");
+	second = xmms_mock_entry (medialib, 2, "Red Fang", "Red Fang", "Reverse Thunder");
+
+	g_snprintf (first_id, sizeof (first_id), "%d", first);
+	g_snprintf (second_id, sizeof (second_id), "%d", second);
+
+	/* clients must not overwrite server properties */
+	entry = xmmsv_build_dict (XMMSV_DICT_ENTRY_INT ("tracknr", 3),
+	                          XMMSV_DICT_END);
+	properties = xmmsv_build_dict (XMMSV_DICT_ENTRY (first_id, entry),
+	                               XMMSV_DICT_END);
+	result = XMMS_IPC_CALL (medialib, XMMS_IPC_COMMAND_MEDIALIB_SET_PROPERTIES,
+	                        xmmsv_new_string ("server"), properties);
+	CU_ASSERT (xmmsv_is_type (result, XMMSV_TYPE_ERROR));
+	xmmsv_unref (result);
+
+	/* a single non-existing entry should fail the whole batch */
+	entry = xmmsv_build_dict (XMMSV_DICT_ENTRY_INT ("tracknr", 3),
+	                          XMMSV_DICT_END);
+	properties = xmmsv_build_dict (XMMSV_DICT_ENTRY (first_id, entry),
+	                               XMMSV_DICT_ENTRY ("1337", xmmsv_ref (entry)),
+	                               XMMSV_DICT_END);
+	result = XMMS_IPC_CALL (medialib, XMMS_IPC_COMMAND_MEDIALIB_SET_PROPERTIES,
+	                        xmmsv_new_string ("client/unittest"), properties);
+	CU_ASSERT (xmmsv_is_type (result, XMMSV_TYPE_ERROR));
+	xmmsv_unref (result);
+
+	result = XMMS_IPC_CALL (medialib, XMMS_IPC_COMMAND_MEDIALIB_GET_INFO, xmmsv_new_int (first));
+	CU_ASSERT (xmmsv_dict_get (result, "tracknr", &tracknr));
+	CU_ASSERT_FALSE (xmmsv_dict_get (tracknr, "client/unittest", &client));
+	xmmsv_unref (result);
+
+	properties = xmmsv_build_dict (XMMSV_DICT_ENTRY (first_id,
+	                                                 xmmsv_build_dict (XMMSV_DICT_ENTRY_INT ("tracknr", 3),
+	                                                                   XMMSV_DICT_ENTRY_STR ("title", "Wires"),
+	                                                                   XMMSV_DICT_END)),
+	                               XMMSV_DICT_ENTRY (second_id,
+	                                                 xmmsv_build_dict (XMMSV_DICT_ENTRY_INT ("tracknr", 4),
+	                                                                   XMMSV_DICT_END)),
+	                               XMMSV_DICT_END);
+	result = XMMS_IPC_CALL (medialib, XMMS_IPC_COMMAND_MEDIALIB_SET_PROPERTIES,
+	                        xmmsv_new_string ("client/unittest"), properties);
+	CU_ASSERT (xmmsv_is_type (result, XMMSV_TYPE_NONE));
+	xmmsv_unref (result);
+
+	result = XMMS_IPC_CALL (medialib, XMMS_IPC_COMMAND_MEDIALIB_GET_INFO, xmmsv_new_int (first));
+	CU_ASSERT (xmmsv_dict_get (result, "title", &title));
+	CU_ASSERT (xmmsv_dict_get (title, "client/unittest", &client));
+	CU_ASSERT (xmmsv_get_string (client, &string_value));
+	CU_ASSERT_STRING_EQUAL ("Wires", string_value);
+	CU_ASSERT (xmmsv_dict_get (result, "tracknr", &tracknr));
+	CU_ASSERT (xmmsv_dict_get (tracknr, "client/unittest", &client));
+	CU_ASSERT (xmmsv_get_int (client, &int_value));
+	CU_ASSERT_EQUAL (3, int_value);
+	xmmsv_unref (result);
+
+	result = XMMS_IPC_CALL (medialib, XMMS_IPC_COMMAND_MEDIALIB_GET_INFO, xmmsv_new_int (second));
+	CU_ASSERT (xmmsv_dict_get (result, "tracknr", &tracknr));
+	CU_ASSERT (xmmsv_dict_get (tracknr, "client/unittest", &client));
+	CU_ASSERT (xmmsv_get_int (client, &int_value));
+	CU_ASSERT_EQUAL (4, int_value);
+	xmmsv_unref (result);
+
+	/* none values remove the property */
+	entry = xmmsv_build_dict (XMMSV_DICT_ENTRY ("title", xmmsv_new_none ()),
+	                          XMMSV_DICT_END);
+	properties = xmmsv_build_dict (XMMSV_DICT_ENTRY (first_id, entry),
+	                               XMMSV_DICT_END);
+	result = XMMS_IPC_CALL (medialib, XMMS_IPC_COMMAND_MEDIALIB_SET_PROPERTIES,
+	                        xmmsv_new_string ("client/unittest"), properties);
+	CU_ASSERT (xmmsv_is_type (result, XMMSV_TYPE_NONE));
+	xmmsv_unref (result);
+
+	result = XMMS_IPC_CALL (medialib, XMMS_IPC_COMMAND_MEDIALIB_GET_INFO, xmmsv_new_int (first));
+	CU_ASSERT (xmmsv_dict_get (result, "title", &title));
+	CU_ASSERT_FALSE (xmmsv_dict_get (title, "client/unittest", &client));
+	xmmsv_unref (result);
+
+	/* integers the medialib can't store fail the batch instead of wrapping */
+	entry = xmmsv_build_dict (XMMSV_DICT_ENTRY_INT ("tracknr", 5),
+	                          XMMSV_DICT_ENTRY ("duration", xmmsv_new_int ((gint64) G_MAXINT32 + 1)),
+	                          XMMSV_DICT_END);
+	properties = xmmsv_build_dict (XMMSV_DICT_ENTRY (first_id, entry),
+	                               XMMSV_DICT_END);
+	result = XMMS_IPC_CALL (medialib, XMMS_IPC_COMMAND_MEDIALIB_SET_PROPERTIES,
+	                        xmmsv_new_string ("client/unittest"), properties);
+	CU_ASSERT (xmmsv_is_type (result, XMMSV_TYPE_ERROR));
+	xmmsv_unref (result);
+
+	result = XMMS_IPC_CALL (medialib, XMMS_IPC_COMMAND_MEDIALIB_GET_INFO, xmmsv_new_int (first));
+	CU_ASSERT (xmmsv_dict_get (result, "tracknr", &tracknr));
+	CU_ASSERT (xmmsv_dict_get (tracknr, "client/unittest", &client));
+	CU_ASSERT (xmmsv_get_int (client, &int_value));
+	CU_ASSERT_EQUAL (3, int_value);
+	CU_ASSERT_FALSE (xmmsv_dict_get (result, "duration", &client));
+	xmmsv_unref (result);
+}
+
 CASE(test_client_move_entry)
 {
 	xmms_medialib_session_t *session;
@@ -0,0 +1,522 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include "xcu.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <xmmspriv/xmms_log.h>
+#include <xmmspriv/xmms_ipc.h>
+#include <xmmspriv/xmms_config.h>
+#include <xmmspriv/xmms_plugin.h>
+
+/* TEST_PLUGIN_PATH is the module built from manifest-plugin.c */
+
+static gchar *tmpdir, *plugindir, *manifest;
+
+typedef struct {
+	gint loaded;
+	gint deferred;
+} plugin_count_t;
+
+static void
+install_plugin (const gchar *name)
+{
+	gchar *contents, *path;
+	gsize length;
+
+	CU_ASSERT (g_file_get_contents (TEST_PLUGIN_PATH, &contents, &length, NULL));
+
+	path = g_build_filename (plugindir, name, NULL);
+	CU_ASSERT (g_file_set_contents (path, contents, length, NULL));
+
+	g_free (path);
+	g_free (contents);
+}
+
+/* Change the size of a plugin, like an upgrade would */
+static void
+touch_plugin (const gchar *name)
+{
+	gchar *contents, *path;
+	gsize length;
+
+	path = g_build_filename (plugindir, name, NULL);
+	CU_ASSERT (g_file_get_contents (path, &contents, &length, NULL));
+
+	contents = g_realloc (contents, length + 16);
+	memset (contents + length, 0, 16);
+	CU_ASSERT (g_file_set_contents (path, contents, length + 16, NULL));
+
+	g_free (path);
+	g_free (contents);
+}
+
+static void
+remove_plugin (const gchar *name)
+{
+	gchar *path;
+
+	path = g_build_filename (plugindir, name, NULL);
+	g_unlink (path);
+	g_free (path);
+}
+
+/* Shut the plugin system down and start it again, like a daemon restart */
+static void
+restart (void)
+{
+	xmms_plugin_shutdown ();
+	xmms_plugin_init (plugindir);
+}
+
+static gboolean
+count_plugin (xmms_plugin_t *plugin, gpointer udata)
+{
+	plugin_count_t *count = udata;
+
+	if (strcmp (plugin->shortname, "manifest_test") != 0) {
+		return TRUE;
+	}
+
+	if (plugin->deferred) {
+		count->deferred++;
+	} else if (plugin->module) {
+		count->loaded++;
+	}
+
+	return TRUE;
+}
+
+static plugin_count_t
+count_plugins (void)
+{
+	plugin_count_t count = { 0, 0 };
+
+	xmms_plugin_foreach (XMMS_PLUGIN_TYPE_XFORM, count_plugin, &count);
+
+	return count;
+}
+
+static xmmsv_t *
+manifest_read (void)
+{
+	xmmsv_t *bin, *ret;
+	gchar *contents;
+	gsize length;
+
+	if (!g_file_get_contents (manifest, &contents, &length, NULL)) {
+		return NULL;
+	}
+
+	bin = xmmsv_new_bin ((guchar *) contents, length);
+	ret = xmmsv_deserialize (bin);
+	xmmsv_unref (bin);
+	g_free (contents);
+
+	return ret;
+}
+
+static void
+manifest_write (xmmsv_t *dict)
+{
+	const guchar *buffer;
+	xmmsv_t *serialized;
+	guint length;
+
+	serialized = xmmsv_serialize (dict);
+	CU_ASSERT (xmmsv_get_bin (serialized, &buffer, &length));
+	CU_ASSERT (g_file_set_contents (manifest, (const gchar *) buffer, length, NULL));
+	xmmsv_unref (serialized);
+}
+
+/* The manifest entry of a plugin, or NULL if it isn't listed */
+static xmmsv_t *
+manifest_entry (const gchar *name)
+{
+	xmmsv_list_iter_t *it;
+	xmmsv_t *dict, *plugins, *entry, *ret = NULL;
+	const gchar *path;
+	gchar *expected;
+
+	dict = manifest_read ();
+	if (!dict) {
+		return NULL;
+	}
+
+	expected = g_build_filename (plugindir, name, NULL);
+
+	CU_ASSERT (xmmsv_dict_get (dict, "plugins", &plugins));
+	CU_ASSERT (xmmsv_get_list_iter (plugins, &it));
+
+	for (; xmmsv_list_iter_valid (it); xmmsv_list_iter_next (it)) {
+		xmmsv_list_iter_entry (it, &entry);
+		if (xmmsv_dict_entry_get_string (entry, "path", &path) &&
+		    strcmp (path, expected) == 0) {
+			ret = xmmsv_ref (entry);
+		}
+	}
+
+	g_free (expected);
+	xmmsv_unref (dict);
+
+	return ret;
+}
+
+/* Leave a mark in the manifest that rewriting it would lose */
+static void
+manifest_mark (void)
+{
+	xmmsv_t *dict;
+
+	dict = manifest_read ();
+	CU_ASSERT_PTR_NOT_NULL_FATAL (dict);
+	xmmsv_dict_set_int (dict, "marked", 1);
+	manifest_write (dict);
+	xmmsv_unref (dict);
+}
+
+static gboolean
+manifest_marked (void)
+{
+	xmmsv_t *dict;
+	gboolean ret;
+
+	dict = manifest_read ();
+	CU_ASSERT_PTR_NOT_NULL_FATAL (dict);
+	ret = xmmsv_dict_has_key (dict, "marked");
+	xmmsv_unref (dict);
+
+	return ret;
+}
+
+/* Whether a plugin is listed as failed, with its current size */
+static gboolean
+listed_as_failed (const gchar *name)
+{
+	xmmsv_t *entry;
+	GStatBuf st;
+	gint64 size = -1;
+	gint32 failed = 0;
+	gchar *path;
+
+	path = g_build_filename (plugindir, name, NULL);
+	CU_ASSERT_EQUAL (0, g_stat (path, &st));
+	g_free (path);
+
+	entry = manifest_entry (name);
+	if (!entry) {
+		return FALSE;
+	}
+
+	xmmsv_dict_entry_get_int32 (entry, "failed", &failed);
+	xmmsv_dict_entry_get_int64 (entry, "size", &size);
+	xmmsv_unref (entry);
+
+	return failed && size == st.st_size;
+}
+
+static gboolean
+has_registration (xmmsv_t *entry, const gchar *kind, const gchar *value)
+{
+	xmmsv_list_iter_t *it;
+	xmmsv_t *registrations, *registration;
+	const gchar *a, *b;
+
+	CU_ASSERT (xmmsv_dict_get (entry, "registrations", &registrations));
+	CU_ASSERT (xmmsv_get_list_iter (registrations, &it));
+
+	for (; xmmsv_list_iter_valid (it); xmmsv_list_iter_next (it)) {
+		xmmsv_list_iter_entry (it, &registration);
+		if (xmmsv_list_get_string (registration, 0, &a) &&
+		    xmmsv_list_get_string (registration, 2, &b) &&
+		    strcmp (a, kind) == 0 && strcmp (b, value) == 0) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+SETUP (plugin) {
+	xmms_ipc_init ();
+	xmms_log_init (0);
+
+	xmms_config_init ("memory://");
+
+	tmpdir = g_dir_make_tmp ("xmms-t-plugin-XXXXXX", NULL);
+	plugindir = g_build_filename (tmpdir, "plugins", NULL);
+	g_mkdir (plugindir, 0755);
+
+	/* the manifest goes to the user cache dir */
+	g_setenv ("XDG_CACHE_HOME", tmpdir, TRUE);
+	manifest = g_build_filename (tmpdir, "xmms2", "plugins.manifest", NULL);
+
+	install_plugin ("libfirst.so");
+	xmms_plugin_init (plugindir);
+
+	return 0;
+}
+
+CLEANUP () {
+	gchar *cachedir;
+
+	xmms_plugin_shutdown ();
+
+	remove_plugin ("libfirst.so");
+	remove_plugin ("libsecond.so");
+	remove_plugin ("libbroken.so");
+	g_rmdir (plugindir);
+
+	g_unlink (manifest);
+	cachedir = g_path_get_dirname (manifest);
+	g_rmdir (cachedir);
+	g_rmdir (tmpdir);
+
+	g_free (cachedir);
+	g_free (manifest); manifest = NULL;
+	g_free (plugindir); plugindir = NULL;
+	g_free (tmpdir); tmpdir = NULL;
+
+	g_unsetenv ("XDG_CACHE_HOME");
+
+	xmms_config_shutdown ();
+	xmms_ipc_shutdown ();
+
+	return 0;
+}
+
+CASE (test_manifest_record_and_replay)
+{
+	xmms_config_property_t *prop;
+	xmms_plugin_t *plugin;
+	plugin_count_t count;
+	xmmsv_t *entry;
+
+	/* the first start loads the plugin and records what it registers */
+	count = count_plugins ();
+	CU_ASSERT_EQUAL (1, count.loaded);
+	CU_ASSERT_EQUAL (0, count.deferred);
+
+	entry = manifest_entry ("libfirst.so");
+	CU_ASSERT_PTR_NOT_NULL_FATAL (entry);
+	CU_ASSERT (has_registration (entry, "config", "42"));
+	CU_ASSERT (has_registration (entry, "extension", "*.mt"));
+
+	/* but not what another thread registered in the meantime */
+	CU_ASSERT_FALSE (has_registration (entry, "extension", "*.elsewhere"));
+	xmmsv_unref (entry);
+
+	/* later starts replay that without opening the plugin */
+	xmms_plugin_shutdown ();
+	xmms_config_shutdown ();
+	xmms_config_init ("memory://");
+	xmms_plugin_init (plugindir);
+
+	count = count_plugins ();
+	CU_ASSERT_EQUAL (0, count.loaded);
+	CU_ASSERT_EQUAL (1, count.deferred);
+
+	prop = xmms_config_lookup ("manifest_test.answer");
+	CU_ASSERT_PTR_NOT_NULL_FATAL (prop);
+	CU_ASSERT_STRING_EQUAL ("42", xmms_config_property_get_string (prop));
+
+	/* until it's needed */
+	plugin = xmms_plugin_find (XMMS_PLUGIN_TYPE_XFORM, "manifest_test");
+	CU_ASSERT_PTR_NOT_NULL_FATAL (plugin);
+	CU_ASSERT_PTR_NOT_NULL (plugin->module);
+	CU_ASSERT_FALSE (plugin->deferred);
+	xmms_object_unref (plugin);
+
+	count = count_plugins ();
+	CU_ASSERT_EQUAL (1, count.loaded);
+	CU_ASSERT_EQUAL (0, count.deferred);
+}
+
+CASE (test_manifest_stale_plugin)
+{
+	GStatBuf st;
+	gint64 size;
+	plugin_count_t count;
+	xmmsv_t *entry;
+	gchar *path;
+
+	restart ();
+	CU_ASSERT_EQUAL (1, count_plugins ().deferred);
+
+	/* a plugin that changed on disk is loaded again */
+	touch_plugin ("libfirst.so");
+	restart ();
+
+	count = count_plugins ();
+	CU_ASSERT_EQUAL (1, count.loaded);
+	CU_ASSERT_EQUAL (0, count.deferred);
+
+	/* and its entry updated */
+	path = g_build_filename (plugindir, "libfirst.so", NULL);
+	CU_ASSERT_EQUAL (0, g_stat (path, &st));
+	g_free (path);
+
+	entry = manifest_entry ("libfirst.so");
+	CU_ASSERT_PTR_NOT_NULL_FATAL (entry);
+	CU_ASSERT (xmmsv_dict_entry_get_int64 (entry, "size", &size));
+	CU_ASSERT_EQUAL (st.st_size, size);
+	xmmsv_unref (entry);
+
+	restart ();
+	CU_ASSERT_EQUAL (1, count_plugins ().deferred);
+}
+
+CASE (test_manifest_stale_version)
+{
+	const gchar *version;
+	plugin_count_t count;
+	xmmsv_t *dict;
+
+	/* a manifest written by another version is ignored */
+	dict = manifest_read ();
+	CU_ASSERT_PTR_NOT_NULL_FATAL (dict);
+	xmmsv_dict_set_string (dict, "version", "0.1/1/1");
+	manifest_write (dict);
+	xmmsv_unref (dict);
+
+	restart ();
+
+	count = count_plugins ();
+	CU_ASSERT_EQUAL (1, count.loaded);
+	CU_ASSERT_EQUAL (0, count.deferred);
+
+	/* and replaced */
+	dict = manifest_read ();
+	CU_ASSERT_PTR_NOT_NULL_FATAL (dict);
+	CU_ASSERT (xmmsv_dict_entry_get_string (dict, "version", &version));
+	CU_ASSERT_STRING_NOT_EQUAL ("0.1/1/1", version);
+	xmmsv_unref (dict);
+
+	restart ();
+	CU_ASSERT_EQUAL (1, count_plugins ().deferred);
+}
+
+CASE (test_manifest_missing_plugin)
+{
+	plugin_count_t count;
+	xmmsv_t *entry;
+
+	/* a new plugin is loaded and added, the known one stays deferred */
+	install_plugin ("libsecond.so");
+	restart ();
+
+	count = count_plugins ();
+	CU_ASSERT_EQUAL (1, count.loaded);
+	CU_ASSERT_EQUAL (1, count.deferred);
+
+	entry = manifest_entry ("libsecond.so");
+	CU_ASSERT_PTR_NOT_NULL (entry);
+	xmmsv_unref (entry);
+
+	restart ();
+
+	count = count_plugins ();
+	CU_ASSERT_EQUAL (0, count.loaded);
+	CU_ASSERT_EQUAL (2, count.deferred);
+
+	/* a removed plugin is dropped from the manifest */
+	remove_plugin ("libsecond.so");
+	restart ();
+
+	count = count_plugins ();
+	CU_ASSERT_EQUAL (0, count.loaded);
+	CU_ASSERT_EQUAL (1, count.deferred);
+
+	CU_ASSERT_PTR_NULL (manifest_entry ("libsecond.so"));
+}
+
+CASE (test_manifest_replaced_before_load)
+{
+	plugin_count_t count;
+	gchar *path;
+
+	restart ();
+	CU_ASSERT_EQUAL (1, count_plugins ().deferred);
+
+	/* the file went bad after the daemon started */
+	path = g_build_filename (plugindir, "libfirst.so", NULL);
+	CU_ASSERT (g_file_set_contents (path, "garbage", -1, NULL));
+	g_free (path);
+
+	CU_ASSERT_PTR_NULL (xmms_plugin_find (XMMS_PLUGIN_TYPE_XFORM, "manifest_test"));
+
+	/* the plugin is given up on rather than tried again */
+	count = count_plugins ();
+	CU_ASSERT_EQUAL (0, count.loaded);
+	CU_ASSERT_EQUAL (0, count.deferred);
+}
+
+CASE (test_manifest_broken_file)
+{
+	gchar *path;
+
+	/* not a plugin at all */
+	path = g_build_filename (plugindir, "libbroken.so", NULL);
+	CU_ASSERT (g_file_set_contents (path, "garbage", -1, NULL));
+	g_free (path);
+
+	restart ();
+	CU_ASSERT_EQUAL (1, count_plugins ().deferred);
+	CU_ASSERT (listed_as_failed ("libbroken.so"));
+
+	/* failing again is no reason to write the manifest again */
+	manifest_mark ();
+	restart ();
+	CU_ASSERT (manifest_marked ());
+	CU_ASSERT (listed_as_failed ("libbroken.so"));
+	CU_ASSERT_EQUAL (1, count_plugins ().deferred);
+}
+
+CASE (test_manifest_failed_setup)
+{
+	plugin_count_t count;
+
+	g_setenv ("MANIFEST_TEST_FAIL", "1", TRUE);
+
+	/* a new version of the plugin fails to set up */
+	touch_plugin ("libfirst.so");
+	restart ();
+
+	count = count_plugins ();
+	CU_ASSERT_EQUAL (0, count.loaded);
+	CU_ASSERT_EQUAL (0, count.deferred);
+	CU_ASSERT (listed_as_failed ("libfirst.so"));
+
+	manifest_mark ();
+	restart ();
+	CU_ASSERT (manifest_marked ());
+	CU_ASSERT (listed_as_failed ("libfirst.so"));
+
+	g_unsetenv ("MANIFEST_TEST_FAIL");
+
+	/* it is tried every time, so it comes back once it works */
+	restart ();
+	CU_ASSERT_FALSE (manifest_marked ());
+	CU_ASSERT_FALSE (listed_as_failed ("libfirst.so"));
+	CU_ASSERT_EQUAL (1, count_plugins ().loaded);
+
+	restart ();
+	CU_ASSERT_EQUAL (1, count_plugins ().deferred);
+}
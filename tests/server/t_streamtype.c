@@ -314,3 +314,33 @@ CASE (test_coerce)
 	xmms_object_unref (from);
 	xmms_object_unref (to);
 }
+
+CASE (test_value_roundtrip)
+{
+	xmms_stream_type_t *st, *copy;
+	xmmsv_t *value;
+
+	st = _xmms_stream_type_new ("dummy",
+	                            XMMS_STREAM_TYPE_MIMETYPE, "audio/pcm",
+	                            XMMS_STREAM_TYPE_URL, "file://*",
+	                            XMMS_STREAM_TYPE_FMT_CHANNELS, 2,
+	                            XMMS_STREAM_TYPE_PRIORITY, 10,
+	                            XMMS_STREAM_TYPE_END);
+
+	value = xmms_stream_type_to_value (st);
+	copy = xmms_stream_type_from_value (value);
+	CU_ASSERT_PTR_NOT_NULL (copy);
+
+	CU_ASSERT_STRING_EQUAL (xmms_stream_type_get_str (st, XMMS_STREAM_TYPE_NAME),
+	                        xmms_stream_type_get_str (copy, XMMS_STREAM_TYPE_NAME));
+	CU_ASSERT_STRING_EQUAL ("file://*",
+	                        xmms_stream_type_get_str (copy, XMMS_STREAM_TYPE_URL));
+	CU_ASSERT_EQUAL (2, xmms_stream_type_get_int (copy, XMMS_STREAM_TYPE_FMT_CHANNELS));
+	CU_ASSERT_EQUAL (10, xmms_stream_type_get_int (copy, XMMS_STREAM_TYPE_PRIORITY));
+	CU_ASSERT_TRUE (xmms_stream_type_match (copy, st));
+	CU_ASSERT_TRUE (xmms_stream_type_match (st, copy));
+
+	xmmsv_unref (value);
+	xmms_object_unref (copy);
+	xmms_object_unref (st);
+}
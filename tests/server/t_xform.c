@@ -19,6 +19,7 @@
 #include <glib.h>
 
 #include <locale.h>
+#include <string.h>
 
 #include <xmmspriv/xmms_plugin.h>
 #include <xmmspriv/xmms_xform.h>
@@ -286,3 +287,135 @@ CASE(test_browse)
 	CU_ASSERT_BROWSE_ENTRY (result, 5, "file:///Last_Directory", 1, 0);
 	xmmsv_unref (result);
 }
+
+#define STATS_TEST_SIZE 1000
+
+static gboolean
+xmms_stats_test_init (xmms_xform_t *xform)
+{
+	xmms_xform_private_data_set (xform, g_new0 (gint, 1));
+	xmms_xform_outdata_type_add (xform, XMMS_STREAM_TYPE_MIMETYPE, "audio/pcm", XMMS_STREAM_TYPE_END);
+	return TRUE;
+}
+
+static void
+xmms_stats_test_destroy (xmms_xform_t *xform)
+{
+	g_free (xmms_xform_private_data_get (xform));
+}
+
+static gint
+xmms_stats_test_read (xmms_xform_t *xform, void *buffer, gint len, xmms_error_t *error)
+{
+	gint *produced = xmms_xform_private_data_get (xform);
+
+	len = MIN (len, STATS_TEST_SIZE - *produced);
+	memset (buffer, 'x', len);
+	*produced += len;
+
+	return len;
+}
+
+static gboolean
+xmms_stats_test_xform_plugin_setup (xmms_xform_plugin_t *xform_plugin)
+{
+	xmms_xform_methods_t methods;
+
+	XMMS_XFORM_METHODS_INIT (methods);
+
+	methods.init = xmms_stats_test_init;
+	methods.destroy = xmms_stats_test_destroy;
+	methods.read = xmms_stats_test_read;
+
+	xmms_xform_plugin_methods_set (xform_plugin, &methods);
+
+	xmms_xform_plugin_indata_add (xform_plugin,
+	                              XMMS_STREAM_TYPE_MIMETYPE, "application/x-url",
+	                              XMMS_STREAM_TYPE_URL, "statstest://*",
+	                              XMMS_STREAM_TYPE_END);
+
+	return TRUE;
+}
+
+XMMS_XFORM_BUILTIN_DEFINE (stats_test_xform,
+                           "stats test xform",
+                           XMMS_VERSION,
+                           "stats test xform",
+                           xmms_stats_test_xform_plugin_setup);
+
+/* Read the whole stream, as the next xform in the chain would, and
+ * return the stats of the test plugin.
+ */
+static xmmsv_t *
+read_chain_stats (gboolean peek)
+{
+	xmms_xform_plugin_t *plugin;
+	xmms_xform_t *source, *xform, *sink;
+	xmms_error_t err;
+	xmmsv_t *stats, *entry;
+	gchar buf[64];
+	gint total = 0, ret;
+
+	plugin = xmms_xform_find_plugin ("stats_test_xform");
+	CU_ASSERT_PTR_NOT_NULL_FATAL (plugin);
+
+	source = xmms_xform_new (NULL, NULL, NULL, 0, NULL);
+	xform = xmms_xform_new (plugin, source, NULL, 1, NULL);
+	CU_ASSERT_PTR_NOT_NULL_FATAL (xform);
+	sink = xmms_xform_new (NULL, xform, NULL, 0, NULL);
+
+	xmms_error_reset (&err);
+
+	if (peek) {
+		CU_ASSERT_EQUAL (sizeof (buf), xmms_xform_peek (sink, buf, sizeof (buf), &err));
+	}
+
+	while ((ret = xmms_xform_read (sink, buf, sizeof (buf), &err)) > 0) {
+		total += ret;
+	}
+	CU_ASSERT_EQUAL (0, ret);
+	CU_ASSERT_EQUAL (STATS_TEST_SIZE, total);
+
+	/* xforms without a plugin aren't listed */
+	stats = xmms_xform_chain_stats (sink);
+	CU_ASSERT_EQUAL (1, xmmsv_list_get_size (stats));
+	CU_ASSERT_TRUE (xmmsv_list_get (stats, 0, &entry));
+	xmmsv_ref (entry);
+
+	xmmsv_unref (stats);
+	xmms_object_unref (sink);
+	xmms_object_unref (xform);
+	xmms_object_unref (source);
+	xmms_object_unref (plugin);
+
+	return entry;
+}
+
+CASE(test_xform_chain_stats)
+{
+	const gchar *name;
+	xmmsv_t *entry;
+	gint bytes, copied, time;
+
+	xmms_plugin_load (&xmms_builtin_stats_test_xform, NULL);
+
+	/* plain reads go straight into the caller's buffer */
+	entry = read_chain_stats (FALSE);
+	CU_ASSERT_TRUE (xmmsv_dict_entry_get_string (entry, "plugin", &name));
+	CU_ASSERT_STRING_EQUAL ("stats_test_xform", name);
+	CU_ASSERT_TRUE (xmmsv_dict_entry_get_int (entry, "bytes", &bytes));
+	CU_ASSERT_EQUAL (STATS_TEST_SIZE, bytes);
+	CU_ASSERT_TRUE (xmmsv_dict_entry_get_int (entry, "copied", &copied));
+	CU_ASSERT_EQUAL (0, copied);
+	CU_ASSERT_TRUE (xmmsv_dict_entry_get_int (entry, "time", &time));
+	CU_ASSERT (time >= 0);
+	xmmsv_unref (entry);
+
+	/* after a peek everything comes out of the peek buffer */
+	entry = read_chain_stats (TRUE);
+	CU_ASSERT_TRUE (xmmsv_dict_entry_get_int (entry, "bytes", &bytes));
+	CU_ASSERT_EQUAL (STATS_TEST_SIZE, bytes);
+	CU_ASSERT_TRUE (xmmsv_dict_entry_get_int (entry, "copied", &copied));
+	CU_ASSERT_EQUAL (STATS_TEST_SIZE, copied);
+	xmmsv_unref (entry);
+}
@@ -0,0 +1,309 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include "xcu.h"
+
+#include <glib.h>
+
+#include <xmmspriv/xmms_log.h>
+#include <xmmspriv/xmms_ipc.h>
+#include <xmmspriv/xmms_config.h>
+#include <xmmspriv/xmms_plugin.h>
+#include <xmmspriv/xmms_xform.h>
+#include <xmmspriv/xmms_xform_plugin.h>
+#include <xmmspriv/xmms_streamtype.h>
+
+/* The test plugins and their input types. They are loaded in the
+ * order given in SETUP, a plugin loaded later comes first in the plugin
+ * list and wins ties.
+ */
+
+static gboolean
+exact_a_setup (xmms_xform_plugin_t *xform_plugin)
+{
+	xmms_xform_plugin_indata_add (xform_plugin,
+	                              XMMS_STREAM_TYPE_MIMETYPE, "audio/x-test",
+	                              XMMS_STREAM_TYPE_PRIORITY, 50,
+	                              XMMS_STREAM_TYPE_END);
+	return TRUE;
+}
+
+static gboolean
+exact_b_setup (xmms_xform_plugin_t *xform_plugin)
+{
+	xmms_xform_plugin_indata_add (xform_plugin,
+	                              XMMS_STREAM_TYPE_MIMETYPE, "audio/x-test",
+	                              XMMS_STREAM_TYPE_PRIORITY, 50,
+	                              XMMS_STREAM_TYPE_END);
+	return TRUE;
+}
+
+static gboolean
+wildcard_setup (xmms_xform_plugin_t *xform_plugin)
+{
+	xmms_xform_plugin_indata_add (xform_plugin,
+	                              XMMS_STREAM_TYPE_MIMETYPE, "audio/*",
+	                              XMMS_STREAM_TYPE_PRIORITY, 40,
+	                              XMMS_STREAM_TYPE_END);
+	xmms_xform_plugin_indata_add (xform_plugin,
+	                              XMMS_STREAM_TYPE_MIMETYPE, "audio/x-other",
+	                              XMMS_STREAM_TYPE_FMT_CHANNELS, 2,
+	                              XMMS_STREAM_TYPE_PRIORITY, 60,
+	                              XMMS_STREAM_TYPE_END);
+	return TRUE;
+}
+
+static gboolean
+multi_setup (xmms_xform_plugin_t *xform_plugin)
+{
+	/* both match audio/x-multi, only the last one registered counts */
+	xmms_xform_plugin_indata_add (xform_plugin,
+	                              XMMS_STREAM_TYPE_MIMETYPE, "audio/x-multi",
+	                              XMMS_STREAM_TYPE_PRIORITY, 30,
+	                              XMMS_STREAM_TYPE_END);
+	xmms_xform_plugin_indata_add (xform_plugin,
+	                              XMMS_STREAM_TYPE_MIMETYPE, "audio/*",
+	                              XMMS_STREAM_TYPE_NAME, "anything",
+	                              XMMS_STREAM_TYPE_PRIORITY, 45,
+	                              XMMS_STREAM_TYPE_END);
+	return TRUE;
+}
+
+static gboolean
+url_setup (xmms_xform_plugin_t *xform_plugin)
+{
+	xmms_xform_plugin_indata_add (xform_plugin,
+	                              XMMS_STREAM_TYPE_MIMETYPE, "application/x-url",
+	                              XMMS_STREAM_TYPE_URL, "file://*.tst",
+	                              XMMS_STREAM_TYPE_PRIORITY, 50,
+	                              XMMS_STREAM_TYPE_END);
+	xmms_xform_plugin_indata_add (xform_plugin,
+	                              XMMS_STREAM_TYPE_URL, "http://*",
+	                              XMMS_STREAM_TYPE_NAME, "http",
+	                              XMMS_STREAM_TYPE_PRIORITY, 20,
+	                              XMMS_STREAM_TYPE_END);
+	return TRUE;
+}
+
+static gboolean
+fallback_setup (xmms_xform_plugin_t *xform_plugin)
+{
+	xmms_xform_plugin_indata_add (xform_plugin,
+	                              XMMS_STREAM_TYPE_MIMETYPE, "*",
+	                              XMMS_STREAM_TYPE_PRIORITY, 10,
+	                              XMMS_STREAM_TYPE_END);
+	return TRUE;
+}
+
+XMMS_XFORM_BUILTIN_DEFINE (exact_a, "exact a", "1.0", "exact a", exact_a_setup);
+XMMS_XFORM_BUILTIN_DEFINE (exact_b, "exact b", "1.0", "exact b", exact_b_setup);
+XMMS_XFORM_BUILTIN_DEFINE (wildcard, "wildcard", "1.0", "wildcard", wildcard_setup);
+XMMS_XFORM_BUILTIN_DEFINE (multi, "multi", "1.0", "multi", multi_setup);
+XMMS_XFORM_BUILTIN_DEFINE (url, "url", "1.0", "url", url_setup);
+XMMS_XFORM_BUILTIN_DEFINE (fallback, "fallback", "1.0", "fallback", fallback_setup);
+
+SETUP (xform_plugin) {
+	xmms_ipc_init ();
+	xmms_log_init (0);
+
+	xmms_config_init ("memory://");
+
+	xmms_plugin_load (&xmms_builtin_fallback, NULL);
+	xmms_plugin_load (&xmms_builtin_exact_a, NULL);
+	xmms_plugin_load (&xmms_builtin_wildcard, NULL);
+	xmms_plugin_load (&xmms_builtin_exact_b, NULL);
+	xmms_plugin_load (&xmms_builtin_multi, NULL);
+	xmms_plugin_load (&xmms_builtin_url, NULL);
+
+	return 0;
+}
+
+CLEANUP () {
+	xmms_plugin_shutdown ();
+
+	xmms_config_shutdown ();
+	xmms_ipc_shutdown ();
+
+	return 0;
+}
+
+typedef struct {
+	const xmms_stream_type_t *st;
+	xmms_xform_plugin_t *match;
+	gint priority;
+} linear_state_t;
+
+/* What xmms_xform_find did before the index: ask every plugin in turn */
+static gboolean
+linear_match (xmms_plugin_t *plugin, gpointer udata)
+{
+	linear_state_t *state = udata;
+	gint priority;
+
+	if (!xmms_xform_plugin_supports ((xmms_xform_plugin_t *) plugin,
+	                                 state->st, &priority)) {
+		return TRUE;
+	}
+
+	if (priority > state->priority) {
+		state->match = (xmms_xform_plugin_t *) plugin;
+		state->priority = priority;
+	}
+
+	return TRUE;
+}
+
+/* Check that the index and the linear walk agree, and on what */
+static void
+check_find (const gchar *expected, gint expected_priority,
+            xmms_stream_type_t *st)
+{
+	linear_state_t state = { st, NULL, -1 };
+	xmms_xform_plugin_t *match;
+	gint priority;
+
+	xmms_plugin_foreach (XMMS_PLUGIN_TYPE_XFORM, linear_match, &state);
+
+	match = xmms_xform_plugin_find (st, &priority);
+
+	CU_ASSERT_PTR_EQUAL (state.match, match);
+	CU_ASSERT_EQUAL (state.priority, priority);
+
+	if (expected) {
+		CU_ASSERT_PTR_NOT_NULL_FATAL (match);
+		CU_ASSERT_STRING_EQUAL (expected,
+		                        xmms_plugin_shortname_get ((xmms_plugin_t *) match));
+		CU_ASSERT_EQUAL (expected_priority, priority);
+	} else {
+		CU_ASSERT_PTR_NULL (match);
+	}
+
+	xmms_object_unref (st);
+}
+
+static void
+set_priority (const gchar *key, const gchar *value)
+{
+	xmms_config_property_t *prop;
+
+	prop = xmms_config_lookup (key);
+	CU_ASSERT_PTR_NOT_NULL_FATAL (prop);
+	xmms_config_property_set_data (prop, value);
+}
+
+CASE (test_find_ties)
+{
+	/* two plugins with the same priority, the later one wins */
+	check_find ("exact_b", 50,
+	            _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                   XMMS_STREAM_TYPE_MIMETYPE, "audio/x-test",
+	                                   XMMS_STREAM_TYPE_END));
+
+	/* and with a wildcard of the same priority in between */
+	set_priority ("wildcard.priority.audio/*", "50");
+	check_find ("exact_b", 50,
+	            _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                   XMMS_STREAM_TYPE_MIMETYPE, "audio/x-test",
+	                                   XMMS_STREAM_TYPE_END));
+
+	set_priority ("multi.priority.anything", "50");
+	check_find ("multi", 50,
+	            _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                   XMMS_STREAM_TYPE_MIMETYPE, "audio/x-test",
+	                                   XMMS_STREAM_TYPE_END));
+}
+
+CASE (test_find_priorities)
+{
+	check_find ("multi", 45,
+	            _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                   XMMS_STREAM_TYPE_MIMETYPE, "audio/x-other",
+	                                   XMMS_STREAM_TYPE_FMT_CHANNELS, 1,
+	                                   XMMS_STREAM_TYPE_END));
+
+	check_find ("wildcard", 60,
+	            _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                   XMMS_STREAM_TYPE_MIMETYPE, "audio/x-other",
+	                                   XMMS_STREAM_TYPE_FMT_CHANNELS, 2,
+	                                   XMMS_STREAM_TYPE_END));
+
+	/* priorities changed at runtime are picked up */
+	set_priority ("exact_a.priority.audio/x-test", "80");
+	check_find ("exact_a", 80,
+	            _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                   XMMS_STREAM_TYPE_MIMETYPE, "audio/x-test",
+	                                   XMMS_STREAM_TYPE_END));
+
+	set_priority ("fallback.priority.*", "90");
+	check_find ("fallback", 90,
+	            _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                   XMMS_STREAM_TYPE_MIMETYPE, "audio/x-test",
+	                                   XMMS_STREAM_TYPE_END));
+}
+
+CASE (test_find_first_type_of_plugin)
+{
+	/* audio/x-multi at 70 would win, but audio/* of the same plugin
+	 * was registered later and is the one that counts */
+	set_priority ("multi.priority.audio/x-multi", "70");
+	check_find ("multi", 45,
+	            _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                   XMMS_STREAM_TYPE_MIMETYPE, "audio/x-multi",
+	                                   XMMS_STREAM_TYPE_END));
+
+	set_priority ("multi.priority.anything", "5");
+	check_find ("wildcard", 40,
+	            _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                   XMMS_STREAM_TYPE_MIMETYPE, "audio/x-multi",
+	                                   XMMS_STREAM_TYPE_END));
+}
+
+CASE (test_find_urls)
+{
+	check_find ("url", 50,
+	            _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                   XMMS_STREAM_TYPE_MIMETYPE, "application/x-url",
+	                                   XMMS_STREAM_TYPE_URL, "file:///music/a.tst",
+	                                   XMMS_STREAM_TYPE_END));
+
+	check_find ("url", 20,
+	            _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                   XMMS_STREAM_TYPE_MIMETYPE, "application/x-url",
+	                                   XMMS_STREAM_TYPE_URL, "http://example.org/a.tst",
+	                                   XMMS_STREAM_TYPE_END));
+
+	check_find ("fallback", 10,
+	            _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                   XMMS_STREAM_TYPE_MIMETYPE, "application/x-url",
+	                                   XMMS_STREAM_TYPE_URL, "file:///music/a.ogg",
+	                                   XMMS_STREAM_TYPE_END));
+
+	/* a stream without a mimetype is only matched by types without one */
+	check_find (NULL, -1,
+	            _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                   XMMS_STREAM_TYPE_URL, "file:///music/a.tst",
+	                                   XMMS_STREAM_TYPE_NAME, "no mimetype",
+	                                   XMMS_STREAM_TYPE_END));
+}
+
+CASE (test_find_nothing)
+{
+	set_priority ("fallback.priority.*", "-1");
+	check_find (NULL, -1,
+	            _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                   XMMS_STREAM_TYPE_MIMETYPE, "video/x-none",
+	                                   XMMS_STREAM_TYPE_END));
+}
@@ -0,0 +1,223 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include <glib.h>
+#include <stdlib.h>
+
+#include <xmms/xmms_log.h>
+#include <xmms/xmms_sample.h>
+#include <xmmspriv/xmms_log.h>
+#include <xmmspriv/xmms_ipc.h>
+#include <xmmspriv/xmms_config.h>
+#include <xmmspriv/xmms_plugin.h>
+#include <xmmspriv/xmms_xform.h>
+#include <xmmspriv/xmms_xform_plugin.h>
+#include <xmmspriv/xmms_streamtype.h>
+
+#define DEFAULT_CHAINS 100000
+
+/*
+ * The stream types a chain for a local file goes through, from the url
+ * to the decoded audio.
+ */
+static xmms_stream_type_t **
+chain_types_new (gint *count)
+{
+	static const gchar *mimes[] = {
+		"audio/mpeg", "audio/x-flac", "application/ogg", "audio/x-wav",
+		"audio/mp4", "audio/x-ms-wma", "audio/x-mpc", "audio/x-wavpack"
+	};
+	xmms_stream_type_t **types;
+	gint i, n = 0;
+
+	types = g_new0 (xmms_stream_type_t *, G_N_ELEMENTS (mimes) + 3);
+
+	types[n++] = _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                    XMMS_STREAM_TYPE_MIMETYPE, "application/x-url",
+	                                    XMMS_STREAM_TYPE_URL, "file:///music/track",
+	                                    XMMS_STREAM_TYPE_END);
+	types[n++] = _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                    XMMS_STREAM_TYPE_MIMETYPE, "application/octet-stream",
+	                                    XMMS_STREAM_TYPE_END);
+
+	for (i = 0; i < G_N_ELEMENTS (mimes); i++) {
+		types[n++] = _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+		                                    XMMS_STREAM_TYPE_MIMETYPE, mimes[i],
+		                                    XMMS_STREAM_TYPE_END);
+	}
+
+	types[n++] = _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+	                                    XMMS_STREAM_TYPE_MIMETYPE, "audio/pcm",
+	                                    XMMS_STREAM_TYPE_FMT_FORMAT, XMMS_SAMPLE_FORMAT_S16,
+	                                    XMMS_STREAM_TYPE_FMT_CHANNELS, 2,
+	                                    XMMS_STREAM_TYPE_FMT_SAMPLERATE, 44100,
+	                                    XMMS_STREAM_TYPE_END);
+
+	*count = n;
+
+	return types;
+}
+
+typedef struct match_state_St {
+	xmms_xform_plugin_t *match;
+	const xmms_stream_type_t *out_type;
+	gint priority;
+} match_state_t;
+
+/* How xmms_xform_find used to pick a plugin, kept as the reference */
+static gboolean
+reference_match (xmms_plugin_t *plugin, gpointer user_data)
+{
+	xmms_xform_plugin_t *xform_plugin = (xmms_xform_plugin_t *) plugin;
+	match_state_t *state = (match_state_t *) user_data;
+	gint priority = 0;
+
+	XMMS_DBG ("Trying plugin '%s'", xmms_plugin_shortname_get (plugin));
+	if (!xmms_xform_plugin_supports (xform_plugin, state->out_type, &priority)) {
+		return TRUE;
+	}
+
+	XMMS_DBG ("Plugin '%s' matched (priority %d)",
+	          xmms_plugin_shortname_get (plugin), priority);
+
+	if (priority > state->priority) {
+		state->match = xform_plugin;
+		state->priority = priority;
+	}
+
+	return TRUE;
+}
+
+static xmms_xform_plugin_t *
+reference_find (const xmms_stream_type_t *st, gint *priority)
+{
+	match_state_t state;
+
+	state.out_type = st;
+	state.match = NULL;
+	state.priority = -1;
+
+	xmms_plugin_foreach (XMMS_PLUGIN_TYPE_XFORM, reference_match, &state);
+
+	*priority = state.priority;
+
+	return state.match;
+}
+
+static gboolean
+count_plugin (xmms_plugin_t *plugin, gpointer user_data)
+{
+	(*(gint *) user_data)++;
+	return TRUE;
+}
+
+static void
+quiet_log_handler (const gchar *log_domain, GLogLevelFlags log_level,
+                   const gchar *message, gpointer user_data)
+{
+	if (log_level & (G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL)) {
+		g_printerr ("%s: %s\n", log_domain, message);
+	}
+}
+
+/**
+ * Time how long finding the plugins for a whole chain takes, with the
+ * mimetype index and with the old walk over all plugins.
+ *
+ * Usage: xform-dispatch-bench <plugindir> [chains]
+ */
+gint
+main (gint argc, gchar **argv)
+{
+	xmms_stream_type_t **types;
+	xmms_xform_plugin_t *a, *b;
+	gint64 t0, t1, t2;
+	gint i, j, count, chains = DEFAULT_CHAINS, plugins = 0, pa, pb;
+	gboolean ok = TRUE;
+
+	if (argc < 2) {
+		g_printerr ("Usage: %s <plugindir> [chains]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (argc > 2) {
+		chains = MAX (1, atoi (argv[2]));
+	}
+
+	xmms_log_init (0);
+	g_log_set_default_handler (quiet_log_handler, NULL);
+
+	xmms_ipc_init ();
+	xmms_config_init ("memory://");
+
+	if (!xmms_plugin_init (argv[1])) {
+		g_printerr ("Could not load plugins\n");
+		return EXIT_FAILURE;
+	}
+
+	xmms_plugin_foreach (XMMS_PLUGIN_TYPE_XFORM, count_plugin, &plugins);
+
+	types = chain_types_new (&count);
+
+	for (j = 0; j < count; j++) {
+		a = xmms_xform_plugin_find (types[j], &pa);
+		b = reference_find (types[j], &pb);
+
+		g_print ("%-26s -> %s\n",
+		         xmms_stream_type_get_str (types[j], XMMS_STREAM_TYPE_MIMETYPE),
+		         a ? xmms_plugin_shortname_get ((xmms_plugin_t *) a) : "(none)");
+
+		if (a != b || pa != pb) {
+			g_printerr ("  mismatch, reference picked %s\n",
+			            b ? xmms_plugin_shortname_get ((xmms_plugin_t *) b) : "(none)");
+			ok = FALSE;
+		}
+	}
+
+	t0 = g_get_monotonic_time ();
+	for (i = 0; i < chains; i++) {
+		for (j = 0; j < count; j++) {
+			reference_find (types[j], &pb);
+		}
+	}
+
+	t1 = g_get_monotonic_time ();
+	for (i = 0; i < chains; i++) {
+		for (j = 0; j < count; j++) {
+			xmms_xform_plugin_find (types[j], &pa);
+		}
+	}
+
+	t2 = g_get_monotonic_time ();
+
+	g_print ("%d xform plugins, %d chains of %d lookups\n",
+	         plugins, chains, count);
+	g_print ("plugin walk  %8.2f us/chain\n", (gdouble) (t1 - t0) / chains);
+	g_print ("index        %8.2f us/chain  speedup %.1fx\n",
+	         (gdouble) (t2 - t1) / chains,
+	         (gdouble) (t1 - t0) / MAX (1, t2 - t1));
+
+	for (j = 0; j < count; j++) {
+		xmms_object_unref (types[j]);
+	}
+	g_free (types);
+
+	xmms_plugin_shutdown ();
+	xmms_config_shutdown ();
+	xmms_ipc_shutdown ();
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
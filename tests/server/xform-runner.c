@@ -0,0 +1,604 @@
+/*  XMMS2 - X Music Multiplexer System
+ *  Copyright (C) 2003-2023 XMMS2 Team
+ *
+ *  PLUGINS ARE NOT CONSIDERED TO BE DERIVED WORK !!!
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ */
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include <xmms/xmms_sample.h>
+#include <xmmspriv/xmms_log.h>
+#include <xmmspriv/xmms_ipc.h>
+#include <xmmspriv/xmms_config.h>
+#include <xmmspriv/xmms_plugin.h>
+#include <xmmspriv/xmms_medialib.h>
+#include <xmmspriv/xmms_bindata.h>
+#include <xmmspriv/xmms_xform.h>
+#include <xmmspriv/xmms_xform_object.h>
+#include <xmmspriv/xmms_streamtype.h>
+
+#define DRAIN_SIZE 16384
+
+typedef struct xmms_runner_args_St {
+	enum {
+		FORMAT_PRETTY,
+		FORMAT_JSON
+	} format;
+	const gchar *plugin_path;
+	gchar **effects;
+	gchar **paths;
+	gboolean debug;
+} xmms_runner_args_t;
+
+static void
+simple_log_handler (const gchar *log_domain, GLogLevelFlags log_level,
+                    const gchar *message, gpointer user_data)
+{
+	xmms_runner_args_t *args = (xmms_runner_args_t *) user_data;
+
+	if (log_level & G_LOG_FLAG_RECURSION) {
+		exit (1);
+	}
+
+	/* keep stdout clean for the results */
+	if (args->debug || (log_level & (G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL |
+	                                 G_LOG_LEVEL_WARNING))) {
+		g_printerr ("%s: %s\n", log_domain, message);
+	}
+
+	if (log_level & G_LOG_FLAG_FATAL) {
+		exit (EXIT_FAILURE);
+	}
+}
+
+static void
+scan_path (const gchar *path, xmmsv_t *list)
+{
+	const gchar *filename;
+	GDir *dir;
+
+	if (g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
+		xmmsv_list_append_string (list, path);
+		return;
+	}
+
+	dir = g_dir_open (path, 0, NULL);
+	if (dir == NULL) {
+		g_printerr ("Could not open directory: %s\n", path);
+		exit (EXIT_FAILURE);
+	}
+
+	while ((filename = g_dir_read_name (dir)) != NULL) {
+		gchar *filepath;
+
+		filepath = g_build_filename (path, filename, NULL);
+		scan_path (filepath, list);
+		g_free (filepath);
+	}
+
+	g_dir_close (dir);
+}
+
+/* anything the output could take, let the chain pick the cheapest */
+static GList *
+goal_formats_new (void)
+{
+	static const xmms_sample_format_t formats[] = {
+		XMMS_SAMPLE_FORMAT_S16,
+		XMMS_SAMPLE_FORMAT_S32,
+		XMMS_SAMPLE_FORMAT_FLOAT
+	};
+	GList *goals = NULL;
+	gint i, channels;
+
+	for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+		for (channels = 1; channels <= 2; channels++) {
+			xmms_stream_type_t *type;
+
+			type = _xmms_stream_type_new (XMMS_STREAM_TYPE_BEGIN,
+			                              XMMS_STREAM_TYPE_MIMETYPE, "audio/pcm",
+			                              XMMS_STREAM_TYPE_FMT_FORMAT, formats[i],
+			                              XMMS_STREAM_TYPE_FMT_CHANNELS, channels,
+			                              XMMS_STREAM_TYPE_END);
+			goals = g_list_append (goals, type);
+		}
+	}
+
+	return goals;
+}
+
+static void
+goal_formats_free (GList *goals)
+{
+	GList *n;
+
+	for (n = goals; n; n = g_list_next (n)) {
+		xmms_object_unref (n->data);
+	}
+	g_list_free (goals);
+}
+
+static xmms_medialib_entry_t
+entry_for_path (xmms_medialib_t *medialib, const gchar *path)
+{
+	xmms_medialib_session_t *session;
+	xmms_medialib_entry_t entry;
+	xmms_error_t err;
+	gchar *absolute, *url;
+
+	if (g_path_is_absolute (path)) {
+		absolute = g_strdup (path);
+	} else {
+		gchar *cwd = g_get_current_dir ();
+		absolute = g_build_filename (cwd, path, NULL);
+		g_free (cwd);
+	}
+
+	/* encoded by xmms_medialib_entry_new */
+	url = g_strconcat ("file://", absolute, NULL);
+	g_free (absolute);
+
+	xmms_error_reset (&err);
+
+	do {
+		session = xmms_medialib_session_begin (medialib);
+		entry = xmms_medialib_entry_new (session, url, &err);
+	} while (!xmms_medialib_session_commit (session));
+
+	g_free (url);
+
+	return entry;
+}
+
+static glong
+peak_rss (void)
+{
+	struct rusage usage;
+
+	if (getrusage (RUSAGE_SELF, &usage) == -1) {
+		return -1;
+	}
+
+	/* kilobytes on Linux */
+	return usage.ru_maxrss;
+}
+
+/* time spent in each stage itself, not in the ones it read from */
+static void
+stats_make_exclusive (xmmsv_t *stages)
+{
+	xmmsv_list_iter_t *it;
+	xmmsv_t *stage;
+	gint64 previous = 0;
+
+	xmmsv_get_list_iter (stages, &it);
+	while (xmmsv_list_iter_entry (it, &stage)) {
+		gint64 time;
+
+		xmmsv_dict_entry_get_int64 (stage, "time", &time);
+		xmmsv_dict_set_int (stage, "time", MAX (time - previous, 0));
+		previous = time;
+
+		xmmsv_list_iter_next (it);
+	}
+}
+
+static void
+stats_accumulate (xmmsv_t *totals, xmmsv_t *stages)
+{
+	xmmsv_list_iter_t *it;
+	xmmsv_t *stage;
+
+	xmmsv_get_list_iter (stages, &it);
+	while (xmmsv_list_iter_entry (it, &stage)) {
+		gint64 bytes, copied, time, value;
+		const gchar *plugin;
+		xmmsv_t *total;
+
+		xmmsv_dict_entry_get_string (stage, "plugin", &plugin);
+		xmmsv_dict_entry_get_int64 (stage, "bytes", &bytes);
+		xmmsv_dict_entry_get_int64 (stage, "copied", &copied);
+		xmmsv_dict_entry_get_int64 (stage, "time", &time);
+
+		if (!xmmsv_dict_get (totals, plugin, &total)) {
+			total = xmmsv_build_dict (XMMSV_DICT_ENTRY_INT ("bytes", 0),
+			                          XMMSV_DICT_ENTRY_INT ("copied", 0),
+			                          XMMSV_DICT_ENTRY_INT ("time", 0),
+			                          XMMSV_DICT_END);
+			xmmsv_dict_set (totals, plugin, total);
+			xmmsv_unref (total);
+		}
+
+		xmmsv_dict_entry_get_int64 (total, "bytes", &value);
+		xmmsv_dict_set_int (total, "bytes", value + bytes);
+		xmmsv_dict_entry_get_int64 (total, "copied", &value);
+		xmmsv_dict_set_int (total, "copied", value + copied);
+		xmmsv_dict_entry_get_int64 (total, "time", &value);
+		xmmsv_dict_set_int (total, "time", value + time);
+
+		xmmsv_list_iter_next (it);
+	}
+}
+
+/**
+ * Set up the chain for one file and read it to the end as fast
+ * as it goes, returns a dict describing the run or NULL.
+ */
+static xmmsv_t *
+run_file (xmms_medialib_t *medialib, GList *goals, const gchar *path)
+{
+	xmms_medialib_entry_t entry;
+	xmms_xform_t *xform;
+	xmms_error_t err;
+	xmmsv_t *stages, *result;
+	gint64 t0, t1, t2, bytes = 0, copied = 0;
+	gint frame_size, samplerate;
+	gdouble decode, audio;
+	gchar *buffer;
+	gint res;
+
+	entry = entry_for_path (medialib, path);
+	if (!entry) {
+		return NULL;
+	}
+
+	t0 = g_get_monotonic_time ();
+	xform = xmms_xform_chain_setup (medialib, entry, goals, FALSE);
+	t1 = g_get_monotonic_time ();
+
+	if (!xform) {
+		g_printerr ("Could not set up a chain for %s\n", path);
+		return NULL;
+	}
+
+	xmms_error_reset (&err);
+	buffer = g_malloc (DRAIN_SIZE);
+
+	do {
+		res = xmms_xform_this_read (xform, buffer, DRAIN_SIZE, &err);
+		if (res > 0) {
+			bytes += res;
+		}
+	} while (res > 0);
+
+	t2 = g_get_monotonic_time ();
+	g_free (buffer);
+
+	if (res < 0) {
+		g_printerr ("Error reading %s: %s\n", path, xmms_error_message_get (&err));
+	}
+
+	frame_size = xmms_sample_frame_size_get (xmms_xform_outtype_get (xform));
+	samplerate = xmms_xform_outtype_get_int (xform, XMMS_STREAM_TYPE_FMT_SAMPLERATE);
+
+	decode = (t2 - t1) / (gdouble) G_USEC_PER_SEC;
+	audio = (frame_size > 0 && samplerate > 0) ? bytes / frame_size / (gdouble) samplerate : 0.0;
+
+	stages = xmms_xform_chain_stats (xform);
+	stats_make_exclusive (stages);
+
+	{
+		xmmsv_list_iter_t *it;
+		xmmsv_t *stage;
+
+		xmmsv_get_list_iter (stages, &it);
+		while (xmmsv_list_iter_entry (it, &stage)) {
+			gint64 value;
+			xmmsv_dict_entry_get_int64 (stage, "copied", &value);
+			copied += value;
+			xmmsv_list_iter_next (it);
+		}
+	}
+
+	result = xmmsv_build_dict (XMMSV_DICT_ENTRY_STR ("file", path),
+	                           XMMSV_DICT_ENTRY_INT ("ok", res == 0),
+	                           XMMSV_DICT_ENTRY_INT ("setup_usec", t1 - t0),
+	                           XMMSV_DICT_ENTRY_INT ("decode_usec", t2 - t1),
+	                           XMMSV_DICT_ENTRY_INT ("bytes", bytes),
+	                           XMMSV_DICT_ENTRY_INT ("samples", frame_size > 0 ? bytes / frame_size : 0),
+	                           XMMSV_DICT_ENTRY ("samples_per_sec", xmmsv_new_float (decode > 0 ? (bytes / MAX (frame_size, 1)) / decode : 0)),
+	                           XMMSV_DICT_ENTRY ("realtime", xmmsv_new_float (decode > 0 ? audio / decode : 0)),
+	                           XMMSV_DICT_ENTRY_INT ("copied", copied),
+	                           XMMSV_DICT_ENTRY_INT ("peak_rss_kb", peak_rss ()),
+	                           XMMSV_DICT_ENTRY ("chain", stages),
+	                           XMMSV_DICT_END);
+
+	xmms_object_unref (xform);
+
+	return result;
+}
+
+static void
+print_json (xmmsv_t *value)
+{
+	switch (xmmsv_get_type (value)) {
+		case XMMSV_TYPE_INT64: {
+			gint64 i;
+			xmmsv_get_int64 (value, &i);
+			g_print ("%" G_GINT64_FORMAT, i);
+			break;
+		}
+		case XMMSV_TYPE_FLOAT: {
+			gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+			float f;
+			xmmsv_get_float (value, &f);
+			g_print ("%s", g_ascii_formatd (buf, sizeof (buf), "%.3f", f));
+			break;
+		}
+		case XMMSV_TYPE_STRING: {
+			const gchar *s;
+			gchar *escaped;
+			xmmsv_get_string (value, &s);
+			escaped = g_strescape (s, NULL);
+			g_print ("\"%s\"", escaped);
+			g_free (escaped);
+			break;
+		}
+		case XMMSV_TYPE_LIST: {
+			xmmsv_list_iter_t *it;
+			xmmsv_t *entry;
+			gboolean first = TRUE;
+
+			g_print ("[");
+			xmmsv_get_list_iter (value, &it);
+			while (xmmsv_list_iter_entry (it, &entry)) {
+				g_print (first ? "" : ", ");
+				print_json (entry);
+				first = FALSE;
+				xmmsv_list_iter_next (it);
+			}
+			g_print ("]");
+			break;
+		}
+		case XMMSV_TYPE_DICT: {
+			xmmsv_dict_iter_t *it;
+			xmmsv_t *entry;
+			const gchar *key;
+			gboolean first = TRUE;
+
+			g_print ("{");
+			xmmsv_get_dict_iter (value, &it);
+			while (xmmsv_dict_iter_pair (it, &key, &entry)) {
+				g_print (first ? "\"%s\": " : ", \"%s\": ", key);
+				print_json (entry);
+				first = FALSE;
+				xmmsv_dict_iter_next (it);
+			}
+			g_print ("}");
+			break;
+		}
+		default:
+			g_print ("null");
+			break;
+	}
+}
+
+static void
+print_pretty (xmmsv_t *files, xmmsv_t *totals)
+{
+	xmmsv_list_iter_t *lit;
+	xmmsv_dict_iter_t *dit;
+	xmmsv_t *value;
+	const gchar *key;
+
+	xmmsv_get_list_iter (files, &lit);
+	while (xmmsv_list_iter_entry (lit, &value)) {
+		gint64 setup, decode, copied, rss;
+		float speed, realtime;
+		const gchar *file;
+
+		xmmsv_dict_entry_get_string (value, "file", &file);
+		xmmsv_dict_entry_get_int64 (value, "setup_usec", &setup);
+		xmmsv_dict_entry_get_int64 (value, "decode_usec", &decode);
+		xmmsv_dict_entry_get_int64 (value, "copied", &copied);
+		xmmsv_dict_entry_get_int64 (value, "peak_rss_kb", &rss);
+		xmmsv_dict_entry_get_float (value, "samples_per_sec", &speed);
+		xmmsv_dict_entry_get_float (value, "realtime", &realtime);
+
+		g_print ("* %s\n", file);
+		g_print ("   - Chain setup: %.3fms\n", setup / 1000.0);
+		g_print ("   - Decode: %.3fms, %.0f samples/s, %.1fx realtime\n",
+		         decode / 1000.0, speed, realtime);
+		g_print ("   - Copied: %" G_GINT64_FORMAT " bytes, peak RSS %" G_GINT64_FORMAT " KiB\n",
+		         copied, rss);
+
+		xmmsv_list_iter_next (lit);
+	}
+
+	g_print ("Per plugin:\n");
+
+	xmmsv_get_dict_iter (totals, &dit);
+	while (xmmsv_dict_iter_pair (dit, &key, &value)) {
+		gint64 bytes, time;
+
+		xmmsv_dict_entry_get_int64 (value, "bytes", &bytes);
+		xmmsv_dict_entry_get_int64 (value, "time", &time);
+
+		g_print ("   - %-16s %12" G_GINT64_FORMAT " bytes in %10.3fms (%.1f MiB/s)\n",
+		         key, bytes, time / 1000.0,
+		         time > 0 ? (bytes / 1048576.0) / (time / (gdouble) G_USEC_PER_SEC) : 0.0);
+
+		xmmsv_dict_iter_next (dit);
+	}
+}
+
+static void
+parse_command_line (gint argc, gchar **argv, xmms_runner_args_t *args)
+{
+	GOptionContext *context;
+	const gchar *format = "pretty";
+	GError *error = NULL;
+
+	const GOptionEntry options[] = {
+		{
+			"format", 'f', 0,
+			G_OPTION_ARG_STRING, &format,
+			"'json' or 'pretty' (default).", "<format>"
+		},
+		{
+			"plugin-path", 'p', 0,
+			G_OPTION_ARG_FILENAME, &args->plugin_path,
+			"Load plugins from <path>.", "<path>"
+		},
+		{
+			"effect", 'e', 0,
+			G_OPTION_ARG_STRING_ARRAY, &args->effects,
+			"Add <effect> to the chain, may be repeated.", "<effect>"
+		},
+		{
+			"debug", 'd', 0,
+			G_OPTION_ARG_NONE, &args->debug,
+			"Enable debug logging.", NULL
+		},
+		{
+			G_OPTION_REMAINING, 0, 0,
+			G_OPTION_ARG_FILENAME_ARRAY, &args->paths,
+			NULL, "<file|directory>..."
+		},
+		{
+			NULL
+		}
+	};
+
+	context = g_option_context_new ("- Xform Chain Benchmark");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error) || !args->paths) {
+		gchar *helptext = g_option_context_get_help (context, TRUE, NULL);
+		g_print ("Option parsing failed: %s\n%s",
+		         error ? error->message : "no files given", helptext);
+		g_free (helptext);
+		exit (EXIT_FAILURE);
+	}
+
+	if (strcmp (format, "json") == 0) {
+		args->format = FORMAT_JSON;
+	} else {
+		args->format = FORMAT_PRETTY;
+	}
+
+	g_option_context_free (context);
+}
+
+
+/**
+ * Xform Chain Benchmark
+ * - set up the regular chain, with effects if asked, for every file
+ * - read it to the end without any realtime pacing
+ * - report setup time, throughput and copying per file and per plugin
+ */
+gint
+main (gint argc, gchar **argv)
+{
+	xmms_runner_args_t args = { 0 };
+	xmms_medialib_t *medialib;
+	xmms_xform_object_t *xform_object;
+	xmms_bindata_t *bindata;
+	xmmsv_t *files, *results, *totals, *result;
+	xmmsv_list_iter_t *it;
+	GList *goals;
+	gchar *bindir;
+	const gchar *path;
+	gint i, exit_code = EXIT_SUCCESS;
+
+	xmms_log_init (0);
+
+	parse_command_line (argc, argv, &args);
+
+	g_log_set_default_handler (simple_log_handler, (gpointer) &args);
+
+	xmms_ipc_init ();
+	xmms_config_init ("memory://");
+	xmms_config_property_register ("medialib.path", "memory://", NULL, NULL);
+
+	/* don't leave cover art and such in the user's bindata */
+	bindir = g_dir_make_tmp ("xform-runner-XXXXXX", NULL);
+	xmms_config_property_register ("bindata.path", bindir, NULL, NULL);
+
+	for (i = 0; args.effects && args.effects[i]; i++) {
+		gchar key[64];
+
+		g_snprintf (key, sizeof (key), "effect.order.%i", i);
+		xmms_config_property_register (key, args.effects[i], NULL, NULL);
+	}
+
+	if (!xmms_plugin_init (args.plugin_path)) {
+		g_printerr ("Could not load plugins\n");
+		exit (EXIT_FAILURE);
+	}
+
+	medialib = xmms_medialib_init ();
+	xform_object = xmms_xform_object_init ();
+	bindata = xmms_bindata_init ();
+
+	files = xmmsv_new_list ();
+	for (i = 0; args.paths[i]; i++) {
+		scan_path (args.paths[i], files);
+	}
+
+	goals = goal_formats_new ();
+	results = xmmsv_new_list ();
+	totals = xmmsv_new_dict ();
+
+	xmmsv_get_list_iter (files, &it);
+	while (xmmsv_list_iter_entry_string (it, &path)) {
+		result = run_file (medialib, goals, path);
+		if (result) {
+			xmmsv_t *stages;
+
+			xmmsv_dict_get (result, "chain", &stages);
+			stats_accumulate (totals, stages);
+
+			xmmsv_list_append (results, result);
+			xmmsv_unref (result);
+		} else {
+			exit_code = EXIT_FAILURE;
+		}
+		xmmsv_list_iter_next (it);
+	}
+
+	if (args.format == FORMAT_JSON) {
+		result = xmmsv_build_dict (XMMSV_DICT_ENTRY ("files", xmmsv_ref (results)),
+		                           XMMSV_DICT_ENTRY ("plugins", xmmsv_ref (totals)),
+		                           XMMSV_DICT_ENTRY_INT ("peak_rss_kb", peak_rss ()),
+		                           XMMSV_DICT_END);
+		print_json (result);
+		g_print ("\n");
+		xmmsv_unref (result);
+	} else {
+		print_pretty (results, totals);
+		g_print ("Peak RSS: %ld KiB\n", peak_rss ());
+	}
+
+	goal_formats_free (goals);
+	xmmsv_unref (results);
+	xmmsv_unref (totals);
+	xmmsv_unref (files);
+
+	xmms_object_unref (bindata);
+	xmms_object_unref (xform_object);
+	xmms_object_unref (medialib);
+	xmms_plugin_shutdown ();
+	xmms_config_shutdown ();
+	xmms_ipc_shutdown ();
+
+	g_rmdir (bindir);
+	g_free (bindir);
+	g_strfreev (args.effects);
+	g_strfreev (args.paths);
+
+	return exit_code;
+}
@@ -23,13 +23,20 @@
 #define ST_NE(x) #x
 #define ST(x) ST_NE(x)
 
-int xcu_pre_case (const char *name);
-void xcu_post_case (const char *name);
+/* the generated runner is C, C++ suites must match its linkage */
+#ifdef __cplusplus
+# define XCU_EXTERN extern "C"
+#else
+# define XCU_EXTERN
+#endif
+
+XCU_EXTERN int xcu_pre_case (const char *name);
+XCU_EXTERN void xcu_post_case (const char *name);
 
 
 #define CASE(name)							\
 	static void __testcase_##name (void);				\
-	void __testcase_wrapper_##name (void);			\
+	XCU_EXTERN void __testcase_wrapper_##name (void);		\
 	void __testcase_wrapper_##name (void) {			\
 		if (xcu_pre_case (ST (name))) {				\
 			__testsuite_setup ();					\
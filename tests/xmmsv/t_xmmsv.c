@@ -697,6 +697,86 @@ CASE (test_xmmsv_dict_values) {
 	xmmsv_unref (val);
 }
 
+CASE (test_xmmsv_dict_grow) {
+	xmmsv_dict_iter_t *it;
+	xmmsv_t *val;
+	char key[64];
+	int i, value, count;
+
+	val = xmmsv_new_dict ();
+
+	/* Fill up past the inline storage */
+	for (i = 0; i < 40; i++) {
+		snprintf (key, sizeof (key), (i % 4) ? "key%d" :
+		          "a key that is far too long to be shared between dicts %d", i);
+		CU_ASSERT_TRUE (xmmsv_dict_set_int (val, key, i));
+		CU_ASSERT_EQUAL (i + 1, xmmsv_dict_get_size (val));
+	}
+
+	for (i = 0; i < 40; i += 2) {
+		snprintf (key, sizeof (key), (i % 4) ? "key%d" :
+		          "a key that is far too long to be shared between dicts %d", i);
+		CU_ASSERT_TRUE (xmmsv_dict_remove (val, key));
+	}
+	CU_ASSERT_EQUAL (20, xmmsv_dict_get_size (val));
+
+	for (i = 0; i < 40; i++) {
+		snprintf (key, sizeof (key), (i % 4) ? "key%d" :
+		          "a key that is far too long to be shared between dicts %d", i);
+		if (i % 2) {
+			CU_ASSERT_TRUE (xmmsv_dict_entry_get_int (val, key, &value));
+			CU_ASSERT_EQUAL (i, value);
+		} else {
+			CU_ASSERT_FALSE (xmmsv_dict_entry_get_int (val, key, &value));
+		}
+	}
+
+	count = 0;
+	CU_ASSERT_TRUE (xmmsv_get_dict_iter (val, &it));
+	for (; xmmsv_dict_iter_valid (it); xmmsv_dict_iter_next (it)) {
+		count++;
+	}
+	CU_ASSERT_EQUAL (20, count);
+
+	CU_ASSERT_TRUE (xmmsv_dict_clear (val));
+	CU_ASSERT_EQUAL (0, xmmsv_dict_get_size (val));
+	CU_ASSERT_TRUE (xmmsv_dict_set_int (val, "key1", 1));
+	CU_ASSERT_EQUAL (1, xmmsv_dict_get_size (val));
+
+	xmmsv_unref (val);
+}
+
+static const char *
+first_dict_key (xmmsv_t *dict)
+{
+	xmmsv_dict_iter_t *it;
+	const char *key = NULL;
+
+	CU_ASSERT_TRUE (xmmsv_get_dict_iter (dict, &it));
+	CU_ASSERT_TRUE (xmmsv_dict_iter_pair (it, &key, NULL));
+
+	return key;
+}
+
+CASE (test_xmmsv_dict_interned_keys) {
+	xmmsv_t *first, *second;
+
+	/* known property names are shared between dicts */
+	first = xmmsv_build_dict (XMMSV_DICT_ENTRY_STR ("artist", "a"), XMMSV_DICT_END);
+	second = xmmsv_build_dict (XMMSV_DICT_ENTRY_STR ("artist", "b"), XMMSV_DICT_END);
+	CU_ASSERT_PTR_EQUAL (first_dict_key (first), first_dict_key (second));
+	xmmsv_unref (first);
+	xmmsv_unref (second);
+
+	/* anything else is copied per dict */
+	first = xmmsv_build_dict (XMMSV_DICT_ENTRY_STR ("unknown", "a"), XMMSV_DICT_END);
+	second = xmmsv_build_dict (XMMSV_DICT_ENTRY_STR ("unknown", "b"), XMMSV_DICT_END);
+	CU_ASSERT_PTR_NOT_EQUAL (first_dict_key (first), first_dict_key (second));
+	CU_ASSERT_STRING_EQUAL (first_dict_key (first), first_dict_key (second));
+	xmmsv_unref (first);
+	xmmsv_unref (second);
+}
+
 CASE (test_xmmsv_dict_format) {
 	xmmsv_t *val;
 	char *buf;
@@ -938,6 +1018,67 @@ CASE (test_xmmsv_type_bitbuffer)
 	xmmsv_unref (value);
 }
 
+CASE (test_xmmsv_type_bitbuffer_data)
+{
+	xmmsv_t *value;
+	unsigned char data[3000], b[3000];
+	int64_t r;
+	int i;
+
+	for (i = 0; i < sizeof (data); i++) {
+		data[i] = i * 7;
+	}
+
+	value = xmmsv_new_bitbuffer ();
+
+	/* aligned, growing the buffer several times over */
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_put_data (value, data, 1000));
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_put_data (value, data + 1000, 2000));
+	CU_ASSERT_EQUAL (3000 * 8, xmmsv_bitbuffer_len (value));
+	CU_ASSERT_EQUAL (3000 * 8, xmmsv_bitbuffer_pos (value));
+	CU_ASSERT_TRUE (memcmp (data, xmmsv_bitbuffer_buffer (value), 3000) == 0);
+
+	/* overwriting the middle doesn't cut off the rest */
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_goto (value, 8));
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_put_data (value, (unsigned char *) "ab", 2));
+	CU_ASSERT_EQUAL (3000 * 8, xmmsv_bitbuffer_len (value));
+	data[1] = 'a';
+	data[2] = 'b';
+
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_rewind (value));
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_get_data (value, b, 10));
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_get_data (value, b + 10, 2990));
+	CU_ASSERT_TRUE (memcmp (data, b, 3000) == 0);
+
+	/* reading past the end fails without moving */
+	CU_ASSERT_FALSE (xmmsv_bitbuffer_get_data (value, b, 1));
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_goto (value, 2999 * 8));
+	CU_ASSERT_FALSE (xmmsv_bitbuffer_get_data (value, b, 2));
+	CU_ASSERT_EQUAL (2999 * 8, xmmsv_bitbuffer_pos (value));
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_get_data (value, b, 1));
+	CU_ASSERT_EQUAL (data[2999], b[0]);
+
+	xmmsv_unref (value);
+
+	/* unaligned data goes bit by bit, and must end up the same */
+	value = xmmsv_new_bitbuffer ();
+
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_put_bits (value, 3, 5));
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_put_data (value, data, 100));
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_put_bits (value, 5, 17));
+	CU_ASSERT_EQUAL (101 * 8, xmmsv_bitbuffer_len (value));
+
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_rewind (value));
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_get_bits (value, 3, &r));
+	CU_ASSERT_EQUAL (5, r);
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_get_data (value, b, 100));
+	CU_ASSERT_TRUE (memcmp (data, b, 100) == 0);
+	CU_ASSERT_TRUE (xmmsv_bitbuffer_get_bits (value, 5, &r));
+	CU_ASSERT_EQUAL (17, r);
+
+	xmmsv_unref (value);
+}
+
 CASE (test_xmmsv_type_bitbuffer2)
 {
 	xmmsv_t *value;
@@ -1174,3 +1315,35 @@ CASE (test_xmmsv_deep_copy_collection)
 	xmmsv_unref (u);
 	xmmsv_unref (copy);
 }
+
+CASE (test_xmmsv_freeze)
+{
+	xmmsv_t *dict, *list, *copy, *bb;
+
+	list = xmmsv_build_list (XMMSV_LIST_ENTRY_INT (1), XMMSV_LIST_END);
+	dict = xmmsv_build_dict (XMMSV_DICT_ENTRY ("list", list), XMMSV_DICT_END);
+
+	CU_ASSERT_FALSE (xmmsv_is_frozen (dict));
+	CU_ASSERT_TRUE (xmmsv_freeze (dict));
+	CU_ASSERT_TRUE (xmmsv_is_frozen (dict));
+	CU_ASSERT_TRUE (xmmsv_is_frozen (list));
+
+	CU_ASSERT_FALSE (xmmsv_dict_set_int (dict, "foo", 42));
+	CU_ASSERT_FALSE (xmmsv_dict_remove (dict, "list"));
+	CU_ASSERT_FALSE (xmmsv_list_append_int (list, 2));
+	CU_ASSERT_FALSE (xmmsv_list_clear (list));
+	CU_ASSERT_EQUAL (1, xmmsv_list_get_size (list));
+
+	/* copies are mutable again */
+	copy = xmmsv_copy (dict);
+	CU_ASSERT_FALSE (xmmsv_is_frozen (copy));
+	CU_ASSERT_TRUE (xmmsv_dict_set_int (copy, "foo", 42));
+	xmmsv_unref (copy);
+
+	bb = xmmsv_new_bitbuffer ();
+	CU_ASSERT_FALSE (xmmsv_freeze (bb));
+	CU_ASSERT_FALSE (xmmsv_is_frozen (bb));
+	xmmsv_unref (bb);
+
+	xmmsv_unref (dict);
+}